@@ -14,7 +14,8 @@ then
     exit
 fi
 
-cmake -S . -B build -DBOARD=beagley_ai/j722s/mcu_r5f0_0
+# Extra arguments go to cmake, e.g. -DR5_SENSOR_OFFLOAD=ON
+cmake -S . -B build -DBOARD=beagley_ai/j722s/mcu_r5f0_0 "$@"
 cd build
 make
 cd ..
@@ -0,0 +1,32 @@
+#!/bin/bash
+
+# Builds the host R5 simulator (see sim_main.c) into R5/sim/build/r5_sim and the NeoPixel
+# waveform test (see wave_main.c) into R5/sim/build/neo_wave.
+# Uses the host gcc; needs no Zephyr install, board or R5.
+
+# Exit on error:
+set -e
+
+SIM_DIR="$(cd "$(dirname "$0")" && pwd)"
+R5_DIR="$SIM_DIR/.."
+APP_DIR="$R5_DIR/../app"
+HAL_DIR="$R5_DIR/../hal"
+
+mkdir -p "$SIM_DIR/build"
+gcc -std=gnu11 -O2 -g -Wall -Werror -Wpedantic -Wextra -pthread \
+    -DNEOPIXEL_PUBLISH_HOOK=sim_record_published \
+    -I"$SIM_DIR" -I"$R5_DIR/src" -I"$APP_DIR/include" -I"$HAL_DIR/include" \
+    "$SIM_DIR/sim_main.c" "$SIM_DIR/sim_zephyr.c" \
+    "$R5_DIR/src/frame_renderer.c" "$R5_DIR/src/neopixel_tx.c" \
+    "$APP_DIR/src/neopixel.c" "$APP_DIR/src/ledAnimation.c" "$APP_DIR/src/eventBus.c" \
+    "$APP_DIR/src/scheduler.c" "$APP_DIR/src/threadConfig.c" "$APP_DIR/src/sleep_and_timer.c" \
+    -lm -o "$SIM_DIR/build/r5_sim"
+
+gcc -std=gnu11 -O2 -g -Wall -Werror -Wpedantic -Wextra \
+    -I"$SIM_DIR" -I"$R5_DIR/src" \
+    "$SIM_DIR/wave_main.c" "$SIM_DIR/sim_zephyr.c" "$R5_DIR/src/neopixel_tx.c" \
+    -o "$SIM_DIR/build/neo_wave"
+
+echo "Built $SIM_DIR/build/r5_sim and $SIM_DIR/build/neo_wave"
+echo "Run: $SIM_DIR/build/r5_sim [seconds per scenario]"
+echo "Run: $SIM_DIR/build/neo_wave"
@@ -0,0 +1,439 @@
+// R5 Simulator
+//
+// Runs the Linux NeoPixel module (app/src/neopixel.c, with the event bus, scheduler and LED
+// animations) and the R5 frame renderer (R5/src/frame_renderer.c and neopixel_tx.c) in one
+// process on the host. The two sides share an emulated R5 memory instead of the BTCM, and
+// the NeoPixel pin is a recorder. neopixel.c is built with a hook that records every frame
+// under the sequence it is published with. After every render pass the frame the R5 latched
+// is checked against the one Linux published under that sequence, and the waveform is
+// decoded back into GRBW words and checked against it as well, bit timing included.
+//
+// Each scenario drives the Linux side through the event bus the way the app does and
+// reports frames published, latched, skipped and seen on the wire. The two sides run on
+// real threads, so the mailbox sees real races; the bit timing runs on the virtual counter
+// of sim_zephyr.c, so the waveform does not depend on host scheduling. The run fails on any
+// latched frame that differs from what Linux published and on any frame on the wire that is
+// not exact: wrong data, a bit outside the timing tolerance, or the wrong number of bits.
+//
+// Build with R5/sim/build_sim.sh, run as: r5_sim [seconds per scenario]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
+#include "sharedDataLayout.h"
+#include "frame_renderer.h"
+#include "neopixel_tx.h"
+#include "eventBus.h"
+#include "scheduler.h"
+#include "threadConfig.h"
+#include "neopixel.h"
+#include "r5Memory.h"
+#include "hal/led.h"
+#include "hal/GPS.h"
+
+#define SHARED_MEM_LENGTH 0x8000
+#define DEFAULT_SCENARIO_SEC 2
+#define BURST_FRAMES 1000
+
+// Wire checks, WS2812B datasheet limits
+#define ZERO_HIGH_NS 350
+#define ONE_HIGH_NS 700
+#define HIGH_TOLERANCE_NS 150
+#define LATCH_LOW_NS 5000           // A low this long ends the frame early
+#define MAX_TRANSITIONS (2 * FRAME_MAX_LEDS * NEO_CHANNELS * 8)
+#define R5_PRIORITY 49              // Above every Linux-side thread (see threadConfig.c)
+#define PUBLISHED_FRAMES 4096       // Published frames kept for the latch check; power of two
+
+// Emulated R5 memory, zeroed like the BTCM after a power cycle
+static uint8_t sharedMemory[SHARED_MEM_LENGTH] __attribute__((aligned(8)));
+
+static const struct gpio_dt_spec neopixel = {.name = "neopixel"};
+static pthread_t r5Thread;
+static atomic_bool r5Running = false;
+
+// Wire statistics, written by the R5 thread
+static atomic_ulong wireFrames = 0;
+static atomic_ulong wireMismatches = 0;    // Frames with clean timing but other data
+static atomic_ulong wireExact = 0;         // Frames with clean timing and the right data
+static atomic_ulong malformedFrames = 0;   // Wrong number of bits, or unpaired edges
+static atomic_ulong mistimedFrames = 0;    // Frames with a timing error or a gap
+static atomic_ulong timingErrors = 0;      // Bits with a high time outside the tolerance
+static atomic_ulong latchGaps = 0;         // Lows long enough to end the frame early
+static atomic_ulong transitionsDropped = 0;
+static atomic_ulong latchErrors = 0;       // Latched frames that differ from the published one
+
+// Frames as Linux published them, by sequence / 2
+struct publishedFrame {
+	uint32_t sequence;
+	uint32_t ledCount;
+	uint32_t leds[FRAME_MAX_LEDS];
+};
+
+static pthread_mutex_t publishedMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct publishedFrame published[PUBLISHED_FRAMES];
+
+struct counters {
+	uint32_t published;
+	uint32_t drawn;
+	uint32_t skipped;
+	unsigned long wire;
+	unsigned long mismatches;
+	unsigned long mistimed;
+	unsigned long latch;
+	unsigned long timing;
+	unsigned long gaps;
+};
+
+// Stand-ins for the Linux side: the shared memory and the hal modules neopixel.c uses
+// ----------------------------------------
+volatile void* getR5MmapAddr(void)
+{
+	return sharedMemory;
+}
+
+void freeR5MmapAddr(volatile void* pR5Base)
+{
+	(void)pR5Base;
+}
+
+LED leds[] = {
+	{.name = "ACT"},
+	{.name = "PWR"},
+};
+
+void Led_initialize(void)
+{
+}
+
+void Led_cleanUp(void)
+{
+}
+
+void Led_setTrigger(LED *led, const char *trigger)
+{
+	(void)led;
+	(void)trigger;
+}
+
+void Led_setBrightness(LED *led, int brightness)
+{
+	(void)led;
+	(void)brightness;
+}
+
+bool GPS_hasSignal(void)
+{
+	return true;
+}
+
+// NEOPIXEL_PUBLISH_HOOK: called by publish_frame() before the sequence goes even
+void sim_record_published(uint32_t sequence, const uint32_t *pFrame, int count)
+{
+	pthread_mutex_lock(&publishedMutex);
+	struct publishedFrame *pEntry = &published[(sequence / 2) % PUBLISHED_FRAMES];
+	pEntry->sequence = sequence;
+	pEntry->ledCount = count < FRAME_MAX_LEDS ? count : FRAME_MAX_LEDS;
+	for (uint32_t i = 0; i < pEntry->ledCount; i++) {
+		pEntry->leds[i] = pFrame[i];
+	}
+	pthread_mutex_unlock(&publishedMutex);
+}
+
+// The frame the R5 latched must be exactly the one Linux published under its sequence
+static bool check_latched(const uint32_t *pLeds, uint32_t ledCount, uint32_t sequence)
+{
+	if (sequence == 0) {
+		return true;	// All-off boot frame, nothing published yet
+	}
+	pthread_mutex_lock(&publishedMutex);
+	const struct publishedFrame *pEntry = &published[(sequence / 2) % PUBLISHED_FRAMES];
+	bool same = pEntry->sequence == sequence && pEntry->ledCount == ledCount;
+	for (uint32_t i = 0; same && i < ledCount; i++) {
+		same = pEntry->leds[i] == pLeds[i];
+	}
+	pthread_mutex_unlock(&publishedMutex);
+	return same;
+}
+
+// R5 side
+// ----------------------------------------
+
+// Checks the frame the R5 latched against the published one, then decodes the transitions
+// of what it sent and compares them with that frame
+static void check_wire(void)
+{
+	static struct gpio_transition transitions[MAX_TRANSITIONS];
+	uint32_t dropped = 0;
+	uint32_t count = sim_gpio_take_transitions(transitions, MAX_TRANSITIONS, &dropped);
+	if (dropped > 0) {
+		atomic_fetch_add(&transitionsDropped, dropped);
+	}
+	if (count == 0) {
+		return;
+	}
+
+	uint32_t ledCount = 0;
+	uint32_t sequence = 0;
+	const uint32_t *pSent = frame_renderer_last_sent(&ledCount, &sequence);
+	if (!check_latched(pSent, ledCount, sequence)) {
+		atomic_fetch_add(&latchErrors, 1);
+	}
+	const int bitsPerLed = NEO_CHANNELS * 8;
+	const uint32_t mask = NEO_CHANNELS == 4 ? 0xffffffff : 0xffffff00;
+	uint32_t bits = 0;
+	uint32_t word = 0;
+	bool match = true;
+	bool clean = true;
+	bool wellFormed = count % 2 == 0;
+	for (uint32_t i = 0; i + 1 < count; i += 2) {
+		if (transitions[i].value != 1 || transitions[i + 1].value != 0) {
+			wellFormed = false;
+			break;
+		}
+		uint32_t high = transitions[i + 1].cycles - transitions[i].cycles;
+		bool one = high > (ZERO_HIGH_NS + ONE_HIGH_NS) / 2;
+		int32_t error = (int32_t)high - (one ? ONE_HIGH_NS : ZERO_HIGH_NS);
+		if (error > HIGH_TOLERANCE_NS || error < -HIGH_TOLERANCE_NS) {
+			atomic_fetch_add(&timingErrors, 1);
+			clean = false;
+		}
+		if (i + 2 < count && transitions[i + 2].cycles - transitions[i + 1].cycles > LATCH_LOW_NS) {
+			atomic_fetch_add(&latchGaps, 1);
+			clean = false;
+		}
+
+		word |= (uint32_t)one << (31 - bits % bitsPerLed);
+		bits++;
+		if (bits % bitsPerLed == 0) {
+			uint32_t led = bits / bitsPerLed - 1;
+			if (led >= ledCount || word != (pSent[led] & mask)) {
+				match = false;
+			}
+			word = 0;
+		}
+	}
+	if (bits != ledCount * bitsPerLed) {
+		wellFormed = false;
+	}
+	atomic_fetch_add(&wireFrames, 1);
+	if (!wellFormed) {
+		atomic_fetch_add(&malformedFrames, 1);
+	} else if (!clean) {
+		atomic_fetch_add(&mistimedFrames, 1);
+	} else if (!match) {
+		atomic_fetch_add(&wireMismatches, 1);
+	} else {
+		atomic_fetch_add(&wireExact, 1);
+	}
+}
+
+static void *r5_main(void *arg)
+{
+	(void)arg;
+	neo_tx_init(&neopixel);
+	while (atomic_load(&r5Running)) {
+		frame_renderer_poll();
+		check_wire();
+		k_msleep(FRAME_POLL_MS);
+	}
+	return NULL;
+}
+
+// The R5 has a core to itself; the closest a host thread gets is the top real-time
+// priority, so it polls the mailbox on time the way the R5 would
+static void start_r5(void)
+{
+	pthread_attr_t attr;
+	struct sched_param param = {.sched_priority = R5_PRIORITY};
+	pthread_attr_init(&attr);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	pthread_attr_setschedparam(&attr, &param);
+	if (pthread_create(&r5Thread, &attr, r5_main, NULL) != 0) {
+		fprintf(stderr, "R5 thread runs without SCHED_FIFO; expect more skipped frames\n");
+		pthread_create(&r5Thread, NULL, r5_main, NULL);
+	}
+	pthread_attr_destroy(&attr);
+}
+
+// Scenarios
+// ----------------------------------------
+
+static void sleep_ms(long ms)
+{
+	struct timespec delay = {ms / 1000, (ms % 1000) * 1000000L};
+	nanosleep(&delay, NULL);
+}
+
+static void publish_speed(int color)
+{
+	struct Event event = {.topic = EVENT_SPEED_STATE};
+	event.speed.color = color;
+	EventBus_publish(&event);
+}
+
+static void publish_progress(bool active, double percent)
+{
+	struct Event event = {.topic = EVENT_PROGRESS};
+	event.progress.active = active;
+	event.progress.percent = percent;
+	EventBus_publish(&event);
+}
+
+static void publish_parking(bool active, int mode, int color)
+{
+	struct Event event = {.topic = EVENT_PARKING};
+	event.parking.active = active;
+	event.parking.mode = mode;
+	event.parking.color = color;
+	EventBus_publish(&event);
+}
+
+static struct counters read_counters(void)
+{
+	struct counters c;
+	c.published = MEM_UINT32(sharedMemory + SEQUENCE_OFFSET) / 2;
+	c.drawn = MEM_UINT32(sharedMemory + R5_FRAMES_OFFSET);
+	c.skipped = MEM_UINT32(sharedMemory + R5_SKIPPED_OFFSET);
+	c.wire = atomic_load(&wireFrames);
+	c.mismatches = atomic_load(&wireMismatches);
+	c.mistimed = atomic_load(&mistimedFrames);
+	c.latch = atomic_load(&latchErrors);
+	c.timing = atomic_load(&timingErrors);
+	c.gaps = atomic_load(&latchGaps);
+	return c;
+}
+
+static void report(const char *name, const struct counters *pBefore, double seconds)
+{
+	// Let the R5 catch up with the last frame before counting
+	sleep_ms(4 * FRAME_POLL_MS);
+	struct counters after = read_counters();
+	uint32_t drawn = after.drawn - pBefore->drawn;
+	printf("%-10s %9u %7u %7u %7lu %9lu %10lu %5lu %7lu %5lu %8.1f\n",
+	       name, after.published - pBefore->published, drawn, after.skipped - pBefore->skipped,
+	       after.wire - pBefore->wire, after.mistimed - pBefore->mistimed,
+	       after.mismatches - pBefore->mismatches, after.latch - pBefore->latch,
+	       after.timing - pBefore->timing, after.gaps - pBefore->gaps, drawn / seconds);
+}
+
+// Navigation: the progress bar fills in 1% steps
+static void scenario_progress(int seconds)
+{
+	struct counters before = read_counters();
+	publish_parking(false, 0, 2);
+	publish_speed(2);
+	for (int percent = 0; percent <= 100; percent++) {
+		publish_progress(true, percent);
+		sleep_ms(seconds * 1000L / 100);
+	}
+	report("progress", &before, seconds);
+}
+
+// Speeding: the pulse animation renders from the scheduler at its frame rate
+static void scenario_speeding(int seconds)
+{
+	struct counters before = read_counters();
+	publish_progress(true, 60);
+	publish_speed(0);
+	sleep_ms(seconds * 1000L);
+	report("speeding", &before, seconds);
+}
+
+// Handbrake reminder chaser
+static void scenario_chaser(int seconds)
+{
+	struct counters before = read_counters();
+	publish_speed(2);
+	publish_progress(false, 0);
+	publish_parking(true, 1, 2);
+	sleep_ms(seconds * 1000L);
+	report("chaser", &before, seconds);
+}
+
+// Back-to-back state changes, far faster than the R5 polls: most frames are replaced
+// before they are latched, and the newest one must still reach the wire intact
+static void scenario_burst(void)
+{
+	struct timespec start;
+	struct timespec end;
+	struct counters before = read_counters();
+	publish_parking(false, 0, 2);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int i = 0; i < BURST_FRAMES; i++) {
+		publish_progress(true, (i % 2) ? 10 : 90);
+		if (i % 64 == 63) {
+			sleep_ms(1);    // Leave the bus queue room
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+	report("burst", &before, seconds);
+}
+
+int main(int argc, char *argv[])
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : DEFAULT_SCENARIO_SEC;
+	if (seconds <= 0) {
+		fprintf(stderr, "Usage: %s [seconds per scenario]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	frame_renderer_init(sharedMemory);
+	atomic_store(&r5Running, true);
+	start_r5();
+
+	ThreadConfig_init();
+	EventBus_init();
+	Scheduler_init();
+	NeoPixel_init();
+
+	printf("%-10s %9s %7s %7s %7s %9s %10s %5s %7s %5s %8s\n", "scenario", "published", "drawn",
+	       "skipped", "on-wire", "mistimed", "mismatches", "latch", "timing", "gaps", "drawn/s");
+	scenario_progress(seconds);
+	scenario_speeding(seconds);
+	scenario_chaser(seconds);
+	scenario_burst();
+
+	Scheduler_cleanup();
+	EventBus_cleanup();
+	NeoPixel_cleanUp();
+	sleep_ms(4 * FRAME_POLL_MS);
+	atomic_store(&r5Running, false);
+	pthread_join(r5Thread, NULL);
+	ThreadConfig_cleanup();
+
+	unsigned long exact = atomic_load(&wireExact);
+	unsigned long malformed = atomic_load(&malformedFrames);
+	unsigned long mismatched = atomic_load(&wireMismatches);
+	unsigned long latch = atomic_load(&latchErrors);
+	unsigned long mistimed = atomic_load(&mistimedFrames);
+	printf("Wire: %lu frames checked: %lu exact, %lu mismatched, %lu mistimed, %lu malformed; "
+	       "%lu latched frames not as published; %lu timing errors, %lu latch gaps, "
+	       "%lu transitions dropped\n",
+	       atomic_load(&wireFrames), exact, mismatched, mistimed, malformed, latch,
+	       atomic_load(&timingErrors), atomic_load(&latchGaps), atomic_load(&transitionsDropped));
+	const char *pFailure = NULL;
+	if (latch > 0) {
+		pFailure = "the R5 latched frames Linux did not publish";
+	} else if (malformed > 0) {
+		pFailure = "malformed frames on the wire";
+	} else if (mismatched > 0) {
+		pFailure = "frames with clean timing but wrong data";
+	} else if (mistimed > 0) {
+		pFailure = "bits outside the WS2812B timing";
+	} else if (exact == 0) {
+		pFailure = "no frame came out exact";
+	}
+	if (pFailure != NULL) {
+		printf("FAIL: %s\n", pFailure);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,116 @@
+// Host implementation of the Zephyr stand-ins in sim/zephyr: CLOCK_MONOTONIC for uptime and
+// sleeps, a virtual cycle counter, and a GPIO that records its transitions for the waveform
+// checkers in sim_main.c and wave_main.c.
+//
+// The cycle counter is virtual: every read advances it by COUNTER_READ_NS and every GPIO
+// write by GPIO_WRITE_NS, roughly what they cost on the R5. The transmitter's spin loops
+// then produce the same waveform however the host schedules the thread, so a wrong bit on
+// the wire is always a bug and never a preempted host thread.
+
+#include <time.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
+
+#define NS_PER_SEC 1000000000LL
+#define MAX_TRANSITIONS 65536       // Two per bit: enough for a full FRAME_MAX_LEDS frame
+#define COUNTER_READ_NS 10
+#define GPIO_WRITE_NS 40
+
+static struct gpio_transition transitions[MAX_TRANSITIONS];
+static uint32_t transitionCount = 0;
+static uint32_t transitionsDropped = 0;
+static int pinLevel = 0;
+static uint32_t virtualCycles = 0;          // Only the R5 thread reads the counter
+
+static int64_t now_ns(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * NS_PER_SEC + now.tv_nsec;
+}
+
+static int64_t boot_ns(void)
+{
+	static int64_t boot = 0;
+	if (boot == 0) {
+		boot = now_ns();
+	}
+	return boot;
+}
+
+uint32_t k_cycle_get_32(void)
+{
+	virtualCycles += COUNTER_READ_NS;
+	return virtualCycles;
+}
+
+void sim_set_cycles(uint32_t cycles)
+{
+	virtualCycles = cycles;
+}
+
+uint32_t sys_clock_hw_cycles_per_sec(void)
+{
+	return (uint32_t)NS_PER_SEC;
+}
+
+uint32_t k_ns_to_cyc_near32(uint32_t ns)
+{
+	return ns;
+}
+
+void k_busy_wait(uint32_t usec)
+{
+	int64_t end = now_ns() + usec * 1000LL;
+	while (now_ns() < end) {
+	}
+}
+
+int64_t k_uptime_get(void)
+{
+	return (now_ns() - boot_ns()) / 1000000;
+}
+
+uint32_t k_uptime_get_32(void)
+{
+	return (uint32_t)k_uptime_get();
+}
+
+int32_t k_msleep(int32_t ms)
+{
+	struct timespec delay = {ms / 1000, (ms % 1000) * 1000000L};
+	nanosleep(&delay, NULL);
+	return 0;
+}
+
+int gpio_pin_set_dt(const struct gpio_dt_spec *spec, int value)
+{
+	(void)spec;
+	virtualCycles += GPIO_WRITE_NS;
+	uint32_t cycles = virtualCycles;
+	value = value ? 1 : 0;
+	if (value == pinLevel) {
+		return 0;
+	}
+	pinLevel = value;
+	if (transitionCount < MAX_TRANSITIONS) {
+		transitions[transitionCount].cycles = cycles;
+		transitions[transitionCount].value = value;
+		transitionCount++;
+	} else {
+		transitionsDropped++;
+	}
+	return 0;
+}
+
+uint32_t sim_gpio_take_transitions(struct gpio_transition *pOut, uint32_t max, uint32_t *pDropped)
+{
+	uint32_t count = transitionCount < max ? transitionCount : max;
+	for (uint32_t i = 0; i < count; i++) {
+		pOut[i] = transitions[i];
+	}
+	*pDropped = transitionsDropped + (transitionCount - count);
+	transitionCount = 0;
+	transitionsDropped = 0;
+	return count;
+}
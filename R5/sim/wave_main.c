@@ -0,0 +1,147 @@
+// NeoPixel Waveform Test
+//
+// Drives R5/src/neopixel_tx.c alone on the virtual cycle counter of sim_zephyr.c and checks
+// the recorded waveform bit by bit: the high time of every 0 and 1, the period from one
+// rising edge to the next, and that the bits decode back to the words sent. Each pattern is
+// sent once from a low counter value and once starting just before the 32-bit counter
+// wraps, so a deadline compare that is not wrap-safe shows up as a broken bit. Prints the
+// measured ranges and fails on any bit outside the tolerance.
+//
+// Build with R5/sim/build_sim.sh, run as: neo_wave
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
+#include "neopixel_tx.h"
+
+#define TEST_LEDS 64
+#define ZERO_HIGH_NS 350
+#define ONE_HIGH_NS 700
+#define BIT_NS 1250
+#define HIGH_TOLERANCE_NS 150       // WS2812B datasheet
+#define PERIOD_TOLERANCE_NS 150     // Tighter than the datasheet's 600: the bit grid is fixed
+#define MAX_TRANSITIONS (2 * TEST_LEDS * NEO_CHANNELS * 8)
+#define BELOW_WRAP_NS (TEST_LEDS * NEO_CHANNELS * 8 * BIT_NS / 2)
+
+struct range {
+	uint32_t min;
+	uint32_t max;
+};
+
+static const struct gpio_dt_spec neopixel = {.name = "neopixel"};
+static struct gpio_transition transitions[MAX_TRANSITIONS];
+static struct range zeroHigh = {UINT32_MAX, 0};
+static struct range oneHigh = {UINT32_MAX, 0};
+static struct range period = {UINT32_MAX, 0};
+
+static void update(struct range *pRange, uint32_t value)
+{
+	if (value < pRange->min) {
+		pRange->min = value;
+	}
+	if (value > pRange->max) {
+		pRange->max = value;
+	}
+}
+
+static bool within(uint32_t value, uint32_t target, uint32_t tolerance)
+{
+	int32_t error = (int32_t)value - (int32_t)target;
+	return error <= (int32_t)tolerance && error >= -(int32_t)tolerance;
+}
+
+// Sends leds starting at counter value start; returns the number of bad bits
+static int send_and_check(const char *pName, const uint32_t *pLeds, uint32_t start)
+{
+	const int bitsPerLed = NEO_CHANNELS * 8;
+	const uint32_t mask = NEO_CHANNELS == 4 ? 0xffffffff : 0xffffff00;
+	uint32_t dropped = 0;
+
+	sim_gpio_take_transitions(transitions, MAX_TRANSITIONS, &dropped);
+	sim_set_cycles(start);
+	neo_tx_send(pLeds, TEST_LEDS);
+	uint32_t count = sim_gpio_take_transitions(transitions, MAX_TRANSITIONS, &dropped);
+
+	int errors = 0;
+	if (dropped > 0 || count != MAX_TRANSITIONS) {
+		printf("%-12s start 0x%08x: %u edges, expected %u\n", pName, start, count, MAX_TRANSITIONS);
+		return 1;
+	}
+	uint32_t word = 0;
+	for (uint32_t i = 0; i < count; i += 2) {
+		uint32_t bit = i / 2;
+		if (transitions[i].value != 1 || transitions[i + 1].value != 0) {
+			printf("%-12s start 0x%08x: bit %u has unpaired edges\n", pName, start, bit);
+			return errors + 1;
+		}
+		bool one = (pLeds[bit / bitsPerLed] >> (31 - bit % bitsPerLed)) & 1;
+		uint32_t high = transitions[i + 1].cycles - transitions[i].cycles;
+		update(one ? &oneHigh : &zeroHigh, high);
+		if (!within(high, one ? ONE_HIGH_NS : ZERO_HIGH_NS, HIGH_TOLERANCE_NS)) {
+			printf("%-12s start 0x%08x: bit %u high %u ns\n", pName, start, bit, high);
+			errors++;
+		}
+		if (i + 2 < count) {
+			uint32_t length = transitions[i + 2].cycles - transitions[i].cycles;
+			update(&period, length);
+			if (!within(length, BIT_NS, PERIOD_TOLERANCE_NS)) {
+				printf("%-12s start 0x%08x: bit %u period %u ns\n", pName, start, bit, length);
+				errors++;
+			}
+		}
+		word |= (uint32_t)(high > (ZERO_HIGH_NS + ONE_HIGH_NS) / 2) << (31 - bit % bitsPerLed);
+		if ((bit + 1) % bitsPerLed == 0) {
+			uint32_t led = bit / bitsPerLed;
+			if (word != (pLeds[led] & mask)) {
+				printf("%-12s start 0x%08x: LED %u decoded 0x%08x, sent 0x%08x\n",
+				       pName, start, led, word, pLeds[led] & mask);
+				errors++;
+			}
+			word = 0;
+		}
+	}
+	return errors;
+}
+
+int main(void)
+{
+	static uint32_t zeros[TEST_LEDS];
+	static uint32_t ones[TEST_LEDS];
+	static uint32_t alternate[TEST_LEDS];
+	static uint32_t mixed[TEST_LEDS];
+	uint32_t seed = 0x12345678;
+	for (int i = 0; i < TEST_LEDS; i++) {
+		zeros[i] = 0;
+		ones[i] = 0xffffffff;
+		alternate[i] = 0xaaaaaaaa;
+		seed = seed * 1664525 + 1013904223;
+		mixed[i] = seed;
+	}
+	const struct {
+		const char *pName;
+		const uint32_t *pLeds;
+	} patterns[] = {
+		{"zeros", zeros}, {"ones", ones}, {"alternating", alternate}, {"random", mixed},
+	};
+	const uint32_t starts[] = {0x1000, (uint32_t)0 - BELOW_WRAP_NS};
+
+	neo_tx_init(&neopixel);
+	int errors = 0;
+	for (size_t p = 0; p < sizeof(patterns) / sizeof(patterns[0]); p++) {
+		for (size_t s = 0; s < sizeof(starts) / sizeof(starts[0]); s++) {
+			errors += send_and_check(patterns[p].pName, patterns[p].pLeds, starts[s]);
+		}
+	}
+
+	printf("T0H %u-%u ns, T1H %u-%u ns, bit period %u-%u ns (%d LEDs x %d bits, counter wrap included)\n",
+	       zeroHigh.min, zeroHigh.max, oneHigh.min, oneHigh.max, period.min, period.max,
+	       TEST_LEDS, NEO_CHANNELS * 8);
+	if (errors > 0) {
+		printf("FAIL: %d bits outside the WS2812B timing or decoded wrong\n", errors);
+		return EXIT_FAILURE;
+	}
+	printf("PASS\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,25 @@
+// Host stand-in for the Zephyr GPIO API: pins are recorded, not driven (see sim_zephyr.c)
+
+#ifndef _SIM_ZEPHYR_GPIO_H_
+#define _SIM_ZEPHYR_GPIO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct gpio_dt_spec {
+	const char *name;
+};
+
+// Every change of the pin level, stamped with k_cycle_get_32()
+struct gpio_transition {
+	uint32_t cycles;
+	int value;
+};
+
+int gpio_pin_set_dt(const struct gpio_dt_spec *spec, int value);
+
+// Copies up to max transitions recorded since the last call into pOut; returns how many.
+// Transitions beyond max are dropped and counted in *pDropped.
+uint32_t sim_gpio_take_transitions(struct gpio_transition *pOut, uint32_t max, uint32_t *pDropped);
+
+#endif
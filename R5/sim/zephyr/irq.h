@@ -0,0 +1,16 @@
+// Host stand-in for Zephyr interrupt locking; the simulator has no interrupts to mask
+
+#ifndef _SIM_ZEPHYR_IRQ_H_
+#define _SIM_ZEPHYR_IRQ_H_
+
+static inline unsigned int irq_lock(void)
+{
+	return 0;
+}
+
+static inline void irq_unlock(unsigned int key)
+{
+	(void)key;
+}
+
+#endif
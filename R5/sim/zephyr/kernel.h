@@ -0,0 +1,20 @@
+// Host stand-in for the parts of the Zephyr kernel API the R5 renderer uses (see sim_zephyr.c)
+
+#ifndef _SIM_ZEPHYR_KERNEL_H_
+#define _SIM_ZEPHYR_KERNEL_H_
+
+#include <stdint.h>
+
+// The cycle counter counts virtual nanoseconds (1 GHz) and wraps like a 32-bit counter
+uint32_t k_cycle_get_32(void);
+uint32_t sys_clock_hw_cycles_per_sec(void);
+uint32_t k_ns_to_cyc_near32(uint32_t ns);
+void k_busy_wait(uint32_t usec);
+int64_t k_uptime_get(void);
+uint32_t k_uptime_get_32(void);
+int32_t k_msleep(int32_t ms);
+
+// Simulator only: moves the cycle counter, e.g. to just before it wraps
+void sim_set_cycles(uint32_t cycles);
+
+#endif
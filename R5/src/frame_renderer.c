@@ -0,0 +1,144 @@
+// Frame Renderer
+//
+// Latches the frames Linux composes (see sharedDataLayout.h) onto the NeoPixel strip; every
+// visualization lives on the Linux side.
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+#include "sharedDataLayout.h"
+#include "neopixel_tx.h"
+#include "frame_renderer.h"
+
+#define NEO_NUM_LEDS          8   // # LEDs until Linux sends a frame; then its LED count
+#define NEO_REFRESH_MS     1000   // Resend an unchanged frame this often
+
+static volatile uint8_t *pR5Base = NULL;
+
+// Telemetry counters; the shared words are only ever stored from these
+static uint32_t heartbeat = 0;
+static uint32_t framesDrawn = 0;
+static uint32_t framesSkipped = 0;
+static uint32_t renderMaxCycles = 0;
+static uint32_t readRetries = 0;
+
+// Local copy of one consistent mailbox frame (R5 RAM, not the shared memory)
+struct frame {
+	uint32_t sequence;
+	uint32_t ledCount;
+	uint32_t leds[FRAME_MAX_LEDS];
+};
+
+static struct frame current;
+static struct frame next;
+static bool haveFrame = false;
+static int64_t lastDraw = 0;
+
+// Copies the frame Linux last finished writing. Returns false if the mailbox is not set
+// up yet or Linux kept switching buffers during every attempt; the caller keeps its old
+// frame then.
+static bool read_frame(struct frame *pFrame)
+{
+	if (MEM_UINT32(pR5Base + MAGIC_OFFSET) != MAILBOX_MAGIC) {
+		return false;
+	}
+	if (MEM_UINT32(pR5Base + VERSION_OFFSET) != MAILBOX_VERSION) {
+		MEM_UINT32(pR5Base + R5_ERROR_OFFSET) = R5_ERROR_VERSION;
+		return false;
+	}
+	MEM_UINT32(pR5Base + R5_ERROR_OFFSET) = R5_ERROR_NONE;
+	for (int attempt = 0; attempt < 4; attempt++) {
+		if (attempt > 0) {
+			MEM_UINT32(pR5Base + R5_READ_RETRIES_OFFSET) = ++readRetries;
+		}
+		uint32_t before = MEM_UINT32(pR5Base + SEQUENCE_OFFSET);
+		if (before & 1) {
+			continue;	// Linux is switching buffers
+		}
+		MEM_BARRIER();
+		uint32_t buffer = MEM_UINT32(pR5Base + FRONT_OFFSET) & 1;
+		pFrame->ledCount = MEM_UINT32(pR5Base + LED_COUNT_OFFSET);
+		if (pFrame->ledCount > FRAME_MAX_LEDS) {
+			pFrame->ledCount = FRAME_MAX_LEDS;
+		}
+		for (uint32_t i = 0; i < pFrame->ledCount; i++) {
+			pFrame->leds[i] = MEM_UINT32(pR5Base + FRAME_OFFSET(buffer) + i * sizeof(uint32_t));
+		}
+		MEM_BARRIER();
+		if (MEM_UINT32(pR5Base + SEQUENCE_OFFSET) == before) {
+			pFrame->sequence = before;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void show_frame(const struct frame *pFrame)
+{
+	uint32_t start = k_cycle_get_32();
+	neo_tx_send(pFrame->leds, pFrame->ledCount);
+	uint32_t cycles = k_cycle_get_32() - start;
+	MEM_UINT32(pR5Base + R5_RENDER_CYCLES_OFFSET) = cycles;
+	if (cycles > renderMaxCycles) {
+		renderMaxCycles = cycles;
+		MEM_UINT32(pR5Base + R5_RENDER_MAX_CYCLES_OFFSET) = cycles;
+	}
+}
+
+// The R5 owns the telemetry block and the sensor ring; start them from zero on every boot
+void frame_renderer_init(volatile uint8_t *pBase)
+{
+	pR5Base = pBase;
+	for (uint32_t offset = R5_HEARTBEAT_OFFSET; offset < SENSOR_CONTROL_OFFSET; offset += sizeof(uint32_t)) {
+		MEM_UINT32(pR5Base + offset) = 0;
+	}
+	MEM_UINT32(pR5Base + R5_CYCLE_HZ_OFFSET) = sys_clock_hw_cycles_per_sec();
+
+	// All off until Linux has published a frame
+	heartbeat = 0;
+	framesDrawn = 0;
+	framesSkipped = 0;
+	renderMaxCycles = 0;
+	readRetries = 0;
+	current.sequence = 0;
+	current.ledCount = NEO_NUM_LEDS;
+	for (int i = 0; i < NEO_NUM_LEDS; i++) {
+		current.leds[i] = 0;
+	}
+	haveFrame = false;
+	lastDraw = 0;
+}
+
+void frame_renderer_poll(void)
+{
+	bool fresh = read_frame(&next) && (!haveFrame || next.sequence != current.sequence);
+	if (fresh) {
+		// Linux adds 2 per frame, so a larger step means frames were replaced unseen
+		if (haveFrame && next.sequence - current.sequence > 2) {
+			framesSkipped += (next.sequence - current.sequence) / 2 - 1;
+			MEM_UINT32(pR5Base + R5_SKIPPED_OFFSET) = framesSkipped;
+		}
+		current = next;
+		haveFrame = true;
+		MEM_UINT32(pR5Base + R5_FRAMES_OFFSET) = ++framesDrawn;
+	}
+
+	// A frame is only sent again when it changed, plus once a second in case the
+	// NeoPixel strip was plugged in later
+	int64_t now = k_uptime_get();
+	if (fresh || now - lastDraw >= NEO_REFRESH_MS) {
+		show_frame(&current);
+		lastDraw = now;
+		if (fresh) {
+			MEM_UINT32(pR5Base + ACK_OFFSET) = current.sequence;
+		}
+	}
+	MEM_UINT32(pR5Base + R5_HEARTBEAT_OFFSET) = ++heartbeat;
+}
+
+const uint32_t *frame_renderer_last_sent(uint32_t *pCount, uint32_t *pSequence)
+{
+	*pCount = current.ledCount;
+	*pSequence = current.sequence;
+	return current.leds;
+}
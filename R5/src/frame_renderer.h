@@ -0,0 +1,26 @@
+// Frame Renderer
+//
+// The R5 side of the mailbox in sharedDataLayout.h: copies the frame Linux last published,
+// sends it with neo_tx_send() and keeps the telemetry block up to date. It only uses the
+// shared memory, the kernel clock and the transmitter, so the host simulator (R5/sim) runs
+// the same code against an emulated shared memory and GPIO.
+
+#ifndef _FRAME_RENDERER_H_
+#define _FRAME_RENDERER_H_
+
+#include <stdint.h>
+
+#define FRAME_POLL_MS         5   // Latch new frames at up to 200 fps
+
+// Zeroes the telemetry block of the shared memory at pBase and starts with all LEDs off
+void frame_renderer_init(volatile uint8_t *pBase);
+
+// One pass of the render loop: latches a new frame, or resends the current one once a
+// second, and beats the heartbeat. Call every FRAME_POLL_MS.
+void frame_renderer_poll(void);
+
+// Frame most recently sent to the strip; *pCount gets its LED count and *pSequence the
+// mailbox sequence it was latched under (0 for the all-off frame before the first one)
+const uint32_t *frame_renderer_last_sent(uint32_t *pCount, uint32_t *pSequence);
+
+#endif
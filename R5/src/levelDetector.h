@@ -0,0 +1,54 @@
+#ifndef _LEVEL_DETECTOR_H_
+#define _LEVEL_DETECTOR_H_
+
+// Flat-surface check for the parking level mode, used by Linux (parking.c) and, when the
+// sensors are offloaded, by the R5 sampler; keep the app/include and R5/src copies identical.
+// - Input is acceleration in g; the car is level when x and y are near 0 and z near 1.
+// - Output color: 0 red (too steep), 1 yellow (decent), 2 green (flat).
+// - Every band has separate enter and exit thresholds, so the color does not flicker
+//   around a boundary.
+
+#define LEVEL_COLOR_BAD 0
+#define LEVEL_COLOR_DECENT 1
+#define LEVEL_COLOR_GOOD 2
+
+// Hysteresis thresholds
+#define LEVEL_BAD_ENTER_XY 0.15f
+#define LEVEL_BAD_EXIT_XY 0.12f
+#define LEVEL_BAD_ENTER_Z_LOW 0.95f
+#define LEVEL_BAD_EXIT_Z_LOW 0.98f
+#define LEVEL_BAD_ENTER_Z_HIGH 1.05f
+#define LEVEL_BAD_EXIT_Z_HIGH 1.02f
+#define LEVEL_DECENT_ENTER_XY 0.07f
+#define LEVEL_DECENT_EXIT_XY 0.05f
+
+static inline float level_abs(float value)
+{
+    return value < 0 ? -value : value;
+}
+
+// Next color from the previous one and a new sample
+static inline int level_update(int prevColor, float x, float y, float z)
+{
+    float ax = level_abs(x);
+    float ay = level_abs(y);
+    int bad = ax > LEVEL_BAD_ENTER_XY || ay > LEVEL_BAD_ENTER_XY ||
+              z < LEVEL_BAD_ENTER_Z_LOW || z > LEVEL_BAD_ENTER_Z_HIGH;
+    int bad_exit = ax < LEVEL_BAD_EXIT_XY && ay < LEVEL_BAD_EXIT_XY &&
+                   z > LEVEL_BAD_EXIT_Z_LOW && z < LEVEL_BAD_EXIT_Z_HIGH;
+    int decent = !bad && (ax > LEVEL_DECENT_ENTER_XY || ay > LEVEL_DECENT_ENTER_XY);
+    int decent_exit = ax < LEVEL_DECENT_EXIT_XY && ay < LEVEL_DECENT_EXIT_XY;
+
+    if (prevColor == LEVEL_COLOR_BAD && bad_exit) {
+        return LEVEL_COLOR_DECENT;  // Move to yellow if exiting bad range
+    } else if (bad) {
+        return LEVEL_COLOR_BAD;     // Stay in red
+    } else if (prevColor == LEVEL_COLOR_DECENT && decent_exit) {
+        return LEVEL_COLOR_GOOD;    // Move to green if exiting decent range
+    } else if (decent) {
+        return LEVEL_COLOR_DECENT;  // Stay in yellow
+    }
+    return LEVEL_COLOR_GOOD;        // Default to green
+}
+
+#endif
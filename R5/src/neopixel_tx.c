@@ -0,0 +1,77 @@
+// NeoPixel Transmitter
+//
+// Every bit starts on a fixed 1.25 us grid measured in counter cycles and is high for the
+// short or the long time, so timing errors never add up along the strip. Interrupts are off
+// while a frame goes out: a tick in the middle of a bit could stretch the low time past the
+// ~5 us the LEDs take as the end of the frame.
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+#include <zephyr/irq.h>
+#include "neopixel_tx.h"
+
+// NeoPixel Timing (what the hardware needs)
+#define NEO_ONE_ON_NS       700   // High time of a 1
+#define NEO_ZERO_ON_NS      350   // High time of a 0
+#define NEO_BIT_NS         1250   // One bit, high plus low
+#define NEO_RESET_US         60   // Must be at least 50us, use 60us
+#define NEO_CALIBRATION_WRITES 64
+
+static const struct gpio_dt_spec *pNeopixel = NULL;
+static uint32_t oneOnCycles;
+static uint32_t zeroOnCycles;
+static uint32_t bitCycles;
+
+// Counter-wrap safe wait for an absolute cycle count
+static inline void wait_until(uint32_t deadline)
+{
+	while ((int32_t)(k_cycle_get_32() - deadline) < 0) {
+	}
+}
+
+void neo_tx_init(const struct gpio_dt_spec *pPin)
+{
+	pNeopixel = pPin;
+	oneOnCycles = k_ns_to_cyc_near32(NEO_ONE_ON_NS);
+	zeroOnCycles = k_ns_to_cyc_near32(NEO_ZERO_ON_NS);
+	bitCycles = k_ns_to_cyc_near32(NEO_BIT_NS);
+
+	// A pulse is at least as long as the GPIO write that starts it
+	uint32_t start = k_cycle_get_32();
+	for (int i = 0; i < NEO_CALIBRATION_WRITES; i++) {
+		gpio_pin_set_dt(pNeopixel, 0);
+	}
+	uint32_t writeCycles = (k_cycle_get_32() - start) / NEO_CALIBRATION_WRITES;
+	uint32_t hz = sys_clock_hw_cycles_per_sec();
+
+	printf("NeoPixel: %u Hz counter, bit %u cycles, 0/1 high %u/%u cycles, GPIO write %u cycles\n",
+			hz, bitCycles, zeroOnCycles, oneOnCycles, writeCycles);
+	if (writeCycles >= zeroOnCycles) {
+		printf("NeoPixel: WARNING GPIO write is longer than a 0 pulse; 0 bits will read as 1\n");
+	}
+	if (zeroOnCycles < 4) {
+		printf("NeoPixel: WARNING counter too coarse for the bit timing\n");
+	}
+}
+
+void neo_tx_send(const uint32_t *pLeds, uint32_t count)
+{
+	unsigned int key = irq_lock();
+	uint32_t bitStart = k_cycle_get_32();
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t word = pLeds[i];
+		for (int bit = 31; bit >= 32 - NEO_CHANNELS * 8; bit--) {
+			uint32_t high = ((word >> bit) & 1) ? oneOnCycles : zeroOnCycles;
+			wait_until(bitStart);
+			gpio_pin_set_dt(pNeopixel, 1);
+			wait_until(bitStart + high);
+			gpio_pin_set_dt(pNeopixel, 0);
+			bitStart += bitCycles;
+		}
+	}
+	irq_unlock(key);
+
+	// Latch
+	k_busy_wait(NEO_RESET_US);
+}
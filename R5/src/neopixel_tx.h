@@ -0,0 +1,23 @@
+// NeoPixel Transmitter
+//
+// Sends GRBW words to a WS2812B / SK6812 strip on one GPIO. Bit timing comes from the
+// cycle counter (k_cycle_get_32) against absolute deadlines, with the cost of a GPIO write
+// measured at start-up, instead of hand-tuned busy loops.
+
+#ifndef _NEOPIXEL_TX_H_
+#define _NEOPIXEL_TX_H_
+
+#include <stdint.h>
+#include <zephyr/drivers/gpio.h>
+
+// Channels sent per LED: 3 for GRB strips (WS2812B), 4 for GRBW strips (SK6812 RGBW).
+// Words are always GRBW; a GRB strip gets the top three bytes.
+#define NEO_CHANNELS 4
+
+// Calibrates the timing for pPin (already configured as an output) and prints the result
+void neo_tx_init(const struct gpio_dt_spec *pPin);
+
+// Sends count LEDs, first word to the first LED, then holds the line low for the latch
+void neo_tx_send(const uint32_t *pLeds, uint32_t count);
+
+#endif
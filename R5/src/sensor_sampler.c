@@ -0,0 +1,182 @@
+// Sensor Sampler
+//
+// A periodic kernel timer paces the thread, so samples stay on a fixed 10 ms grid however
+// long a read takes; the only thing that delays one is a NeoPixel frame going out with
+// interrupts off (about 300 us for 8 LEDs). The joystick ADC conversion takes longer than
+// an accelerometer read, so it is only sampled every JOYSTICK_EVERY samples, the rate the
+// Linux parking task used to poll it at.
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+#include "sharedDataLayout.h"
+#include "sensor_sampler.h"
+
+#ifdef R5_SENSOR_OFFLOAD
+
+#include <zephyr/drivers/i2c.h>
+#include "levelDetector.h"
+
+// Accelerometer, set up as hal/src/accelerometer.c does without the FIFO (LIS2DW12 register
+// map: the address auto-increments through OUT_X_L..OUT_Z_H by default)
+#define ACCEL_REG_CTRL1 0x20
+#define ACCEL_REG_CTRL6 0x25
+#define ACCEL_REG_OUT_X_L 0x28
+#define ACCEL_CTRL1_100HZ 0x57      // ODR 100 Hz, high-performance (14-bit)
+#define ACCEL_CTRL6_2G 0x00
+#define ACCEL_COUNTS_PER_G 4096.0f
+
+// Joystick ADC (TLA2024), Y axis only: it picks the parking mode
+#define ADC_REG_CONFIGURATION 0x01
+#define ADC_REG_DATA 0x00
+#define ADC_CONF_Y_LOW 0xC2         // 0x83C2, low byte first as the Linux driver sends it
+#define ADC_CONF_Y_HIGH 0x83
+#define ADC_CONVERSION_US 750
+#define JOYSTICK_EVERY 10           // Every 100 ms
+#define JOYSTICK_THRESHOLD 0.7f
+
+#define SENSOR_STACK_SIZE 1024
+#define SENSOR_PRIORITY K_PRIO_COOP(1)  // Ahead of the frame loop in main()
+
+static const struct i2c_dt_spec accel = I2C_DT_SPEC_GET(DT_ALIAS(accel));
+static const struct i2c_dt_spec adc = I2C_DT_SPEC_GET(DT_ALIAS(joystick_adc));
+
+K_THREAD_STACK_DEFINE(sensorStack, SENSOR_STACK_SIZE);
+static struct k_thread sensorThread;
+static struct k_timer sensorTimer;
+static volatile uint8_t *pBase = NULL;
+
+// Parking state machine, as parking.c runs it on Linux
+static int mode = 0;
+static int color = LEVEL_COLOR_GOOD;
+static bool wasActive = false;
+// Joystick range, widened by every reading like the Linux driver does
+static uint16_t yMin = 8;
+static uint16_t yMax = 1635;
+
+static void fail(const char *what)
+{
+	printf("ERROR: sensor sampler: %s\n", what);
+	MEM_UINT32(pBase + SENSOR_STATUS_OFFSET) = SENSOR_STATUS_I2C_ERROR;
+}
+
+static bool read_accel(int16_t xyz[3])
+{
+	uint8_t raw[6];
+	if (i2c_burst_read_dt(&accel, ACCEL_REG_OUT_X_L, raw, sizeof(raw)) != 0) {
+		return false;
+	}
+	for (int axis = 0; axis < 3; axis++) {
+		xyz[axis] = (int16_t)((raw[2 * axis + 1] << 8) | raw[2 * axis]) >> 2;
+	}
+	return true;
+}
+
+// Joystick Y scaled to -1 (down) .. 1 (up), 0 if the ADC did not answer
+static float read_joystick_y(void)
+{
+	uint8_t config[3] = {ADC_REG_CONFIGURATION, ADC_CONF_Y_LOW, ADC_CONF_Y_HIGH};
+	uint8_t reg = ADC_REG_DATA;
+	uint8_t raw[2];
+	if (i2c_write_dt(&adc, config, sizeof(config)) != 0) {
+		return 0;
+	}
+	k_usleep(ADC_CONVERSION_US);
+	if (i2c_write_read_dt(&adc, &reg, 1, raw, sizeof(raw)) != 0) {
+		return 0;
+	}
+	uint16_t position = ((raw[0] << 8) | raw[1]) >> 4;
+	if (position < yMin) {
+		yMin = position;
+	}
+	if (position > yMax) {
+		yMax = position;
+	}
+	return -(2.0f * (position - yMin) / (yMax - yMin) - 1.0f);
+}
+
+static void update_mode(uint32_t sample)
+{
+	bool active = MEM_UINT32(pBase + SENSOR_CONTROL_OFFSET) != 0;
+	if (!active) {
+		wasActive = false;
+		mode = 0;
+		return;
+	}
+	if (!wasActive) {
+		wasActive = true;
+		mode = 1;	// Default start handbrake reminder
+	}
+	if (sample % JOYSTICK_EVERY == 0) {
+		float y = read_joystick_y();
+		if (y > JOYSTICK_THRESHOLD) {
+			mode = 1;
+		} else if (y < -JOYSTICK_THRESHOLD) {
+			mode = 2;
+		}
+	}
+}
+
+static void append_record(uint32_t head, const int16_t xyz[3])
+{
+	uint32_t slot = head % SENSOR_RING_RECORDS;
+	MEM_UINT32(pBase + SENSOR_RECORD_OFFSET(slot, SENSOR_RECORD_TIME_MS)) = k_uptime_get_32();
+	MEM_UINT32(pBase + SENSOR_RECORD_OFFSET(slot, SENSOR_RECORD_X)) = (uint32_t)(int32_t)xyz[0];
+	MEM_UINT32(pBase + SENSOR_RECORD_OFFSET(slot, SENSOR_RECORD_Y)) = (uint32_t)(int32_t)xyz[1];
+	MEM_UINT32(pBase + SENSOR_RECORD_OFFSET(slot, SENSOR_RECORD_Z)) = (uint32_t)(int32_t)xyz[2];
+	MEM_UINT32(pBase + SENSOR_RECORD_OFFSET(slot, SENSOR_RECORD_MODE)) = mode;
+	MEM_UINT32(pBase + SENSOR_RECORD_OFFSET(slot, SENSOR_RECORD_COLOR)) = color;
+	MEM_BARRIER();
+	MEM_UINT32(pBase + SENSOR_HEAD_OFFSET) = head + 1;
+}
+
+static void sensor_thread(void *p1, void *p2, void *p3)
+{
+	(void)p1;
+	(void)p2;
+	(void)p3;
+	if (!i2c_is_ready_dt(&accel) || !i2c_is_ready_dt(&adc)) {
+		fail("I2C bus not ready");
+		return;
+	}
+	if (i2c_reg_write_byte_dt(&accel, ACCEL_REG_CTRL1, ACCEL_CTRL1_100HZ) != 0 ||
+	    i2c_reg_write_byte_dt(&accel, ACCEL_REG_CTRL6, ACCEL_CTRL6_2G) != 0) {
+		fail("accelerometer setup");
+		return;
+	}
+	MEM_UINT32(pBase + SENSOR_STATUS_OFFSET) = SENSOR_STATUS_RUNNING;
+
+	k_timer_init(&sensorTimer, NULL, NULL);
+	k_timer_start(&sensorTimer, K_MSEC(SENSOR_PERIOD_MS), K_MSEC(SENSOR_PERIOD_MS));
+	for (uint32_t head = 0; ; head++) {
+		k_timer_status_sync(&sensorTimer);
+		int16_t xyz[3];
+		if (!read_accel(xyz)) {
+			fail("accelerometer read");
+			k_timer_stop(&sensorTimer);
+			return;
+		}
+		update_mode(head);
+		if (mode == 2) {
+			color = level_update(color, xyz[0] / ACCEL_COUNTS_PER_G, xyz[1] / ACCEL_COUNTS_PER_G,
+					     xyz[2] / ACCEL_COUNTS_PER_G);
+		}
+		append_record(head, xyz);
+	}
+}
+
+void sensor_sampler_start(volatile uint8_t *pR5Base)
+{
+	pBase = pR5Base;
+	k_thread_create(&sensorThread, sensorStack, K_THREAD_STACK_SIZEOF(sensorStack),
+			sensor_thread, NULL, NULL, NULL, SENSOR_PRIORITY, 0, K_NO_WAIT);
+}
+
+#else
+
+void sensor_sampler_start(volatile uint8_t *pR5Base)
+{
+	MEM_UINT32(pR5Base + SENSOR_STATUS_OFFSET) = SENSOR_STATUS_OFF;
+}
+
+#endif
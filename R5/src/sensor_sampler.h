@@ -0,0 +1,17 @@
+// Sensor Sampler
+//
+// With R5_SENSOR_OFFLOAD, the R5 owns the Zen Hat I2C bus: it samples the accelerometer
+// every SENSOR_PERIOD_MS, reads the joystick for the parking mode and runs the level check,
+// and appends the results to the sensor ring in shared memory (see sharedDataLayout.h).
+// Linux then only reads the ring instead of polling the sensors itself.
+
+#ifndef _SENSOR_SAMPLER_H_
+#define _SENSOR_SAMPLER_H_
+
+#include <stdint.h>
+
+// Starts the sampling thread; pR5Base is the shared memory. Without R5_SENSOR_OFFLOAD it
+// only marks the sensor block as unused.
+void sensor_sampler_start(volatile uint8_t *pR5Base);
+
+#endif
@@ -1,33 +1,77 @@
 /**
  * ai_api.h
- * 
- * C wrapper for the Gemini AI API interface
+ *
+ * C wrapper for the Gemini AI API interface.
+ *
+ * A single long-lived worker (ai_api.py --worker) is started by AI_init() and talks to us
+ * over a Unix socket using length-prefixed frames tagged with a request id, so several
+ * requests can be in flight and each one can be polled, timed out or cancelled on its own.
+ * Response text is streamed into a fixed per-request buffer, so it can be read sentence by
+ * sentence while the model is still generating the rest.
  */
 
  #ifndef AI_API_H
  #define AI_API_H
- 
+
  #include <stdbool.h>
- 
+ #include <stddef.h>
+
+ typedef enum {
+     AI_PENDING,     // Still waiting for the worker
+     AI_DONE,        // Response available
+     AI_FAILED,      // Worker reported an error or died
+     AI_TIMEOUT,     // Deadline passed; the request was cancelled
+     AI_UNKNOWN,     // No such request id (already collected or cancelled)
+ } AiStatus;
 
-// Initialize the AI API module
+ // Latency of each stage in milliseconds, accumulated over all completed requests
+ typedef struct {
+     int completed;
+     int failed;
+     int timedOut;
+     double avgQueueMs;      // AI_submit() until the request is on the socket
+     double avgFirstChunkMs; // AI_submit() until the first piece of text arrives
+     double avgWorkerMs;     // On the socket until the response frame arrives
+     double avgTotalMs;      // AI_submit() until the response frame arrives
+     double maxTotalMs;
+ } AiStats;
+
+// Initialize the AI API module (starts the worker process)
  void AI_init(void);
- 
+
  /**
   * Clean up the AI API module
   */
  void AI_cleanup(void);
- 
-// Process transcription from the mic
- char* AI_processTranscription(void);
- 
-// Process the text
+
+ // Queue a prompt for the worker. Returns a request id (> 0), or -1 on failure.
+ int AI_submit(const char* prompt, int timeoutMs);
+
+ // Check on a request without blocking. When AI_DONE is returned, *response receives
+ // a malloc'd string the caller must free, and the request id is released.
+ AiStatus AI_poll(int requestId, char** response);
+
+ // Block until the request completes, fails or times out
+ AiStatus AI_wait(int requestId, char** response);
+
+ // Block until the next complete sentence of the response has arrived and copy it to out.
+ // Returns false once the response is finished or has failed; *status says how it ended
+ // and the request id is released.
+ bool AI_readSentence(int requestId, char *out, size_t outSize, AiStatus *status);
+
+ // Cancel a request; its response is discarded if it arrives later
+ void AI_cancel(int requestId);
+
+ // Per-stage latency statistics
+ AiStats AI_getStats(void);
+
+// Process a transcription from the mic. Returns the whole answer (caller frees) or NULL.
+ char* AI_processTranscription(const char* transcription);
+
+// Process the text. Returns the whole answer (caller frees) or NULL.
  char* AI_processText(const char* text);
- 
- // Set the callback function to be called when AI processing completes
-//  void AI_setResponseCallback(void (*callback)(const char* response));
- 
+
  // Checks if API key is set
  bool AI_isApiKeySet(void);
- 
- #endif /* AI_API_H */
\ No newline at end of file
+
+ #endif /* AI_API_H */
@@ -0,0 +1,80 @@
+/*
+ * This header defines the interface for the DrivingEvents module, which watches the
+ * accelerometer stream while driving for harsh braking, harsh acceleration, hard cornering
+ * and impacts.
+ *
+ * Every accelerometer sample goes through a few constant-cost steps: a slow gravity
+ * estimate is subtracted, a sliding-window mean smooths each axis, and one threshold state
+ * machine per event type (enter and exit thresholds plus a minimum duration) decides when
+ * an event starts. The module publishes EVENT_DRIVING as soon as one does, and one second
+ * later hands a binary record to a low-priority writer thread that appends it to
+ * DRIVING_EVENTS_FILE: the raw samples from one second before to one second after the
+ * trigger, and the GPS fixes around it.
+ *
+ * The accelerometer is assumed to be mounted flat (z up, as the parking level check also
+ * assumes) with x pointing forward and y to the left.
+**/
+#ifndef DRIVING_EVENTS_H
+#define DRIVING_EVENTS_H
+
+#include <stdint.h>
+
+#define DRIVING_EVENTS_FILE "driving_events.bin"
+
+typedef enum {
+    DRIVING_HARSH_BRAKING = 1,
+    DRIVING_HARSH_ACCELERATION,
+    DRIVING_CORNERING,
+    DRIVING_IMPACT,
+} DrivingEventType;
+
+// Record layout, little-endian, as appended to DRIVING_EVENTS_FILE: one header, then
+// fixCount fixes, then sampleCount samples
+#define DRIVING_RECORD_MAGIC 0x54564544     // "DEVT"
+#define DRIVING_RECORD_VERSION 1
+#define DRIVING_RECORD_ONGOING 0x1          // Flag: still above the exit threshold at the end
+
+struct DrivingRecordHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t type;              // DrivingEventType
+    uint64_t triggerNs;         // CLOCK_MONOTONIC when the event was confirmed
+    int64_t unixTime;           // Wall clock seconds at the same moment
+    int16_t peakMilliG;         // Signed for braking and cornering
+    uint16_t durationMs;        // Above the threshold, up to the end of the record
+    uint16_t sampleRateHz;
+    uint16_t preSamples;        // Samples before the trigger
+    uint16_t sampleCount;
+    uint16_t fixCount;
+    uint32_t flags;
+};
+
+struct DrivingRecordFix {
+    int32_t offsetMs;           // Relative to the trigger
+    int32_t latitudeE7;         // Degrees * 10^7
+    int32_t longitudeE7;
+    uint16_t speedKmhE2;        // km/h * 100
+    uint16_t valid;
+};
+
+struct DrivingRecordSample {
+    int16_t x;                  // Milli-g, gravity included
+    int16_t y;
+    int16_t z;
+};
+
+typedef struct {
+    uint64_t samples;           // Accelerometer samples analysed
+    uint64_t events[DRIVING_IMPACT + 1];    // Per DrivingEventType
+    uint64_t records;           // Written to DRIVING_EVENTS_FILE
+    uint64_t recordsDropped;    // Writer thread too far behind
+    uint64_t gaps;              // Samples lost before the detector read them
+} DrivingEventsStats;
+
+// Initialization and cleanup; call after Accelerometer_initialize() and EventBus_init()
+void DrivingEvents_init(void);
+void DrivingEvents_cleanup(void);
+
+DrivingEventsStats DrivingEvents_getStats(void);
+
+#endif // DRIVING_EVENTS_H
@@ -0,0 +1,84 @@
+/*
+ * This header defines the interface for the EventBus module, a small publish/subscribe hub.
+ *
+ * Producers (GPS, joystick, speed limit lookup, road tracker, parking) publish typed events
+ * instead of having every consumer poll their getters on its own timer. Publishing never
+ * blocks or takes a lock: events go into a bounded multi-producer ring, and one dispatcher
+ * thread hands each event to the handlers subscribed to its topic, in publish order.
+ * Handlers run on the dispatcher thread, so they must be quick and must not wait on I/O.
+**/
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "hal/GPS.h"
+#include "hal/joystick.h"
+
+typedef enum {
+    EVENT_FIX,              // New GPS reading (valid or not)
+    EVENT_SPEED_LIMIT,      // The speed limit for the current road changed
+    EVENT_SPEED_STATE,      // Speed, limit or speed LED color changed
+    EVENT_PROGRESS,         // Navigation progress changed, or a target was set/cleared
+    EVENT_PARKING,          // Parking assistant mode or level color changed
+    EVENT_BUTTON,           // Joystick button press or direction change
+    EVENT_DRIVING,          // Harsh braking, acceleration, cornering or an impact detected
+    EVENT_TOPIC_COUNT,
+} EventTopic;
+
+struct Event {
+    EventTopic topic;
+    uint64_t publishedNs;   // CLOCK_MONOTONIC, filled in by EventBus_publish()
+    union {
+        struct {
+            struct location location;
+            bool valid;
+        } fix;
+        int speedLimit;
+        struct {
+            double speed;
+            int speedLimit;
+            int color;      // 0: red, 1: yellow, 2: green, 3: no GPS
+        } speed;
+        struct {
+            bool active;    // A target is set
+            double percent;
+        } progress;
+        struct {
+            bool active;
+            int mode;       // 0: travelling, 1: handbrake reminder, 2: flat surface detection
+            int color;      // 0: red, 1: yellow, 2: green
+        } parking;
+        JoystickDirection button;
+        struct {
+            int type;       // DrivingEventType (drivingEvents.h)
+            double peakG;   // Filtered acceleration; raw magnitude for an impact
+        } driving;
+    };
+};
+
+typedef void (*EventHandler)(const struct Event *event, void *context);
+
+typedef struct {
+    uint64_t published;
+    uint64_t dropped;       // Queue was full
+    uint64_t delivered;     // Handler calls
+    double avgLatencyUs;    // Publish until the first handler starts
+    double maxLatencyUs;
+} EventBusStats;
+
+// Function to initialize (starts the dispatcher) and clean up the EventBus module.
+// Call cleanup before the subscribed modules are torn down; no handler runs afterwards.
+void EventBus_init(void);
+void EventBus_cleanup(void);
+
+// Register a handler for a topic. Returns 0 on success, -1 if the topic has no free slot.
+int EventBus_subscribe(EventTopic topic, EventHandler handler, void *context);
+
+// Queue an event for the dispatcher. Safe from any thread; returns false if it was dropped.
+bool EventBus_publish(const struct Event *event);
+
+// Delivery statistics
+EventBusStats EventBus_getStats(void);
+
+#endif // EVENT_BUS_H
@@ -0,0 +1,41 @@
+/*
+ * This header defines the interface for the Intent module, a small on-device command parser.
+ *
+ * Command templates ("set target to *", "clear target", "what is the speed limit", ...) are compiled
+ * into a word trie when the module starts. A transcript is lower-cased, split into words and matched
+ * against the trie from its first word, so recognizing a command takes microseconds and never needs
+ * the AI. Only utterances that open with a command are handled here; "what speed limit applies to
+ * trucks" or "how far is the moon" go to the AI. Spoken numbers are turned into digits and street suffixes are abbreviated, so an
+ * address like "eighty eight eighty eight university drive west burnaby" comes out ready to geocode.
+**/
+#ifndef INTENT_H
+#define INTENT_H
+
+#include <stdbool.h>
+
+#define INTENT_MAX_ARGUMENT 256
+
+typedef enum {
+    INTENT_NONE,            // Not a known command; hand the text to the AI
+    INTENT_SET_TARGET,      // "set target <place>", "navigate to <place>"
+    INTENT_CLEAR_TARGET,    // "clear target", "cancel navigation"
+    INTENT_SPEED_LIMIT,     // "what is the speed limit"
+    INTENT_CURRENT_SPEED,   // "how fast am I going"
+    INTENT_PROGRESS,        // "how far is it", "are we there yet"
+    INTENT_WHERE_AM_I,      // "where am I"
+} IntentType;
+
+struct Intent {
+    IntentType type;
+    char argument[INTENT_MAX_ARGUMENT];     // Place for INTENT_SET_TARGET, empty otherwise
+    bool isStreetAddress;                   // Argument is "<number> <name> <street type> ..."
+};
+
+// Function to initialize (compile the templates) and clean up the Intent module
+void Intent_init(void);
+void Intent_cleanup(void);
+
+// Parses a transcript. Returns true and fills *intent when a command is recognized.
+bool Intent_parse(const char *text, struct Intent *intent);
+
+#endif // INTENT_H
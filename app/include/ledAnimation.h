@@ -0,0 +1,30 @@
+/*
+ * This header defines the interface for the LedAnimation module, which composes the NeoPixel
+ * frames that the R5 latches onto the strip.
+ *
+ * A frame is one GRBW word per LED, built from the current driving and parking state by a
+ * few layered effects: the route progress bar in the speed color, a pulse over it while
+ * speeding, the level check fill and the handbrake reminder chaser. Composing is a pure
+ * function of the state and the time, so a new visualization only needs a new effect here,
+ * never an R5 firmware change.
+**/
+#ifndef LED_ANIMATION_H
+#define LED_ANIMATION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct LedState {
+    double progress;        // Route progress in percent, 0 when not navigating
+    int speedColor;         // 0 red (speeding), 1 yellow (near the limit), 2 green, 3 no fix
+    bool parkingActive;
+    int parkingMode;        // 1 handbrake reminder, 2 level check
+    int parkingColor;       // Level check: 0 red (steep), 1 yellow, 2 green (flat)
+};
+
+// Fills frame[ledCount] with the picture for state at timeMs (any monotonic millisecond
+// clock). Returns true if the picture changes with time, i.e. it has to be composed again
+// every frame period to animate; false if it stays the same until the state changes.
+bool LedAnimation_compose(const struct LedState *state, uint32_t timeMs, uint32_t *frame, int ledCount);
+
+#endif // LED_ANIMATION_H
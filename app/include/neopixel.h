@@ -2,17 +2,37 @@
  * This header defines the interface for controlling NeoPixel LEDs and onboard GPIO LEDs
  * based on GPS signal status, road tracking progress, and parking mode.
  * 
- * It Uses a background thread to update LED states every second and communicates to R5 to control NeoPixel animations.
+ * It reacts to events from the EventBus (GPS fix, speed state, progress, parking), composes each NeoPixel frame
+ * with the LedAnimation module and streams it to the R5, which only latches frames onto the strip.
  * Integrates with the RoadTracker and Parking modules for dynamic behavior.
 **/
 #ifndef LED_CONTROLLER_H
 #define LED_CONTROLLER_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
-// Initializes the neopixel controller and starts the neopxiel update thread
+// What the R5 reports about itself (see the telemetry block in sharedDataLayout.h)
+struct R5Telemetry {
+    bool alive;                 // Heartbeat moved within the stall timeout
+    unsigned long stalls;       // Times the heartbeat stopped since init
+    uint32_t heartbeat;
+    uint32_t publishedSequence; // Last frame Linux sent
+    uint32_t ackedSequence;     // Last frame the R5 put on the strip
+    uint32_t framesDrawn;
+    uint32_t framesSkipped;     // Replaced by a newer frame before the R5 latched them
+    uint32_t readRetries;
+    double renderUs;            // Time the last frame took on the wire
+    double maxRenderUs;
+    uint32_t error;             // R5_ERROR_*
+};
+
+// Initializes the neopixel controller and subscribes it to the events it displays
 void NeoPixel_init(void);
 
-// Cleans up the neopixel controller and joins the thread
+// Cleans up the neopixel controller; call after EventBus_cleanup()
 void NeoPixel_cleanUp(void);
+
+// Latest R5 telemetry, refreshed by a monitor task that also reports a stalled R5
+struct R5Telemetry NeoPixel_getR5Telemetry(void);
 #endif // LED_CONTROLLER_H
@@ -0,0 +1,17 @@
+/*
+ * This header defines access to the R5 shared memory: the BTCM of the MCU R5, mapped
+ * through /dev/mem, which holds the mailbox laid out in sharedDataLayout.h.
+ *
+ * It is its own module so the R5 simulator (R5/sim) can link the NeoPixel and parking code
+ * against an emulated shared memory instead.
+**/
+#ifndef R5_MEMORY_H
+#define R5_MEMORY_H
+
+// Maps the R5 shared memory; exits if /dev/mem is not accessible
+volatile void* getR5MmapAddr(void);
+
+// Unmaps memory from getR5MmapAddr()
+void freeR5MmapAddr(volatile void* pR5Base);
+
+#endif // R5_MEMORY_H
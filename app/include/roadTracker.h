@@ -1,11 +1,11 @@
 /* 
  * This header file defines the interface for the RoadTracker module,
- * It starts a background thread that calculates the distance between the current location and the target location, 
+ * On every GPS fix from the EventBus it calculates the distance between the current location and the target location,
  * and computes a progress percentage from 0 to 100.
  * The module allows:
  *  - Setting a target location using a human-readable address.
  *  - Retrieving the current GPS location and the target location.
- *  - Tracking progress toward the target location in real time.
+ *  - Tracking progress toward the target location in real time (published as EVENT_PROGRESS).
  * 
 **/
 #ifndef ROADTRACKER_H
@@ -24,6 +24,9 @@ void RoadTracker_cleanup();
 // Fubnction to set the target location 
 void RoadTracker_setTarget(char* address);
 
+// Function to set the target location from an address that was already geocoded (skips the lookup)
+void RoadTracker_setTargetLocation(char* address, struct location target);
+
 // Function to get the current location
 struct location RoadTracker_getCurrentLocation();
 
@@ -0,0 +1,41 @@
+/*
+ * This header defines the interface for the Scheduler module, which runs periodic tasks
+ * from a hierarchical timer wheel on one thread.
+ *
+ * Each run is due at an absolute deadline (start + n * period), so the time a task takes
+ * never pushes later runs back the way a sleepForMs() loop does. A task may accept some
+ * slack; its deadline is then moved onto a coarse grid inside that slack so tasks with
+ * compatible deadlines fire in the same wakeup. Every task keeps its own lateness and
+ * overrun statistics. Tasks run on the scheduler thread and must be short.
+**/
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint64_t runs;
+    uint64_t overruns;      // Periods skipped because a run started after the next deadline
+    double avgLatencyUs;    // Start of run minus its nominal deadline
+    double maxLatencyUs;
+    double jitterUs;        // Standard deviation of the latency
+    double avgRunUs;
+} SchedulerTaskStats;
+
+// Function to initialize (starts the scheduler thread) and clean up the Scheduler module
+void Scheduler_init(void);
+void Scheduler_cleanup(void);
+
+// Run fn(context) every periodMs; slackMs is how late a run may be to share a wakeup.
+// Returns a task id (>= 0) or -1 if the table is full.
+int Scheduler_addPeriodic(const char *name, long periodMs, long slackMs, void (*fn)(void *context), void *context);
+
+// Stop a task. Waits if it is running right now, so its context can be freed afterwards.
+// Safe to call after Scheduler_cleanup.
+void Scheduler_remove(int taskId);
+
+// Statistics of one task, and a line per task on stdout
+SchedulerTaskStats Scheduler_getStats(int taskId);
+void Scheduler_printStats(void);
+
+#endif // SCHEDULER_H
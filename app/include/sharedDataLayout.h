@@ -8,13 +8,91 @@
 // - It seems that using a struct for the ATCM memory does not work 
 //   (hangs when accessing memory via a struct pointer).
 // - Therefore, using an array.
+// - This file is shared by Linux (app/include) and the R5 (R5/src); keep both copies identical.
 
-#define MSG_OFFSET 0
-#define MSG_SIZE   32
-#define PROGRESS_OFFSET (MSG_OFFSET + sizeof(uint32_t))
-#define COLOR_OFFSET (PROGRESS_OFFSET + sizeof(uint32_t))
-#define MODE_OFFSET (COLOR_OFFSET + sizeof(uint32_t))
+// Mailbox protocol
+// - The R5 is a plain frame renderer: Linux composes every frame (one GRBW word per LED) and
+//   the R5 latches whatever frame is current onto the strip.
+// - Frames are double-buffered. Linux fills the buffer that is not FRONT_OFFSET, then, under
+//   the SEQUENCE_OFFSET seqlock, switches FRONT_OFFSET and LED_COUNT_OFFSET to it. The seqlock
+//   window is a few words, and the R5 copies a frame only while the sequence is even and
+//   unchanged across the copy, so it never shows half of one frame and half of another.
+// - Linux is the only writer of everything except ACK_OFFSET; after drawing a frame the R5
+//   stores its sequence there. An unchanged sequence means there is nothing new to draw.
+// - The R5 ignores the mailbox until MAGIC_OFFSET and VERSION_OFFSET match, which covers
+//   both uninitialized memory and a Linux side built against another layout.
+#define MAILBOX_MAGIC   0x4E454F50  // "NEOP"
+#define MAILBOX_VERSION 6
 
-#define MEM_UINT8(addr) *(uint8_t*)(addr)
-#define MEM_UINT32(addr) *(uint32_t*)(addr)
+#define MAGIC_OFFSET 0
+#define VERSION_OFFSET (MAGIC_OFFSET + sizeof(uint32_t))
+#define SEQUENCE_OFFSET (VERSION_OFFSET + sizeof(uint32_t))
+#define ACK_OFFSET (SEQUENCE_OFFSET + sizeof(uint32_t))
+#define FRONT_OFFSET (ACK_OFFSET + sizeof(uint32_t))
+#define LED_COUNT_OFFSET (FRONT_OFFSET + sizeof(uint32_t))
+// Two frame buffers; word i of a buffer is LED i, the first (bottom) LED of the strip
+// Bits: {Green/8 bits} {Red/8 bits} {Blue/8 bits} {White/8 bits}
+#define FRAME_MAX_LEDS 256
+#define FRAME_OFFSET(buffer) (LED_COUNT_OFFSET + sizeof(uint32_t) + (buffer) * FRAME_MAX_LEDS * sizeof(uint32_t))
+
+// Telemetry, written only by the R5 and never by Linux (up to SENSOR_CONTROL_OFFSET)
+// - R5_HEARTBEAT_OFFSET counts main loop passes (one per poll); Linux treats a heartbeat
+//   that stops moving as a stalled R5.
+// - R5_SKIPPED_OFFSET counts frames Linux replaced before the R5 got to latch them, judged
+//   from gaps in the sequence, so zero proves every published frame reached the strip.
+#define R5_HEARTBEAT_OFFSET FRAME_OFFSET(2)
+#define R5_FRAMES_OFFSET (R5_HEARTBEAT_OFFSET + sizeof(uint32_t))           // Frames latched
+#define R5_SKIPPED_OFFSET (R5_FRAMES_OFFSET + sizeof(uint32_t))
+#define R5_RENDER_CYCLES_OFFSET (R5_SKIPPED_OFFSET + sizeof(uint32_t))      // Last frame on the wire
+#define R5_RENDER_MAX_CYCLES_OFFSET (R5_RENDER_CYCLES_OFFSET + sizeof(uint32_t))
+#define R5_CYCLE_HZ_OFFSET (R5_RENDER_MAX_CYCLES_OFFSET + sizeof(uint32_t)) // Counter rate
+#define R5_READ_RETRIES_OFFSET (R5_CYCLE_HZ_OFFSET + sizeof(uint32_t))      // Seqlock copies redone
+#define R5_ERROR_OFFSET (R5_READ_RETRIES_OFFSET + sizeof(uint32_t))
+
+// Sensor ring, only used when both sides are built with R5_SENSOR_OFFLOAD
+// - The R5 samples the accelerometer every SENSOR_PERIOD_MS, runs the parking mode and level
+//   state machine on it and appends one record per sample; Linux only reads the ring.
+// - The R5 writes a record, then advances SENSOR_HEAD_OFFSET (records ever written, so it
+//   never goes backwards); record n lives in slot n % SENSOR_RING_RECORDS. A reader copies
+//   the records it wants and rechecks the head afterwards: any record the head has since
+//   moved SENSOR_RING_RECORDS past was overwritten during the copy and is dropped.
+// - SENSOR_CONTROL_OFFSET is the only word in this block Linux writes: 1 while the parking
+//   assistant is active (not navigating), 0 otherwise. Each 0 to 1 change restarts in the
+//   handbrake reminder mode, as the Linux state machine does.
+#define SENSOR_PERIOD_MS 10
+#define SENSOR_RING_RECORDS 64
+#define SENSOR_STATUS_OFFSET (R5_ERROR_OFFSET + sizeof(uint32_t))
+#define SENSOR_HEAD_OFFSET (SENSOR_STATUS_OFFSET + sizeof(uint32_t))
+// Record words; x, y and z are signed raw counts, 4096 per g (the +-2g range)
+#define SENSOR_RECORD_TIME_MS 0     // R5 uptime
+#define SENSOR_RECORD_X 1
+#define SENSOR_RECORD_Y 2
+#define SENSOR_RECORD_Z 3
+#define SENSOR_RECORD_MODE 4        // 0 inactive, 1 handbrake reminder, 2 level check
+#define SENSOR_RECORD_COLOR 5       // levelDetector.h color
+#define SENSOR_RECORD_WORDS 6
+#define SENSOR_RECORD_OFFSET(slot, word) \
+    (SENSOR_HEAD_OFFSET + sizeof(uint32_t) + ((slot) * SENSOR_RECORD_WORDS + (word)) * sizeof(uint32_t))
+#define SENSOR_CONTROL_OFFSET SENSOR_RECORD_OFFSET(SENSOR_RING_RECORDS, 0)
+#define MAILBOX_END (SENSOR_CONTROL_OFFSET + sizeof(uint32_t))
+
+// SENSOR_STATUS_OFFSET values
+#define SENSOR_STATUS_OFF 0     // The R5 firmware was built without R5_SENSOR_OFFLOAD
+#define SENSOR_STATUS_RUNNING 1
+#define SENSOR_STATUS_I2C_ERROR 2   // A sensor did not answer; the ring stops
+
+// R5 error codes
+#define R5_ERROR_NONE 0
+#define R5_ERROR_GPIO 1         // A GPIO could not be configured; the R5 has stopped
+#define R5_ERROR_VERSION 2      // Linux wrote a mailbox of another version
+
+#define MEM_UINT8(addr) *(volatile uint8_t*)(addr)
+#define MEM_UINT32(addr) *(volatile uint32_t*)(addr)
+
+// Orders the mailbox accesses for the other core too (outer shareable, non-cacheable mapping)
+#if defined(__aarch64__) || defined(__arm__)
+#define MEM_BARRIER() __asm__ volatile("dmb sy" ::: "memory")
+#else
+#define MEM_BARRIER() __sync_synchronize()
+#endif
 #endif
@@ -0,0 +1,30 @@
+/*
+ * This header defines the interface for the ThreadConfig module, which starts the
+ * latency-critical threads with real-time attributes taken from one table.
+ *
+ * A thread started through ThreadConfig_create() is looked up by name. If the table has an
+ * entry, the thread gets that entry's SCHED_FIFO priority and CPU affinity, and runs on a
+ * stack that was allocated and touched at init, so its first run never page faults.
+ * ThreadConfig_init() also locks all current and future memory (mlockall). Names that are
+ * not in the table get default attributes. Without the privilege for real-time scheduling
+ * (CAP_SYS_NICE or an rtprio limit) the thread still starts, with normal scheduling.
+**/
+#ifndef THREAD_CONFIG_H
+#define THREAD_CONFIG_H
+
+#include <pthread.h>
+
+// Function to initialize (before any thread is created) and clean up the ThreadConfig module.
+// Cleanup frees the preallocated stacks, so every configured thread must have been joined.
+void ThreadConfig_init(void);
+void ThreadConfig_cleanup(void);
+
+// pthread_create() with the attributes configured for name. The name is also set as the
+// thread name (shown by top -H and ps -L). Returns 0 or an error number like pthread_create().
+// A configured name may only have one thread at a time.
+int ThreadConfig_create(pthread_t *thread, const char *name, void *(*fn)(void *arg), void *arg);
+
+// One line per configured thread on stdout: requested and applied policy, priority and CPU
+void ThreadConfig_print(void);
+
+#endif // THREAD_CONFIG_H
@@ -0,0 +1,50 @@
+/*
+ * This header defines the interface for the TtsCache module, which keeps synthesized speech in memory.
+ *
+ * Fixed prompts are rendered by espeak once, on a background thread started by TtsCache_init() (or on
+ * first use if that comes sooner), and played straight from RAM.
+ * Other text is synthesized the first time it is spoken and kept in a small LRU cache keyed by a
+ * hash of the text, so repeated phrases (street names, numbers, AI answers) are never re-synthesized.
+**/
+#ifndef TTS_CACHE_H
+#define TTS_CACHE_H
+
+#include <stdbool.h>
+
+// Fixed phrases rendered once in the background
+typedef enum {
+    TTS_PROMPT_TARGET_RESET,        // "Target location reset successfully"
+    TTS_PROMPT_INVALID_ADDRESS,     // Target could not be geocoded
+    TTS_PROMPT_INVALID_LOCATION,    // No GPS fix when setting the target
+    TTS_PROMPT_TARGET_SET,          // "Successfully setting the target destination to" (followed by the address)
+    TTS_PROMPT_SPEED_LIMIT,         // "The speed limit is" (followed by a number)
+    TTS_PROMPT_SPEED_LIMIT_UNKNOWN, // No speed limit known for the current road
+    TTS_PROMPT_CURRENT_SPEED,       // "You are driving at" (followed by a number)
+    TTS_PROMPT_PROGRESS,            // "You have covered" (followed by a number)
+    TTS_PROMPT_NO_TARGET,           // Progress asked for without a target
+    TTS_NUM_PROMPTS
+} TtsPrompt;
+
+// Initializes the cache and starts rendering the fixed prompts in the background. Speaker_init() must be called first.
+void TtsCache_init(void);
+void TtsCache_cleanup(void);
+
+// Plays a fixed prompt
+void TtsCache_playPrompt(TtsPrompt prompt);
+
+// Speaks arbitrary text, synthesizing it only if it is not already cached
+void TtsCache_say(const char *text);
+
+// Speaks a fixed prompt immediately followed by dynamic text as one clip
+void TtsCache_sayPromptWith(TtsPrompt prompt, const char *text);
+
+// Speaks a non-negative integer by concatenating cached number words ("fifty", "two")
+void TtsCache_sayNumber(int number);
+
+// Speaks a fixed prompt, a number and a unit ("kilometers per hour") as one clip
+void TtsCache_sayPromptNumber(TtsPrompt prompt, int number, const char *unit);
+
+// Synthesizes text into the cache without playing it, so a later TtsCache_say() starts instantly
+void TtsCache_prefetch(const char *text);
+
+#endif // TTS_CACHE_H
@@ -0,0 +1,20 @@
+/*
+ * This header defines the interface for the VoiceCommand module, which acts on a finished transcript.
+ *
+ * Commands the Intent parser recognizes (set or clear the target, speed limit, current speed, progress,
+ * where am I) are answered on the device. The AI is only used to turn a spoken place that is not already
+ * a street address into one, and to answer anything that is not a command.
+ * When setting a target, the place as spoken is geocoded in parallel with the AI formatting and the first
+ * lookup that succeeds wins. Each stage's latency is printed per request.
+**/
+#ifndef VOICE_COMMAND_H
+#define VOICE_COMMAND_H
+
+// Function to initialize and clean up the VoiceCommand module
+void VoiceCommand_init(void);
+void VoiceCommand_cleanup(void);
+
+// Acts on one transcript; blocks until the answer has been spoken
+void VoiceCommand_handle(const char *transcription);
+
+#endif // VOICE_COMMAND_H
@@ -1,224 +1,608 @@
 /**
  * ai_api.c
  *
- * Implementation of the C wrapper for the Gemini AI API,
- * using fork/exec with a nonblocking pipe and select() so that
- * the function checks regularly for the global “running” flag.
+ * Implementation of the C wrapper for the Gemini AI API.
+ *
+ * The Python side runs once as a persistent worker, so interpreter startup, the
+ * google.generativeai import and client configuration are paid a single time.
+ * Requests and responses travel over a socketpair as frames:
+ *
+ *     uint32 payload length | uint32 request id | uint8 frame type | payload
+ *
+ * (little endian). A reader thread matches response frames to the pending request table.
+ *
+ * Responses are streamed: the worker forwards text chunks as Gemini generates them and ends
+ * with an END frame. Chunks are appended to a fixed slice of one arena allocated at startup,
+ * so a response never reallocates and memory use is bounded, and complete sentences can be
+ * handed out (AI_readSentence) while the rest of the answer is still being generated.
  */
 
  #include "ai_api.h"
  #include <stdio.h>
  #include <stdlib.h>
+ #include <stdint.h>
  #include <string.h>
+ #include <ctype.h>
  #include <unistd.h>
  #include <pthread.h>
- #include <fcntl.h>      /* For fcntl(), O_NONBLOCK */
  #include <errno.h>
  #include <signal.h>
  #include <time.h>
+ #include <fcntl.h>
  #include <sys/wait.h>
- #include <sys/select.h>
- 
- #define MAX_RESPONSE_SIZE 4096
- 
- // Global mutex and response buffer.
+ #include <sys/socket.h>
+
+ #define MAX_REQUESTS 8
+ #define AI_ARENA_SIZE (16 * 1024)      // Response text kept per request
+ #define READ_SCRATCH_SIZE 4096
+ #define DEFAULT_TIMEOUT_MS 10000
+ #define FRAME_HEADER_SIZE 9
+ #define WORKER_SCRIPT "./ai_api.py"
+
+ enum {
+     FRAME_REQUEST = 1,      // C -> worker: prompt text
+     FRAME_CANCEL = 2,       // C -> worker: drop this request id
+     FRAME_CHUNK = 3,        // worker -> C: next piece of the response text
+     FRAME_ERROR = 4,        // worker -> C: error message, ends the request
+     FRAME_END = 5,          // worker -> C: response complete
+ };
+
+ struct request {
+     int id;                 // 0 when the slot is free
+     AiStatus status;
+     char *text;             // This request's slice of the arena
+     size_t length;          // Bytes of text received
+     size_t consumed;        // Bytes already handed out by AI_readSentence()
+     bool gotChunk;
+     bool truncated;
+     struct timespec submitted;
+     struct timespec sent;
+     struct timespec firstChunk;
+     struct timespec deadline;
+ };
+
+ // Global mutex and response arena.
  static pthread_mutex_t ai_mutex = PTHREAD_MUTEX_INITIALIZER;
- static char ai_response_buffer[MAX_RESPONSE_SIZE] = {0};
- 
- // The global flag defined in main.c (ensure it is declared with external linkage).
-//  extern volatile int running;
-
- static char* run_python_script(const char* arg) {
-     int pipefd[2];
-     if (pipe(pipefd) < 0) {
-         perror("pipe");
-         return NULL;
+ static pthread_cond_t ai_cond;
+ static pthread_mutex_t send_mutex = PTHREAD_MUTEX_INITIALIZER;
+ // Serializes worker restarts. Not ai_mutex: stopping the worker joins the reader thread,
+ // which takes ai_mutex.
+ static pthread_mutex_t restart_mutex = PTHREAD_MUTEX_INITIALIZER;
+ static char *arena = NULL;
+ static char scratch[READ_SCRATCH_SIZE];  // Only used by the reader thread
+
+ static struct request requests[MAX_REQUESTS];
+ static int next_request_id = 1;
+ static int worker_fd = -1;
+ static pid_t worker_pid = -1;
+ static pthread_t reader_thread;
+ static int worker_alive = 0;
+
+ // Stage latency accumulators (protected by ai_mutex)
+ static AiStats stats;
+ static double total_queue_ms = 0;
+ static double total_first_chunk_ms = 0;
+ static double total_worker_ms = 0;
+ static double total_ms = 0;
+
+ static double ms_between(const struct timespec *start, const struct timespec *end) {
+     return (end->tv_sec - start->tv_sec) * 1000.0 + (end->tv_nsec - start->tv_nsec) / 1000000.0;
+ }
+
+ static int timespec_passed(const struct timespec *deadline) {
+     struct timespec now;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+     return now.tv_sec > deadline->tv_sec ||
+            (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+ }
+
+ static int read_full(int fd, void *buf, size_t len) {
+     uint8_t *p = buf;
+     while (len > 0) {
+         ssize_t n = read(fd, p, len);
+         if (n < 0 && errno == EINTR) continue;
+         if (n <= 0) return -1;
+         p += n;
+         len -= (size_t)n;
+     }
+     return 0;
+ }
+
+ static int send_frame(uint32_t id, uint8_t type, const char *payload, size_t len) {
+     uint8_t header[FRAME_HEADER_SIZE];
+     for (int i = 0; i < 4; i++) {
+         header[i] = (len >> (8 * i)) & 0xFF;
+         header[4 + i] = (id >> (8 * i)) & 0xFF;
+     }
+     header[8] = type;
+
+     int result = 0;
+     pthread_mutex_lock(&send_mutex);
+     const uint8_t *parts[2] = {header, (const uint8_t *)payload};
+     size_t sizes[2] = {sizeof(header), len};
+     for (int part = 0; part < 2 && result == 0; part++) {
+         size_t done = 0;
+         while (done < sizes[part]) {
+             // MSG_NOSIGNAL: a dead worker must not take us down with SIGPIPE
+             ssize_t n = send(worker_fd, parts[part] + done, sizes[part] - done, MSG_NOSIGNAL);
+             if (n < 0 && errno == EINTR) continue;
+             if (n <= 0) {
+                 result = -1;
+                 break;
+             }
+             done += (size_t)n;
+         }
+     }
+     pthread_mutex_unlock(&send_mutex);
+     return result;
+ }
+
+ // Must hold ai_mutex
+ static struct request *find_request(int id) {
+     for (int i = 0; i < MAX_REQUESTS; i++) {
+         if (requests[i].id == id && id != 0) {
+             return &requests[i];
+         }
+     }
+     return NULL;
+ }
+
+ // Must hold ai_mutex
+ static void release_request(struct request *req) {
+     req->id = 0;
+     req->length = 0;
+     req->consumed = 0;
+     if (req->text) {
+         req->text[0] = '\0';
+     }
+ }
+
+ // Must hold ai_mutex. Text beyond the arena slice is dropped.
+ static void append_text(struct request *req, const char *data, size_t len) {
+     size_t room = AI_ARENA_SIZE - 1 - req->length;
+     if (len > room) {
+         if (!req->truncated) {
+             printf("AI request %d: response longer than %d bytes, truncating\n", req->id, AI_ARENA_SIZE);
+         }
+         req->truncated = true;
+         len = room;
+     }
+     memcpy(req->text + req->length, data, len);
+     req->length += len;
+     req->text[req->length] = '\0';
+ }
+
+ // Must hold ai_mutex
+ static void finish_request(struct request *req, const struct timespec *now) {
+     req->status = AI_DONE;
+     double queue = ms_between(&req->submitted, &req->sent);
+     double first = req->gotChunk ? ms_between(&req->submitted, &req->firstChunk) : 0;
+     double worker = ms_between(&req->sent, now);
+     double total = ms_between(&req->submitted, now);
+     stats.completed++;
+     total_queue_ms += queue;
+     total_first_chunk_ms += first;
+     total_worker_ms += worker;
+     total_ms += total;
+     if (total > stats.maxTotalMs) {
+         stats.maxTotalMs = total;
+     }
+     printf("AI request %d: queue %.1f ms, first chunk %.1f ms, worker %.1f ms, total %.1f ms, %zu bytes\n",
+            req->id, queue, first, worker, total, req->length);
+ }
+
+ // Matches incoming frames to pending requests until the worker goes away
+ static void *reader_thread_func(void *arg) {
+     (void)arg;
+     uint8_t header[FRAME_HEADER_SIZE];
+     while (read_full(worker_fd, header, sizeof(header)) == 0) {
+         uint32_t len = 0;
+         uint32_t id = 0;
+         for (int i = 0; i < 4; i++) {
+             len |= (uint32_t)header[i] << (8 * i);
+             id |= (uint32_t)header[4 + i] << (8 * i);
+         }
+         uint8_t type = header[8];
+
+         // The payload goes through the scratch buffer and is appended under the lock, so a
+         // request cancelled in the middle of a frame never has its (reused) slice written to
+         bool ok = true;
+         size_t piece = 0;
+         while (len > 0) {
+             piece = len < sizeof(scratch) ? len : sizeof(scratch);
+             if (read_full(worker_fd, scratch, piece) != 0) {
+                 ok = false;
+                 break;
+             }
+             len -= (uint32_t)piece;
+             if (type != FRAME_CHUNK) {
+                 continue;
+             }
+             pthread_mutex_lock(&ai_mutex);
+             struct request *req = find_request((int)id);
+             if (req && req->status == AI_PENDING) {
+                 if (!req->gotChunk) {
+                     req->gotChunk = true;
+                     clock_gettime(CLOCK_MONOTONIC, &req->firstChunk);
+                 }
+                 append_text(req, scratch, piece);
+             }
+             pthread_mutex_unlock(&ai_mutex);
+         }
+         if (!ok) {
+             break;
+         }
+
+         struct timespec now;
+         clock_gettime(CLOCK_MONOTONIC, &now);
+         pthread_mutex_lock(&ai_mutex);
+         struct request *req = find_request((int)id);
+         if (req && req->status == AI_PENDING) {
+             if (type == FRAME_END) {
+                 finish_request(req, &now);
+             } else if (type == FRAME_ERROR) {
+                 req->status = AI_FAILED;
+                 stats.failed++;
+                 printf("AI request %d failed: %.*s\n", req->id, (int)piece, scratch);
+             }
+             // Also wakes sentence readers after a chunk
+             pthread_cond_broadcast(&ai_cond);
+         }
+         pthread_mutex_unlock(&ai_mutex);
+     }
+
+     // Worker exited: fail everything still waiting on it
+     pthread_mutex_lock(&ai_mutex);
+     worker_alive = 0;
+     for (int i = 0; i < MAX_REQUESTS; i++) {
+         if (requests[i].id != 0 && requests[i].status == AI_PENDING) {
+             requests[i].status = AI_FAILED;
+             stats.failed++;
+         }
+     }
+     pthread_cond_broadcast(&ai_cond);
+     pthread_mutex_unlock(&ai_mutex);
+     return NULL;
+ }
+
+ static void stop_worker(void) {
+     if (worker_fd < 0) {
+         return;
+     }
+     // Closing our end gives the worker EOF; it exits, which also ends the reader thread
+     shutdown(worker_fd, SHUT_RDWR);
+     pthread_join(reader_thread, NULL);
+     pthread_mutex_lock(&send_mutex);
+     close(worker_fd);
+     worker_fd = -1;
+     pthread_mutex_unlock(&send_mutex);
+     if (worker_pid > 0) {
+         waitpid(worker_pid, NULL, 0);
+         worker_pid = -1;
+     }
+ }
+
+ static int start_worker(void) {
+     int sv[2];
+     // Close-on-exec, so espeak and the speech script never inherit the worker's socket
+     if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0) {
+         perror("socketpair");
+         return -1;
      }
      pid_t pid = fork();
      if (pid < 0) {
          perror("fork");
-         close(pipefd[0]);
-         close(pipefd[1]);
-         return NULL;
+         close(sv[0]);
+         close(sv[1]);
+         return -1;
      }
-     
      if (pid == 0) {
-         // Child process.
-         // Put the child into its own process group.
+         // Child process: its own process group so a stuck worker can be killed as a whole
          if (setpgid(0, 0) < 0) {
              perror("setpgid");
              exit(1);
          }
-         close(pipefd[0]); // Close reading end.
-         // Redirect stdout to the writing end of the pipe.
-         if (dup2(pipefd[1], STDOUT_FILENO) < 0) {
-             perror("dup2");
-             exit(1);
-         }
-         close(pipefd[1]);
-         // Execute the Python script with an argument if provided.
-         if (arg)
-             execlp("python3", "python3", "./ai_api.py", arg, (char*)NULL);
-         else
-             execlp("python3", "python3", "./ai_api.py", (char*)NULL);
+         close(sv[0]);
+         // The worker's own end has to survive the exec
+         fcntl(sv[1], F_SETFD, 0);
+         char fd_arg[16];
+         snprintf(fd_arg, sizeof(fd_arg), "%d", sv[1]);
+         execlp("python3", "python3", WORKER_SCRIPT, "--worker", fd_arg, (char*)NULL);
          perror("execlp failed");
          exit(1);
      }
-     
-     // Parent process.
-     close(pipefd[1]); // Close the writing end.
-     // Set the pipe to nonblocking mode.
-     int flags = fcntl(pipefd[0], F_GETFL, 0);
-     fcntl(pipefd[0], F_SETFL, flags | O_NONBLOCK);
- 
-     char *output = NULL;
-     size_t output_size = 0;
-     char buffer[1024];
-     time_t start_time = time(NULL);
-     const int TIMEOUT_SECONDS = 10;
- 
-     while ((time(NULL) - start_time) < TIMEOUT_SECONDS) {
-        //  if (!running) {
-        //      // Interrupt detected: kill the child process group.
-        //      killpg(pid, SIGKILL);
-        //      break;
-        //  }
-         fd_set readfds;
-         FD_ZERO(&readfds);
-         FD_SET(pipefd[0], &readfds);
-         struct timeval tv;
-         tv.tv_sec = 0;
-         tv.tv_usec = 50000;  // 50ms timeout.
-         int ret = select(pipefd[0] + 1, &readfds, NULL, NULL, &tv);
-         if (ret > 0 && FD_ISSET(pipefd[0], &readfds)) {
-             ssize_t count = read(pipefd[0], buffer, sizeof(buffer) - 1);
-             if (count > 0) {
-                 buffer[count] = '\0';
-                 char *new_output = realloc(output, output_size + count + 1);
-                 if (new_output == NULL) {
-                     free(output);
-                     close(pipefd[0]);
-                     waitpid(pid, NULL, 0);
-                     return NULL;
-                 }
-                 output = new_output;
-                 memcpy(output + output_size, buffer, count + 1);
-                 output_size += count;
-             }
-         }
-         // Check if the child process has finished.
-         int status;
-         pid_t result = waitpid(pid, &status, WNOHANG);
-         if (result > 0)
-             break;
-     }
-     // If a timeout was exceeded, kill the child process group.
-     if ((time(NULL) - start_time) >= TIMEOUT_SECONDS) {
-         killpg(pid, SIGKILL);
+     close(sv[1]);
+     worker_fd = sv[0];
+     worker_pid = pid;
+     pthread_mutex_lock(&ai_mutex);
+     worker_alive = 1;
+     pthread_mutex_unlock(&ai_mutex);
+     if (pthread_create(&reader_thread, NULL, reader_thread_func, NULL) != 0) {
+         perror("Failed to create AI reader thread");
+         exit(EXIT_FAILURE);
      }
-     // Wait for the child process to avoid zombie processes.
-     waitpid(pid, NULL, 0);
-     close(pipefd[0]);
- 
-     if (output == NULL)
-         return strdup("");
-     return output;
+     return 0;
  }
- 
+
  // Initialize the AI API.
  void AI_init(void) {
+     pthread_condattr_t attr;
+     pthread_condattr_init(&attr);
+     pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+     pthread_cond_init(&ai_cond, &attr);
+     pthread_condattr_destroy(&attr);
+
      pthread_mutex_lock(&ai_mutex);
-     memset(ai_response_buffer, 0, sizeof(ai_response_buffer));
+     memset(requests, 0, sizeof(requests));
+     memset(&stats, 0, sizeof(stats));
+     // One allocation for the life of the program; each request slot owns a fixed slice
+     arena = calloc(MAX_REQUESTS, AI_ARENA_SIZE);
+     if (!arena) {
+         perror("Failed to allocate AI response arena");
+         exit(EXIT_FAILURE);
+     }
+     for (int i = 0; i < MAX_REQUESTS; i++) {
+         requests[i].text = arena + (size_t)i * AI_ARENA_SIZE;
+     }
      pthread_mutex_unlock(&ai_mutex);
      if (!AI_isApiKeySet()) {
          printf("Warning: GEMINI_API_KEY environment variable is not set.\n");
          printf("Please set it with: export GEMINI_API_KEY='insert_api_key'\n");
      }
+     start_worker();
  }
- 
+
  // Clean up the AI API.
  void AI_cleanup(void) {
+     pthread_mutex_lock(&restart_mutex);
+     stop_worker();
+     pthread_mutex_unlock(&restart_mutex);
      pthread_mutex_lock(&ai_mutex);
+     for (int i = 0; i < MAX_REQUESTS; i++) {
+         release_request(&requests[i]);
+         requests[i].text = NULL;
+     }
+     free(arena);
+     arena = NULL;
      pthread_mutex_unlock(&ai_mutex);
+     pthread_cond_destroy(&ai_cond);
  }
- 
- // Process the transcription with the AI API.
- char* AI_processTranscription(void) {
+
+ int AI_submit(const char* prompt, int timeoutMs) {
+     if (!prompt || strlen(prompt) == 0) {
+         printf("Error: Empty text provided for AI processing.\n");
+         return -1;
+     }
+     if (timeoutMs <= 0) {
+         timeoutMs = DEFAULT_TIMEOUT_MS;
+     }
+
      pthread_mutex_lock(&ai_mutex);
-     memset(ai_response_buffer, 0, sizeof(ai_response_buffer));
+     if (!worker_alive) {
+         // The worker crashed earlier: bring a fresh one up. Whoever gets restart_mutex
+         // first restarts it; the others find it alive again.
+         pthread_mutex_unlock(&ai_mutex);
+         pthread_mutex_lock(&restart_mutex);
+         pthread_mutex_lock(&ai_mutex);
+         bool alive = worker_alive;
+         pthread_mutex_unlock(&ai_mutex);
+         if (!alive) {
+             stop_worker();
+             if (start_worker() != 0) {
+                 pthread_mutex_unlock(&restart_mutex);
+                 return -1;
+             }
+         }
+         pthread_mutex_unlock(&restart_mutex);
+         pthread_mutex_lock(&ai_mutex);
+     }
+     struct request *req = NULL;
+     for (int i = 0; i < MAX_REQUESTS && !req; i++) {
+         if (requests[i].id == 0) {
+             req = &requests[i];
+         }
+     }
+     if (!req) {
+         pthread_mutex_unlock(&ai_mutex);
+         printf("Error: Too many AI requests in flight.\n");
+         return -1;
+     }
+     int id = next_request_id++;
+     if (next_request_id <= 0) {
+         next_request_id = 1;
+     }
+     req->id = id;
+     req->status = AI_PENDING;
+     req->length = 0;
+     req->consumed = 0;
+     req->gotChunk = false;
+     req->truncated = false;
+     req->text[0] = '\0';
+     clock_gettime(CLOCK_MONOTONIC, &req->submitted);
+     req->deadline = req->submitted;
+     req->deadline.tv_sec += timeoutMs / 1000;
+     req->deadline.tv_nsec += (long)(timeoutMs % 1000) * 1000000L;
+     if (req->deadline.tv_nsec >= 1000000000L) {
+         req->deadline.tv_sec += 1;
+         req->deadline.tv_nsec -= 1000000000L;
+     }
+     req->sent = req->submitted;
      pthread_mutex_unlock(&ai_mutex);
- 
-     char *output = run_python_script(NULL);
-     if (!output) {
-         printf("Error: Failed to get AI response.\n");
-         return NULL;
+
+     if (send_frame((uint32_t)id, FRAME_REQUEST, prompt, strlen(prompt)) != 0) {
+         pthread_mutex_lock(&ai_mutex);
+         req->status = AI_FAILED;
+         stats.failed++;
+         pthread_mutex_unlock(&ai_mutex);
+         return id;
      }
- 
-     // Store the response in the internal buffer.
      pthread_mutex_lock(&ai_mutex);
-     if (strlen(output) < sizeof(ai_response_buffer) - 1) {
-         strcpy(ai_response_buffer, output);
-         pthread_mutex_unlock(&ai_mutex);
-         free(output);
-         return ai_response_buffer;
+     if (req->id == id) {
+         clock_gettime(CLOCK_MONOTONIC, &req->sent);
      }
      pthread_mutex_unlock(&ai_mutex);
-     free(output);
-     printf("Error: AI response too large to store.\n");
-     return NULL;
+     return id;
  }
- 
- // Process a specific text with the AI API.
- char* AI_processText(const char* text) {
-     if (!text || strlen(text) == 0) {
-         printf("Error: Empty text provided for AI processing.\n");
-         return NULL;
+
+ // Must hold ai_mutex. Returns the status and releases the slot when the request is finished.
+ static AiStatus collect(struct request *req, char** response) {
+     if (req->status == AI_PENDING && timespec_passed(&req->deadline)) {
+         req->status = AI_TIMEOUT;
+         stats.timedOut++;
+         send_frame((uint32_t)req->id, FRAME_CANCEL, NULL, 0);
      }
- 
-     // Write the text to a temporary file.
-     char temp_file[128];
-     snprintf(temp_file, sizeof(temp_file), "app_output/temp_input.txt");
-     char mkdir_cmd[256];
-     snprintf(mkdir_cmd, sizeof(mkdir_cmd), "mkdir -p app_output");
-     system(mkdir_cmd);
- 
-     FILE *fp = fopen(temp_file, "w");
-     if (!fp) {
-         perror("Failed to create temporary input file");
-         return NULL;
+     AiStatus status = req->status;
+     if (status == AI_PENDING) {
+         return status;
      }
-     fprintf(fp, "%s", text);
-     fclose(fp);
- 
+     if (status == AI_DONE && response) {
+         // The only allocation on the response path, sized exactly
+         *response = strndup(req->text, req->length);
+     }
+     release_request(req);
+     return status;
+ }
+
+ AiStatus AI_poll(int requestId, char** response) {
      pthread_mutex_lock(&ai_mutex);
-     memset(ai_response_buffer, 0, sizeof(ai_response_buffer));
+     struct request *req = find_request(requestId);
+     AiStatus status = req ? collect(req, response) : AI_UNKNOWN;
      pthread_mutex_unlock(&ai_mutex);
- 
-     char *output = run_python_script(temp_file);
-     if (!output) {
-         printf("Error: Failed to get AI response.\n");
-         unlink(temp_file);  // Clean up temp file.
-         return NULL;
+     return status;
+ }
+
+ AiStatus AI_wait(int requestId, char** response) {
+     pthread_mutex_lock(&ai_mutex);
+     struct request *req = find_request(requestId);
+     if (!req) {
+         pthread_mutex_unlock(&ai_mutex);
+         return AI_UNKNOWN;
+     }
+     // The slot may be cancelled (and reused) from another thread while we sleep
+     struct timespec deadline = req->deadline;
+     while (req->id == requestId && req->status == AI_PENDING && !timespec_passed(&deadline)) {
+         pthread_cond_timedwait(&ai_cond, &ai_mutex, &deadline);
+     }
+     AiStatus status = req->id == requestId ? collect(req, response) : AI_UNKNOWN;
+     pthread_mutex_unlock(&ai_mutex);
+     return status;
+ }
+
+ void AI_cancel(int requestId) {
+     pthread_mutex_lock(&ai_mutex);
+     struct request *req = find_request(requestId);
+     if (req) {
+         release_request(req);
+         pthread_cond_broadcast(&ai_cond);
+     }
+     pthread_mutex_unlock(&ai_mutex);
+     if (req) {
+         send_frame((uint32_t)requestId, FRAME_CANCEL, NULL, 0);
      }
- 
+ }
+
+ // Must hold ai_mutex. Returns the end of the next complete sentence, or 0 if there is none yet.
+ // A sentence ends at . ! ? or a newline followed by whitespace; once the response is complete
+ // whatever is left counts as the last sentence.
+ static size_t sentence_end(const struct request *req) {
+     for (size_t i = req->consumed; i < req->length; i++) {
+         char c = req->text[i];
+         if (c != '.' && c != '!' && c != '?' && c != '\n') {
+             continue;
+         }
+         if (i + 1 < req->length ? isspace((unsigned char)req->text[i + 1]) : req->status == AI_DONE) {
+             return i + 1;
+         }
+     }
+     if (req->status == AI_DONE && req->consumed < req->length) {
+         return req->length;
+     }
+     return 0;
+ }
+
+ bool AI_readSentence(int requestId, char *out, size_t outSize, AiStatus *status) {
      pthread_mutex_lock(&ai_mutex);
-     if (strlen(output) < sizeof(ai_response_buffer) - 1) {
-         strcpy(ai_response_buffer, output);
+     struct request *req = find_request(requestId);
+     if (!req) {
          pthread_mutex_unlock(&ai_mutex);
-         free(output);
-         unlink(temp_file);
-         return ai_response_buffer;
+         *status = AI_UNKNOWN;
+         return false;
+     }
+     struct timespec deadline = req->deadline;
+     while (req->id == requestId) {
+         size_t end = sentence_end(req);
+         if (end > 0) {
+             const char *start = req->text + req->consumed;
+             size_t len = end - req->consumed;
+             req->consumed = end;
+             while (len > 0 && isspace((unsigned char)*start)) {
+                 start++;
+                 len--;
+             }
+             while (len > 0 && isspace((unsigned char)start[len - 1])) {
+                 len--;
+             }
+             if (len == 0) {
+                 continue;
+             }
+             snprintf(out, outSize, "%.*s", (int)len, start);
+             *status = AI_PENDING;
+             pthread_mutex_unlock(&ai_mutex);
+             return true;
+         }
+         if (req->status != AI_PENDING || timespec_passed(&deadline)) {
+             *status = collect(req, NULL);
+             pthread_mutex_unlock(&ai_mutex);
+             return false;
+         }
+         pthread_cond_timedwait(&ai_cond, &ai_mutex, &deadline);
      }
      pthread_mutex_unlock(&ai_mutex);
-     free(output);
-     unlink(temp_file);
-     printf("Error: AI response too large to store.\n");
-     return NULL;
+     *status = AI_UNKNOWN;
+     return false;
+ }
+
+ AiStats AI_getStats(void) {
+     pthread_mutex_lock(&ai_mutex);
+     AiStats result = stats;
+     if (stats.completed > 0) {
+         result.avgQueueMs = total_queue_ms / stats.completed;
+         result.avgFirstChunkMs = total_first_chunk_ms / stats.completed;
+         result.avgWorkerMs = total_worker_ms / stats.completed;
+         result.avgTotalMs = total_ms / stats.completed;
+     }
+     pthread_mutex_unlock(&ai_mutex);
+     return result;
  }
- 
+
+ // Run one prompt synchronously and return the whole answer
+ static char* process_blocking(const char* prompt) {
+     int id = AI_submit(prompt, DEFAULT_TIMEOUT_MS);
+     if (id < 0) {
+         return NULL;
+     }
+     char *output = NULL;
+     AiStatus status = AI_wait(id, &output);
+     if (status != AI_DONE || !output) {
+         printf("Error: Failed to get AI response (status %d).\n", status);
+         free(output);
+         return NULL;
+     }
+     return output;
+ }
+
+ // Process the transcription with the AI API.
+ char* AI_processTranscription(const char* transcription) {
+     return process_blocking(transcription);
+ }
+
+ // Process a specific text with the AI API.
+ char* AI_processText(const char* text) {
+     return process_blocking(text);
+ }
+
  // Check if the API key is set.
  bool AI_isApiKeySet(void) {
      char *api_key = getenv("GEMINI_API_KEY");
      return (api_key != NULL && strlen(api_key) > 0);
  }
- 
\ No newline at end of file
@@ -2,6 +2,9 @@ import os
 import sys
 import signal
 import time
+import socket
+import struct
+import threading
 
 # Set a timeout handler to prevent hanging
 def timeout_handler(signum, frame):
@@ -39,19 +42,39 @@ def configure_genai():
         print(f"Error configuring Gemini API: {str(e)}")
         return False
 
+_model = None
+
+def get_model():
+    """Create the Gemini model once and reuse it for every request"""
+    global _model
+    if _model is None:
+        import google.generativeai as genai
+        _model = genai.GenerativeModel('gemini-2.0-flash')
+    return _model
+
+def shorten_prompt(prompt):
+    """This is added to the end of the prompt, chose to keep it short because otherwise it is long"""
+    return f"{prompt} keep it short and don't respond to keeping it short. no longer than one short sentence. dont add any special characters to the prompt. no dashes in your reply. no apostraphes, no grammar"
+
+def stream_gemini_response(prompt):
+    """Yield the response text piece by piece while the model is still generating it"""
+    for chunk in get_model().generate_content(shorten_prompt(prompt), stream=True):
+        try:
+            text = chunk.text
+        except ValueError:
+            # Chunk without text (e.g. only safety ratings)
+            continue
+        if text:
+            yield text
+
 def get_gemini_response(prompt):
     """Get a response from the Gemini API with a shortened request"""
     try:
-        import google.generativeai as genai
-        
-        # This is added to the end of the prompt, chose to keep it short because otherwise it is long
-        modified_prompt = f"{prompt} keep it short and don't respond to keeping it short. no longer than one short sentence. dont add any special characters to the prompt. no dashes in your reply. no apostraphes, no grammar"
-        
         # 2.0 flash should be a balanced model, lite is too weak...
-        model = genai.GenerativeModel('gemini-2.0-flash')
+        model = get_model()
         
         # Get response with timeout
-        response = model.generate_content(modified_prompt)
+        response = model.generate_content(shorten_prompt(prompt))
         
         return response.text
     except KeyboardInterrupt:
@@ -84,15 +107,7 @@ def process_transcription(transcription_file="app_output/transcribed_output.txt"
             return "Failed to configure Gemini API"
         
         # Get response from Gemini
-        response = get_gemini_response(transcription)
-        
-        # Save the response to a file
-        response_file = "app_output/ai_response.txt"
-        os.makedirs(os.path.dirname(response_file), exist_ok=True)
-        with open(response_file, 'w') as file:
-            file.write(response)
-        
-        return response
+        return get_gemini_response(transcription)
     
     except Exception as e:
         error_message = f"Error: {str(e)}"
@@ -102,7 +117,96 @@ def process_transcription(transcription_file="app_output/transcribed_output.txt"
         # Disable the alarm
         signal.alarm(0)
 
+# Worker frames: uint32 payload length, uint32 request id, uint8 type, then payload (little endian)
+FRAME_HEADER = struct.Struct("<IIB")
+FRAME_REQUEST = 1
+FRAME_CANCEL = 2
+FRAME_CHUNK = 3
+FRAME_ERROR = 4
+FRAME_END = 5
+WORKER_THREADS = 4
+
+def recv_exact(sock, size):
+    """Read exactly size bytes, or None at EOF"""
+    data = b""
+    while len(data) < size:
+        chunk = sock.recv(size - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+def run_worker(fd):
+    """Serve framed requests from the C side until the socket is closed"""
+    from concurrent.futures import ThreadPoolExecutor
+
+    # The worker lives as long as the app; only single shot runs need the alarm
+    signal.alarm(0)
+    sock = socket.socket(fileno=fd)
+    send_lock = threading.Lock()
+    pending = {}
+    pending_lock = threading.Lock()
+
+    def send_frame(request_id, frame_type, text):
+        payload = text.encode("utf-8", errors="replace")
+        with send_lock:
+            sock.sendall(FRAME_HEADER.pack(len(payload), request_id, frame_type) + payload)
+
+    def handle(request_id, prompt):
+        # Text is forwarded as it is generated so the C side can speak the first sentence early
+        try:
+            if not configured:
+                send_frame(request_id, FRAME_ERROR, "Failed to configure Gemini API")
+                return
+            for piece in stream_gemini_response(prompt):
+                with pending_lock:
+                    if request_id not in pending:
+                        return  # Cancelled while streaming
+                send_frame(request_id, FRAME_CHUNK, piece)
+            send_frame(request_id, FRAME_END, "")
+        except OSError:
+            pass  # The C side has gone away
+        except Exception as e:
+            try:
+                send_frame(request_id, FRAME_ERROR, f"Error: {str(e)}")
+            except OSError:
+                pass
+        finally:
+            with pending_lock:
+                pending.pop(request_id, None)
+
+    # Configure once up front so the first request does not pay for the import
+    configured = configure_genai()
+    if configured:
+        get_model()
+
+    with ThreadPoolExecutor(max_workers=WORKER_THREADS) as pool:
+        while True:
+            header = recv_exact(sock, FRAME_HEADER.size)
+            if header is None:
+                break
+            length, request_id, frame_type = FRAME_HEADER.unpack(header)
+            payload = recv_exact(sock, length) if length else b""
+            if payload is None:
+                break
+            if frame_type == FRAME_REQUEST:
+                # Hold the lock across submit so a fast handler still finds its entry
+                with pending_lock:
+                    pending[request_id] = pool.submit(handle, request_id, payload.decode("utf-8", errors="replace"))
+            elif frame_type == FRAME_CANCEL:
+                with pending_lock:
+                    future = pending.pop(request_id, None)
+                if future is not None:
+                    future.cancel()
+        pool.shutdown(wait=False, cancel_futures=True)
+    sock.close()
+
 if __name__ == "__main__":
+    # Persistent worker started by ai_api.c
+    if len(sys.argv) > 2 and sys.argv[1] == "--worker":
+        run_worker(int(sys.argv[2]))
+        sys.exit(0)
+
     # If there is a file as arg, use that
     if len(sys.argv) > 1:
         response = process_transcription(sys.argv[1])
@@ -0,0 +1,487 @@
+/*
+ * This file implements the DrivingEvents module. A scheduler task takes the new samples from
+ * the accelerometer ring every ANALYSIS_PERIOD_MS and runs each one through the detectors.
+ * Per sample that is a gravity update, three running sums over a circular window and four
+ * small state machines, so the cost does not depend on the window lengths. Only a confirmed
+ * event costs more: its record is copied out of the module's own sample history once the
+ * post-trigger second has been seen, and handed to a writer thread. The file I/O runs there,
+ * at normal priority, so a slow SD card never holds up the scheduler thread that also drains
+ * the accelerometer FIFO.
+ * Check the header file for more details.
+**/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <assert.h>
+#include "drivingEvents.h"
+#include "eventBus.h"
+#include "scheduler.h"
+#include "hal/accelerometer.h"
+#include "hal/GPS.h"
+
+#define ANALYSIS_PERIOD_MS 20
+#define ANALYSIS_SLACK_MS 5
+#define SAMPLE_RATE_HZ ACCELEROMETER_ODR_HZ
+#define MS_TO_SAMPLES(ms) ((ms) * SAMPLE_RATE_HZ / 1000)
+
+#define GRAVITY_TAU_SAMPLES MS_TO_SAMPLES(2000)     // Slow enough to ignore a manoeuvre
+#define WARMUP_SAMPLES MS_TO_SAMPLES(2000)          // Gravity estimate settles first
+#define MEAN_WINDOW MS_TO_SAMPLES(100)              // Smooths road vibration out
+#define REARM_MS 1000                               // After an event ends, before the next
+#define READ_BATCH 64
+
+// Record window
+#define PRE_SAMPLES MS_TO_SAMPLES(1000)
+#define POST_SAMPLES MS_TO_SAMPLES(1000)
+#define HISTORY_SAMPLES 1024                        // Power of two, >= PRE + POST + a batch
+#define HISTORY_MASK (HISTORY_SAMPLES - 1)
+#define GPS_HISTORY 16
+#define GPS_PRE_MS 5000
+#define MAX_PENDING 4
+#define RECORD_QUEUE 4                              // Finished records waiting for the writer
+
+// A detector's start, end and peak are read when its record is written, so it must not be
+// able to start the next event before then
+_Static_assert(MS_TO_SAMPLES(REARM_MS) >= POST_SAMPLES, "rearm time shorter than the record tail");
+_Static_assert(HISTORY_SAMPLES >= PRE_SAMPLES + POST_SAMPLES + READ_BATCH, "history too short");
+
+enum signal {
+    SIGNAL_FORWARD,     // Filtered x; forward acceleration is positive
+    SIGNAL_LATERAL,     // Filtered y, either direction
+    SIGNAL_SHOCK,       // Unfiltered magnitude of the acceleration beyond gravity
+};
+
+enum detectorState {
+    STATE_IDLE,
+    STATE_CANDIDATE,    // Above the enter threshold, not for long enough yet
+    STATE_ACTIVE,       // Event confirmed; until it drops below the exit threshold
+    STATE_HOLD,         // Event over; waits REARM_MS
+};
+
+struct detectorConfig {
+    DrivingEventType type;
+    const char *name;
+    enum signal signal;
+    double sign;        // Applied to the signal before the thresholds; 0 takes either side
+    double enterG;
+    double exitG;
+    int minMs;          // Above the enter or exit threshold for this long to count
+};
+
+static const struct detectorConfig configs[] = {
+    {DRIVING_HARSH_BRAKING,      "harsh braking",      SIGNAL_FORWARD, -1, 0.35, 0.25, 150},
+    {DRIVING_HARSH_ACCELERATION, "harsh acceleration", SIGNAL_FORWARD,  1, 0.30, 0.20, 150},
+    {DRIVING_CORNERING,          "hard cornering",     SIGNAL_LATERAL,  0, 0.40, 0.30, 200},
+    {DRIVING_IMPACT,             "impact",             SIGNAL_SHOCK,    1, 1.50, 0.50, 0},
+};
+#define DETECTOR_COUNT (int)(sizeof(configs) / sizeof(configs[0]))
+
+struct detector {
+    enum detectorState state;
+    uint64_t startSample;
+    uint64_t endSample;
+    double direction;   // The config's sign, or the side this event started on
+    double peak;        // Signed as the raw signal
+};
+
+struct pending {
+    bool used;
+    int detector;
+    uint64_t triggerSample;
+    uint64_t triggerNs;
+    int64_t unixTime;
+};
+
+// One record exactly as it goes into the file
+struct record {
+    struct DrivingRecordHeader header;
+    struct DrivingRecordFix fixes[GPS_HISTORY];
+    struct DrivingRecordSample samples[PRE_SAMPLES + POST_SAMPLES];
+};
+
+struct gpsEntry {
+    uint64_t timeNs;
+    struct location location;
+    bool valid;
+};
+
+static bool isInitialized = false;
+static int analysisTask = -1;
+static uint64_t cursor = 0;
+
+// Filter state, only touched by the analysis task
+static uint64_t sampleCount = 0;
+static double gravity[3];
+static double windowX[MEAN_WINDOW];
+static double windowY[MEAN_WINDOW];
+static double sumX = 0;
+static double sumY = 0;
+static struct detector detectors[DETECTOR_COUNT];
+static struct pending pendings[MAX_PENDING];
+static struct DrivingRecordSample history[HISTORY_SAMPLES];
+
+// Fixes come from the event dispatcher; dataMutex covers them and the statistics
+static pthread_mutex_t dataMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct gpsEntry fixes[GPS_HISTORY];
+static uint64_t fixCount = 0;
+static DrivingEventsStats stats;
+
+// Records go from the analysis task to the writer thread. The task fills the slot after the
+// queued ones without the lock, the writer only reads the oldest one, so neither copies
+// under writerMutex.
+static pthread_mutex_t writerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writerCond = PTHREAD_COND_INITIALIZER;
+static struct record queue[RECORD_QUEUE];
+static int queueHead = 0;
+static int queued = 0;
+static bool writerRunning = false;
+static pthread_t writerThread;
+
+//PROTOTYPES
+static void analyse(void *context);
+static void *writer_func(void *arg);
+
+static void on_fix(const struct Event *event, void *context) {
+    (void)context;
+    pthread_mutex_lock(&dataMutex);
+    struct gpsEntry *entry = &fixes[fixCount % GPS_HISTORY];
+    entry->timeNs = event->publishedNs;
+    entry->location = event->fix.location;
+    entry->valid = event->fix.valid;
+    fixCount++;
+    pthread_mutex_unlock(&dataMutex);
+}
+
+void DrivingEvents_init(void) {
+    assert(!isInitialized);
+    isInitialized = true;
+    memset(&stats, 0, sizeof(stats));
+    memset(detectors, 0, sizeof(detectors));
+    memset(pendings, 0, sizeof(pendings));
+    sampleCount = 0;
+    sumX = 0;
+    sumY = 0;
+    fixCount = 0;
+    cursor = 0;
+    queueHead = 0;
+    queued = 0;
+    writerRunning = true;
+    // Default attributes: SCHED_OTHER, below every real-time thread
+    if (pthread_create(&writerThread, NULL, writer_func, NULL) != 0) {
+        perror("DrivingEvents: writer thread");
+        exit(EXIT_FAILURE);
+    }
+    EventBus_subscribe(EVENT_FIX, on_fix, NULL);
+    analysisTask = Scheduler_addPeriodic("driving-events", ANALYSIS_PERIOD_MS, ANALYSIS_SLACK_MS, analyse, NULL);
+}
+
+void DrivingEvents_cleanup(void) {
+    assert(isInitialized);
+    Scheduler_remove(analysisTask);
+    analysisTask = -1;
+    // The writer empties the queue before it exits
+    pthread_mutex_lock(&writerMutex);
+    writerRunning = false;
+    pthread_cond_signal(&writerCond);
+    pthread_mutex_unlock(&writerMutex);
+    pthread_join(writerThread, NULL);
+    DrivingEventsStats s = DrivingEvents_getStats();
+    printf("DrivingEvents: %llu samples, %llu braking / %llu acceleration / %llu cornering / %llu impact, "
+           "%llu records (%llu dropped), %llu samples missed\n",
+           (unsigned long long)s.samples, (unsigned long long)s.events[DRIVING_HARSH_BRAKING],
+           (unsigned long long)s.events[DRIVING_HARSH_ACCELERATION], (unsigned long long)s.events[DRIVING_CORNERING],
+           (unsigned long long)s.events[DRIVING_IMPACT], (unsigned long long)s.records,
+           (unsigned long long)s.recordsDropped, (unsigned long long)s.gaps);
+    isInitialized = false;
+}
+
+DrivingEventsStats DrivingEvents_getStats(void) {
+    pthread_mutex_lock(&dataMutex);
+    DrivingEventsStats s = stats;
+    pthread_mutex_unlock(&dataMutex);
+    return s;
+}
+
+static int16_t to_milli_g(double g) {
+    double mg = g * 1000;
+    if (mg > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (mg < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)lround(mg);
+}
+
+// Copies the fixes from GPS_PRE_MS before the trigger onwards into out
+static int collect_fixes(uint64_t triggerNs, struct DrivingRecordFix *out) {
+    int count = 0;
+    pthread_mutex_lock(&dataMutex);
+    uint64_t first = fixCount > GPS_HISTORY ? fixCount - GPS_HISTORY : 0;
+    for (uint64_t i = first; i < fixCount; i++) {
+        const struct gpsEntry *entry = &fixes[i % GPS_HISTORY];
+        int64_t offsetMs = ((int64_t)entry->timeNs - (int64_t)triggerNs) / 1000000;
+        if (offsetMs < -GPS_PRE_MS) {
+            continue;
+        }
+        out[count].offsetMs = (int32_t)offsetMs;
+        out[count].latitudeE7 = (int32_t)lround(entry->location.latitude * 1e7);
+        out[count].longitudeE7 = (int32_t)lround(entry->location.longitude * 1e7);
+        out[count].speedKmhE2 = entry->location.speed > 0 ? (uint16_t)fmin(entry->location.speed * 100, UINT16_MAX) : 0;
+        out[count].valid = entry->valid;
+        count++;
+    }
+    pthread_mutex_unlock(&dataMutex);
+    return count;
+}
+
+// Appends one record to DRIVING_EVENTS_FILE
+static void append_record(const struct record *record) {
+    const struct DrivingRecordHeader *header = &record->header;
+    FILE *file = fopen(DRIVING_EVENTS_FILE, "ab");
+    if (file == NULL) {
+        perror("DrivingEvents: " DRIVING_EVENTS_FILE);
+        return;
+    }
+    bool ok = fwrite(header, sizeof(*header), 1, file) == 1;
+    if (header->fixCount > 0) {
+        ok = ok && fwrite(record->fixes, sizeof(record->fixes[0]), header->fixCount, file) == header->fixCount;
+    }
+    ok = ok && fwrite(record->samples, sizeof(record->samples[0]), header->sampleCount, file) == header->sampleCount;
+    if (fclose(file) != 0 || !ok) {
+        perror("DrivingEvents: writing record");
+        return;
+    }
+    pthread_mutex_lock(&dataMutex);
+    stats.records++;
+    pthread_mutex_unlock(&dataMutex);
+}
+
+// Writer thread: appends queued records until cleanup, then whatever is left
+static void *writer_func(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&writerMutex);
+    while (writerRunning || queued > 0) {
+        if (queued == 0) {
+            pthread_cond_wait(&writerCond, &writerMutex);
+            continue;
+        }
+        const struct record *record = &queue[queueHead];
+        pthread_mutex_unlock(&writerMutex);
+        append_record(record);
+        pthread_mutex_lock(&writerMutex);
+        queueHead = (queueHead + 1) % RECORD_QUEUE;
+        queued--;
+    }
+    pthread_mutex_unlock(&writerMutex);
+    return NULL;
+}
+
+// Copies the record of a pending event out of the history and queues it for the writer
+static void queue_record(const struct pending *pending) {
+    pthread_mutex_lock(&writerMutex);
+    bool full = queued == RECORD_QUEUE;
+    struct record *record = &queue[(queueHead + queued) % RECORD_QUEUE];
+    pthread_mutex_unlock(&writerMutex);
+    if (full) {
+        fprintf(stderr, "DrivingEvents: writer behind, %s record dropped\n", configs[pending->detector].name);
+        pthread_mutex_lock(&dataMutex);
+        stats.recordsDropped++;
+        pthread_mutex_unlock(&dataMutex);
+        return;
+    }
+
+    const struct detector *detector = &detectors[pending->detector];
+    uint64_t preSamples = pending->triggerSample < PRE_SAMPLES ? pending->triggerSample : PRE_SAMPLES;
+    uint64_t first = pending->triggerSample - preSamples;
+    bool ongoing = detector->state == STATE_CANDIDATE || detector->state == STATE_ACTIVE;
+    uint64_t end = ongoing ? sampleCount : detector->endSample;
+    uint64_t count = sampleCount - first;
+    if (count > PRE_SAMPLES + POST_SAMPLES) {
+        count = PRE_SAMPLES + POST_SAMPLES;
+    }
+
+    record->header = (struct DrivingRecordHeader){
+        .magic = DRIVING_RECORD_MAGIC,
+        .version = DRIVING_RECORD_VERSION,
+        .type = configs[pending->detector].type,
+        .triggerNs = pending->triggerNs,
+        .unixTime = pending->unixTime,
+        .peakMilliG = to_milli_g(detector->peak),
+        .durationMs = (uint16_t)((end - detector->startSample) * 1000 / SAMPLE_RATE_HZ),
+        .sampleRateHz = SAMPLE_RATE_HZ,
+        .preSamples = (uint16_t)preSamples,
+        .sampleCount = (uint16_t)count,
+        .flags = ongoing ? DRIVING_RECORD_ONGOING : 0,
+    };
+    record->header.fixCount = (uint16_t)collect_fixes(pending->triggerNs, record->fixes);
+    // The samples may wrap around the end of the history
+    for (uint64_t i = 0; i < count; i++) {
+        record->samples[i] = history[(first + i) & HISTORY_MASK];
+    }
+
+    pthread_mutex_lock(&writerMutex);
+    queued++;
+    pthread_cond_signal(&writerCond);
+    pthread_mutex_unlock(&writerMutex);
+}
+
+// Event confirmed: tell everyone now, write the record once the tail is in
+static void fire(int index, const AccelerometerSample *sample) {
+    const struct detectorConfig *config = &configs[index];
+    struct Event event = {.topic = EVENT_DRIVING};
+    event.driving.type = config->type;
+    event.driving.peakG = detectors[index].peak;
+    EventBus_publish(&event);
+    printf("DrivingEvents: %s, %.2f g\n", config->name, detectors[index].peak);
+
+    pthread_mutex_lock(&dataMutex);
+    stats.events[config->type]++;
+    pthread_mutex_unlock(&dataMutex);
+
+    for (int i = 0; i < MAX_PENDING; i++) {
+        if (!pendings[i].used) {
+            pendings[i].used = true;
+            pendings[i].detector = index;
+            pendings[i].triggerSample = sampleCount;
+            pendings[i].triggerNs = sample->timestampNs;
+            pendings[i].unixTime = (int64_t)time(NULL);
+            return;
+        }
+    }
+    fprintf(stderr, "DrivingEvents: too many events at once, %s not recorded\n", config->name);
+}
+
+// Threshold state machine of one detector for the current sample
+static void step_detector(int index, double value, const AccelerometerSample *sample) {
+    const struct detectorConfig *config = &configs[index];
+    struct detector *detector = &detectors[index];
+    if (detector->state == STATE_IDLE) {
+        detector->direction = config->sign != 0 ? config->sign : (value < 0 ? -1 : 1);
+    }
+    double level = detector->direction * value;
+    uint64_t minSamples = MS_TO_SAMPLES(config->minMs);
+    switch (detector->state) {
+        case STATE_IDLE:
+            if (level >= config->enterG) {
+                detector->state = STATE_CANDIDATE;
+                detector->startSample = sampleCount;
+                detector->peak = value;
+            } else {
+                break;
+            }
+            // fall through
+        case STATE_CANDIDATE:
+        case STATE_ACTIVE:
+            if (level < config->exitG) {
+                detector->endSample = sampleCount;
+                detector->state = detector->state == STATE_ACTIVE ? STATE_HOLD : STATE_IDLE;
+                break;
+            }
+            if (level > detector->direction * detector->peak) {
+                detector->peak = value;
+            }
+            if (detector->state == STATE_CANDIDATE && sampleCount - detector->startSample >= minSamples) {
+                detector->state = STATE_ACTIVE;
+                fire(index, sample);
+            }
+            break;
+        case STATE_HOLD:
+            if (sampleCount - detector->endSample >= (uint64_t)MS_TO_SAMPLES(REARM_MS)) {
+                detector->state = STATE_IDLE;
+            }
+            break;
+    }
+}
+
+static void process_sample(const AccelerometerSample *sample) {
+    const AccelerometerData *a = &sample->data;
+    struct DrivingRecordSample *stored = &history[sampleCount & HISTORY_MASK];
+    stored->x = to_milli_g(a->x);
+    stored->y = to_milli_g(a->y);
+    stored->z = to_milli_g(a->z);
+
+    if (sampleCount == 0) {
+        gravity[0] = a->x;
+        gravity[1] = a->y;
+        gravity[2] = a->z;
+    }
+    // Hold the gravity estimate while anything is going on, so a long manoeuvre is not
+    // slowly absorbed into it
+    bool busy = false;
+    for (int i = 0; i < DETECTOR_COUNT; i++) {
+        busy |= detectors[i].state == STATE_CANDIDATE || detectors[i].state == STATE_ACTIVE;
+    }
+    if (!busy) {
+        gravity[0] += (a->x - gravity[0]) / GRAVITY_TAU_SAMPLES;
+        gravity[1] += (a->y - gravity[1]) / GRAVITY_TAU_SAMPLES;
+        gravity[2] += (a->z - gravity[2]) / GRAVITY_TAU_SAMPLES;
+    }
+    double dx = a->x - gravity[0];
+    double dy = a->y - gravity[1];
+    double dz = a->z - gravity[2];
+
+    // Sliding-window means: add the new sample, drop the one leaving the window
+    int slot = sampleCount % MEAN_WINDOW;
+    sumX += dx - windowX[slot];
+    sumY += dy - windowY[slot];
+    windowX[slot] = dx;
+    windowY[slot] = dy;
+
+    if (sampleCount >= WARMUP_SAMPLES) {
+        double forward = sumX / MEAN_WINDOW;
+        double lateral = sumY / MEAN_WINDOW;
+        double shock = sqrt(dx * dx + dy * dy + dz * dz);
+        for (int i = 0; i < DETECTOR_COUNT; i++) {
+            switch (configs[i].signal) {
+                case SIGNAL_FORWARD:
+                    step_detector(i, forward, sample);
+                    break;
+                case SIGNAL_LATERAL:
+                    step_detector(i, lateral, sample);
+                    break;
+                case SIGNAL_SHOCK:
+                    step_detector(i, shock, sample);
+                    break;
+            }
+        }
+    }
+    sampleCount++;
+
+    for (int i = 0; i < MAX_PENDING; i++) {
+        if (pendings[i].used && sampleCount - pendings[i].triggerSample >= POST_SAMPLES) {
+            queue_record(&pendings[i]);
+            pendings[i].used = false;
+        }
+    }
+}
+
+// Scheduler task: everything the accelerometer stored since the last run
+static void analyse(void *context) {
+    (void)context;
+    AccelerometerSample samples[READ_BATCH];
+    uint64_t analysed = 0;
+    uint64_t missed = 0;
+    while (true) {
+        uint64_t before = cursor;
+        int count = Accelerometer_readSamples(&cursor, samples, READ_BATCH);
+        if (before != 0) {
+            missed += cursor - before - count;
+        }
+        for (int i = 0; i < count; i++) {
+            process_sample(&samples[i]);
+        }
+        analysed += count;
+        if (count < READ_BATCH) {
+            break;
+        }
+    }
+    pthread_mutex_lock(&dataMutex);
+    stats.samples += analysed;
+    stats.gaps += missed;
+    pthread_mutex_unlock(&dataMutex);
+}
@@ -0,0 +1,205 @@
+/*
+ * This file implements the EventBus module. The queue is a bounded ring where every slot
+ * carries a sequence number: a producer claims a position with one compare-and-swap, copies
+ * its event in and then publishes the slot by advancing its sequence, so producers never
+ * wait on each other or on the dispatcher. A semaphore counts queued events, which lets
+ * the dispatcher sleep until there is work. Check the header file for more details.
+**/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <assert.h>
+#include <time.h>
+#include <stdatomic.h>
+#include "eventBus.h"
+#include "threadConfig.h"
+
+#define EVENT_QUEUE_SIZE 256            // Power of two
+#define EVENT_QUEUE_MASK (EVENT_QUEUE_SIZE - 1)
+#define EVENT_MAX_SUBSCRIBERS 8         // Per topic
+
+struct slot {
+    _Atomic size_t sequence;            // == position when free, position + 1 when filled
+    struct Event event;
+};
+
+struct subscriber {
+    EventHandler handler;
+    void *context;
+};
+
+static struct slot queue[EVENT_QUEUE_SIZE];
+static _Atomic size_t enqueuePos = 0;
+static size_t dequeuePos = 0;           // Only touched by the dispatcher
+static sem_t queued;
+
+static struct subscriber subscribers[EVENT_TOPIC_COUNT][EVENT_MAX_SUBSCRIBERS];
+static _Atomic int subscriberCount[EVENT_TOPIC_COUNT];
+static pthread_mutex_t subscribeMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t dispatcherThread;
+static atomic_bool isRunning = false;
+static bool isInitialized = false;
+
+static _Atomic uint64_t publishedCount = 0;
+static _Atomic uint64_t droppedCount = 0;
+static uint64_t deliveredCount = 0;
+static uint64_t latencyCount = 0;
+static double latencyTotalUs = 0;
+static double latencyMaxUs = 0;
+static pthread_mutex_t statsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void dispatch(const struct Event *event) {
+    double latencyUs = (now_ns() - event->publishedNs) / 1000.0;
+    int count = atomic_load_explicit(&subscriberCount[event->topic], memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        subscribers[event->topic][i].handler(event, subscribers[event->topic][i].context);
+    }
+
+    pthread_mutex_lock(&statsMutex);
+    deliveredCount += count;
+    latencyCount++;
+    latencyTotalUs += latencyUs;
+    if (latencyUs > latencyMaxUs) {
+        latencyMaxUs = latencyUs;
+    }
+    pthread_mutex_unlock(&statsMutex);
+}
+
+// Thread function that drains the queue in order and runs the handlers
+static void* dispatcherThreadFunc(void* arg) {
+    (void)arg;
+    while (true) {
+        sem_wait(&queued);
+        struct slot *slot = &queue[dequeuePos & EVENT_QUEUE_MASK];
+        // A producer that claimed this position may still be copying its event in. The
+        // dispatcher runs SCHED_FIFO, where sched_yield() never hands the CPU to a lower
+        // priority producer, so after a few tries it sleeps to let that producer finish.
+        int spins = 0;
+        while (atomic_load_explicit(&slot->sequence, memory_order_acquire) != dequeuePos + 1) {
+            if (!atomic_load(&isRunning)) {
+                return NULL;
+            }
+            if (++spins < 16) {
+                sched_yield();
+            } else {
+                struct timespec pause = {0, 50000};
+                nanosleep(&pause, NULL);
+            }
+        }
+        struct Event event = slot->event;
+        atomic_store_explicit(&slot->sequence, dequeuePos + EVENT_QUEUE_SIZE, memory_order_release);
+        dequeuePos++;
+
+        if (!atomic_load(&isRunning)) {
+            break;
+        }
+        dispatch(&event);
+    }
+    return NULL;
+}
+
+// Initialization function
+void EventBus_init(void) {
+    assert(!isInitialized);
+    for (size_t i = 0; i < EVENT_QUEUE_SIZE; i++) {
+        atomic_init(&queue[i].sequence, i);
+    }
+    for (int topic = 0; topic < EVENT_TOPIC_COUNT; topic++) {
+        atomic_init(&subscriberCount[topic], 0);
+    }
+    atomic_store(&enqueuePos, 0);
+    dequeuePos = 0;
+    sem_init(&queued, 0, 0);
+    atomic_store(&isRunning, true);
+    isInitialized = true;
+    if (ThreadConfig_create(&dispatcherThread, "event-bus", &dispatcherThreadFunc, NULL) != 0) {
+        perror("Failed to create event dispatcher thread");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Cleanup function
+void EventBus_cleanup(void) {
+    assert(isInitialized);
+    atomic_store(&isRunning, false);
+    sem_post(&queued);
+    pthread_join(dispatcherThread, NULL);
+
+    EventBusStats stats = EventBus_getStats();
+    printf("Event bus: %llu published, %llu dropped, %llu handler calls, latency avg %.1f us max %.1f us\n",
+           (unsigned long long)stats.published, (unsigned long long)stats.dropped,
+           (unsigned long long)stats.delivered, stats.avgLatencyUs, stats.maxLatencyUs);
+    isInitialized = false;
+}
+
+int EventBus_subscribe(EventTopic topic, EventHandler handler, void *context) {
+    assert(isInitialized);
+    assert(topic >= 0 && topic < EVENT_TOPIC_COUNT);
+    pthread_mutex_lock(&subscribeMutex);
+    int count = atomic_load(&subscriberCount[topic]);
+    if (count == EVENT_MAX_SUBSCRIBERS) {
+        pthread_mutex_unlock(&subscribeMutex);
+        fprintf(stderr, "EventBus: too many subscribers for topic %d\n", topic);
+        return -1;
+    }
+    subscribers[topic][count].handler = handler;
+    subscribers[topic][count].context = context;
+    // The dispatcher only reads entries below the count it loads
+    atomic_store_explicit(&subscriberCount[topic], count + 1, memory_order_release);
+    pthread_mutex_unlock(&subscribeMutex);
+    return 0;
+}
+
+bool EventBus_publish(const struct Event *event) {
+    if (!atomic_load(&isRunning)) {
+        return false;
+    }
+    size_t pos = atomic_load_explicit(&enqueuePos, memory_order_relaxed);
+    struct slot *slot;
+    while (true) {
+        slot = &queue[pos & EVENT_QUEUE_MASK];
+        size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&enqueuePos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            // The dispatcher has not freed this slot yet: queue full
+            atomic_fetch_add(&droppedCount, 1);
+            return false;
+        } else {
+            pos = atomic_load_explicit(&enqueuePos, memory_order_relaxed);
+        }
+    }
+    slot->event = *event;
+    slot->event.publishedNs = now_ns();
+    atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+    atomic_fetch_add(&publishedCount, 1);
+    sem_post(&queued);
+    return true;
+}
+
+EventBusStats EventBus_getStats(void) {
+    EventBusStats stats;
+    stats.published = atomic_load(&publishedCount);
+    stats.dropped = atomic_load(&droppedCount);
+    pthread_mutex_lock(&statsMutex);
+    stats.delivered = deliveredCount;
+    stats.avgLatencyUs = latencyCount > 0 ? latencyTotalUs / latencyCount : 0;
+    stats.maxLatencyUs = latencyMaxUs;
+    pthread_mutex_unlock(&statsMutex);
+    return stats;
+}
@@ -0,0 +1,408 @@
+/*
+* This file implements the Intent module. The command templates below are compiled into a word trie
+* at startup; a "*" at the end of a template captures the rest of the utterance as the argument.
+* Matching walks the trie from the first word of the transcript (after any polite lead-in such as
+* "hey can you") and keeps the deepest accepting node, so "set target to X" wins over "set target X".
+* A template without "*" only matches when nothing but filler words ("here", "is it", ...) follows,
+* so "how far is the moon" still goes to the AI. Check the header file for more details.
+**/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+#include "intent.h"
+
+#define MAX_WORDS 64
+#define MAX_WORD_LENGTH 24
+#define MAX_TRIE_NODES 256
+#define NO_NODE -1
+
+struct template {
+    const char *pattern;
+    IntentType type;
+};
+
+static const struct template templates[] = {
+    {"set target *", INTENT_SET_TARGET},
+    {"set target to *", INTENT_SET_TARGET},
+    {"set the target to *", INTENT_SET_TARGET},
+    {"set destination *", INTENT_SET_TARGET},
+    {"set destination to *", INTENT_SET_TARGET},
+    {"set the destination to *", INTENT_SET_TARGET},
+    {"navigate to *", INTENT_SET_TARGET},
+    {"take me to *", INTENT_SET_TARGET},
+    {"drive to *", INTENT_SET_TARGET},
+    {"directions to *", INTENT_SET_TARGET},
+    {"clear target", INTENT_CLEAR_TARGET},
+    {"clear the target", INTENT_CLEAR_TARGET},
+    {"clear destination", INTENT_CLEAR_TARGET},
+    {"clear the destination", INTENT_CLEAR_TARGET},
+    {"reset target", INTENT_CLEAR_TARGET},
+    {"cancel navigation", INTENT_CLEAR_TARGET},
+    {"stop navigation", INTENT_CLEAR_TARGET},
+    {"speed limit", INTENT_SPEED_LIMIT},
+    {"what is the speed limit", INTENT_SPEED_LIMIT},
+    {"whats the speed limit", INTENT_SPEED_LIMIT},
+    {"how fast can i go", INTENT_SPEED_LIMIT},
+    {"how fast am i going", INTENT_CURRENT_SPEED},
+    {"what is my speed", INTENT_CURRENT_SPEED},
+    {"whats my speed", INTENT_CURRENT_SPEED},
+    {"current speed", INTENT_CURRENT_SPEED},
+    {"what is my current speed", INTENT_CURRENT_SPEED},
+    {"whats my current speed", INTENT_CURRENT_SPEED},
+    {"how far", INTENT_PROGRESS},
+    {"how far away", INTENT_PROGRESS},
+    {"how much further", INTENT_PROGRESS},
+    {"are we there yet", INTENT_PROGRESS},
+    {"distance to target", INTENT_PROGRESS},
+    {"where am i", INTENT_WHERE_AM_I},
+};
+
+struct trieNode {
+    char word[MAX_WORD_LENGTH];
+    int firstChild;
+    int nextSibling;
+    IntentType endType;     // A template ends at this node
+    IntentType slotType;    // A template continues with "*" at this node
+};
+
+// Words skipped before a command ("hey can you navigate to ...")
+static const char *leadingFillers[] = {
+    "hey", "ok", "okay", "so", "please", "can", "could", "would", "you",
+};
+
+// Words allowed after a command that takes no argument ("how far is it", "where am i right now")
+static const char *trailingFillers[] = {
+    "please", "here", "now", "right", "currently", "still", "again", "yet", "is", "it", "to", "go", "left",
+};
+
+struct abbreviation {
+    const char *word;
+    const char *shortForm;
+};
+
+// Street types, as written in the addresses Nominatim expects
+static const struct abbreviation streetTypes[] = {
+    {"street", "St"}, {"avenue", "Ave"}, {"road", "Rd"}, {"drive", "Dr"}, {"boulevard", "Blvd"},
+    {"lane", "Ln"}, {"highway", "Hwy"}, {"crescent", "Cres"}, {"place", "Pl"}, {"court", "Ct"},
+    {"parkway", "Pkwy"}, {"way", "Way"}, {"mall", "Mall"}, {"square", "Sq"}, {"terrace", "Terr"},
+};
+
+static const struct abbreviation directions[] = {
+    {"north", "N"}, {"south", "S"}, {"east", "E"}, {"west", "W"},
+};
+
+static const char *smallNumbers[] = {
+    "zero", "one", "two", "three", "four", "five", "six", "seven", "eight", "nine", "ten",
+    "eleven", "twelve", "thirteen", "fourteen", "fifteen", "sixteen", "seventeen", "eighteen", "nineteen"
+};
+static const char *tensNumbers[] = {
+    "", "", "twenty", "thirty", "forty", "fifty", "sixty", "seventy", "eighty", "ninety"
+};
+
+static struct trieNode nodes[MAX_TRIE_NODES];
+static int numNodes = 0;
+static bool isInitialized = false;
+
+static int new_node(const char *word) {
+    assert(numNodes < MAX_TRIE_NODES);
+    struct trieNode *node = &nodes[numNodes];
+    snprintf(node->word, sizeof(node->word), "%s", word);
+    node->firstChild = NO_NODE;
+    node->nextSibling = NO_NODE;
+    node->endType = INTENT_NONE;
+    node->slotType = INTENT_NONE;
+    return numNodes++;
+}
+
+static int find_child(int parent, const char *word) {
+    for (int child = nodes[parent].firstChild; child != NO_NODE; child = nodes[child].nextSibling) {
+        if (strcmp(nodes[child].word, word) == 0) {
+            return child;
+        }
+    }
+    return NO_NODE;
+}
+
+// Splits text into lower-case words. Apostrophes are dropped ("what's" -> "whats"), any other
+// punctuation separates words.
+static int tokenize(const char *text, char words[][MAX_WORD_LENGTH], int maxWords) {
+    int count = 0;
+    int length = 0;
+    for (const char *p = text; ; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '\'') {
+            continue;
+        }
+        if (isalnum(c)) {
+            if (length < MAX_WORD_LENGTH - 1 && count < maxWords) {
+                words[count][length++] = (char)tolower(c);
+            }
+            continue;
+        }
+        if (length > 0) {
+            words[count][length] = '\0';
+            count++;
+            length = 0;
+        }
+        if (c == '\0') {
+            break;
+        }
+    }
+    return count;
+}
+
+static void compile_template(const struct template *t) {
+    char words[MAX_WORDS][MAX_WORD_LENGTH];
+    int count = 0;
+    int length = 0;
+    // Same as tokenize() but "*" is kept as a word of its own
+    for (const char *p = t->pattern; ; p++) {
+        if (*p == ' ' || *p == '\0') {
+            if (length > 0) {
+                words[count][length] = '\0';
+                count++;
+                length = 0;
+            }
+            if (*p == '\0') {
+                break;
+            }
+        } else if (length < MAX_WORD_LENGTH - 1) {
+            words[count][length++] = *p;
+        }
+    }
+
+    int node = 0;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(words[i], "*") == 0) {
+            nodes[node].slotType = t->type;
+            return;
+        }
+        int child = find_child(node, words[i]);
+        if (child == NO_NODE) {
+            child = new_node(words[i]);
+            nodes[child].nextSibling = nodes[node].firstChild;
+            nodes[node].firstChild = child;
+        }
+        node = child;
+    }
+    nodes[node].endType = t->type;
+}
+
+static int lookup(const char *word, const char *table[], int size) {
+    for (int i = 0; i < size; i++) {
+        if (table[i][0] != '\0' && strcmp(word, table[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool only_fillers(char words[][MAX_WORD_LENGTH], int start, int count) {
+    for (int i = start; i < count; i++) {
+        if (lookup(words[i], trailingFillers, sizeof(trailingFillers) / sizeof(trailingFillers[0])) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static const char *abbreviate(const char *word, const struct abbreviation *table, int size) {
+    for (int i = 0; i < size; i++) {
+        if (strcmp(word, table[i].word) == 0) {
+            return table[i].shortForm;
+        }
+    }
+    return NULL;
+}
+
+static bool is_digits(const char *word) {
+    for (const char *p = word; *p; p++) {
+        if (!isdigit((unsigned char)*p)) {
+            return false;
+        }
+    }
+    return word[0] != '\0';
+}
+
+static bool is_number_word(const char *word) {
+    return is_digits(word) || lookup(word, smallNumbers, 20) >= 0 || lookup(word, tensNumbers, 10) >= 0 ||
+           strcmp(word, "hundred") == 0 || strcmp(word, "thousand") == 0;
+}
+
+static void append(char *out, size_t outSize, const char *text) {
+    size_t used = strlen(out);
+    snprintf(out + used, outSize - used, "%s", text);
+}
+
+// Converts a run of number words into digits. House numbers are usually read in groups
+// ("eighty eight eighty eight", "one two three"), so whenever a word cannot continue the
+// current cardinal number a new group starts and the groups are written side by side.
+static int parse_number(char words[][MAX_WORD_LENGTH], int count, int pos, char *out, size_t outSize) {
+    long total = 0;         // Thousands already closed in this group
+    long current = 0;       // Value below one thousand in this group
+    bool open = false;
+    char group[24];
+
+    for (; pos < count && is_number_word(words[pos]); pos++) {
+        const char *word = words[pos];
+        int small = lookup(word, smallNumbers, 20);
+        int tens = lookup(word, tensNumbers, 10);
+        bool started = current > 0 || total > 0;
+
+        if (is_digits(word)) {
+            if (open) {
+                snprintf(group, sizeof(group), "%ld", total + current);
+                append(out, outSize, group);
+            }
+            append(out, outSize, word);
+            open = false;
+            total = current = 0;
+            continue;
+        }
+        if (strcmp(word, "hundred") == 0) {
+            if (open && current > 0 && current < 100) {
+                current *= 100;
+            }
+            continue;
+        }
+        if (strcmp(word, "thousand") == 0) {
+            if (open && current > 0 && total == 0) {
+                total = current * 1000;
+                current = 0;
+            }
+            continue;
+        }
+
+        bool extends;
+        if (small >= 0 && small < 10) {
+            extends = open && started && current % 10 == 0 && current % 100 != 10;
+        } else {
+            extends = open && started && current % 100 == 0;
+        }
+        if (!extends) {
+            if (open) {
+                snprintf(group, sizeof(group), "%ld", total + current);
+                append(out, outSize, group);
+            }
+            total = current = 0;
+            open = true;
+        }
+        current += (small >= 0) ? small : tens * 10;
+    }
+    if (open) {
+        snprintf(group, sizeof(group), "%ld", total + current);
+        append(out, outSize, group);
+    }
+    return pos;
+}
+
+// Rewrites the spoken place into address form: digits for numbers, capitalized names,
+// abbreviated street types and directions, and a comma before the city.
+static void format_argument(char words[][MAX_WORD_LENGTH], int start, int count, struct Intent *intent) {
+    char *out = intent->argument;
+    size_t outSize = sizeof(intent->argument);
+    bool leadingNumber = false;
+    bool sawName = false;
+    bool sawStreetType = false;
+    bool afterStreet = false;
+
+    // "set target to the ..." after the "set target *" template
+    if (start < count - 1 && strcmp(words[start], "to") == 0) {
+        start++;
+    }
+    out[0] = '\0';
+    for (int i = start; i < count; ) {
+        if (out[0] != '\0') {
+            append(out, outSize, afterStreet ? ", " : " ");
+            afterStreet = false;
+        }
+        if (is_number_word(words[i])) {
+            leadingNumber = leadingNumber || i == start;
+            i = parse_number(words, count, i, out, outSize);
+            continue;
+        }
+        const char *shortForm = sawName && !sawStreetType ? abbreviate(words[i], streetTypes, sizeof(streetTypes) / sizeof(streetTypes[0])) : NULL;
+        if (shortForm) {
+            append(out, outSize, shortForm);
+            sawStreetType = true;
+            afterStreet = true;
+            i++;
+            if (i < count && (shortForm = abbreviate(words[i], directions, sizeof(directions) / sizeof(directions[0])))) {
+                append(out, outSize, " ");
+                append(out, outSize, shortForm);
+                i++;
+            }
+            continue;
+        }
+        char word[MAX_WORD_LENGTH];
+        snprintf(word, sizeof(word), "%s", words[i]);
+        word[0] = (char)toupper((unsigned char)word[0]);
+        append(out, outSize, word);
+        sawName = true;
+        i++;
+    }
+    intent->isStreetAddress = leadingNumber && sawName && sawStreetType;
+}
+
+// Initialization function
+void Intent_init(void) {
+    assert(!isInitialized);
+    numNodes = 0;
+    new_node("");
+    for (size_t i = 0; i < sizeof(templates) / sizeof(templates[0]); i++) {
+        compile_template(&templates[i]);
+    }
+    isInitialized = true;
+}
+
+// Cleanup function
+void Intent_cleanup(void) {
+    assert(isInitialized);
+    numNodes = 0;
+    isInitialized = false;
+}
+
+bool Intent_parse(const char *text, struct Intent *intent) {
+    assert(isInitialized);
+    char words[MAX_WORDS][MAX_WORD_LENGTH];
+    int count = tokenize(text ? text : "", words, MAX_WORDS);
+
+    intent->type = INTENT_NONE;
+    intent->argument[0] = '\0';
+    intent->isStreetAddress = false;
+
+    // Commands must open the utterance; a command phrase inside a question is left to the AI
+    int start = 0;
+    while (start < count && lookup(words[start], leadingFillers, sizeof(leadingFillers) / sizeof(leadingFillers[0])) >= 0) {
+        start++;
+    }
+
+    // The deepest accepting node wins
+    IntentType type = INTENT_NONE;
+    int argStart = -1;
+    int node = 0;
+    for (int pos = start; ; pos++) {
+        if (nodes[node].slotType != INTENT_NONE && pos < count) {
+            type = nodes[node].slotType;
+            argStart = pos;
+        }
+        if (nodes[node].endType != INTENT_NONE && only_fillers(words, pos, count)) {
+            type = nodes[node].endType;
+            argStart = -1;
+        }
+        if (pos == count || (node = find_child(node, words[pos])) == NO_NODE) {
+            break;
+        }
+    }
+    if (type == INTENT_NONE) {
+        return false;
+    }
+    intent->type = type;
+    if (argStart >= 0) {
+        format_argument(words, argStart, count, intent);
+    }
+    return true;
+}
@@ -0,0 +1,112 @@
+/*
+ * This file implements the LedAnimation module. Each effect draws into the frame and reports
+ * whether it moves; compose() picks the effects for the state and stacks them in order.
+ * Check the header file for more details.
+**/
+#include <stdbool.h>
+#include <stdint.h>
+#include "ledAnimation.h"
+
+// GRBW words, at the brightness the strip has always used
+#define COLOR_OFF    0x00000000
+#define COLOR_RED    0x000f0000
+#define COLOR_YELLOW 0x0f0f0000
+#define COLOR_GREEN  0x0f000000
+#define COLOR_WHITE  0x0000000f
+#define COLOR_TEAL   0x0f000f00
+#define COLOR_TRACK  0x0f0f0f00     // Remaining part of the route
+
+#define CHASER_STEP_MS 150          // Handbrake reminder: time per LED
+#define PULSE_PERIOD_MS 1000        // Speeding: one brightness pulse
+#define PULSE_MIN_LEVEL 64          // Dimmest point of the pulse, out of 256
+
+// GRBW word for a color code: 0 red, 1 yellow, 2 green, anything else dim white
+static uint32_t color_word(int code) {
+    switch (code) {
+        case 0:
+            return COLOR_RED;
+        case 1:
+            return COLOR_YELLOW;
+        case 2:
+            return COLOR_GREEN;
+        default:
+            return COLOR_WHITE;
+    }
+}
+
+// Scales all four channels by level/256
+static uint32_t scale_color(uint32_t color, uint32_t level) {
+    uint32_t scaled = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        uint32_t channel = (color >> shift) & 0xff;
+        scaled |= ((channel * level) >> 8) << shift;
+    }
+    return scaled;
+}
+
+static bool effect_fill(uint32_t *frame, int ledCount, uint32_t color) {
+    for (int i = 0; i < ledCount; i++) {
+        frame[i] = color;
+    }
+    return false;
+}
+
+// First LED is always lit; the bar reaches the last LED at 100%
+static int progress_leds(double progress, int ledCount) {
+    if (progress >= 100) {
+        return ledCount;
+    }
+    if (progress <= 0) {
+        return 1;
+    }
+    return 1 + (int)(progress * (ledCount - 1) / 100);
+}
+
+static bool effect_progress(uint32_t *frame, int ledCount, double progress, int speedColor) {
+    int lit = progress_leds(progress, ledCount);
+    for (int i = 0; i < ledCount; i++) {
+        frame[i] = i < lit ? color_word(speedColor) : COLOR_TRACK;
+    }
+    return false;
+}
+
+// Triangle wave over the lit part of the bar
+static bool effect_pulse(uint32_t *frame, int ledCount, double progress, uint32_t timeMs) {
+    uint32_t phase = timeMs % PULSE_PERIOD_MS;
+    uint32_t half = PULSE_PERIOD_MS / 2;
+    uint32_t ramp = phase < half ? phase : PULSE_PERIOD_MS - phase;
+    uint32_t level = PULSE_MIN_LEVEL + (256 - PULSE_MIN_LEVEL) * ramp / half;
+    int lit = progress_leds(progress, ledCount);
+    for (int i = 0; i < lit && i < ledCount; i++) {
+        frame[i] = scale_color(frame[i], level);
+    }
+    return true;
+}
+
+// One teal LED runs from the top of the strip to the bottom
+static bool effect_chaser(uint32_t *frame, int ledCount, uint32_t timeMs) {
+    int step = (int)((timeMs / CHASER_STEP_MS) % (uint32_t)ledCount);
+    effect_fill(frame, ledCount, COLOR_OFF);
+    frame[ledCount - 1 - step] = COLOR_TEAL;
+    return true;
+}
+
+bool LedAnimation_compose(const struct LedState *state, uint32_t timeMs, uint32_t *frame, int ledCount) {
+    if (ledCount <= 0) {
+        return false;
+    }
+    if (state->parkingActive) {
+        if (state->parkingMode == 1) {
+            return effect_chaser(frame, ledCount, timeMs);
+        }
+        if (state->parkingMode == 2) {
+            return effect_fill(frame, ledCount, color_word(state->parkingColor));
+        }
+        return effect_fill(frame, ledCount, COLOR_OFF);
+    }
+    bool animated = effect_progress(frame, ledCount, state->progress, state->speedColor);
+    if (state->speedColor == 0) {
+        animated |= effect_pulse(frame, ledCount, state->progress, timeMs);
+    }
+    return animated;
+}
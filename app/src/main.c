@@ -18,22 +18,63 @@
 #include "hal/rotary_state.h"
 #include "neopixel.h"
 #include "parking.h"
+#include "drivingEvents.h"
 #include "hal/led.h"
+#include "hal/speaker.h"
+#include "ttsCache.h"
+#include "ai_api.h"
+#include "voiceCommand.h"
+#include "eventBus.h"
+#include "hal/reactor.h"
+#include "scheduler.h"
+#include "threadConfig.h"
+
+static pthread_mutex_t exitMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t exitCond = PTHREAD_COND_INITIALIZER;
+static bool exitRequested = false;
+
+// Called on the event dispatcher when the joystick button is pressed
+static void on_button(const struct Event *event, void *context) {
+    (void)context;
+    if (event->button == JOYSTICK_PRESSED) {
+        pthread_mutex_lock(&exitMutex);
+        exitRequested = true;
+        pthread_cond_signal(&exitCond);
+        pthread_mutex_unlock(&exitMutex);
+    }
+}
 
 int main() {
+    // Memory locking and the preallocated stacks must be in place before any thread starts
+    ThreadConfig_init();
+    // Every module below publishes or subscribes to events, and the device modules register
+    // their file descriptors with the reactor or periodic work with the scheduler, so these come first
+    EventBus_init();
+    EventBus_subscribe(EVENT_BUTTON, on_button, NULL);
+    Reactor_init();
+    Scheduler_init();
     Ic2_initialize();
     Gpio_initialize();
     Joystick_initialize();
-    Accelerometer_initialize();
+#ifndef R5_SENSOR_OFFLOAD
+    Accelerometer_initialize();     // Otherwise the R5 samples it
+#endif
     GPS_init();
     // Calling this will enable a thread read the gps data from demo_gps.txt. See "demo_locationData.txt" in project folder for more info"
     // GPS_demoInit();
     SpeedLED_init();
+    Speaker_init();
+    TtsCache_init();
     StreetAPI_init();
     RoadTracker_init();
     Parking_init();
+#ifndef R5_SENSOR_OFFLOAD
+    DrivingEvents_init();
+#endif
     NeoPixel_init();
     RotaryState_init();
+    AI_init();
+    VoiceCommand_init();
     Microphone_init();
 
     // Start the button listener thread
@@ -42,25 +83,40 @@ int main() {
     } else {
         printf("Failed to start button listener.\n");
     }
+    if (Microphone_startWakeWordListener() == 0) {
+        printf("Wake word listener started. Say the wake word to record audio.\n");
+    }
+    ThreadConfig_print();
     
-    // Main loop to keep the program running. The program will exit when the joystick button is pressed.
-    while (true) {
-        if (Joystick_isButtonPressed()) {
-            break;
-        } 
-        sleepForMs(100);
+    // Keep the program running until the joystick button is pressed
+    pthread_mutex_lock(&exitMutex);
+    while (!exitRequested) {
+        pthread_cond_wait(&exitCond, &exitMutex);
     }
+    pthread_mutex_unlock(&exitMutex);
 
+    // Stop the device handlers and event delivery first so nothing runs while its module is torn down
+    Reactor_cleanup();
+    Scheduler_cleanup();
+    EventBus_cleanup();
     Microphone_cleanup();
+    VoiceCommand_cleanup();
+    AI_cleanup();
     NeoPixel_cleanUp();
     RoadTracker_cleanup();
     StreetAPI_cleanup();
+    TtsCache_cleanup();
+    Speaker_cleanup();
     SpeedLED_cleanup();
     GPS_cleanup();
     Joystick_cleanUp();
     Parking_cleanup();
     Gpio_cleanup();
+#ifndef R5_SENSOR_OFFLOAD
+    DrivingEvents_cleanup();
     Accelerometer_cleanUp();
+#endif
     Ic2_cleanUp();
+    ThreadConfig_cleanup();
     return 0;
 }
\ No newline at end of file
@@ -4,13 +4,41 @@
 #!/usr/bin/env python3
 import sys
 import os
+import io
 import argparse
 import speech_recognition as sr
 
 
+class FlacAudioData(sr.AudioData):
+    """Audio that is already FLAC-encoded, handed to recognize_google as it is"""
+    def __init__(self, flac_data, sample_rate):
+        super().__init__(b"", sample_rate, 2)
+        self.flac_data = flac_data
+
+    def get_flac_data(self, convert_rate=None, convert_width=None):
+        # Skips the WAV -> flac binary round trip; the C side encoded it while recording
+        return self.flac_data
+
+def transcribe_flac(sample_rate):
+    """Transcribe a 16-bit mono FLAC stream arriving on stdin until EOF"""
+    r = sr.Recognizer()
+    try:
+        audio_data = FlacAudioData(sys.stdin.buffer.read(), sample_rate)
+        return r.recognize_google(audio_data)
+    except sr.UnknownValueError:
+        return "Could not understand audio"
+    except sr.RequestError as e:
+        return f"Error with the speech recognition service; {e}"
+    except Exception as e:
+        return f"Error processing audio stream: {str(e)}"
+
 def transcribe_audio(audio_file):
     """Transcribe using Google's Speech Recognition API"""
     
+    # "-" means the WAV is piped in on stdin (no temp file on disk)
+    if audio_file == "-":
+        audio_file = io.BytesIO(sys.stdin.buffer.read())
+    
     # Initialize recognizer
     r = sr.Recognizer()
     
@@ -48,10 +76,14 @@ def transcribe_audio(audio_file):
 
 if __name__ == "__main__":
     parser = argparse.ArgumentParser(description='Transcribe WAV audio file to text')
-    parser.add_argument('audio_file', help='Path to WAV audio file')
+    parser.add_argument('audio_file', help='Path to WAV audio file, or - to read it from stdin')
+    parser.add_argument('--flac', type=int, metavar='RATE', help='stdin carries a 16-bit mono FLAC stream at RATE Hz')
     
     args = parser.parse_args()
     
     # Transcribe and print the result
-    result = transcribe_audio(args.audio_file)
+    if args.flac and args.audio_file == "-":
+        result = transcribe_flac(args.flac)
+    else:
+        result = transcribe_audio(args.audio_file)
     print(result)
\ No newline at end of file
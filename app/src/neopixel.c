@@ -1,14 +1,11 @@
-#include "hal/i2c.h"
-#include "hal/gpio.h"
 #include "sleep_and_timer.h"
 
-#include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
-#include <sys/mman.h>
 #include <math.h>
 #include <pthread.h>
 #include <roadTracker.h>
@@ -16,130 +13,267 @@
 #include <parking.h>
 #include "sharedDataLayout.h"
 #include "neopixel.h"
+#include "r5Memory.h"
 #include "hal/led.h"
 #include "hal/GPS.h"
-
-// Memory mapping constants
-#define ATCM_ADDR     0x79000000  // MCU ATCM (p59 TRM)
-#define BTCM_ADDR     0x79020000  // MCU BTCM (p59 TRM)
-#define MEM_LENGTH    0x8000
+#include "eventBus.h"
+#include "scheduler.h"
+#include "ledAnimation.h"
 
 #define GREEN_LED &leds[0]
 #define RED_LED &leds[1]
-#define PROGRESS_PER_LED 14
-#define MAX_NUM_LED 8
-#define REMOVE_LED_MODE_NUMBER 10
+#define NUM_LEDS 8                  // Length of the strip; the R5 takes up to FRAME_MAX_LEDS
+#define FRAME_PERIOD_MS 20          // 50 fps while an animation runs
+#define FRAME_SLACK_MS 5
+#define MONITOR_PERIOD_MS 250
+#define R5_STALL_MS 1000            // The R5 beats every 5 ms; this long without one is a stall
+#define TELEMETRY_LOG_MS 60000
 
 static bool isInitialized = false;
-static pthread_t LEDpthread;
-static bool isRunning = false;
+static volatile void *r5Base = NULL;
+static int frameTask = -1;
+static int monitorTask = -1;
+
+// Event handlers (event dispatcher) and the frame task (scheduler) both render
+static pthread_mutex_t renderMutex = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t sequence = 0;       // Mailbox seqlock
+static uint32_t front = 0;          // Frame buffer the R5 is showing
+static bool animating = false;      // Last frame depends on time, keep composing
+static uint32_t lastFrame[NUM_LEDS];   // What the R5 has, so unchanged frames are not sent
+static bool havePublished = false;
+static unsigned long framesSent = 0;
+static unsigned long framesUnchanged = 0;
+static struct timespec startTime;
+
+// R5 monitor state; the mutex also covers it
+static struct R5Telemetry telemetry;
+static uint32_t lastBeatMs = 0;
+static uint32_t lastLogMs = 0;
 
-static void* LED_thread(void* arg);
+// Latest state from the event bus
+static bool hasSignal = false;
+static struct LedState state = {.progress = 0, .speedColor = 3, .parkingActive = false, .parkingMode = 0, .parkingColor = 2};
 
-// Memory mapping function
-volatile void* getR5MmapAddr(void)
+// Onboard LEDs: green while the GPS has a fix, red otherwise. Only called on a change;
+// the triggers are set to "none" once at init.
+static void show_signal(bool signal) {
+    Led_setBrightness(RED_LED, signal ? 0 : 1);
+    Led_setBrightness(GREEN_LED, signal ? 1 : 0);
+}
+
+static uint32_t elapsed_ms(void)
 {
-    // Access /dev/mem to gain access to physical memory (for memory-mapped devices/specialmemory)
-    int fd = open("/dev/mem", O_RDWR | O_SYNC);
-    if (fd == -1) {
-        perror("ERROR: could not open /dev/mem; Did you run with sudo?");
-        exit(EXIT_FAILURE);
-    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)time_diff_ms(&startTime, &now);
+}
+
+#ifdef NEOPIXEL_PUBLISH_HOOK
+// Host simulator only (R5/sim): told each frame and the sequence it goes out under, before
+// the R5 can latch it
+void NEOPIXEL_PUBLISH_HOOK(uint32_t sequence, const uint32_t *frame, int count);
+#endif
 
-    // Inside main memory (fd), access the part at offset BTCM_ADDR:
-    // (Get points to start of R5 memory after it's memory mapped)
-    volatile void* pR5Base = mmap(0, MEM_LENGTH, PROT_READ | PROT_WRITE, MAP_SHARED, fd, BTCM_ADDR);
-    if (pR5Base == MAP_FAILED) {
-        perror("ERROR: could not map memory");
-        exit(EXIT_FAILURE);
+// Must hold renderMutex. Fills the back buffer, then switches the R5 to it under the
+// mailbox seqlock (see sharedDataLayout.h).
+static void publish_frame(const uint32_t *frame, int count)
+{
+    volatile uint8_t *base = (volatile uint8_t*)r5Base;
+    uint32_t back = front ^ 1;
+    for (int i = 0; i < count; i++) {
+        MEM_UINT32(base + FRAME_OFFSET(back) + i * sizeof(uint32_t)) = frame[i];
     }
-    close(fd);
+    MEM_BARRIER();
+    MEM_UINT32(base + SEQUENCE_OFFSET) = ++sequence;    // Odd: switching buffers
+    MEM_BARRIER();
+    MEM_UINT32(base + FRONT_OFFSET) = back;
+    MEM_UINT32(base + LED_COUNT_OFFSET) = count;
+    MEM_BARRIER();
+#ifdef NEOPIXEL_PUBLISH_HOOK
+    NEOPIXEL_PUBLISH_HOOK(sequence + 1, frame, count);
+#endif
+    MEM_UINT32(base + SEQUENCE_OFFSET) = ++sequence;    // Even: frame complete
+    front = back;
+}
 
-    return pR5Base;
+// Must hold renderMutex. Composes the current state into a frame and sends it to the R5
+// if it differs from the last one; an animation step often does not change any LED.
+static void render(void)
+{
+    uint32_t frame[NUM_LEDS];
+    animating = LedAnimation_compose(&state, elapsed_ms(), frame, NUM_LEDS);
+    if (havePublished && memcmp(frame, lastFrame, sizeof(frame)) == 0) {
+        framesUnchanged++;
+        return;
+    }
+    publish_frame(frame, NUM_LEDS);
+    memcpy(lastFrame, frame, sizeof(frame));
+    havePublished = true;
+    framesSent++;
 }
 
-static void freeR5MmapAddr(volatile uint8_t* pR5Base)
+// Scheduler task; only does work while the picture is animated
+static void on_frame_tick(void *context)
 {
-    if (munmap((void*) pR5Base, MEM_LENGTH)) {
-        perror("R5 munmap failed");
-        exit(EXIT_FAILURE);
+    (void)context;
+    pthread_mutex_lock(&renderMutex);
+    if (animating) {
+        render();
     }
+    pthread_mutex_unlock(&renderMutex);
 }
 
+static void log_telemetry(const struct R5Telemetry *t)
+{
+    printf("R5: %s, heartbeat %u, frames %u drawn / %u skipped, seq %u acked %u, "
+           "render %.0f us (max %.0f us), %u read retries, %lu stalls, error %u\n",
+           t->alive ? "alive" : "STALLED", t->heartbeat, t->framesDrawn, t->framesSkipped,
+           t->publishedSequence, t->ackedSequence, t->renderUs, t->maxRenderUs,
+           t->readRetries, t->stalls, t->error);
+}
 
-void NeoPixel_init(void)
+// Must hold renderMutex. Copies the R5 telemetry block and checks the heartbeat.
+static void refresh_telemetry(uint32_t nowMs)
 {
-    assert(!isInitialized);
-    isInitialized = true;
-    isRunning = true;
-    Led_initialize();
-    if (pthread_create(&LEDpthread, NULL, LED_thread, NULL) != 0) {
-        perror("Failed to create accelerometer thread");
-        exit(EXIT_FAILURE);
+    volatile uint8_t *base = (volatile uint8_t*)r5Base;
+    uint32_t heartbeat = MEM_UINT32(base + R5_HEARTBEAT_OFFSET);
+    uint32_t hz = MEM_UINT32(base + R5_CYCLE_HZ_OFFSET);
+    telemetry.publishedSequence = sequence;
+    telemetry.ackedSequence = MEM_UINT32(base + ACK_OFFSET);
+    telemetry.framesDrawn = MEM_UINT32(base + R5_FRAMES_OFFSET);
+    telemetry.framesSkipped = MEM_UINT32(base + R5_SKIPPED_OFFSET);
+    telemetry.readRetries = MEM_UINT32(base + R5_READ_RETRIES_OFFSET);
+    telemetry.error = MEM_UINT32(base + R5_ERROR_OFFSET);
+    if (hz > 0) {
+        telemetry.renderUs = MEM_UINT32(base + R5_RENDER_CYCLES_OFFSET) * 1e6 / hz;
+        telemetry.maxRenderUs = MEM_UINT32(base + R5_RENDER_MAX_CYCLES_OFFSET) * 1e6 / hz;
+    }
+
+    if (heartbeat != telemetry.heartbeat) {
+        if (!telemetry.alive) {
+            printf("R5: heartbeat running (%u)\n", heartbeat);
+        }
+        telemetry.heartbeat = heartbeat;
+        telemetry.alive = true;
+        lastBeatMs = nowMs;
+    } else if (telemetry.alive && nowMs - lastBeatMs > R5_STALL_MS) {
+        telemetry.alive = false;
+        telemetry.stalls++;
+        fprintf(stderr, "R5: heartbeat stopped at %u for %u ms (error %u, acked %u of %u)\n",
+                heartbeat, nowMs - lastBeatMs, telemetry.error, telemetry.ackedSequence, sequence);
     }
 }
 
-// Thread function to set the neoPixel colors and the led based on the road tracker progress and parking mode
-void* LED_thread(void* arg)
+// Scheduler task: watch the R5 and log its telemetry once a minute
+static void on_monitor_tick(void *context)
 {
-    (void)arg; // Mark the parameter as unused
-    volatile void *pR5Base = getR5MmapAddr();
-    // int progress = 0;
-    while (isRunning) {
-        // progress = (progress + 1)%9;
-        if (GPS_hasSignal()) {
-            Led_setTrigger(RED_LED, "none");
-            Led_setBrightness(RED_LED, 0);
-            Led_setTrigger(GREEN_LED, "none");
-            Led_setBrightness(GREEN_LED, 1);
-
-        } else {
-            Led_setTrigger(GREEN_LED, "none");
-            Led_setBrightness(GREEN_LED, 0);
-            Led_setTrigger(RED_LED, "none");
-            Led_setBrightness(RED_LED, 1);
-        }
-        if (!Parking_Activate()) {
-            // printf("Parking not activated\n");
-            MEM_UINT32((uint8_t*)pR5Base + MODE_OFFSET) = 0;
-            // 0 to 8 in here
-            int led_on = 1;
-            double progress = RoadTracker_getProgress();
-            if (progress >= 100) {
-                led_on = MAX_NUM_LED;
-            } else if (progress > 0) {
-                led_on = (int)(progress / PROGRESS_PER_LED) + led_on;
+    (void)context;
+    pthread_mutex_lock(&renderMutex);
+    uint32_t nowMs = elapsed_ms();
+    refresh_telemetry(nowMs);
+    struct R5Telemetry snapshot = telemetry;
+    bool log = nowMs - lastLogMs >= TELEMETRY_LOG_MS;
+    if (log) {
+        lastLogMs = nowMs;
+    }
+    pthread_mutex_unlock(&renderMutex);
+    if (log) {
+        log_telemetry(&snapshot);
+    }
+}
+
+// Called on the event dispatcher; the LEDs change as soon as the state they show does
+static void on_event(const struct Event *event, void *context)
+{
+    (void)context;
+    pthread_mutex_lock(&renderMutex);
+    switch (event->topic) {
+        case EVENT_FIX:
+            if (event->fix.valid != hasSignal) {
+                hasSignal = event->fix.valid;
+                show_signal(hasSignal);
             }
-            int color = SpeedLED_getLEDColor();
-            // int progress = 7;
-            // printf("led_on: %d\n", led_on);
-            // printf("    %15s: 0x%04x\n", "progress", MEM_UINT32((uint8_t*)pR5Base + PROGRESS_OFFSET));
-            MEM_UINT32((uint8_t*)pR5Base + PROGRESS_OFFSET) = led_on;
-            MEM_UINT32((uint8_t*)pR5Base + COLOR_OFFSET) = color;
-        } else {
-            // printf("Parking activated\n");
-            // printf("modenumber: %d\n", Parking_getMode());
-            // printf("color: %d\n", Parking_getMode());
-            MEM_UINT32((uint8_t*)pR5Base + MODE_OFFSET) = Parking_getMode();
-            MEM_UINT32((uint8_t*)pR5Base + COLOR_OFFSET) = Parking_getColor();
-        }
-        sleepForMs(1000);
+            pthread_mutex_unlock(&renderMutex);
+            return;
+        case EVENT_SPEED_STATE:
+            state.speedColor = event->speed.color;
+            break;
+        case EVENT_PROGRESS:
+            state.progress = event->progress.percent;
+            break;
+        case EVENT_PARKING:
+            state.parkingActive = event->parking.active;
+            state.parkingMode = event->parking.mode;
+            state.parkingColor = event->parking.color;
+            break;
+        default:
+            pthread_mutex_unlock(&renderMutex);
+            return;
     }
-    // Remove LED effect by setting invalid mode number
-    MEM_UINT32((uint8_t*)pR5Base + MODE_OFFSET) = REMOVE_LED_MODE_NUMBER;
-    freeR5MmapAddr(pR5Base);
-    return NULL;
+    render();
+    pthread_mutex_unlock(&renderMutex);
 }
 
-void NeoPixel_cleanUp()
+struct R5Telemetry NeoPixel_getR5Telemetry(void)
 {
     assert(isInitialized);
-    isRunning = false;
+    pthread_mutex_lock(&renderMutex);
+    struct R5Telemetry snapshot = telemetry;
+    pthread_mutex_unlock(&renderMutex);
+    return snapshot;
+}
+
+void NeoPixel_init(void)
+{
+    assert(!isInitialized);
+    isInitialized = true;
+    Led_initialize();
+    r5Base = getR5MmapAddr();
     Led_setTrigger(RED_LED, "none");
-    Led_setBrightness(RED_LED, 0);
     Led_setTrigger(GREEN_LED, "none");
+    hasSignal = GPS_hasSignal();
+    show_signal(hasSignal);
+    havePublished = false;
+    // Give the R5 one stall timeout from now to show a heartbeat
+    memset(&telemetry, 0, sizeof(telemetry));
+    telemetry.alive = true;
+    lastBeatMs = 0;
+    lastLogMs = 0;
+    // Carry on from the sequence the R5 last saw, so a restart is never mistaken for a
+    // frame it already drew; the header goes in last, once a whole frame is there
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    sequence = MEM_UINT32((uint8_t*)r5Base + SEQUENCE_OFFSET) & ~1u;
+    front = MEM_UINT32((uint8_t*)r5Base + FRONT_OFFSET) & 1;
+    render();
+    MEM_BARRIER();
+    MEM_UINT32((uint8_t*)r5Base + VERSION_OFFSET) = MAILBOX_VERSION;
+    MEM_UINT32((uint8_t*)r5Base + MAGIC_OFFSET) = MAILBOX_MAGIC;
+    EventBus_subscribe(EVENT_FIX, on_event, NULL);
+    EventBus_subscribe(EVENT_SPEED_STATE, on_event, NULL);
+    EventBus_subscribe(EVENT_PROGRESS, on_event, NULL);
+    EventBus_subscribe(EVENT_PARKING, on_event, NULL);
+    frameTask = Scheduler_addPeriodic("neopixel", FRAME_PERIOD_MS, FRAME_SLACK_MS, on_frame_tick, NULL);
+    monitorTask = Scheduler_addPeriodic("r5-monitor", MONITOR_PERIOD_MS, MONITOR_PERIOD_MS / 4, on_monitor_tick, NULL);
+}
+
+// Must be called after EventBus_cleanup() and Scheduler_cleanup() so nothing else touches the mapping
+void NeoPixel_cleanUp()
+{
+    assert(isInitialized);
+    Scheduler_remove(frameTask);
+    Scheduler_remove(monitorTask);
+    frameTask = -1;
+    monitorTask = -1;
+    // Turn the strip off
+    uint32_t frame[NUM_LEDS] = {0};
+    publish_frame(frame, NUM_LEDS);
+    printf("NeoPixel: %lu frames sent, %lu unchanged frames skipped\n", framesSent, framesUnchanged);
+    refresh_telemetry(elapsed_ms());
+    log_telemetry(&telemetry);
+    freeR5MmapAddr(r5Base);
+    r5Base = NULL;
+    Led_setBrightness(RED_LED, 0);
     Led_setBrightness(GREEN_LED, 0);
     Led_cleanUp();
-    pthread_join(LEDpthread, NULL);
     isInitialized = false;
 }
@@ -13,114 +13,236 @@
 #include <unistd.h>
 #include <math.h>
 #include <stdatomic.h>
+#include "eventBus.h"
+#include "scheduler.h"
+#include "levelDetector.h"
+#ifdef R5_SENSOR_OFFLOAD
+#include "sharedDataLayout.h"
+#include "r5Memory.h"
+#endif
 
-static pthread_t parkingThread;
-static pthread_t modeThread;
-static bool isRunning = false;
+#define SAMPLING_PERIOD_MS 100
+#define SAMPLING_SLACK_MS 10
+
+static int samplingTask = -1;
 static bool isInitialized = false;
 static bool isParking = false;
 static atomic_int mode = 2; //1 for handbranke reminder, 2 for flat surface detection //0 for travel tracking
 static atomic_int color = 0; //0 red bad, 1 yellow decent, 2 green good
-static bool reset = true;
-
-static int prevColor = 2; // Assume green initially
+static atomic_bool navigating = false;  // Mirrors EVENT_PROGRESS, so we never poll the road tracker
 
-// Hysteresis thresholds
-static const float bad_enter_x = 0.15, bad_exit_x = 0.12;
-static const float bad_enter_y = 0.15, bad_exit_y = 0.12;
-static const float bad_enter_z_low = 0.95, bad_exit_z_low = 0.98;
-static const float bad_enter_z_high = 1.05, bad_exit_z_high = 1.02;
-
-static const float decent_enter_x = 0.07, decent_exit_x = 0.05;
-static const float decent_enter_y = 0.07, decent_exit_y = 0.05;
+// Last published state, so EVENT_PARKING only goes out on a change
+static bool lastActive = false;
+static int lastMode = -1;
+static int lastColor = -1;
 
 //PROTOTYPE
-static void* parkingThreadFunc(void* arg);
-static void* modeThreadFunc(void* arg);
+static void sample_parking(void* context);
+static void sampling_start(void);
+static void sampling_stop(void);
+
+// Called on the event dispatcher when navigation starts, progresses or ends
+static void on_progress(const struct Event *event, void *context) {
+    (void)context;
+    atomic_store(&navigating, event->progress.active);
+}
 
 // Initialization function
 void Parking_init(void) {
     assert(!isInitialized);
-    isRunning = true;
     isInitialized = true;
-    pthread_create(&modeThread, NULL, &modeThreadFunc, NULL);
-    pthread_create(&parkingThread, NULL, &parkingThreadFunc, NULL);
+    EventBus_subscribe(EVENT_PROGRESS, on_progress, NULL);
+    sampling_start();
+    samplingTask = Scheduler_addPeriodic("parking", SAMPLING_PERIOD_MS, SAMPLING_SLACK_MS, sample_parking, NULL);
 }
 
 // Cleanup function
 void Parking_cleanup(void) {
     assert(isInitialized);
-    isRunning = false;
-    pthread_join(parkingThread, NULL);
-    pthread_join(modeThread, NULL);
+    Scheduler_remove(samplingTask);
+    samplingTask = -1;
+    sampling_stop();
     isInitialized = false;
 }
 
-//Joystick thread
-static void* modeThreadFunc(void* args) {
-    (void) args;
-    assert(isInitialized);
-    while (isRunning) {
-        JoystickDirection data = getJoystickDirection();
-        if(reset  && !RoadTracker_isRunning()) {
-            reset = false;
-            mode = 1; //default start handbreak reminder
-        }
+// EVENT_PARKING for the current state, if it changed since the last one
+static void publish_changes(void) {
+    if (isParking != lastActive || mode != lastMode || color != lastColor) {
+        lastActive = isParking;
+        lastMode = mode;
+        lastColor = color;
+        struct Event event = {.topic = EVENT_PARKING};
+        event.parking.active = lastActive;
+        event.parking.mode = lastMode;
+        event.parking.color = lastColor;
+        EventBus_publish(&event);
+    }
+}
 
-        if (data == JOYSTICK_UP) {
-           mode = 1;
-        } else if (data == JOYSTICK_DOWN) {
-           mode = 2;
-        }
-        sleepForMs(100);
+#ifndef R5_SENSOR_OFFLOAD
+
+static bool reset = true;
+static int prevColor = LEVEL_COLOR_GOOD; // Assume green initially
+
+// Must be called from the sampling task. Picks the mode from the joystick and navigation state.
+static void update_mode(void) {
+    if (atomic_load(&navigating)) { //road tracker is running
+        isParking = false;
+        reset = true;
+        mode = 0;
+        return;
+    }
+    isParking = true;
+    if (reset) {
+        reset = false;
+        mode = 1; //default start handbreak reminder
+    }
+    JoystickDirection data = getJoystickDirection();
+    if (data == JOYSTICK_UP) {
+       mode = 1;
+    } else if (data == JOYSTICK_DOWN) {
+       mode = 2;
     }
-    return NULL;
 }
 
-// Thread function
-static void* parkingThreadFunc(void* arg) {
-    assert(isInitialized);
-    (void)arg; // Suppress unused parameter warning
-
-    while (isRunning) {
-        while (RoadTracker_isRunning() && isRunning) { //road tracker is running
-            isParking = false;
-            reset = true;
-            mode = 0;
-            sleepForMs(100);
+// Scheduler task, every SAMPLING_PERIOD_MS. The accelerometer and the joystick ADC have to be
+// sampled, so this is the one remaining timer in the module; everything downstream only hears
+// about changes.
+static void sample_parking(void* context) {
+    (void)context;
+    update_mode();
+    if (isParking && mode == 2) { // Flat surface detection mode
+        AccelerometerData data = Accelerometer_getReading();
+        prevColor = level_update(prevColor, data.x, data.y, data.z);
+        color = prevColor; // Apply updated color state
+    }
+    publish_changes();
+}
+
+// main() sets up the accelerometer and the joystick
+static void sampling_start(void) {
+}
+
+static void sampling_stop(void) {
+}
+
+#else
+
+// The R5 samples the sensors and runs the state machine above at SENSOR_PERIOD_MS; this
+// task only tells it whether parking is active and picks up its newest record.
+static volatile uint8_t *r5Base = NULL;
+static uint32_t lastHead = 0;
+static bool haveRecord = false;
+static uint32_t lastRecordMs = 0;
+static unsigned long recordsSeen = 0;
+static unsigned long recordsLost = 0;  // Overwritten before this task got to them
+static uint32_t maxIntervalMs = 0;
+static uint32_t minIntervalMs = UINT32_MAX;
+static uint32_t lastStatus = SENSOR_STATUS_RUNNING;
+
+// Record word of slot
+static uint32_t record_word(uint32_t slot, int word) {
+    return MEM_UINT32(r5Base + SENSOR_RECORD_OFFSET(slot, word));
+}
+
+// Counts the records written since the last call and the spacing of their timestamps
+static void track_intervals(uint32_t head) {
+    uint32_t fresh = head - lastHead;
+    if (head < lastHead) {      // The R5 restarted
+        fresh = head;
+        haveRecord = false;
+    }
+    if (fresh > SENSOR_RING_RECORDS) {
+        recordsLost += fresh - SENSOR_RING_RECORDS;
+        fresh = SENSOR_RING_RECORDS;
+        haveRecord = false;     // No interval across the gap
+    }
+    for (uint32_t n = head - fresh; n != head; n++) {
+        uint32_t timeMs = record_word(n % SENSOR_RING_RECORDS, SENSOR_RECORD_TIME_MS);
+        MEM_BARRIER();
+        if (MEM_UINT32(r5Base + SENSOR_HEAD_OFFSET) - n >= SENSOR_RING_RECORDS) {
+            recordsLost++;      // The R5 has been rewriting this slot
+            haveRecord = false;
             continue;
         }
-        // printf("Parking activated\n");
-        isParking = true;
-        AccelerometerData data = Accelerometer_getReading();
-        if (mode == 2) { // Flat surface detection mode
-            bool bad = (fabs(data.x) > bad_enter_x || fabs(data.y) > bad_enter_y || data.z < bad_enter_z_low || data.z > bad_enter_z_high);
-            bool bad_exit = (fabs(data.x) < bad_exit_x && fabs(data.y) < bad_exit_y && data.z > bad_exit_z_low && data.z < bad_exit_z_high);
-
-            bool decent = (!bad) && (fabs(data.x) > decent_enter_x || fabs(data.y) > decent_enter_y);
-            bool decent_exit = (fabs(data.x) < decent_exit_x && fabs(data.y) < decent_exit_y);
-
-            if (prevColor == 0 && bad_exit) {
-                prevColor = 1; // Move to yellow if exiting bad range
-            } else if (bad) {
-                prevColor = 0; // Stay in red
-            } else if (prevColor == 1 && decent_exit) {
-                prevColor = 2; // Move to green if exiting decent range
-            } else if (decent) {
-                prevColor = 1; // Stay in yellow
-            } else {
-                prevColor = 2; // Default to green
+        if (haveRecord) {
+            uint32_t interval = timeMs - lastRecordMs;
+            if (interval > maxIntervalMs) {
+                maxIntervalMs = interval;
+            }
+            if (interval < minIntervalMs) {
+                minIntervalMs = interval;
             }
+        }
+        lastRecordMs = timeMs;
+        haveRecord = true;
+        recordsSeen++;
+    }
+    lastHead = head;
+}
 
-            color = prevColor; // Apply updated color state
+// Takes mode and color from the newest record. Returns false if there is none, or the R5
+// overwrote it while it was being read.
+static bool read_newest(uint32_t head) {
+    if (head == 0) {
+        return false;
+    }
+    uint32_t slot = (head - 1) % SENSOR_RING_RECORDS;
+    int newMode = (int)record_word(slot, SENSOR_RECORD_MODE);
+    int newColor = (int)record_word(slot, SENSOR_RECORD_COLOR);
+    MEM_BARRIER();
+    if (MEM_UINT32(r5Base + SENSOR_HEAD_OFFSET) - (head - 1) >= SENSOR_RING_RECORDS) {
+        return false;
+    }
+    // Mode 0 means the R5 has not seen SENSOR_CONTROL_OFFSET go to 1 yet; it starts in 1 then
+    mode = newMode != 0 ? newMode : 1;
+    color = newColor;
+    return true;
+}
+
+static void sample_parking(void* context) {
+    (void)context;
+    isParking = !atomic_load(&navigating);
+    MEM_UINT32(r5Base + SENSOR_CONTROL_OFFSET) = isParking ? 1 : 0;
+
+    uint32_t status = MEM_UINT32(r5Base + SENSOR_STATUS_OFFSET);
+    if (status != lastStatus) {
+        lastStatus = status;
+        if (status != SENSOR_STATUS_RUNNING) {
+            fprintf(stderr, "Parking: R5 sensor sampling is %s\n",
+                    status == SENSOR_STATUS_OFF ? "not built into the R5 firmware" : "stopped by an I2C error");
         }
+    }
 
-        sleepForMs(100); // Adjust the polling rate as needed
+    MEM_BARRIER();
+    uint32_t head = MEM_UINT32(r5Base + SENSOR_HEAD_OFFSET);
+    MEM_BARRIER();
+    track_intervals(head);
+    if (!isParking) {
+        mode = 0;
+    } else if (!read_newest(head) && mode == 0) {
+        mode = 1; // Until the R5 reports, like the Linux state machine starts
     }
+    publish_changes();
+}
 
-    return NULL;
+static void sampling_start(void) {
+    r5Base = getR5MmapAddr();
+    lastHead = MEM_UINT32(r5Base + SENSOR_HEAD_OFFSET);  // Older records predate this run
 }
 
+static void sampling_stop(void) {
+    MEM_UINT32(r5Base + SENSOR_CONTROL_OFFSET) = 0;
+    if (recordsSeen > 1) {
+        printf("Parking: %lu R5 sensor samples, %lu lost, interval %u..%u ms (period %d ms)\n",
+               recordsSeen, recordsLost, minIntervalMs, maxIntervalMs, SENSOR_PERIOD_MS);
+    }
+    freeR5MmapAddr(r5Base);
+    r5Base = NULL;
+}
+
+#endif
+
 bool Parking_Activate(void) {
     return isParking;
 }
@@ -18,14 +18,14 @@
 #include "roadTracker.h"
 #include <stdatomic.h>
 #include "speedLimitLED.h"
+#include "ttsCache.h"
+#include "eventBus.h"
 
 #define EARTH_RADIUS 6371.0 // Radius of Earth in kilometers
 #define M_PI 3.14159265358979323846
 #define THRESHOLD_REACH 0.3
 #define SLEEP_TIME_FOR_PROGRESS_FULL 5000
 
-static pthread_t roadTrackerThread;
-static bool isRunning = false;
 static bool isInitialized = false;
 static pthread_mutex_t roadTrackerMutex = PTHREAD_MUTEX_INITIALIZER; // Mutex to protect road tracker data
 
@@ -37,9 +37,10 @@ static double totalDistanceNeeded = -1;
 static double current_distance = -1;
 static double progress = 0;
 static char target_address[256] = "";
+static struct timespec reached_time;     // When progress first hit 100
+static bool target_reached = false;
 
-static void* trackLocationThreadFunc(void* arg);
-static void runCommand(const char* command);
+static void on_fix(const struct Event *event, void *context);
 static void RoadTracker_resetData();
 static double deg_to_rad(double deg);
 static double haversine_distance(struct location loc1, struct location loc2);
@@ -47,53 +48,64 @@ static double haversine_distance(struct location loc1, struct location loc2);
 // Initialization function
 void RoadTracker_init(void) {
     assert(!isInitialized);
-    isRunning = true;
     isInitialized = true;
-    pthread_create(&roadTrackerThread, NULL, &trackLocationThreadFunc, NULL);
+    EventBus_subscribe(EVENT_FIX, on_fix, NULL);
 }
 
 // Cleanup function
 void RoadTracker_cleanup(void) {
     assert(isInitialized);
-    isRunning = false;
-    pthread_join(roadTrackerThread, NULL);
     isInitialized = false;
 }
 
-// Thread function to track the progress of the target location
-static void* trackLocationThreadFunc(void* arg) {
-    assert(isInitialized);
-    (void)arg;
-    while (isRunning) {
-        if (target_set) { // Only run if target is set
-            current_location  = GPS_getLocation();
-            if (current_location.latitude == INVALID_LATITUDE) {
-                progress = 0; // Reset progress if GPS signal is invalid
-                printf("Invalid Current Location. Check GPS signal !\n"); 
-            } else {
-                current_location  = GPS_getLocation();
-                current_distance = haversine_distance(current_location, target_location);
-                if (totalDistanceNeeded > 0) {
-                    progress = ((totalDistanceNeeded - current_distance) / totalDistanceNeeded) * 100;
-                    if (progress < 0) {
-                        progress = 0;  // Prevent negative progress
-                    } else if (current_distance <= THRESHOLD_REACH) { // Consider reach if within certain threshold to prevent the target is actually in the building
-                        progress = 100;
-                    }
-                }
-                if (progress == 100) {
-                    // Sleep for 3 seconds before resetting target to display NeoPixel longer
-                    printf("Target: Latitude %.6f, Longitude: %.6f, Current: Latitude %.6f, Longitude: %.6f, Speed: %.6f, Speed Limit: %d, progress: %.2f\n",target_location.latitude, target_location.longitude, current_location.latitude, current_location.longitude, current_location.speed, SpeedLED_getSpeedLimit(), progress);
-                    sleepForMs(SLEEP_TIME_FOR_PROGRESS_FULL);
-                    RoadTracker_resetData();
-                } else {
-                    printf("Target: Latitude %.6f, Longitude: %.6f, Current: Latitude %.6f, Longitude: %.6f, Speed: %.6f, Speed Limit: %d, progress: %.2f\n",target_location.latitude, target_location.longitude, current_location.latitude, current_location.longitude, current_location.speed, SpeedLED_getSpeedLimit(), progress);
-                }
+// Must hold roadTrackerMutex. Tells the subscribers (NeoPixel, parking) where navigation stands.
+static void publish_progress(void) {
+    struct Event event = {.topic = EVENT_PROGRESS};
+    event.progress.active = target_set;
+    event.progress.percent = progress;
+    EventBus_publish(&event);
+}
+
+// Called on the event dispatcher for every GPS reading to track the progress of the target location
+static void on_fix(const struct Event *event, void *context) {
+    (void)context;
+    pthread_mutex_lock(&roadTrackerMutex);
+    if (!target_set) { // Only run if target is set
+        pthread_mutex_unlock(&roadTrackerMutex);
+        return;
+    }
+    double previous = progress;
+    current_location = event->fix.location;
+    if (!event->fix.valid) {
+        progress = 0; // Reset progress if GPS signal is invalid
+        printf("Invalid Current Location. Check GPS signal !\n"); 
+    } else {
+        current_distance = haversine_distance(current_location, target_location);
+        if (totalDistanceNeeded > 0) {
+            progress = ((totalDistanceNeeded - current_distance) / totalDistanceNeeded) * 100;
+            if (progress < 0) {
+                progress = 0;  // Prevent negative progress
+            } else if (current_distance <= THRESHOLD_REACH) { // Consider reach if within certain threshold to prevent the target is actually in the building
+                progress = 100;
+            }
+        }
+        printf("Target: Latitude %.6f, Longitude: %.6f, Current: Latitude %.6f, Longitude: %.6f, Speed: %.6f, Speed Limit: %d, progress: %.2f\n",target_location.latitude, target_location.longitude, current_location.latitude, current_location.longitude, current_location.speed, SpeedLED_getSpeedLimit(), progress);
+        if (progress == 100) {
+            // Keep the target for a few seconds so the NeoPixel shows the arrival before resetting
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (!target_reached) {
+                target_reached = true;
+                reached_time = now;
+            } else if (time_diff_ms(&reached_time, &now) >= SLEEP_TIME_FOR_PROGRESS_FULL) {
+                RoadTracker_resetData();
             }
         }
-        sleepForMs(300);
     }
-    return NULL;
+    if (progress != previous || !target_set) {
+        publish_progress();
+    }
+    pthread_mutex_unlock(&roadTrackerMutex);
 }
 
 // Function to reset the target location and data
@@ -101,9 +113,10 @@ void RoadTracker_resetTarget() {
     assert(isInitialized);
     pthread_mutex_lock(&roadTrackerMutex); // Lock the mutex before resetting target
     RoadTracker_resetData();
-    runCommand("espeak -v mb-en1 -s 120  'Target location reset successfully' -w resetTarget.wav");
-    runCommand("aplay -q resetTarget.wav");
+    publish_progress();
     pthread_mutex_unlock(&roadTrackerMutex); // Unlock the mutex after resetting target
+    // Speak without the lock; on_fix takes it on the event dispatcher
+    TtsCache_playPrompt(TTS_PROMPT_TARGET_RESET);
 }
 
 // Function to remove the trailing spaces from the address parsing from microphone
@@ -115,25 +128,21 @@ static void rtrim(char *str) {
     str[len] = '\0';
 }
 
-// Expecting to be call from microphone
-// Function to set the target location
-// It will play the audio to let user know the target location is set or not
-void RoadTracker_setTarget(char *address) {
-    assert(isInitialized);
-    pthread_mutex_lock(&roadTrackerMutex); // Lock the mutex before setting target
+// Must hold roadTrackerMutex. Sets the target from an already geocoded location and
+// returns the prompt that tells the user whether it worked. The caller plays it after
+// unlocking, so on_fix on the event dispatcher never waits for the speaker.
+static TtsPrompt apply_target(char *address, struct location target) {
+    TtsPrompt prompt;
     souruce_location  = GPS_getLocation();
-    rtrim(address);
-    target_location = StreetAPI_get_lat_long(address);
+    target_location = target;
     printf("Target Location: Latitude %.6f, Longitude %.6f\n", target_location.latitude, target_location.longitude);
     if (target_location.latitude == INVALID_LATITUDE) {
         // printf("Fail to set the Target Location due to invalid address. Check the address again !\n");
-        runCommand("espeak -v mb-en1 -s 120  'Fail to set the Target Location due to invalid input address. Check the input address again ' -w invalidTargetError.wav");
-        runCommand("aplay -q invalidTargetError.wav");
+        prompt = TTS_PROMPT_INVALID_ADDRESS;
         RoadTracker_resetData();
     } else if (souruce_location.latitude == INVALID_LATITUDE) {
         // printf("Fail to set the Target Location due to invalid current location. Check the GPS signal again!\n");
-        runCommand("espeak -v mb-en1 -s 120  'Fail to set the Target Location due to invalid current location. Check the GPS signal again ' -w invalidCurrentError.wav");
-        runCommand("aplay -q invalidCurrentError.wav");
+        prompt = TTS_PROMPT_INVALID_LOCATION;
         RoadTracker_resetData();
     } else {
         // Set target Information
@@ -142,12 +151,39 @@ void RoadTracker_setTarget(char *address) {
         target_address[sizeof(target_address) - 1] = '\0'; // Ensure null termination
         target_set = true;
         printf("Target set to: Latitude %.6f, Longitude %.6f | Source Location: Latitude %.6f, Longitude %.6f | Total Distance: %.2f km\n", target_location.latitude, target_location.longitude, souruce_location.latitude, souruce_location.longitude, totalDistanceNeeded);
-        char sucessSetMsg[512]; // Adjust size if needed
-        snprintf(sucessSetMsg, sizeof(sucessSetMsg), "espeak -v mb-en1 -s 120 'Successfully setting the target destination to %s' -w successSet.wav", target_address);
-        runCommand(sucessSetMsg);
-        runCommand("aplay -q successSet.wav");
+        prompt = TTS_PROMPT_TARGET_SET;
     }
+    publish_progress();
+    return prompt;
+}
+
+// Sets the target under the lock, then plays the outcome without it
+static void set_target(char *address, struct location target) {
+    pthread_mutex_lock(&roadTrackerMutex); // Lock the mutex before setting target
+    TtsPrompt prompt = apply_target(address, target);
     pthread_mutex_unlock(&roadTrackerMutex); // Unlock the mutex after setting target
+    if (prompt == TTS_PROMPT_TARGET_SET) {
+        TtsCache_sayPromptWith(prompt, address);
+    } else {
+        TtsCache_playPrompt(prompt);
+    }
+}
+
+// Expecting to be call from microphone
+// Function to set the target location
+// It will play the audio to let user know the target location is set or not
+void RoadTracker_setTarget(char *address) {
+    assert(isInitialized);
+    rtrim(address);
+    // The geocode is an HTTP request; it runs before the lock is taken
+    set_target(address, StreetAPI_get_lat_long(address));
+}
+
+// Function to set the target location when the caller has already geocoded the address
+void RoadTracker_setTargetLocation(char *address, struct location target) {
+    assert(isInitialized);
+    rtrim(address);
+    set_target(address, target);
 }
 
 // Function to get the target location
@@ -163,6 +199,7 @@ static void RoadTracker_resetData() {
     current_distance = -1;
     strcpy(target_address, "");
     progress = 0;
+    target_reached = false;
 }
 
 // Convert degrees to radians
@@ -170,16 +207,6 @@ static double deg_to_rad(double deg) {
     return deg * (M_PI / 180.0);
 }
 
-// Fuinction to run a system command
-static void runCommand(const char* command) {
-    if (system(command) == -1) {
-        // printf("%s\n", command);
-        printf("error: system() command failed\n");
-    } else {
-        // printf("%s\n", command);
-    }
-}
-
 // Haversine formula to calculate distance between two locations
 static double haversine_distance(struct location loc1, struct location loc2) {
     double dlat = deg_to_rad(loc2.latitude - loc1.latitude);
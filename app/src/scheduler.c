@@ -0,0 +1,378 @@
+/*
+ * This file implements the Scheduler module. The wheel has 4 levels of 64 slots over 1 ms
+ * ticks (level L slot covers 64^L ticks), so inserting or removing a task is O(1) and a
+ * task far in the future is only touched when its slot cascades down a level. A bitmap per
+ * level says which slots are occupied, so the next wakeup is found with a few bit scans and
+ * the thread sleeps on an absolute CLOCK_MONOTONIC deadline until exactly then.
+ * Check the header file for more details.
+**/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <assert.h>
+#include <time.h>
+#include "scheduler.h"
+#include "threadConfig.h"
+
+#define TICK_NS 1000000LL               // 1 ms
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define MAX_DELTA_TICKS ((1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1)     // About 4.6 hours
+#define MAX_TASKS 16
+#define NAME_LENGTH 24
+
+struct task {
+    bool active;
+    bool running;
+    char name[NAME_LENGTH];
+    void (*fn)(void *context);
+    void *context;
+    uint64_t periodTicks;
+    uint64_t grainTicks;                // Deadlines are rounded up to a multiple of this
+    uint64_t nominal;                   // Tick the next run is due
+    uint64_t expiry;                    // Tick the next run fires (nominal rounded into the slack)
+    int level;
+    int slot;
+    int prev;
+    int next;
+
+    uint64_t runs;
+    uint64_t overruns;
+    double latencySumUs;
+    double latencySquareSumUs;
+    double latencyMaxUs;
+    double runSumUs;
+};
+
+static struct task tasks[MAX_TASKS];
+static int wheel[WHEEL_LEVELS][WHEEL_SIZE];     // Head task index per slot, -1 if empty
+static uint64_t occupied[WHEEL_LEVELS];         // Bit per non-empty slot
+static uint64_t currentTick = 0;                // Every tick up to here has been processed
+static int64_t startNs = 0;
+
+static pthread_mutex_t schedulerMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wakeCond;                 // Deadline moved earlier or shutting down
+static pthread_cond_t idleCond;                 // A task finished running
+static pthread_t schedulerThread;
+static bool isRunning = false;
+static bool isInitialized = false;
+
+static int64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static uint64_t now_tick(void) {
+    return (uint64_t)((now_ns() - startNs) / TICK_NS);
+}
+
+static void wheel_insert(int index) {
+    struct task *task = &tasks[index];
+    uint64_t delta = task->expiry - currentTick;
+    if (delta > MAX_DELTA_TICKS) {
+        delta = MAX_DELTA_TICKS;
+        task->expiry = currentTick + delta;
+    }
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1ULL << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    int slot = (int)((task->expiry >> (WHEEL_BITS * level)) & WHEEL_MASK);
+    task->level = level;
+    task->slot = slot;
+    task->prev = -1;
+    task->next = wheel[level][slot];
+    if (task->next >= 0) {
+        tasks[task->next].prev = index;
+    }
+    wheel[level][slot] = index;
+    occupied[level] |= 1ULL << slot;
+}
+
+static void wheel_unlink(int index) {
+    struct task *task = &tasks[index];
+    if (task->prev >= 0) {
+        tasks[task->prev].next = task->next;
+    } else {
+        wheel[task->level][task->slot] = task->next;
+    }
+    if (task->next >= 0) {
+        tasks[task->next].prev = task->prev;
+    }
+    if (wheel[task->level][task->slot] < 0) {
+        occupied[task->level] &= ~(1ULL << task->slot);
+    }
+    task->level = -1;
+}
+
+static bool wheel_empty(void) {
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        if (occupied[level] != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Earliest tick with work: a level 0 expiry, or a higher level slot that must cascade
+static uint64_t next_event_tick(void) {
+    uint64_t next = UINT64_MAX;
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        uint64_t bits = occupied[level];
+        if (bits == 0) {
+            continue;
+        }
+        int shift = WHEEL_BITS * level;
+        // Rotate so bit 0 is the slot right after the current one
+        int k = (int)(((currentTick >> shift) + 1) & WHEEL_MASK);
+        uint64_t rotated = k ? (bits >> k) | (bits << (WHEEL_SIZE - k)) : bits;
+        uint64_t offset = (uint64_t)__builtin_ctzll(rotated) + 1;
+        uint64_t tick = level == 0 ? currentTick + offset
+                                   : ((currentTick >> shift) + offset) << shift;
+        if (tick < next) {
+            next = tick;
+        }
+    }
+    return next;
+}
+
+// Jump to tick (nothing is due before it), cascade the slots that start there and
+// collect the tasks that fire. Returns the number written to due.
+static int advance_to(uint64_t tick, int due[MAX_TASKS]) {
+    currentTick = tick;
+    for (int level = WHEEL_LEVELS - 1; level > 0; level--) {
+        int shift = WHEEL_BITS * level;
+        if ((tick & ((1ULL << shift) - 1)) != 0) {
+            continue;
+        }
+        int slot = (int)((tick >> shift) & WHEEL_MASK);
+        int index = wheel[level][slot];
+        while (index >= 0) {
+            int next = tasks[index].next;
+            wheel_unlink(index);
+            wheel_insert(index);
+            index = next;
+        }
+    }
+    int count = 0;
+    int slot = (int)(tick & WHEEL_MASK);
+    int index = wheel[0][slot];
+    while (index >= 0) {
+        int next = tasks[index].next;
+        wheel_unlink(index);
+        due[count++] = index;
+        index = next;
+    }
+    return count;
+}
+
+// Must hold schedulerMutex. Sets the next nominal deadline after tick and queues the task.
+static void schedule_after(int index, uint64_t tick) {
+    struct task *task = &tasks[index];
+    while (task->nominal <= tick) {
+        task->nominal += task->periodTicks;
+    }
+    task->expiry = (task->nominal + task->grainTicks - 1) / task->grainTicks * task->grainTicks;
+    wheel_insert(index);
+}
+
+static void run_task(int index) {
+    struct task *task = &tasks[index];
+    int64_t nominalNs = startNs + (int64_t)task->nominal * TICK_NS;
+    uint64_t nominal = task->nominal;
+    task->running = true;
+    pthread_mutex_unlock(&schedulerMutex);
+
+    int64_t begin = now_ns();
+    task->fn(task->context);
+    int64_t end = now_ns();
+
+    pthread_mutex_lock(&schedulerMutex);
+    task->running = false;
+    double latencyUs = (begin - nominalNs) / 1000.0;
+    task->runs++;
+    task->latencySumUs += latencyUs;
+    task->latencySquareSumUs += latencyUs * latencyUs;
+    if (latencyUs > task->latencyMaxUs) {
+        task->latencyMaxUs = latencyUs;
+    }
+    task->runSumUs += (end - begin) / 1000.0;
+    pthread_cond_broadcast(&idleCond);
+
+    if (task->active) {
+        // Next absolute deadline; any period that already passed is counted and skipped
+        uint64_t now = now_tick();
+        uint64_t missed = now >= nominal + task->periodTicks ? (now - nominal) / task->periodTicks : 0;
+        task->overruns += missed;
+        schedule_after(index, now > currentTick ? now : currentTick);
+    }
+}
+
+static void* schedulerThreadFunc(void* arg) {
+    (void)arg;
+    pthread_mutex_lock(&schedulerMutex);
+    while (isRunning) {
+        if (wheel_empty()) {
+            // Nothing queued: keep the wheel's notion of now fresh for the next insert
+            currentTick = now_tick();
+            pthread_cond_wait(&wakeCond, &schedulerMutex);
+            continue;
+        }
+        uint64_t next = next_event_tick();
+        if (next > now_tick()) {
+            int64_t deadlineNs = startNs + (int64_t)next * TICK_NS;
+            struct timespec deadline = {deadlineNs / 1000000000LL, deadlineNs % 1000000000LL};
+            pthread_cond_timedwait(&wakeCond, &schedulerMutex, &deadline);
+            continue;
+        }
+        int due[MAX_TASKS];
+        int count = advance_to(next, due);
+        for (int i = 0; i < count && isRunning; i++) {
+            if (tasks[due[i]].active) {
+                run_task(due[i]);
+            }
+        }
+    }
+    pthread_mutex_unlock(&schedulerMutex);
+    return NULL;
+}
+
+// Initialization function
+void Scheduler_init(void) {
+    assert(!isInitialized);
+    memset(tasks, 0, sizeof(tasks));
+    memset(wheel, -1, sizeof(wheel));
+    memset(occupied, 0, sizeof(occupied));
+    startNs = now_ns();
+    currentTick = 0;
+
+    // Timed waits take absolute CLOCK_MONOTONIC deadlines, like clock_nanosleep(TIMER_ABSTIME)
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&wakeCond, &attr);
+    pthread_cond_init(&idleCond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    isRunning = true;
+    isInitialized = true;
+    if (ThreadConfig_create(&schedulerThread, "scheduler", &schedulerThreadFunc, NULL) != 0) {
+        perror("Failed to create scheduler thread");
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Cleanup function
+void Scheduler_cleanup(void) {
+    assert(isInitialized);
+    pthread_mutex_lock(&schedulerMutex);
+    isRunning = false;
+    pthread_cond_signal(&wakeCond);
+    pthread_mutex_unlock(&schedulerMutex);
+    pthread_join(schedulerThread, NULL);
+    Scheduler_printStats();
+    pthread_cond_destroy(&wakeCond);
+    pthread_cond_destroy(&idleCond);
+    isInitialized = false;
+}
+
+int Scheduler_addPeriodic(const char *name, long periodMs, long slackMs, void (*fn)(void *context), void *context) {
+    assert(isInitialized);
+    assert(periodMs > 0);
+    pthread_mutex_lock(&schedulerMutex);
+    int index = -1;
+    for (int i = 0; i < MAX_TASKS; i++) {
+        if (!tasks[i].active && !tasks[i].running) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        pthread_mutex_unlock(&schedulerMutex);
+        fprintf(stderr, "Scheduler: no free slot for task %s\n", name);
+        return -1;
+    }
+    struct task *task = &tasks[index];
+    memset(task, 0, sizeof(*task));
+    snprintf(task->name, sizeof(task->name), "%s", name);
+    task->fn = fn;
+    task->context = context;
+    task->periodTicks = (uint64_t)periodMs;
+    // Largest power of two within the slack: tasks that tolerate it line up on the same ticks
+    task->grainTicks = 1;
+    while (slackMs > 0 && (long)task->grainTicks * 2 <= slackMs + 1) {
+        task->grainTicks *= 2;
+    }
+    task->active = true;
+
+    uint64_t now = now_tick();
+    if (wheel_empty()) {
+        currentTick = now;      // Nothing queued relative to the old tick, so it can jump
+    }
+    now = now > currentTick ? now : currentTick;
+    task->nominal = now;
+    schedule_after(index, now);
+    pthread_cond_signal(&wakeCond);
+    pthread_mutex_unlock(&schedulerMutex);
+    return index;
+}
+
+void Scheduler_remove(int taskId) {
+    // Also called by module cleanups after Scheduler_cleanup; the table outlives the thread
+    if (taskId < 0 || taskId >= MAX_TASKS) {
+        return;
+    }
+    pthread_mutex_lock(&schedulerMutex);
+    struct task *task = &tasks[taskId];
+    if (task->active) {
+        task->active = false;
+        if (task->level >= 0) {
+            wheel_unlink(taskId);
+        }
+    }
+    // Removing a task from inside its own run must not wait for itself
+    if (isRunning && !pthread_equal(pthread_self(), schedulerThread)) {
+        while (task->running) {
+            pthread_cond_wait(&idleCond, &schedulerMutex);
+        }
+    }
+    pthread_mutex_unlock(&schedulerMutex);
+}
+
+SchedulerTaskStats Scheduler_getStats(int taskId) {
+    SchedulerTaskStats stats = {0};
+    if (taskId < 0 || taskId >= MAX_TASKS) {
+        return stats;
+    }
+    pthread_mutex_lock(&schedulerMutex);
+    struct task *task = &tasks[taskId];
+    stats.runs = task->runs;
+    stats.overruns = task->overruns;
+    if (task->runs > 0) {
+        stats.avgLatencyUs = task->latencySumUs / task->runs;
+        double variance = task->latencySquareSumUs / task->runs - stats.avgLatencyUs * stats.avgLatencyUs;
+        stats.jitterUs = variance > 0 ? sqrt(variance) : 0;
+        stats.avgRunUs = task->runSumUs / task->runs;
+    }
+    stats.maxLatencyUs = task->latencyMaxUs;
+    pthread_mutex_unlock(&schedulerMutex);
+    return stats;
+}
+
+void Scheduler_printStats(void) {
+    for (int i = 0; i < MAX_TASKS; i++) {
+        if (tasks[i].runs == 0) {
+            continue;
+        }
+        SchedulerTaskStats stats = Scheduler_getStats(i);
+        printf("Task %-16s %llu runs, %llu overruns, latency avg %.0f us max %.0f us jitter %.0f us, run avg %.0f us\n",
+               tasks[i].name, (unsigned long long)stats.runs, (unsigned long long)stats.overruns,
+               stats.avgLatencyUs, stats.maxLatencyUs, stats.jitterUs, stats.avgRunUs);
+    }
+}
@@ -1,4 +1,3 @@
-
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,66 +10,89 @@
 #include <assert.h>
 #include <math.h>
 #include "parking.h"
+#include "eventBus.h"
 
-static pthread_t updateLEDThread;
 static pthread_t updateSpeedLimitThread;
 static bool isRunning = false;
 static bool isInitialized = false;
 
-#define SAMPLING_PERIOD_MS 100  // 100ms sampling period
-double speed_kmh = 0.0; 
+// Protects the speed state below and the fix handed to the speed limit lookup
+static pthread_mutex_t speedMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t newFixCond = PTHREAD_COND_INITIALIZER;
+static struct location latest_fix = {INVALID_LATITUDE, INVALID_LONGITUDE, INVALID_SPEED};
+static bool have_new_fix = false;
+
+double speed_kmh = 0.0;
 int speedLimit = 0;
 int led_color = 2; //0: red, 1: yellow, 2: green
+static bool fix_valid = false;
 
-static void* updateSpeedAndLEDThreadFunc(void* arg) {
-    (void)arg; // Suppress unused parameter warning
-    while (isRunning) {
-
-        //get coords from GPS
-        //use GPS and accelerometer to calculate speed
-        //get speed limit from GPS and API
-        //compare speed to speed limit -> set LED
-
-        // Get GPS reading 
-        // struct location current_location  = {49.191458, -122.817887, 65};
-        struct location current_location = GPS_getLocation();
-        double gps_speed_kmh = current_location.speed;
-        speed_kmh = gps_speed_kmh;
-        if (current_location.latitude == INVALID_LATITUDE) {
-            led_color = 3;
-        } else if (gps_speed_kmh - speedLimit >= -5 && gps_speed_kmh - speedLimit <= 5) {
-            led_color = 1;//yellow
-        } else if (gps_speed_kmh > speedLimit) {
-            led_color = 0;//red
-        } else {
-            led_color = 2;//green
-        }
-        
-        // printf("Current Speed: (gps) %.2f km/h\n", gps_speed_kmh);
+// Must hold speedMutex. Recomputes the LED color and publishes the state if anything changed.
+static void update_speed_state(double speed, bool valid) {
+    int color;
+    if (!valid) {
+        color = 3;
+    } else if (speed - speedLimit >= -5 && speed - speedLimit <= 5) {
+        color = 1;//yellow
+    } else if (speed > speedLimit) {
+        color = 0;//red
+    } else {
+        color = 2;//green
+    }
+    bool changed = color != led_color || speed != speed_kmh || valid != fix_valid;
+    speed_kmh = speed;
+    led_color = color;
+    fix_valid = valid;
+    if (changed) {
+        struct Event event = {.topic = EVENT_SPEED_STATE};
+        event.speed.speed = speed;
+        event.speed.speedLimit = speedLimit;
+        event.speed.color = color;
+        EventBus_publish(&event);
+    }
+}
 
-        sleepForMs(SAMPLING_PERIOD_MS);
-        
+// Called on the event dispatcher for every GPS reading
+static void on_fix(const struct Event *event, void *context) {
+    (void)context;
+    pthread_mutex_lock(&speedMutex);
+    update_speed_state(event->fix.location.speed, event->fix.valid);
+    if (event->fix.valid) {
+        // Hand the position to the lookup thread; the HTTP request must not run on the dispatcher
+        latest_fix = event->fix.location;
+        have_new_fix = true;
+        pthread_cond_signal(&newFixCond);
     }
-    return NULL;
+    pthread_mutex_unlock(&speedMutex);
 }
 
+// Looks up the speed limit once per new valid fix instead of on a fixed timer
 static void* updateSpeedLimitFunc(void* arg) {
     (void)arg; // Suppress unused parameter warning
+    pthread_mutex_lock(&speedMutex);
     while (isRunning) {
-        // Get GPS reading 
-        // struct location current_location  = {49.191458, -122.817887, 65};
-        struct location current_location = GPS_getLocation();
-        // double gps_speed_kmh = current_location.speed;
+        while (isRunning && !have_new_fix) {
+            pthread_cond_wait(&newFixCond, &speedMutex);
+        }
+        if (!isRunning) {
+            break;
+        }
+        struct location current_location = latest_fix;
+        have_new_fix = false;
+        pthread_mutex_unlock(&speedMutex);
 
         int speedLimitResp = get_speed_limit(current_location.latitude, current_location.longitude);
-        if(speedLimitResp > 0) {
+
+        pthread_mutex_lock(&speedMutex);
+        if (speedLimitResp > 0 && speedLimitResp != speedLimit) {
             speedLimit = speedLimitResp;
+            struct Event event = {.topic = EVENT_SPEED_LIMIT, .speedLimit = speedLimit};
+            EventBus_publish(&event);
+            update_speed_state(speed_kmh, fix_valid);
         }
         // printf("Speed Limit: %d km/h\n", speedLimit);
-    
-        sleepForMs(SAMPLING_PERIOD_MS);
-        
     }
+    pthread_mutex_unlock(&speedMutex);
     return NULL;
 }
 
@@ -78,15 +100,17 @@ void SpeedLED_init(void) {
     assert(!isInitialized);
     isRunning = true;
     isInitialized = true;
-    pthread_create(&updateLEDThread, NULL, &updateSpeedAndLEDThreadFunc, NULL);
+    EventBus_subscribe(EVENT_FIX, on_fix, NULL);
     pthread_create(&updateSpeedLimitThread, NULL, &updateSpeedLimitFunc, NULL);
 
 }
 
 void SpeedLED_cleanup(void) {
     assert(isInitialized);
+    pthread_mutex_lock(&speedMutex);
     isRunning = false;
-    pthread_join(updateLEDThread, NULL);
+    pthread_cond_signal(&newFixCond);
+    pthread_mutex_unlock(&speedMutex);
     pthread_join(updateSpeedLimitThread, NULL);
     isInitialized = false;
 }
@@ -104,4 +128,4 @@ double SpeedLED_getSpeed(void) {
 int SpeedLED_getLEDColor(void) {
     assert(isInitialized);
     return led_color;
-}
\ No newline at end of file
+}
@@ -16,10 +16,13 @@
 #define API_URL_LAT_LON "https://nominatim.openstreetmap.org/reverse?format=json&lat=%f&lon=%f"
 #define SMALL_BUFFER_SIZE 512
 #define LARGE_BUFFER_SIZE 1024
+#define REQUEST_TIMEOUT_S 10L   // Give up on a lookup after this long, like the speed limit query
 
 static bool isInitialize = false;
 void StreetAPI_init(){
     assert(!isInitialize);
+    // Lookups run from several threads at once, so curl must be set up before the first of them
+    curl_global_init(CURL_GLOBAL_DEFAULT);
     isInitialize = true;
 }
 
@@ -78,6 +81,9 @@ struct location StreetAPI_get_lat_long(char *address) {
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
     // Set the header to identify the client. It semms required by the API. (not working without it)
     curl_easy_setopt(curl, CURLOPT_USERAGENT, "Mozilla/5.0");
+    // Bound the request; no signals for the timeout, since lookups run on several threads
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, REQUEST_TIMEOUT_S);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
 
     res = curl_easy_perform(curl);
     if (res != CURLE_OK) {
@@ -124,6 +130,9 @@ char* StreetAPI_get_address_from_lat_lon(double lat, double lon) {
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
     // Set the header to identify the client. It semms required by the API. (not working without it)
     curl_easy_setopt(curl, CURLOPT_USERAGENT, "Mozilla/5.0");
+    // Bound the request; no signals for the timeout, since lookups run on several threads
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, REQUEST_TIMEOUT_S);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
 
     res = curl_easy_perform(curl);
     if (res != CURLE_OK) {
@@ -154,5 +163,6 @@ char* StreetAPI_get_address_from_lat_lon(double lat, double lon) {
 
 void StreetAPI_cleanup() {
     assert(isInitialize);
+    curl_global_cleanup();
     isInitialize = false;
 }
@@ -0,0 +1,181 @@
+/*
+ * This file implements the ThreadConfig module. The table below is the one place that says
+ * which threads are latency critical. Priorities stay below 50, where PREEMPT_RT runs the
+ * threaded interrupt handlers, so none of these threads can hold off the UART or GPIO
+ * interrupt it is waiting on. The audio threads share a core; the reactor, the event
+ * dispatcher (which also renders the NeoPixel frame into R5 shared memory) and the scheduler
+ * share another, which leaves the remaining cores to the Python and espeak subprocesses.
+ * Check the header file for more details.
+**/
+#define _GNU_SOURCE             // pthread_attr_setaffinity_np, pthread_setname_np
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "threadConfig.h"
+
+struct threadProfile {
+    const char *name;
+    int priority;           // SCHED_FIFO priority, 0 keeps SCHED_OTHER
+    int cpu;                // -1 lets the thread run anywhere
+    size_t stackSize;
+};
+
+static const struct threadProfile profiles[] = {
+    {"reactor",       45, 1, 128 * 1024},   // GPS UART, rotary encoder, joystick button
+    {"audio-capture", 44, 2, 128 * 1024},   // ALSA period reads; a late read is an overrun
+    {"event-bus",     40, 1, 256 * 1024},   // Event handlers, NeoPixel frames to the R5
+    {"scheduler",     35, 1, 128 * 1024},   // Parking sampling, LED animation frames
+    {"audio-dsp",     30, 2, 128 * 1024},   // Resampler, noise suppressor, AGC
+};
+#define PROFILE_COUNT (int)(sizeof(profiles) / sizeof(profiles[0]))
+
+struct threadState {
+    void *mapping;          // Stack plus a guard page below it
+    size_t mappingSize;
+    bool started;
+    int policy;             // What the thread actually got
+    int priority;
+};
+
+static struct threadState states[PROFILE_COUNT];
+static size_t pageSize = 4096;
+static bool realtimeAllowed = true;
+static bool isInitialized = false;
+
+static int find_profile(const char *name) {
+    for (int i = 0; i < PROFILE_COUNT; i++) {
+        if (strcmp(profiles[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Maps the stack with a PROT_NONE guard page under it and touches every page
+static void allocate_stack(int index) {
+    struct threadState *state = &states[index];
+    state->mappingSize = profiles[index].stackSize + pageSize;
+    state->mapping = mmap(NULL, state->mappingSize, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (state->mapping == MAP_FAILED) {
+        perror("ThreadConfig: stack mmap");
+        state->mapping = NULL;
+        return;
+    }
+    if (mprotect(state->mapping, pageSize, PROT_NONE) != 0) {
+        perror("ThreadConfig: stack guard");
+    }
+    memset((char *)state->mapping + pageSize, 0, profiles[index].stackSize);
+}
+
+static void build_attr(pthread_attr_t *attr, int index, bool realtime) {
+    const struct threadProfile *profile = &profiles[index];
+    pthread_attr_init(attr);
+    if (states[index].mapping != NULL) {
+        pthread_attr_setstack(attr, (char *)states[index].mapping + pageSize, profile->stackSize);
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (profile->cpu >= 0 && profile->cpu < cpus) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(profile->cpu, &set);
+        pthread_attr_setaffinity_np(attr, sizeof(set), &set);
+    }
+    if (realtime && profile->priority > 0) {
+        struct sched_param param = {.sched_priority = profile->priority};
+        pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(attr, SCHED_FIFO);
+        pthread_attr_setschedparam(attr, &param);
+    }
+}
+
+// Initialization function
+void ThreadConfig_init(void) {
+    assert(!isInitialized);
+    long page = sysconf(_SC_PAGESIZE);
+    if (page > 0) {
+        pageSize = (size_t)page;
+    }
+
+    // Lock pages as they are touched, rather than populating every 8 MB default thread
+    // stack and the speech model up front
+    int flags = MCL_CURRENT | MCL_FUTURE;
+#ifdef MCL_ONFAULT
+    flags |= MCL_ONFAULT;
+#endif
+    if (mlockall(flags) != 0) {
+        perror("ThreadConfig: mlockall (pages may be swapped or faulted in late)");
+    }
+
+    memset(states, 0, sizeof(states));
+    for (int i = 0; i < PROFILE_COUNT; i++) {
+        allocate_stack(i);
+    }
+    realtimeAllowed = true;
+    isInitialized = true;
+}
+
+// Cleanup function
+void ThreadConfig_cleanup(void) {
+    assert(isInitialized);
+    for (int i = 0; i < PROFILE_COUNT; i++) {
+        if (states[i].mapping != NULL) {
+            munmap(states[i].mapping, states[i].mappingSize);
+            states[i].mapping = NULL;
+        }
+    }
+    munlockall();
+    isInitialized = false;
+}
+
+int ThreadConfig_create(pthread_t *thread, const char *name, void *(*fn)(void *arg), void *arg) {
+    assert(isInitialized);
+    int index = find_profile(name);
+    int rc;
+    if (index < 0) {
+        rc = pthread_create(thread, NULL, fn, arg);
+    } else {
+        pthread_attr_t attr;
+        build_attr(&attr, index, realtimeAllowed);
+        rc = pthread_create(thread, &attr, fn, arg);
+        pthread_attr_destroy(&attr);
+        if (rc == EPERM && realtimeAllowed) {
+            fprintf(stderr, "ThreadConfig: no permission for SCHED_FIFO, threads keep normal scheduling\n");
+            realtimeAllowed = false;
+            build_attr(&attr, index, false);
+            rc = pthread_create(thread, &attr, fn, arg);
+            pthread_attr_destroy(&attr);
+        }
+    }
+    if (rc != 0) {
+        return rc;
+    }
+
+    pthread_setname_np(*thread, name);
+    if (index >= 0) {
+        // pthread_create() fails rather than ignore explicit attributes, so these took effect
+        bool realtime = realtimeAllowed && profiles[index].priority > 0;
+        states[index].started = true;
+        states[index].policy = realtime ? SCHED_FIFO : SCHED_OTHER;
+        states[index].priority = realtime ? profiles[index].priority : 0;
+    }
+    return 0;
+}
+
+void ThreadConfig_print(void) {
+    for (int i = 0; i < PROFILE_COUNT; i++) {
+        if (!states[i].started) {
+            continue;
+        }
+        printf("Thread %-14s wants FIFO %d on CPU %d, got %s %d\n",
+               profiles[i].name, profiles[i].priority, profiles[i].cpu,
+               states[i].policy == SCHED_FIFO ? "FIFO" : "OTHER", states[i].priority);
+    }
+}
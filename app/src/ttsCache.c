@@ -0,0 +1,468 @@
+/*
+* This file implements the TtsCache module. espeak is run with --stdout so the WAV it produces is
+* parsed straight into memory instead of being written to disk and replayed with aplay.
+* Fixed prompts are rendered on the warmup thread (or on first use, whichever comes first) and live
+* for the life of the program; everything else goes through a small LRU cache keyed by an FNV-1a
+* hash of the text. Check the header file for more details.
+**/
+#define _GNU_SOURCE             // pipe2
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include <sys/wait.h>
+#include "ttsCache.h"
+#include "hal/speaker.h"
+
+#define ESPEAK_VOICE "mb-en1"
+#define ESPEAK_SPEED "120"
+#define LRU_ENTRIES 48
+#define MAX_NUMBER_WORDS 16
+#define MAX_SPOKEN_NUMBER 999999
+#define WAV_HEADER_SIZE 12
+#define WAV_CHUNK_HEADER_SIZE 8
+#define READ_CHUNK_SIZE 4096
+
+struct clip {
+    int16_t *samples;
+    size_t numSamples;
+    unsigned int rate;
+};
+
+struct lruEntry {
+    uint64_t hash;
+    char *text;
+    struct clip clip;
+    unsigned long lastUsed;
+};
+
+static const char *promptText[TTS_NUM_PROMPTS] = {
+    [TTS_PROMPT_TARGET_RESET] = "Target location reset successfully",
+    [TTS_PROMPT_INVALID_ADDRESS] = "Fail to set the Target Location due to invalid input address. Check the input address again",
+    [TTS_PROMPT_INVALID_LOCATION] = "Fail to set the Target Location due to invalid current location. Check the GPS signal again",
+    [TTS_PROMPT_TARGET_SET] = "Successfully setting the target destination to",
+    [TTS_PROMPT_SPEED_LIMIT] = "The speed limit is",
+    [TTS_PROMPT_SPEED_LIMIT_UNKNOWN] = "The speed limit on this road is unknown",
+    [TTS_PROMPT_CURRENT_SPEED] = "You are driving at",
+    [TTS_PROMPT_PROGRESS] = "You have covered",
+    [TTS_PROMPT_NO_TARGET] = "No target destination is set",
+};
+
+static const char *smallNumbers[] = {
+    "zero", "one", "two", "three", "four", "five", "six", "seven", "eight", "nine", "ten",
+    "eleven", "twelve", "thirteen", "fourteen", "fifteen", "sixteen", "seventeen", "eighteen", "nineteen"
+};
+static const char *tensNumbers[] = {
+    "", "", "twenty", "thirty", "forty", "fifty", "sixty", "seventy", "eighty", "ninety"
+};
+
+static struct clip prompts[TTS_NUM_PROMPTS];
+static struct lruEntry lru[LRU_ENTRIES];
+static unsigned long lruTick = 0;
+static atomic_bool isInitialized = false;   // Also read by the warmup thread to stop early
+static pthread_t warmupThread;
+static pthread_mutex_t cacheMutex = PTHREAD_MUTEX_INITIALIZER; // Protects the LRU table
+static pthread_mutex_t promptMutex[TTS_NUM_PROMPTS];           // Protects rendering of each prompt
+
+static uint64_t hash_text(const char *text) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (; *text; text++) {
+        hash ^= (unsigned char)*text;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Parse the RIFF/WAVE stream espeak writes. When writing to a pipe espeak cannot seek back to
+// patch the data size, so the data chunk is taken to run to the end of the buffer.
+static bool parse_wav(const uint8_t *bytes, size_t len, struct clip *out) {
+    if (len < WAV_HEADER_SIZE || memcmp(bytes, "RIFF", 4) != 0 || memcmp(bytes + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    unsigned int rate = 0;
+    size_t pos = WAV_HEADER_SIZE;
+    while (pos + WAV_CHUNK_HEADER_SIZE <= len) {
+        const uint8_t *chunk = bytes + pos;
+        size_t chunkSize = read_le32(chunk + 4);
+        pos += WAV_CHUNK_HEADER_SIZE;
+        if (memcmp(chunk, "fmt ", 4) == 0 && pos + 8 <= len) {
+            rate = read_le32(bytes + pos + 4);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            size_t available = len - pos;
+            if (chunkSize > available) {
+                chunkSize = available;
+            }
+            if (rate == 0) {
+                return false;
+            }
+            out->numSamples = chunkSize / sizeof(int16_t);
+            out->samples = malloc(out->numSamples * sizeof(int16_t) + 1);
+            if (!out->samples) {
+                return false;
+            }
+            memcpy(out->samples, bytes + pos, out->numSamples * sizeof(int16_t));
+            out->rate = rate;
+            return true;
+        }
+        pos += chunkSize;
+    }
+    return false;
+}
+
+// Run espeak without a shell (so quotes in the text are harmless) and capture its WAV output
+static bool synthesize(const char *text, struct clip *out) {
+    int pipefd[2];
+    // Close-on-exec, so a child forked meanwhile elsewhere does not keep the write end open
+    if (pipe2(pipefd, O_CLOEXEC) < 0) {
+        perror("pipe");
+        return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(pipefd[0]);
+        if (dup2(pipefd[1], STDOUT_FILENO) < 0) {
+            perror("dup2");
+            exit(1);
+        }
+        close(pipefd[1]);
+        execlp("espeak", "espeak", "-v", ESPEAK_VOICE, "-s", ESPEAK_SPEED, "--stdout", text, (char *)NULL);
+        perror("execlp espeak failed");
+        exit(1);
+    }
+    close(pipefd[1]);
+
+    uint8_t *bytes = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+    ssize_t count;
+    do {
+        if (size + READ_CHUNK_SIZE > capacity) {
+            capacity = capacity ? capacity * 2 : 64 * READ_CHUNK_SIZE;
+            uint8_t *grown = realloc(bytes, capacity);
+            if (!grown) {
+                free(bytes);
+                close(pipefd[0]);
+                waitpid(pid, NULL, 0);
+                return false;
+            }
+            bytes = grown;
+        }
+        count = read(pipefd[0], bytes + size, READ_CHUNK_SIZE);
+        if (count > 0) {
+            size += (size_t)count;
+        }
+    } while (count > 0);
+    close(pipefd[0]);
+    waitpid(pid, NULL, 0);
+
+    bool ok = parse_wav(bytes, size, out);
+    free(bytes);
+    if (!ok) {
+        fprintf(stderr, "TtsCache: espeak produced no audio for '%s'\n", text);
+    }
+    return ok;
+}
+
+static bool copy_clip(const struct clip *src, struct clip *dst) {
+    dst->samples = malloc(src->numSamples * sizeof(int16_t) + 1);
+    if (!dst->samples) {
+        return false;
+    }
+    memcpy(dst->samples, src->samples, src->numSamples * sizeof(int16_t));
+    dst->numSamples = src->numSamples;
+    dst->rate = src->rate;
+    return true;
+}
+
+// Must hold cacheMutex
+static struct lruEntry *lru_find(uint64_t hash, const char *text) {
+    for (int i = 0; i < LRU_ENTRIES; i++) {
+        if (lru[i].text && lru[i].hash == hash && strcmp(lru[i].text, text) == 0) {
+            lru[i].lastUsed = ++lruTick;
+            return &lru[i];
+        }
+    }
+    return NULL;
+}
+
+// Must hold cacheMutex. Takes ownership of clip.
+static void lru_insert(uint64_t hash, const char *text, struct clip *clip) {
+    if (lru_find(hash, text)) {
+        // Another thread synthesized the same text meanwhile
+        free(clip->samples);
+        return;
+    }
+    struct lruEntry *victim = &lru[0];
+    for (int i = 0; i < LRU_ENTRIES; i++) {
+        if (!lru[i].text) {
+            victim = &lru[i];
+            break;
+        }
+        if (lru[i].lastUsed < victim->lastUsed) {
+            victim = &lru[i];
+        }
+    }
+    free(victim->text);
+    free(victim->clip.samples);
+    victim->text = strdup(text);
+    victim->hash = hash;
+    victim->clip = *clip;
+    victim->lastUsed = ++lruTick;
+}
+
+// Get a private copy of the audio for text, synthesizing it on a cache miss.
+// espeak runs without holding the lock so cached lookups are never blocked behind it.
+static bool get_clip(const char *text, struct clip *out) {
+    uint64_t hash = hash_text(text);
+    pthread_mutex_lock(&cacheMutex);
+    struct lruEntry *entry = lru_find(hash, text);
+    if (entry) {
+        bool ok = copy_clip(&entry->clip, out);
+        pthread_mutex_unlock(&cacheMutex);
+        return ok;
+    }
+    pthread_mutex_unlock(&cacheMutex);
+
+    struct clip fresh;
+    if (!synthesize(text, &fresh)) {
+        return false;
+    }
+    if (!copy_clip(&fresh, out)) {
+        free(fresh.samples);
+        return false;
+    }
+    pthread_mutex_lock(&cacheMutex);
+    lru_insert(hash, text, &fresh);
+    pthread_mutex_unlock(&cacheMutex);
+    return true;
+}
+
+// Get the audio of a fixed prompt, rendering it if neither the warmup thread nor an earlier call has.
+// Returns NULL if espeak fails; the next call tries again.
+static const struct clip *get_prompt(TtsPrompt prompt) {
+    pthread_mutex_lock(&promptMutex[prompt]);
+    if (!prompts[prompt].samples && !synthesize(promptText[prompt], &prompts[prompt])) {
+        prompts[prompt].samples = NULL;
+    }
+    const struct clip *clip = prompts[prompt].samples ? &prompts[prompt] : NULL;
+    pthread_mutex_unlock(&promptMutex[prompt]);
+    return clip;
+}
+
+// Join clips of the same sample rate into one buffer so they play back to back without a gap
+static void play_concatenated(const struct clip *parts, int numParts) {
+    size_t total = 0;
+    for (int i = 0; i < numParts; i++) {
+        if (parts[i].rate != parts[0].rate) {
+            fprintf(stderr, "TtsCache: cannot join clips with different sample rates\n");
+            return;
+        }
+        total += parts[i].numSamples;
+    }
+    int16_t *joined = malloc(total * sizeof(int16_t) + 1);
+    if (!joined) {
+        return;
+    }
+    size_t offset = 0;
+    for (int i = 0; i < numParts; i++) {
+        memcpy(joined + offset, parts[i].samples, parts[i].numSamples * sizeof(int16_t));
+        offset += parts[i].numSamples;
+    }
+    Speaker_playPcm(joined, total, parts[0].rate);
+    free(joined);
+}
+
+// Append the words for 0 < number < 1000
+static int hundreds_to_words(int number, const char *words[], int count) {
+    if (number >= 100) {
+        words[count++] = smallNumbers[number / 100];
+        words[count++] = "hundred";
+        number %= 100;
+    }
+    if (number >= 20) {
+        words[count++] = tensNumbers[number / 10];
+        number %= 10;
+    }
+    if (number > 0) {
+        words[count++] = smallNumbers[number];
+    }
+    return count;
+}
+
+// Split a number below one million into the words that are cached as fragments. Returns the word count.
+static int number_to_words(int number, const char *words[]) {
+    int count = 0;
+    if (number == 0) {
+        words[count++] = smallNumbers[0];
+        return count;
+    }
+    if (number >= 1000) {
+        count = hundreds_to_words(number / 1000, words, count);
+        words[count++] = "thousand";
+        number %= 1000;
+    }
+    return hundreds_to_words(number, words, count);
+}
+
+// Pre-render the fixed prompts and then the number words in the background, so startup does not
+// wait for espeak and the first prompt or spoken number is usually already in memory
+static void* warmupThreadFunc(void* arg) {
+    (void)arg;
+    for (int i = 0; i < TTS_NUM_PROMPTS && isInitialized; i++) {
+        get_prompt((TtsPrompt)i);
+    }
+    for (size_t i = 0; i < sizeof(smallNumbers) / sizeof(smallNumbers[0]) && isInitialized; i++) {
+        TtsCache_prefetch(smallNumbers[i]);
+    }
+    for (size_t i = 2; i < sizeof(tensNumbers) / sizeof(tensNumbers[0]) && isInitialized; i++) {
+        TtsCache_prefetch(tensNumbers[i]);
+    }
+    if (isInitialized) {
+        TtsCache_prefetch("hundred");
+        TtsCache_prefetch("thousand");
+    }
+    return NULL;
+}
+
+void TtsCache_init(void) {
+    assert(!isInitialized);
+    for (int i = 0; i < TTS_NUM_PROMPTS; i++) {
+        pthread_mutex_init(&promptMutex[i], NULL);
+        prompts[i].samples = NULL;
+        prompts[i].numSamples = 0;
+    }
+    isInitialized = true;
+    pthread_create(&warmupThread, NULL, &warmupThreadFunc, NULL);
+}
+
+void TtsCache_cleanup(void) {
+    assert(isInitialized);
+    isInitialized = false;
+    pthread_join(warmupThread, NULL);
+    pthread_mutex_lock(&cacheMutex);
+    for (int i = 0; i < LRU_ENTRIES; i++) {
+        free(lru[i].text);
+        free(lru[i].clip.samples);
+        lru[i].text = NULL;
+        lru[i].clip.samples = NULL;
+    }
+    pthread_mutex_unlock(&cacheMutex);
+    for (int i = 0; i < TTS_NUM_PROMPTS; i++) {
+        free(prompts[i].samples);
+        prompts[i].samples = NULL;
+        pthread_mutex_destroy(&promptMutex[i]);
+    }
+}
+
+void TtsCache_playPrompt(TtsPrompt prompt) {
+    assert(isInitialized);
+    assert(prompt < TTS_NUM_PROMPTS);
+    const struct clip *clip = get_prompt(prompt);
+    if (clip) {
+        Speaker_playPcm(clip->samples, clip->numSamples, clip->rate);
+    }
+}
+
+void TtsCache_say(const char *text) {
+    assert(isInitialized);
+    if (!text || text[0] == '\0') {
+        return;
+    }
+    struct clip clip;
+    if (get_clip(text, &clip)) {
+        Speaker_playPcm(clip.samples, clip.numSamples, clip.rate);
+        free(clip.samples);
+    }
+}
+
+void TtsCache_sayPromptWith(TtsPrompt prompt, const char *text) {
+    assert(isInitialized);
+    assert(prompt < TTS_NUM_PROMPTS);
+    const struct clip *clip = get_prompt(prompt);
+    struct clip parts[2];
+    if (!clip || !get_clip(text, &parts[1])) {
+        TtsCache_playPrompt(prompt);
+        TtsCache_say(text);
+        return;
+    }
+    parts[0] = *clip;
+    play_concatenated(parts, 2);
+    free(parts[1].samples);
+}
+
+// Appends the cached clip of every word of the number to parts, returns the new part count
+static int number_clips(int number, struct clip parts[], int numParts) {
+    const char *words[MAX_NUMBER_WORDS];
+    int numWords = number_to_words(number, words);
+    for (int i = 0; i < numWords; i++) {
+        if (get_clip(words[i], &parts[numParts])) {
+            numParts++;
+        }
+    }
+    return numParts;
+}
+
+void TtsCache_sayNumber(int number) {
+    assert(isInitialized);
+    if (number < 0 || number > MAX_SPOKEN_NUMBER) {
+        return;
+    }
+    struct clip parts[MAX_NUMBER_WORDS];
+    int numParts = number_clips(number, parts, 0);
+    if (numParts > 0) {
+        play_concatenated(parts, numParts);
+    }
+    for (int i = 0; i < numParts; i++) {
+        free(parts[i].samples);
+    }
+}
+
+void TtsCache_sayPromptNumber(TtsPrompt prompt, int number, const char *unit) {
+    assert(isInitialized);
+    assert(prompt < TTS_NUM_PROMPTS);
+    const struct clip *clip = get_prompt(prompt);
+    if (number < 0 || number > MAX_SPOKEN_NUMBER || !clip) {
+        TtsCache_playPrompt(prompt);
+        TtsCache_sayNumber(number);
+        TtsCache_say(unit);
+        return;
+    }
+    // parts[0] is the prompt itself and is not freed
+    struct clip parts[MAX_NUMBER_WORDS + 2];
+    parts[0] = *clip;
+    int numParts = number_clips(number, parts, 1);
+    if (unit && unit[0] != '\0' && get_clip(unit, &parts[numParts])) {
+        numParts++;
+    }
+    play_concatenated(parts, numParts);
+    for (int i = 1; i < numParts; i++) {
+        free(parts[i].samples);
+    }
+}
+
+void TtsCache_prefetch(const char *text) {
+    if (!text || text[0] == '\0') {
+        return;
+    }
+    struct clip clip;
+    if (get_clip(text, &clip)) {
+        free(clip.samples);
+    }
+}
@@ -0,0 +1,352 @@
+/*
+* This file implements the VoiceCommand module. It replaces the substring checks that used to live in
+* the microphone module: the transcript goes through Intent_parse() first and only falls back to the
+* AI when the parser cannot handle it. Check the header file for more details.
+**/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <assert.h>
+#include "hal/GPS.h"
+#include "voiceCommand.h"
+#include "intent.h"
+#include "ai_api.h"
+#include "roadTracker.h"
+#include "speedLimitLED.h"
+#include "streetAPI.h"
+#include "ttsCache.h"
+
+#define UNIT_SPEED "kilometers per hour"
+#define UNIT_PROGRESS "percent of the way"
+
+static bool isInitialized = false;
+
+// Initialization function
+void VoiceCommand_init(void) {
+    assert(!isInitialized);
+    Intent_init();
+    isInitialized = true;
+    // Units are spoken after a number, so have them ready before the first question
+    TtsCache_prefetch(UNIT_SPEED);
+    TtsCache_prefetch(UNIT_PROGRESS);
+}
+
+// Cleanup function
+void VoiceCommand_cleanup(void) {
+    assert(isInitialized);
+    Intent_cleanup();
+    isInitialized = false;
+}
+
+// Stages of the set-target pipeline, in the order they are reported
+typedef enum {
+    STAGE_RAW_GEOCODED,         // Lookup of the place exactly as spoken finished
+    STAGE_AI_FORMATTED,         // AI returned a formatted address
+    STAGE_AI_GEOCODED,          // Lookup of the AI address finished
+    STAGE_CONFIRMATION_READY,   // Spoken confirmation synthesized into the TTS cache
+    STAGE_TARGET_SET,           // Winner handed to RoadTracker (confirmation playing)
+    NUM_STAGES
+} PipelineStage;
+
+static const char *stageNames[NUM_STAGES] = {
+    [STAGE_RAW_GEOCODED] = "raw geocode",
+    [STAGE_AI_FORMATTED] = "AI format",
+    [STAGE_AI_GEOCODED] = "AI geocode",
+    [STAGE_CONFIRMATION_READY] = "confirmation ready",
+    [STAGE_TARGET_SET] = "target set",
+};
+
+// One candidate address and its lookup, run on its own thread
+struct candidate {
+    char address[INTENT_MAX_ARGUMENT];
+    struct location location;
+    bool done;
+    bool started;
+};
+
+// Shared state of one set-target request. Protected by pipelineMutex. Heap allocated: the
+// lookups still in flight when the target is set run on after set_target() returns, and
+// whoever drops the last reference frees it.
+struct pipeline {
+    struct timespec start;
+    struct timespec stageTime[NUM_STAGES];
+    bool stageDone[NUM_STAGES];
+    struct candidate raw;
+    struct candidate ai;
+    int aiRequest;
+    int references;
+};
+
+static pthread_mutex_t pipelineMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pipelineCond = PTHREAD_COND_INITIALIZER;
+
+static bool is_valid(const struct location *loc) {
+    return loc->latitude != INVALID_LATITUDE;
+}
+
+// Must hold pipelineMutex
+static void mark_stage(struct pipeline *p, PipelineStage stage) {
+    clock_gettime(CLOCK_MONOTONIC, &p->stageTime[stage]);
+    p->stageDone[stage] = true;
+    pthread_cond_broadcast(&pipelineCond);
+}
+
+static void release_pipeline(struct pipeline *p) {
+    pthread_mutex_lock(&pipelineMutex);
+    bool last = --p->references == 0;
+    pthread_mutex_unlock(&pipelineMutex);
+    if (last) {
+        free(p);
+    }
+}
+
+// Starts a detached pipeline thread holding its own reference. Returns false if it could not start.
+static bool start_pipeline_thread(struct pipeline *p, void *(*threadFunc)(void *)) {
+    pthread_mutex_lock(&pipelineMutex);
+    p->references++;
+    pthread_mutex_unlock(&pipelineMutex);
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, threadFunc, p) != 0) {
+        release_pipeline(p);
+        return false;
+    }
+    pthread_detach(thread);
+    return true;
+}
+
+static void* rawGeocodeThreadFunc(void* arg) {
+    struct pipeline *p = arg;
+    struct location loc = StreetAPI_get_lat_long(p->raw.address);
+    pthread_mutex_lock(&pipelineMutex);
+    p->raw.location = loc;
+    p->raw.done = true;
+    mark_stage(p, STAGE_RAW_GEOCODED);
+    pthread_mutex_unlock(&pipelineMutex);
+    release_pipeline(p);
+    return NULL;
+}
+
+// Waits for the AI to format the address, then looks that address up
+static void* aiGeocodeThreadFunc(void* arg) {
+    struct pipeline *p = arg;
+    char *formatted = NULL;
+    AiStatus status = AI_wait(p->aiRequest, &formatted);
+
+    pthread_mutex_lock(&pipelineMutex);
+    mark_stage(p, STAGE_AI_FORMATTED);
+    bool lookup = status == AI_DONE && formatted && !p->stageDone[STAGE_TARGET_SET];
+    if (lookup) {
+        printf("Location Formatted: %s\n", formatted);
+        snprintf(p->ai.address, sizeof(p->ai.address), "%s", formatted);
+    }
+    pthread_mutex_unlock(&pipelineMutex);
+    free(formatted);
+
+    struct location loc = {INVALID_LATITUDE, INVALID_LONGITUDE, INVALID_SPEED};
+    if (lookup) {
+        // The AI address is what will be announced if it wins, so have it synthesized too
+        TtsCache_prefetch(p->ai.address);
+        loc = StreetAPI_get_lat_long(p->ai.address);
+    }
+    pthread_mutex_lock(&pipelineMutex);
+    p->ai.location = loc;
+    p->ai.done = true;
+    mark_stage(p, STAGE_AI_GEOCODED);
+    pthread_mutex_unlock(&pipelineMutex);
+    release_pipeline(p);
+    return NULL;
+}
+
+// Synthesizes the confirmation for the place as spoken while the lookups are running
+static void* prefetchThreadFunc(void* arg) {
+    struct pipeline *p = arg;
+    TtsCache_prefetch(p->raw.address);
+    pthread_mutex_lock(&pipelineMutex);
+    mark_stage(p, STAGE_CONFIRMATION_READY);
+    pthread_mutex_unlock(&pipelineMutex);
+    release_pipeline(p);
+    return NULL;
+}
+
+static void print_trace(const struct pipeline *p, const char *winner) {
+    char line[512];
+    int used = snprintf(line, sizeof(line), "Set target pipeline (winner: %s):", winner);
+    for (int i = 0; i < NUM_STAGES && used < (int)sizeof(line); i++) {
+        if (p->stageDone[i]) {
+            long ms = (p->stageTime[i].tv_sec - p->start.tv_sec) * 1000L +
+                      (p->stageTime[i].tv_nsec - p->start.tv_nsec) / 1000000L;
+            used += snprintf(line + used, sizeof(line) - used, " %s %ld ms,", stageNames[i], ms);
+        } else {
+            used += snprintf(line + used, sizeof(line) - used, " %s -,", stageNames[i]);
+        }
+    }
+    printf("%s\n", line);
+}
+
+// Looks up the place as spoken and, unless it is already a street address, asks the AI to
+// format it at the same time. The first lookup that finds the place wins; the other path is
+// cancelled. The spoken confirmation is synthesized while the lookups are still in flight.
+static void set_target(const struct Intent *intent) {
+    struct pipeline *p = calloc(1, sizeof(*p));
+    if (!p) {
+        perror("calloc");
+        return;
+    }
+    p->aiRequest = -1;
+    p->references = 1;          // Ours, dropped once the target is set
+    clock_gettime(CLOCK_MONOTONIC, &p->start);
+    snprintf(p->raw.address, sizeof(p->raw.address), "%s", intent->argument);
+
+    p->raw.started = start_pipeline_thread(p, rawGeocodeThreadFunc);
+    start_pipeline_thread(p, prefetchThreadFunc);
+    if (!intent->isStreetAddress) {
+        char location_query[1024];
+        snprintf(location_query, sizeof(location_query),
+                "Provide only the full address in standard format for: %s. Format should be like: 8888 University Dr W, Burnaby, BC V5A 1S6. Do not include any other text in your response.", intent->argument);
+        printf("Getting formatted address for location...\n");
+        p->aiRequest = AI_submit(location_query, 0);
+        if (p->aiRequest >= 0) {
+            p->ai.started = start_pipeline_thread(p, aiGeocodeThreadFunc);
+        }
+    }
+    if (!p->raw.started) {
+        // Could not run in the background: look it up here instead
+        p->raw.location = StreetAPI_get_lat_long(p->raw.address);
+        p->raw.done = true;
+    }
+
+    pthread_mutex_lock(&pipelineMutex);
+    struct candidate *winner = NULL;
+    while (!winner) {
+        bool rawPending = !p->raw.done;
+        bool aiPending = p->ai.started && !p->ai.done;
+        if (p->raw.done && is_valid(&p->raw.location)) {
+            winner = &p->raw;
+        } else if (p->ai.done && is_valid(&p->ai.location)) {
+            winner = &p->ai;
+        } else if (!rawPending && !aiPending) {
+            break;
+        } else {
+            pthread_cond_wait(&pipelineCond, &pipelineMutex);
+        }
+    }
+    mark_stage(p, STAGE_TARGET_SET);
+    pthread_mutex_unlock(&pipelineMutex);
+
+    // The losing AI request is no longer needed
+    if (p->aiRequest >= 0 && winner != &p->ai) {
+        AI_cancel(p->aiRequest);
+    }
+    // RoadTracker trims the address in place; the prefetch thread may still be reading ours
+    char address[INTENT_MAX_ARGUMENT];
+    if (winner) {
+        snprintf(address, sizeof(address), "%s", winner->address);
+        RoadTracker_setTargetLocation(address, winner->location);
+    } else {
+        // Nothing found: RoadTracker reports the invalid address
+        snprintf(address, sizeof(address), "%s", p->raw.address);
+        RoadTracker_setTargetLocation(address, p->raw.location);
+    }
+    pthread_mutex_lock(&pipelineMutex);
+    print_trace(p, winner == &p->raw ? "spoken address" : winner == &p->ai ? "AI address" : "none");
+    pthread_mutex_unlock(&pipelineMutex);
+
+    // Lookups still in flight finish in the background; the last one frees the pipeline
+    release_pipeline(p);
+}
+
+static void say_where_am_i(void) {
+    struct location here = GPS_getLocation();
+    if (here.latitude == INVALID_LATITUDE) {
+        TtsCache_playPrompt(TTS_PROMPT_INVALID_LOCATION);
+        return;
+    }
+    char *address = StreetAPI_get_address_from_lat_lon(here.latitude, here.longitude);
+    if (address) {
+        TtsCache_say(address);
+        free(address);
+    }
+}
+
+// Speaks the answer one sentence at a time as it streams in, so the first sentence is
+// playing while the model is still generating the rest
+static void ask_ai(const char *transcription) {
+    printf("Getting AI response...\n");
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int id = AI_submit(transcription, 0);
+    if (id < 0) {
+        printf("Failed to get AI response\n");
+        return;
+    }
+    char sentence[INTENT_MAX_ARGUMENT * 2];
+    AiStatus status;
+    int spoken = 0;
+    while (AI_readSentence(id, sentence, sizeof(sentence), &status)) {
+        if (spoken++ == 0) {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            printf("First sentence after %ld ms\n",
+                   (now.tv_sec - start.tv_sec) * 1000L + (now.tv_nsec - start.tv_nsec) / 1000000L);
+        }
+        printf("Fun Fact: %s\n", sentence);
+        TtsCache_say(sentence);
+    }
+    if (spoken == 0) {
+        printf("Failed to get AI response (status %d)\n", status);
+    }
+}
+
+void VoiceCommand_handle(const char *transcription) {
+    assert(isInitialized);
+    struct Intent intent;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bool matched = Intent_parse(transcription, &intent);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    printf("Intent %d parsed in %ld us\n", intent.type,
+           (end.tv_sec - start.tv_sec) * 1000000L + (end.tv_nsec - start.tv_nsec) / 1000L);
+
+    if (!matched) {
+        ask_ai(transcription);
+        return;
+    }
+    switch (intent.type) {
+        case INTENT_SET_TARGET:
+            printf("Location detected: %s\n", intent.argument);
+            set_target(&intent);
+            break;
+        case INTENT_CLEAR_TARGET:
+            RoadTracker_resetTarget();
+            break;
+        case INTENT_SPEED_LIMIT: {
+            int limit = SpeedLED_getSpeedLimit();
+            if (limit > 0) {
+                TtsCache_sayPromptNumber(TTS_PROMPT_SPEED_LIMIT, limit, UNIT_SPEED);
+            } else {
+                TtsCache_playPrompt(TTS_PROMPT_SPEED_LIMIT_UNKNOWN);
+            }
+            break;
+        }
+        case INTENT_CURRENT_SPEED: {
+            double speed = SpeedLED_getSpeed();
+            TtsCache_sayPromptNumber(TTS_PROMPT_CURRENT_SPEED, speed > 0 ? (int)(speed + 0.5) : 0, UNIT_SPEED);
+            break;
+        }
+        case INTENT_PROGRESS:
+            if (RoadTracker_isRunning()) {
+                TtsCache_sayPromptNumber(TTS_PROMPT_PROGRESS, (int)RoadTracker_getProgress(), UNIT_PROGRESS);
+            } else {
+                TtsCache_playPrompt(TTS_PROMPT_NO_TARGET);
+            }
+            break;
+        case INTENT_WHERE_AM_I:
+            say_where_am_i();
+            break;
+        case INTENT_NONE:
+            ask_ai(transcription);
+            break;
+    }
+}
@@ -0,0 +1,121 @@
+/**
+ * bench/bench_audio.c
+ *
+ * Implementation of the shared audio helpers of the host tools.
+ */
+
+#include "bench_audio.h"
+#include "hal/audio_dsp.h"
+#include "hal/resampler.h"
+#include "hal/noise_suppressor.h"
+#include "hal/agc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DSP_BLOCK 441                   // audio_dsp.c reads 10 ms of 44.1 kHz capture at a time
+
+static uint32_t noiseState = 12345;
+
+void BenchAudio_seed(uint32_t seed) {
+    noiseState = seed;
+}
+
+double BenchAudio_uniform(void) {
+    noiseState = noiseState * 1664525 + 1013904223;
+    return (noiseState >> 8) / 16777216.0 * 2.0 - 1.0;
+}
+
+static uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool BenchAudio_loadWav(const char *path, int16_t **samples, size_t *count, unsigned int *rate) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *bytes = malloc(size > 0 ? (size_t)size : 1);
+    bool ok = bytes && size > 12 && fread(bytes, 1, (size_t)size, file) == (size_t)size &&
+              memcmp(bytes, "RIFF", 4) == 0 && memcmp(bytes + 8, "WAVE", 4) == 0;
+    fclose(file);
+
+    unsigned int channels = 0;
+    unsigned int bits = 0;
+    size_t pos = 12;
+    while (ok && pos + 8 <= (size_t)size) {
+        size_t chunkSize = read_le32(bytes + pos + 4);
+        const uint8_t *data = bytes + pos + 8;
+        if (memcmp(bytes + pos, "fmt ", 4) == 0 && chunkSize >= 16) {
+            channels = data[2] | (data[3] << 8);
+            *rate = read_le32(data + 4);
+            bits = data[14] | (data[15] << 8);
+        } else if (memcmp(bytes + pos, "data", 4) == 0) {
+            if (channels == 0 || bits != 16) {
+                break;
+            }
+            if (chunkSize > (size_t)size - pos - 8) {
+                chunkSize = (size_t)size - pos - 8;
+            }
+            *count = chunkSize / 2 / channels;
+            *samples = malloc(*count * sizeof(int16_t) + 1);
+            for (size_t i = 0; *samples && i < *count; i++) {
+                const uint8_t *p = data + i * 2 * channels;
+                (*samples)[i] = (int16_t)(p[0] | (p[1] << 8));
+            }
+            free(bytes);
+            return *samples != NULL;
+        }
+        pos += 8 + chunkSize + (chunkSize & 1);
+    }
+    fprintf(stderr, "%s: not a 16-bit PCM WAV file\n", path);
+    free(bytes);
+    return false;
+}
+
+bool BenchAudio_frontEnd(const char *name, int16_t **samples, size_t *count, unsigned int *rate) {
+    struct Resampler resampler;
+    struct NoiseSuppressor suppressor;
+    struct Agc agc;
+    bool resample = *rate != AUDIO_DSP_RATE;
+    if ((resample && Resampler_init(&resampler, *rate, AUDIO_DSP_RATE) != 0) ||
+        NoiseSuppressor_init(&suppressor) != 0) {
+        fprintf(stderr, "%s: cannot set up the front end\n", name);
+        return false;
+    }
+    Agc_init(&agc, AUDIO_DSP_RATE);
+
+    int16_t *out = malloc((*count + NOISE_SUPPRESSOR_HOP) * sizeof(int16_t) + 1);
+    int16_t resampled[DSP_BLOCK];
+    int16_t cleaned[DSP_BLOCK + NOISE_SUPPRESSOR_HOP];
+    size_t produced = 0;
+    for (size_t pos = 0; out && pos < *count; pos += DSP_BLOCK) {
+        size_t n = *count - pos < DSP_BLOCK ? *count - pos : DSP_BLOCK;
+        const int16_t *block = *samples + pos;
+        if (resample) {
+            n = Resampler_process(&resampler, block, n, resampled);
+            block = resampled;
+        }
+        n = NoiseSuppressor_process(&suppressor, block, n, cleaned);
+        Agc_process(&agc, cleaned, n);
+        memcpy(out + produced, cleaned, n * sizeof(int16_t));
+        produced += n;
+    }
+    if (resample) {
+        Resampler_destroy(&resampler);
+    }
+    NoiseSuppressor_destroy(&suppressor);
+    if (!out) {
+        return false;
+    }
+    free(*samples);
+    *samples = out;
+    *count = produced;
+    *rate = AUDIO_DSP_RATE;
+    return true;
+}
@@ -0,0 +1,29 @@
+/**
+ * bench/bench_audio.h
+ *
+ * Audio helpers shared by the host tools that replay recordings: a WAV loader, the DSP
+ * stage front end (hal/src/audio_dsp.c) and a seeded noise source for synthetic audio.
+ */
+
+#ifndef BENCH_AUDIO_H
+#define BENCH_AUDIO_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Restarts the noise source, so each tool generates the same audio on every run
+void BenchAudio_seed(uint32_t seed);
+
+// Uniform noise in [-1, 1)
+double BenchAudio_uniform(void);
+
+// Loads the first channel of a 16-bit PCM WAV file into a malloc'd buffer
+bool BenchAudio_loadWav(const char *path, int16_t **samples, size_t *count, unsigned int *rate);
+
+// Replaces the samples with what the DSP stage would publish for them: resampled to
+// AUDIO_DSP_RATE (skipped if already at it), noise suppressed and through the AGC, in the
+// same 10 ms blocks. name is only used in error messages.
+bool BenchAudio_frontEnd(const char *name, int16_t **samples, size_t *count, unsigned int *rate);
+
+#endif // BENCH_AUDIO_H
@@ -0,0 +1,48 @@
+#!/bin/bash
+
+# Builds the host benchmarks in this directory into bench/build/.
+# Uses the host gcc; needs no board, sysfs or audio device.
+#   led_bench:     sysfs system calls of the LED HAL, old vs cached descriptors
+#   vad_eval:      voice activity detector over synthetic fixtures or labelled WAV files
+#   dsp_bench:     checks and per-block CPU time of the resampler, noise suppressor and AGC
+#   wake_bench:    keyword spotter CPU per frame, and false accepts/rejects over labelled WAV files
+#   reactor_bench: thread per device vs the reactor: wakeups, context switches, CPU, delay
+#   rt_bench:      cyclictest-style wake-up latency under load, with and without the RT profile
+
+# Exit on error:
+set -e
+
+BENCH_DIR="$(cd "$(dirname "$0")" && pwd)"
+APP_DIR="$BENCH_DIR/../app"
+HAL_DIR="$BENCH_DIR/../hal"
+CFLAGS="-std=gnu11 -O2 -g -Wall -Werror -Wpedantic -Wextra -pthread -I$HAL_DIR/include -I$APP_DIR/include"
+
+mkdir -p "$BENCH_DIR/build"
+
+gcc $CFLAGS -DLED_FILE_NAME="\"$BENCH_DIR/build/leds\"" \
+    "$BENCH_DIR/led_bench.c" "$HAL_DIR/src/led.c" -o "$BENCH_DIR/build/led_bench"
+
+# WAV loading and the DSP front end, shared by the tools that replay recordings
+BENCH_AUDIO="$BENCH_DIR/bench_audio.c $HAL_DIR/src/resampler.c $HAL_DIR/src/noise_suppressor.c $HAL_DIR/src/agc.c"
+
+gcc $CFLAGS "$BENCH_DIR/vad_eval.c" "$HAL_DIR/src/vad.c" $BENCH_AUDIO "$HAL_DIR/src/fft.c" \
+    -lm -o "$BENCH_DIR/build/vad_eval"
+
+gcc $CFLAGS "$BENCH_DIR/dsp_bench.c" "$HAL_DIR/src/resampler.c" "$HAL_DIR/src/noise_suppressor.c" \
+    "$HAL_DIR/src/agc.c" "$HAL_DIR/src/fft.c" -lm -o "$BENCH_DIR/build/dsp_bench"
+
+gcc $CFLAGS "$BENCH_DIR/wake_bench.c" "$HAL_DIR/src/wake_word.c" "$HAL_DIR/src/mfcc.c" "$HAL_DIR/src/fft.c" \
+    $BENCH_AUDIO -lm -o "$BENCH_DIR/build/wake_bench"
+
+gcc $CFLAGS "$BENCH_DIR/reactor_bench.c" "$HAL_DIR/src/reactor.c" "$APP_DIR/src/threadConfig.c" \
+    -o "$BENCH_DIR/build/reactor_bench"
+
+gcc $CFLAGS "$BENCH_DIR/rt_bench.c" "$APP_DIR/src/threadConfig.c" -o "$BENCH_DIR/build/rt_bench"
+
+echo "Built into $BENCH_DIR/build:"
+echo "  led_bench [ticks]"
+echo "  vad_eval [--raw] [--history MS] [file.wav[:startMs:endMs] ...]"
+echo "  dsp_bench [seconds]"
+echo "  wake_bench [--model file.kws] [file.wav:N ...]"
+echo "  reactor_bench [seconds]"
+echo "  rt_bench [seconds] [load threads]"
@@ -0,0 +1,291 @@
+/**
+ * bench/dsp_bench.c
+ *
+ * Checks and throughput of the audio front end (hal/src/audio_dsp.c): the 44.1 -> 16 kHz
+ * resampler, the noise suppressor and the AGC, fed in the same 10 ms blocks as the DSP
+ * thread. Each check prints what it measured and PASS or FAIL:
+ *  - resampler: output rate, a 1 kHz tone keeps its level, a 9 kHz tone is rejected
+ *  - noise suppressor: white noise is reduced, a tone over it is kept
+ *  - AGC: quiet and loud speech-like bursts are brought near the target level without
+ *    clipping, and noise alone does not raise the gain
+ * Then every stage and the whole chain are timed per 10 ms block.
+ *
+ * Run as: dsp_bench [seconds of audio to time]
+ */
+
+#include "hal/resampler.h"
+#include "hal/noise_suppressor.h"
+#include "hal/agc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define IN_RATE 44100
+#define OUT_RATE 16000
+#define BLOCK 441                       // audio_dsp.c reads 10 ms of capture at a time
+#define OUT_BLOCK_MAX (BLOCK + NOISE_SUPPRESSOR_HOP)
+#define DEFAULT_SECONDS 60
+#define SETTLE_SECONDS 1                // Skipped before measuring, for filters and trackers to settle
+
+static int failures = 0;
+static uint32_t seed = 1;
+
+static double uniform(void) {
+    seed = seed * 1664525 + 1013904223;
+    return (seed >> 8) / 16777216.0 * 2.0 - 1.0;
+}
+
+static int16_t clip16(double v) {
+    return (int16_t)lrint(v > 32767.0 ? 32767.0 : v < -32768.0 ? -32768.0 : v);
+}
+
+static double db(double ratio) {
+    return 20.0 * log10(ratio > 1e-12 ? ratio : 1e-12);
+}
+
+static void check(const char *name, bool pass, const char *format, double value) {
+    printf("  %-44s ", name);
+    printf(format, value);
+    printf("  %s\n", pass ? "PASS" : "FAIL");
+    if (!pass) {
+        failures++;
+    }
+}
+
+static double rms(const int16_t *samples, size_t count) {
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        sum += (double)samples[i] * samples[i];
+    }
+    return count > 0 ? sqrt(sum / count) : 0.0;
+}
+
+// RMS of the part of the signal at frequency hz (Goertzel)
+static double tone_rms(const int16_t *samples, size_t count, double hz, unsigned int rate) {
+    double coeff = 2.0 * cos(2.0 * M_PI * hz / rate);
+    double s1 = 0.0;
+    double s2 = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double s = samples[i] + coeff * s1 - s2;
+        s2 = s1;
+        s1 = s;
+    }
+    double power = s1 * s1 + s2 * s2 - coeff * s1 * s2;
+    return sqrt(2.0 * power) / count;
+}
+
+static int16_t *tone(size_t count, double hz, double amplitude, unsigned int rate) {
+    int16_t *samples = malloc(count * sizeof(int16_t));
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = clip16(amplitude * sin(2.0 * M_PI * hz * i / rate));
+    }
+    return samples;
+}
+
+static size_t resample_all(const int16_t *in, size_t count, int16_t *out) {
+    struct Resampler r;
+    if (Resampler_init(&r, IN_RATE, OUT_RATE) != 0) {
+        perror("Resampler_init");
+        exit(EXIT_FAILURE);
+    }
+    size_t produced = 0;
+    for (size_t pos = 0; pos < count; pos += BLOCK) {
+        size_t n = count - pos < BLOCK ? count - pos : BLOCK;
+        produced += Resampler_process(&r, in + pos, n, out + produced);
+    }
+    Resampler_destroy(&r);
+    return produced;
+}
+
+static void check_resampler(void) {
+    printf("Resampler 44.1 -> 16 kHz\n");
+    size_t count = 2 * IN_RATE;
+    int16_t *out = malloc((count * OUT_RATE / IN_RATE + BLOCK) * sizeof(int16_t));
+    size_t skip = OUT_RATE / 10;        // Filter start-up
+
+    int16_t *in = tone(count, 1000.0, 10000.0, IN_RATE);
+    size_t produced = resample_all(in, count, out);
+    check("output samples for 2 s of input", produced >= 2 * OUT_RATE - 1 && produced <= 2 * OUT_RATE + 1,
+          "%8.0f", (double)produced);
+    double level = tone_rms(out + skip, produced - skip, 1000.0, OUT_RATE) / (10000.0 / sqrt(2.0));
+    check("1 kHz tone level (dB)", fabs(db(level)) < 0.1, "%8.2f", db(level));
+    free(in);
+
+    in = tone(count, 9000.0, 10000.0, IN_RATE);
+    produced = resample_all(in, count, out);
+    // -60 dB of the input is 7 LSB; anything past -90 dB rounds to silence
+    double leak = rms(out + skip, produced - skip);
+    check("9 kHz tone, above the output Nyquist, RMS", leak < 7.0, "%8.2f", leak);
+    free(in);
+    free(out);
+}
+
+// Runs 16 kHz audio through the suppressor and returns the output (same length, one hop late)
+static int16_t *suppress_all(const int16_t *in, size_t count) {
+    struct NoiseSuppressor ns;
+    if (NoiseSuppressor_init(&ns) != 0) {
+        perror("NoiseSuppressor_init");
+        exit(EXIT_FAILURE);
+    }
+    int16_t *out = calloc(count + NOISE_SUPPRESSOR_HOP, sizeof(int16_t));
+    size_t produced = 0;
+    for (size_t pos = 0; pos < count; pos += 160) {
+        size_t n = count - pos < 160 ? count - pos : 160;
+        produced += NoiseSuppressor_process(&ns, in + pos, n, out + produced);
+    }
+    NoiseSuppressor_destroy(&ns);
+    return out;
+}
+
+static void check_noise_suppressor(void) {
+    printf("Noise suppressor\n");
+    size_t count = 4 * OUT_RATE;
+    size_t skip = SETTLE_SECONDS * OUT_RATE;
+    int16_t *noise = malloc(count * sizeof(int16_t));
+    for (size_t i = 0; i < count; i++) {
+        noise[i] = clip16(1000.0 * sqrt(3.0) * uniform());
+    }
+    int16_t *out = suppress_all(noise, count);
+    double reduction = rms(out + skip, count - skip) / rms(noise + skip, count - skip);
+    check("white noise alone (dB)", db(reduction) < -6.0, "%8.1f", db(reduction));
+    free(out);
+
+    // A steady tone would be learned as noise in about a second, so use a word-length burst
+    size_t burst = OUT_RATE / 5;
+    size_t burstStart = 2 * skip;
+    int16_t *mixed = malloc(count * sizeof(int16_t));
+    for (size_t i = 0; i < count; i++) {
+        bool on = i >= burstStart && i < burstStart + burst;
+        mixed[i] = clip16(noise[i] + (on ? 4000.0 * sin(2.0 * M_PI * 1000.0 * i / OUT_RATE) : 0.0));
+    }
+    out = suppress_all(mixed, count);
+    size_t start = burstStart + OUT_RATE / 50;
+    size_t length = burst - OUT_RATE / 25;
+    double kept = tone_rms(out + start + NOISE_SUPPRESSOR_HOP, length, 1000.0, OUT_RATE) /
+                  tone_rms(mixed + start, length, 1000.0, OUT_RATE);
+    check("200 ms 1 kHz burst over the noise, level (dB)", fabs(db(kept)) < 3.0, "%8.2f", db(kept));
+    free(out);
+    free(mixed);
+    free(noise);
+}
+
+// Half a second of light noise, as when capture starts, then bursts of a 300 Hz tone, 200 ms on and
+// 100 ms off. Returns the output RMS inside the bursts of the last two seconds.
+static double agc_bursts(double amplitude, double noiseRms, double *peak, float *gain) {
+    size_t lead = OUT_RATE / 2;
+    size_t cycle = OUT_RATE * 3 / 10;
+    size_t count = lead + 4 * OUT_RATE;
+    int16_t *samples = malloc(count * sizeof(int16_t));
+    for (size_t i = 0; i < count; i++) {
+        bool on = amplitude > 0 && i >= lead && (i - lead) % cycle < OUT_RATE / 5;
+        samples[i] = clip16((on ? amplitude * sin(2.0 * M_PI * 300.0 * i / OUT_RATE) : 0.0) + noiseRms * sqrt(3.0) * uniform());
+    }
+    struct Agc agc;
+    Agc_init(&agc, OUT_RATE);
+    for (size_t pos = 0; pos < count; pos += 160) {
+        Agc_process(&agc, samples + pos, 160);
+    }
+    double sum = 0.0;
+    size_t n = 0;
+    *peak = 0.0;
+    for (size_t i = count - 2 * OUT_RATE; i < count; i++) {
+        size_t phase = (i - lead) % cycle;
+        // Skip the first 20 ms of each burst, where a gain raised during the gap is still coming down
+        if (phase >= OUT_RATE / 50 && phase < OUT_RATE / 5) {
+            sum += (double)samples[i] * samples[i];
+            n++;
+        }
+        if (fabs((double)samples[i]) > *peak) {
+            *peak = fabs((double)samples[i]);
+        }
+    }
+    *gain = agc.gain;
+    free(samples);
+    return n > 0 ? sqrt(sum / n) : 0.0;
+}
+
+static void check_agc(void) {
+    printf("AGC (target 3000 RMS)\n");
+    double peak;
+    float gain;
+    double level = agc_bursts(500.0 * sqrt(2.0), 30.0, &peak, &gain);
+    check("quiet bursts at 500 RMS, output RMS", level > 3000.0 / 1.41 && level < 3000.0 * 1.41, "%8.0f", level);
+    level = agc_bursts(12000.0 * sqrt(2.0), 30.0, &peak, &gain);
+    check("loud bursts at 12000 RMS, output RMS", level > 3000.0 / 1.41 && level < 3000.0 * 1.41, "%8.0f", level);
+    check("loud bursts, output peak", peak < 32767.0, "%8.0f", peak);
+    agc_bursts(0.0, 300.0, &peak, &gain);
+    check("noise alone at 300 RMS, gain", gain < 1.5f, "%8.2f", gain);
+}
+
+static double now_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+static void time_chain(int seconds) {
+    size_t blocks = (size_t)seconds * 100;
+    int16_t *in = malloc(blocks * BLOCK * sizeof(int16_t));
+    for (size_t i = 0; i < blocks * BLOCK; i++) {
+        in[i] = clip16(2000.0 * sin(2.0 * M_PI * 220.0 * i / IN_RATE) + 300.0 * uniform());
+    }
+    struct Resampler r;
+    struct NoiseSuppressor ns;
+    struct Agc agc;
+    if (Resampler_init(&r, IN_RATE, OUT_RATE) != 0 || NoiseSuppressor_init(&ns) != 0) {
+        perror("init");
+        exit(EXIT_FAILURE);
+    }
+    Agc_init(&agc, OUT_RATE);
+
+    int16_t resampled[OUT_BLOCK_MAX];
+    int16_t cleaned[OUT_BLOCK_MAX];
+    double resampleUs = 0.0;
+    double suppressUs = 0.0;
+    double agcUs = 0.0;
+    for (size_t b = 0; b < blocks; b++) {
+        double t0 = now_us();
+        size_t n = Resampler_process(&r, in + b * BLOCK, BLOCK, resampled);
+        double t1 = now_us();
+        n = NoiseSuppressor_process(&ns, resampled, n, cleaned);
+        double t2 = now_us();
+        Agc_process(&agc, cleaned, n);
+        double t3 = now_us();
+        resampleUs += t1 - t0;
+        suppressUs += t2 - t1;
+        agcUs += t3 - t2;
+    }
+    Resampler_destroy(&r);
+    NoiseSuppressor_destroy(&ns);
+    free(in);
+
+    double totalUs = resampleUs + suppressUs + agcUs;
+    printf("Throughput over %d s of audio, per 10 ms block\n", seconds);
+    printf("  resampler        %7.2f us\n", resampleUs / blocks);
+    printf("  noise suppressor %7.2f us\n", suppressUs / blocks);
+    printf("  AGC              %7.2f us\n", agcUs / blocks);
+    printf("  chain            %7.2f us  (%.2f%% of one core, %.0fx real time)\n",
+           totalUs / blocks, totalUs / blocks / 100.0, 10000.0 * blocks / totalUs);
+}
+
+int main(int argc, char *argv[]) {
+    int seconds = argc > 1 ? atoi(argv[1]) : DEFAULT_SECONDS;
+    if (seconds <= 0) {
+        fprintf(stderr, "Usage: %s [seconds]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    check_resampler();
+    check_noise_suppressor();
+    check_agc();
+    time_chain(seconds);
+    if (failures > 0) {
+        printf("FAIL: %d checks\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+/**
+ * bench/led_bench.c
+ *
+ * Microbenchmark of the LED HAL's sysfs traffic. It replays what the old LED thread did
+ * every tick: set both onboard LEDs' trigger to "none" and write their brightness, with
+ * the GPS fix (and so the brightness) changing only now and then. It does this once with
+ * the old per-call fopen/fprintf/fclose and once through hal/src/led.c, which keeps the
+ * files open and skips unchanged values. It prints the system calls and the time per tick.
+ *
+ * build_bench.sh points LED_FILE_NAME at fake attribute files under bench/build, so this
+ * measures the system call overhead but not the LED driver. To measure the real sysfs,
+ * build it on the board without -DLED_FILE_NAME and run it as root.
+ *
+ * Run as: led_bench [ticks]
+ */
+
+#include "hal/led.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#define DEFAULT_TICKS 10000
+#define TICKS_PER_FIX_CHANGE 30         // A fix is gained or lost about every 30 s at 1 tick/s
+#define OLD_SYSCALLS_PER_WRITE 3        // openat, write, close
+
+static const char *attributes[] = {"trigger", "brightness", "delay_on", "delay_off", "repeat", "pattern"};
+
+static double now_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+// Creates LED_FILE_NAME/<led>/<attribute> as plain files, unless they exist (real sysfs)
+static void make_fake_leds(void) {
+    mkdir(LED_FILE_NAME, 0755);
+    for (int i = 0; i < 2; i++) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/%s", LED_FILE_NAME, leds[i].name);
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+            perror(path);
+            exit(EXIT_FAILURE);
+        }
+        for (size_t a = 0; a < sizeof(attributes) / sizeof(attributes[0]); a++) {
+            snprintf(path, sizeof(path), "%s/%s/%s", LED_FILE_NAME, leds[i].name, attributes[a]);
+            FILE *file = fopen(path, "a");
+            if (file) {
+                fclose(file);
+            }
+        }
+    }
+}
+
+// The LED HAL before file descriptors were cached: one open, write and close per call
+static unsigned long oldWrites = 0;
+
+static void old_write(LED *led, const char *attribute, const char *value) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s/%s", LED_FILE_NAME, led->name, attribute);
+    FILE *file = fopen(path, "w");
+    if (file == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    fprintf(file, "%s", value);
+    fclose(file);
+    oldWrites++;
+}
+
+static void old_tick(bool signal) {
+    old_write(&leds[0], "trigger", "none");
+    old_write(&leds[1], "trigger", "none");
+    old_write(&leds[0], "brightness", signal ? "1" : "0");
+    old_write(&leds[1], "brightness", signal ? "0" : "1");
+}
+
+static void new_tick(bool signal) {
+    Led_setTrigger(&leds[0], "none");
+    Led_setTrigger(&leds[1], "none");
+    Led_setBrightness(&leds[0], signal ? 1 : 0);
+    Led_setBrightness(&leds[1], signal ? 0 : 1);
+}
+
+int main(int argc, char *argv[]) {
+    int ticks = argc > 1 ? atoi(argv[1]) : DEFAULT_TICKS;
+    if (ticks <= 0) {
+        fprintf(stderr, "Usage: %s [ticks]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    make_fake_leds();
+
+    double start = now_us();
+    for (int i = 0; i < ticks; i++) {
+        old_tick((i / TICKS_PER_FIX_CHANGE) % 2 == 0);
+    }
+    double oldUs = now_us() - start;
+    unsigned long oldSyscalls = oldWrites * OLD_SYSCALLS_PER_WRITE;
+
+    Led_initialize();
+    LedStats before = Led_getStats();
+    start = now_us();
+    for (int i = 0; i < ticks; i++) {
+        new_tick((i / TICKS_PER_FIX_CHANGE) % 2 == 0);
+    }
+    double newUs = now_us() - start;
+    LedStats after = Led_getStats();
+    unsigned long newSyscalls = after.writes - before.writes;
+    Led_cleanUp();
+
+    printf("%d ticks of 2 triggers + 2 brightness writes, fix changing every %d ticks\n", ticks, TICKS_PER_FIX_CHANGE);
+    printf("  fopen/fprintf/fclose: %8lu syscalls  %7.2f us/tick\n", oldSyscalls, oldUs / ticks);
+    printf("  cached fd + pwrite:   %8lu syscalls  %7.2f us/tick  (%lu skipped, %lu opens at init)\n",
+           newSyscalls + before.opens, newUs / ticks, after.skipped - before.skipped, before.opens);
+    printf("  saved: %.1f%% of syscalls, %.1fx less time\n",
+           100.0 * (1.0 - (double)(newSyscalls + before.opens) / oldSyscalls), newUs > 0 ? oldUs / newUs : 0.0);
+    return EXIT_SUCCESS;
+}
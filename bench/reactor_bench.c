@@ -0,0 +1,328 @@
+/**
+ * bench/reactor_bench.c
+ *
+ * Thread per device against the reactor (hal/src/reactor.c), on the same traffic. Pipes
+ * stand in for the device fds and a generator thread writes to them like the devices do:
+ * a burst of NMEA lines from the GPS every second, a rotary turn (8 edges 2 ms apart)
+ * every second, a joystick press every 2 s and a rotary push every 3 s. Every record
+ * carries its write time, so the delay until it is handled is measured too.
+ *
+ * The thread-per-device side copies the loops the reactor replaced:
+ *  - GPS: wait up to 1 s for the UART (VTIME), read, sleep 100 ms
+ *  - joystick: wait up to 1 s for a line event, read it, sleep 10 ms
+ *  - rotary push: the microphone's button listener, a non-blocking check every 10 ms
+ *  - rotary A/B: never polled in the old tree; given the joystick loop here
+ *  - GPS demo feed: sleep 500 ms in a loop
+ * The reactor side registers the same fds and a 500 ms timer with the real reactor.
+ *
+ * Compared: wakeups, voluntary/involuntary context switches and CPU time of the consumer
+ * threads (getrusage(RUSAGE_THREAD), like Reactor_getStats()), and the handling delay.
+ * Fails if either side loses a record.
+ *
+ * Run as: reactor_bench [seconds per side]
+ */
+
+#define _GNU_SOURCE             // RUSAGE_THREAD
+
+#include "hal/reactor.h"
+#include "threadConfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#define DEFAULT_SECONDS 10
+#define GPS_LINES_PER_BURST 6
+#define ROTARY_EDGES_PER_TURN 8
+#define ROTARY_EDGE_GAP_MS 2
+#define DEMO_PERIOD_MS 500
+#define LINE_MAX 64
+
+enum {
+    SOURCE_GPS,
+    SOURCE_JOYSTICK,
+    SOURCE_PUSH,
+    SOURCE_ROTARY,
+    SOURCE_COUNT
+};
+
+static const char *sourceNames[SOURCE_COUNT] = {"GPS UART", "joystick", "rotary push", "rotary A/B"};
+
+struct source {
+    int readFd;
+    int writeFd;
+    char partial[LINE_MAX];             // Start of a line still being written
+    size_t partialLength;
+    long sent;
+    long handled;
+    double totalDelayUs;
+    double maxDelayUs;
+};
+
+struct usage {
+    long wakeups;
+    long voluntarySwitches;
+    long involuntarySwitches;
+    double cpuMs;
+};
+
+static struct source sources[SOURCE_COUNT];
+static pthread_mutex_t usageMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct usage consumers;          // Summed over the consumer threads of one side
+static volatile bool isRunning = false;
+static long demoTicks = 0;
+
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static void sleep_ms(long ms) {
+    struct timespec delay = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&delay, NULL);
+}
+
+static double timeval_ms(struct timeval tv) {
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+/******************************************************************************
+ * Traffic
+ ******************************************************************************/
+
+static void send_record(int index) {
+    char line[LINE_MAX];
+    int length = snprintf(line, sizeof(line), "$REC,%llu\n", (unsigned long long)now_ns());
+    if (write(sources[index].writeFd, line, length) == length) {
+        sources[index].sent++;
+    }
+}
+
+static void *generator_thread(void *arg) {
+    long seconds = *(long *)arg;
+    for (long ms = 0; ms < seconds * 1000; ms += ROTARY_EDGE_GAP_MS) {
+        if (ms % 1000 == 0) {
+            for (int i = 0; i < GPS_LINES_PER_BURST; i++) {
+                send_record(SOURCE_GPS);
+            }
+        }
+        if (ms % 1000 < ROTARY_EDGES_PER_TURN * ROTARY_EDGE_GAP_MS) {
+            send_record(SOURCE_ROTARY);
+        }
+        if (ms % 2000 == 500) {
+            send_record(SOURCE_JOYSTICK);
+        }
+        if (ms % 3000 == 700) {
+            send_record(SOURCE_PUSH);
+        }
+        sleep_ms(ROTARY_EDGE_GAP_MS);
+    }
+    return NULL;
+}
+
+// Reads what is ready on a source and accounts for every complete record
+static void consume(int index) {
+    struct source *source = &sources[index];
+    char buffer[4096];
+    ssize_t length = read(source->readFd, buffer, sizeof(buffer));
+    uint64_t handledNs = now_ns();
+    for (ssize_t i = 0; i < length; i++) {
+        if (buffer[i] != '\n') {
+            if (source->partialLength < LINE_MAX - 1) {
+                source->partial[source->partialLength++] = buffer[i];
+            }
+            continue;
+        }
+        source->partial[source->partialLength] = '\0';
+        source->partialLength = 0;
+        const char *stamp = strchr(source->partial, ',');
+        if (!stamp) {
+            continue;
+        }
+        double delayUs = (handledNs - strtoull(stamp + 1, NULL, 10)) / 1000.0;
+        source->handled++;
+        source->totalDelayUs += delayUs;
+        if (delayUs > source->maxDelayUs) {
+            source->maxDelayUs = delayUs;
+        }
+    }
+}
+
+/******************************************************************************
+ * Thread per device
+ ******************************************************************************/
+
+struct loop {
+    int source;                         // -1 for the demo feed
+    int waitMs;                         // Wait for data up to this long; 0 only checks
+    int sleepMs;                        // Then sleep this long
+};
+
+static bool wait_readable(int fd, int timeoutMs) {
+    fd_set set;
+    FD_ZERO(&set);
+    FD_SET(fd, &set);
+    struct timeval timeout = {timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+    return select(fd + 1, &set, NULL, NULL, &timeout) > 0;
+}
+
+static void add_own_usage(long wakeups) {
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    pthread_mutex_lock(&usageMutex);
+    consumers.wakeups += wakeups;
+    consumers.voluntarySwitches += usage.ru_nvcsw;
+    consumers.involuntarySwitches += usage.ru_nivcsw;
+    consumers.cpuMs += timeval_ms(usage.ru_utime) + timeval_ms(usage.ru_stime);
+    pthread_mutex_unlock(&usageMutex);
+}
+
+static void *device_thread(void *arg) {
+    const struct loop *loop = arg;
+    long wakeups = 0;
+    while (isRunning) {
+        if (loop->source < 0) {
+            demoTicks++;
+        } else {
+            if (loop->waitMs == 0 || wait_readable(sources[loop->source].readFd, loop->waitMs)) {
+                consume(loop->source);
+            }
+            wakeups += loop->waitMs > 0;
+        }
+        sleep_ms(loop->sleepMs);
+        wakeups++;
+    }
+    add_own_usage(wakeups);
+    return NULL;
+}
+
+static const struct loop loops[] = {
+    {SOURCE_GPS, 1000, 100},
+    {SOURCE_JOYSTICK, 1000, 10},
+    {SOURCE_PUSH, 0, 10},
+    {SOURCE_ROTARY, 1000, 10},
+    {-1, 0, DEMO_PERIOD_MS},
+};
+#define LOOP_COUNT (int)(sizeof(loops) / sizeof(loops[0]))
+
+/******************************************************************************
+ * Reactor
+ ******************************************************************************/
+
+static void on_readable(int fd, uint32_t events, void *context) {
+    (void)fd;
+    (void)events;
+    consume((int)(intptr_t)context);
+}
+
+static void on_demo_tick(uint64_t expirations, void *context) {
+    (void)context;
+    demoTicks += (long)expirations;
+}
+
+/******************************************************************************
+ * Comparison
+ ******************************************************************************/
+
+static void reset_sources(void) {
+    for (int i = 0; i < SOURCE_COUNT; i++) {
+        int fds[2];
+        if (pipe2(fds, O_NONBLOCK) != 0) {
+            perror("pipe2");
+            exit(EXIT_FAILURE);
+        }
+        memset(&sources[i], 0, sizeof(sources[i]));
+        sources[i].readFd = fds[0];
+        sources[i].writeFd = fds[1];
+    }
+    memset(&consumers, 0, sizeof(consumers));
+    demoTicks = 0;
+}
+
+static void close_sources(void) {
+    for (int i = 0; i < SOURCE_COUNT; i++) {
+        close(sources[i].readFd);
+        close(sources[i].writeFd);
+    }
+}
+
+// Prints one side's results and returns the number of lost records
+static long report(const char *name, double seconds) {
+    printf("%s, %.1f s\n", name, seconds);
+    printf("  %ld wakeups, %ld voluntary + %ld involuntary context switches, %.1f ms CPU (%.1f per s)\n",
+           consumers.wakeups, consumers.voluntarySwitches, consumers.involuntarySwitches, consumers.cpuMs,
+           (consumers.voluntarySwitches + consumers.involuntarySwitches) / seconds);
+    long lost = 0;
+    for (int i = 0; i < SOURCE_COUNT; i++) {
+        const struct source *s = &sources[i];
+        printf("  %-12s %5ld of %5ld handled, delay %8.1f us avg, %8.1f us max\n", sourceNames[i],
+               s->handled, s->sent, s->handled > 0 ? s->totalDelayUs / s->handled : 0.0, s->maxDelayUs);
+        lost += s->sent - s->handled;
+    }
+    printf("  %ld demo feed ticks\n", demoTicks);
+    return lost;
+}
+
+static void run_traffic(long seconds) {
+    pthread_t generator;
+    pthread_create(&generator, NULL, generator_thread, &seconds);
+    pthread_join(generator, NULL);
+    sleep_ms(200);                      // Let the slowest loop (GPS, 100 ms sleep) catch up
+}
+
+int main(int argc, char *argv[]) {
+    long seconds = argc > 1 ? atol(argv[1]) : DEFAULT_SECONDS;
+    if (seconds <= 0) {
+        fprintf(stderr, "Usage: %s [seconds]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    ThreadConfig_init();
+
+    reset_sources();
+    uint64_t startNs = now_ns();
+    isRunning = true;
+    pthread_t threads[LOOP_COUNT];
+    for (int i = 0; i < LOOP_COUNT; i++) {
+        pthread_create(&threads[i], NULL, device_thread, (void *)&loops[i]);
+    }
+    run_traffic(seconds);
+    isRunning = false;
+    for (int i = 0; i < LOOP_COUNT; i++) {
+        pthread_join(threads[i], NULL);    // Within the 1 s wait of the slowest loop
+    }
+    long lostThreads = report("Thread per device (5 threads)", (now_ns() - startNs) / 1e9);
+    close_sources();
+
+    reset_sources();
+    startNs = now_ns();
+    Reactor_init();
+    for (int i = 0; i < SOURCE_COUNT; i++) {
+        Reactor_addFd(sources[i].readFd, EPOLLIN, on_readable, (void *)(intptr_t)i);
+    }
+    Reactor_addTimer(DEMO_PERIOD_MS, on_demo_tick, NULL);
+    run_traffic(seconds);
+    Reactor_cleanup();
+    double reactorSeconds = (now_ns() - startNs) / 1e9;
+    ReactorStats stats = Reactor_getStats();
+    consumers.wakeups = (long)stats.wakeups;
+    consumers.voluntarySwitches = stats.voluntarySwitches;
+    consumers.involuntarySwitches = stats.involuntarySwitches;
+    consumers.cpuMs = stats.cpuMs;
+    long lostReactor = report("Reactor (1 thread)", reactorSeconds);
+    close_sources();
+
+    ThreadConfig_cleanup();
+    if (lostThreads > 0 || lostReactor > 0) {
+        printf("FAIL: records lost\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,203 @@
+/**
+ * bench/rt_bench.c
+ *
+ * Cyclictest-style wake-up latency under load, with and without the real-time profile of
+ * app/src/threadConfig.c. A measuring thread sleeps to absolute 1 ms deadlines with
+ * clock_nanosleep(TIMER_ABSTIME) and records how late each wake-up is. It runs twice under
+ * the same load: first started by name as "reactor", which gets that profile's SCHED_FIFO
+ * priority, CPU and locked stack, then under a name that is not in the table, which gets
+ * the default scheduling every thread had before.
+ *
+ * The load stands in for the Python and espeak subprocesses: one thread per CPU spinning on
+ * arithmetic and one per CPU sweeping a 32 MB buffer for memory bandwidth, all SCHED_OTHER
+ * without affinity.
+ *
+ * Without the privilege for SCHED_FIFO (CAP_SYS_NICE or an rtprio limit) ThreadConfig falls
+ * back to normal scheduling and both runs measure the same thing; the applied policy is
+ * printed first. Run as root on the board for the real figures.
+ *
+ * Run as: rt_bench [seconds per run] [load threads per kind, default one per CPU]
+ */
+
+#define _GNU_SOURCE             // pthread_setname_np
+
+#include "threadConfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define DEFAULT_SECONDS 10
+#define INTERVAL_NS 1000000L            // 1 ms, as cyclictest -i 1000
+#define HISTOGRAM_US 10000              // Latencies above 10 ms share the last bucket
+#define MEMORY_LOAD_BYTES (32 * 1024 * 1024)
+#define PROFILED_NAME "reactor"
+#define DEFAULT_NAME "rt-bench"
+
+struct run {
+    long seconds;
+    long samples;
+    long overflows;                     // Wake-ups later than a whole interval
+    double totalUs;
+    double minUs;
+    double maxUs;
+    long histogram[HISTOGRAM_US + 1];   // Per microsecond
+};
+
+static volatile bool loadRunning = false;
+static volatile uint64_t loadSink = 0;
+
+static int64_t diff_ns(const struct timespec *a, const struct timespec *b) {
+    return (a->tv_sec - b->tv_sec) * 1000000000LL + (a->tv_nsec - b->tv_nsec);
+}
+
+static void add_ns(struct timespec *t, long ns) {
+    t->tv_nsec += ns;
+    while (t->tv_nsec >= 1000000000L) {
+        t->tv_nsec -= 1000000000L;
+        t->tv_sec++;
+    }
+}
+
+/******************************************************************************
+ * Load
+ ******************************************************************************/
+
+static void *cpu_load_thread(void *arg) {
+    (void)arg;
+    uint64_t x = 88172645463325252ull;
+    while (loadRunning) {
+        for (int i = 0; i < 100000; i++) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+        }
+        loadSink += x;
+    }
+    return NULL;
+}
+
+static void *memory_load_thread(void *arg) {
+    (void)arg;
+    uint8_t *buffer = malloc(MEMORY_LOAD_BYTES);
+    if (!buffer) {
+        perror("memory load");
+        return NULL;
+    }
+    uint8_t value = 0;
+    while (loadRunning) {
+        memset(buffer, value++, MEMORY_LOAD_BYTES);
+        loadSink += buffer[value * 4099 % MEMORY_LOAD_BYTES];
+    }
+    free(buffer);
+    return NULL;
+}
+
+/******************************************************************************
+ * Measurement
+ ******************************************************************************/
+
+static void *measure_thread(void *arg) {
+    struct run *run = arg;
+    struct timespec next, now;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    add_ns(&next, INTERVAL_NS);
+    long loops = run->seconds * (1000000000L / INTERVAL_NS);
+    run->minUs = 1e12;
+    for (long i = 0; i < loops; i++) {
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double latencyUs = diff_ns(&now, &next) / 1000.0;
+        run->samples++;
+        run->totalUs += latencyUs;
+        if (latencyUs < run->minUs) {
+            run->minUs = latencyUs;
+        }
+        if (latencyUs > run->maxUs) {
+            run->maxUs = latencyUs;
+        }
+        long bucket = latencyUs < 0 ? 0 : (long)latencyUs;
+        run->histogram[bucket > HISTOGRAM_US ? HISTOGRAM_US : bucket]++;
+
+        add_ns(&next, INTERVAL_NS);
+        // Skip deadlines already missed, like cyclictest, instead of running them back to back
+        while (diff_ns(&now, &next) > 0) {
+            add_ns(&next, INTERVAL_NS);
+            run->overflows++;
+        }
+    }
+    return NULL;
+}
+
+static double percentile(const struct run *run, double share) {
+    long wanted = (long)(run->samples * share);
+    long seen = 0;
+    for (int us = 0; us <= HISTOGRAM_US; us++) {
+        seen += run->histogram[us];
+        if (seen > wanted) {
+            return us;
+        }
+    }
+    return HISTOGRAM_US;
+}
+
+static void report(const char *label, const struct run *run) {
+    printf("%s\n", label);
+    printf("  %ld wake-ups: min %.0f us, avg %.1f us, p99 %.0f us, p99.9 %.0f us, max %.0f us, %ld missed periods\n",
+           run->samples, run->minUs, run->samples > 0 ? run->totalUs / run->samples : 0.0,
+           percentile(run, 0.99), percentile(run, 0.999), run->maxUs, run->overflows);
+}
+
+static void measure(const char *name, struct run *run) {
+    pthread_t thread;
+    int rc = ThreadConfig_create(&thread, name, measure_thread, run);
+    if (rc != 0) {
+        fprintf(stderr, "ThreadConfig_create(%s) failed: %s\n", name, strerror(rc));
+        exit(EXIT_FAILURE);
+    }
+    pthread_join(thread, NULL);
+}
+
+int main(int argc, char *argv[]) {
+    long seconds = argc > 1 ? atol(argv[1]) : DEFAULT_SECONDS;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    long loadThreads = argc > 2 ? atol(argv[2]) : (cpus > 0 ? cpus : 1);
+    if (seconds <= 0 || loadThreads < 0) {
+        fprintf(stderr, "Usage: %s [seconds] [load threads per kind]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    ThreadConfig_init();
+
+    loadRunning = true;
+    pthread_t *load = calloc(2 * loadThreads + 1, sizeof(pthread_t));
+    for (long i = 0; i < loadThreads; i++) {
+        pthread_create(&load[2 * i], NULL, cpu_load_thread, NULL);
+        pthread_create(&load[2 * i + 1], NULL, memory_load_thread, NULL);
+    }
+    printf("Load: %ld CPU and %ld memory threads on %ld CPUs; %ld s per run at a 1 ms period\n",
+           loadThreads, loadThreads, cpus, seconds);
+
+    static struct run profiled;
+    static struct run plain;
+    profiled.seconds = seconds;
+    plain.seconds = seconds;
+    measure(PROFILED_NAME, &profiled);
+    ThreadConfig_print();
+    measure(DEFAULT_NAME, &plain);
+
+    loadRunning = false;
+    for (long i = 0; i < 2 * loadThreads; i++) {
+        pthread_join(load[i], NULL);
+    }
+    free(load);
+
+    report("With the \"" PROFILED_NAME "\" profile", &profiled);
+    report("Default scheduling", &plain);
+    ThreadConfig_cleanup();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,321 @@
+/**
+ * bench/vad_eval.c
+ *
+ * Offline evaluation of the voice activity detector (hal/src/vad.c). Each recording first
+ * goes through the same front end as on the device (hal/src/audio_dsp.c: resampling to
+ * 16 kHz, noise suppression and AGC; --raw skips it), then is replayed through the same stop rules as record_audio() in hal/src/microphone.c: stop
+ * END_OF_SPEECH_MS after speech ends, after NO_SPEECH_TIMEOUT_MS without any speech, or
+ * at MAX_RECORDING_MS. For comparison it also replays the old check, which called a
+ * 10 ms chunk sound when its mean absolute amplitude was above 50 and stopped after 2 s
+ * without sound.
+ *
+ * Like record_audio(), the VAD first seeds its noise floor from the audio heard before the
+ * recording started. Each fixture has HISTORY_MS of it; --history MS makes the first MS of
+ * each WAV file that audio, and times are then given from the end of it.
+ *
+ * Without arguments it builds synthetic fixtures: a voiced utterance over quiet cabin
+ * noise, highway rumble and fan hiss, highway rumble with no speech, and a command that
+ * follows the wake word with no pause, so speech is already under way at 0 ms. Recordings
+ * are given as WAV files (16-bit PCM, first channel used), optionally labelled with where
+ * the speech is, as file.wav:startMs:endMs. Labelled recordings and the fixtures are
+ * checked: speech must be detected within ONSET_LIMIT_MS of its start, and the recording
+ * must stop no later than STOP_LIMIT_MS after it ends; speech-free ones must never start.
+ *
+ * Run as: vad_eval [--raw] [--history MS] [file.wav[:startMs:endMs] ...]
+ */
+
+#include "bench_audio.h"
+#include "hal/vad.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#define RATE 16000
+#define CHUNK_SAMPLES 160               // What record_audio() reads per call (10 ms)
+#define END_OF_SPEECH_MS 300
+#define NO_SPEECH_TIMEOUT_MS 2000
+#define MAX_RECORDING_MS 15000
+#define MIN_LEVEL 50                    // Microphone's default sound threshold
+#define OLD_SILENCE_MS 2000
+#define ONSET_LIMIT_MS 150
+#define STOP_LIMIT_MS 500
+#define FIXTURE_MS 8000
+#define HISTORY_MS 1500                 // Audio before the recording in each fixture
+#define COMMAND_MS 2200                 // Length of the utterance in the fixtures
+#define KEYWORD_MS 700                  // Wake word at the end of the earlier audio
+#define NO_LABEL -1
+#define NOISE_SEED 12345
+
+struct recording {
+    char name[256];
+    int16_t *samples;
+    size_t count;
+    unsigned int rate;
+    int speechStartMs;                  // NO_LABEL if unknown; -1/-1 when labelled speech-free
+    int speechEndMs;
+    bool labelled;
+    int historyMs;                      // Leading audio that was heard before the recording started
+};
+
+struct result {
+    int startMs;                        // First VAD_EVENT_SPEECH_START, -1 if none
+    int stopMs;
+    const char *reason;
+    double nsPerFrame;
+};
+
+// Voiced syllables (a harmonic series with a rising-falling envelope) in words with
+// short pauses, roughly "set target to the library"
+static void add_speech(double *mix, size_t count, int startMs, int endMs, double rms) {
+    const int syllableMs = 180;
+    const int gapMs = 60;
+    const int wordGapMs = 150;
+    double phase = 0.0;
+    int t = startMs;
+    for (int syllable = 0; t < endMs; syllable++) {
+        int end = t + syllableMs < endMs ? t + syllableMs : endMs;
+        double f0 = 110.0 + 30.0 * sin(syllable * 0.9);
+        for (size_t i = (size_t)t * RATE / 1000; i < (size_t)end * RATE / 1000 && i < count; i++) {
+            double progress = (double)(i - (size_t)t * RATE / 1000) / ((end - t) * RATE / 1000.0);
+            double envelope = sin(M_PI * progress);
+            phase += 2.0 * M_PI * f0 / RATE;
+            double voiced = 0.0;
+            for (int h = 1; h <= 20; h++) {
+                // Crude formants around 500 Hz and 1500 Hz
+                double f = f0 * h;
+                double weight = exp(-pow((f - 500.0) / 300.0, 2)) + 0.5 * exp(-pow((f - 1500.0) / 400.0, 2)) + 0.05;
+                voiced += weight * sin(h * phase);
+            }
+            mix[i] += rms * 1.2 * envelope * voiced;
+        }
+        t = end + ((syllable % 3 == 2) ? wordGapMs : gapMs);
+    }
+}
+
+// Road rumble: white noise through two one-pole low-pass stages; hiss: plain white noise
+static void add_noise(double *mix, size_t count, double rms, bool rumble) {
+    double *noise = malloc(count * sizeof(double));
+    double a = 0.0;
+    double b = 0.0;
+    double sumSquares = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        double white = BenchAudio_uniform();
+        if (rumble) {
+            a += 0.05 * (white - a);
+            b += 0.05 * (a - b);
+            noise[i] = b;
+        } else {
+            noise[i] = white;
+        }
+        sumSquares += noise[i] * noise[i];
+    }
+    double scale = rms / sqrt(sumSquares / count);
+    for (size_t i = 0; i < count; i++) {
+        mix[i] += noise[i] * scale;
+    }
+    free(noise);
+}
+
+// speechStartMs is from the start of the recording, which follows HISTORY_MS of earlier
+// audio; afterWakeWord puts the keyword at the very end of that audio
+static void make_fixture(struct recording *rec, const char *name, double noiseRms, bool rumble,
+                         double speechRms, int speechStartMs, bool afterWakeWord) {
+    snprintf(rec->name, sizeof(rec->name), "%s", name);
+    rec->rate = RATE;
+    rec->historyMs = HISTORY_MS;
+    rec->count = (size_t)(HISTORY_MS + FIXTURE_MS) * RATE / 1000;
+    rec->labelled = true;
+    rec->speechStartMs = speechRms > 0 ? speechStartMs : NO_LABEL;
+    rec->speechEndMs = speechRms > 0 ? speechStartMs + COMMAND_MS : NO_LABEL;
+
+    double *mix = calloc(rec->count, sizeof(double));
+    add_noise(mix, rec->count, noiseRms, rumble);
+    if (afterWakeWord) {
+        add_speech(mix, rec->count, HISTORY_MS - KEYWORD_MS, HISTORY_MS, speechRms);
+    }
+    if (speechRms > 0) {
+        add_speech(mix, rec->count, HISTORY_MS + rec->speechStartMs, HISTORY_MS + rec->speechEndMs, speechRms);
+    }
+    rec->samples = malloc(rec->count * sizeof(int16_t));
+    for (size_t i = 0; i < rec->count; i++) {
+        double v = mix[i] < -32768.0 ? -32768.0 : (mix[i] > 32767.0 ? 32767.0 : mix[i]);
+        rec->samples[i] = (int16_t)lrint(v);
+    }
+    free(mix);
+}
+
+static int chunk_ms(size_t chunk, unsigned int rate) {
+    return (int)((chunk + 1) * CHUNK_SAMPLES * 1000 / rate);
+}
+
+// Samples before the recording start, at the current rate
+static size_t history_samples(const struct recording *rec) {
+    size_t history = (size_t)rec->historyMs * rec->rate / 1000;
+    return history < rec->count ? history : rec->count;
+}
+
+// The stop rules of record_audio()
+static struct result run_vad(const struct recording *rec) {
+    struct result result = {.startMs = -1, .stopMs = -1, .reason = "end of file"};
+    struct Vad vad;
+    Vad_init(&vad, rec->rate, END_OF_SPEECH_MS);
+    Vad_setMinLevel(&vad, MIN_LEVEL);
+    size_t history = history_samples(rec);
+    Vad_seedNoiseFloor(&vad, rec->samples, history);
+    const int16_t *samples = rec->samples + history;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+    size_t chunks = (rec->count - history) / CHUNK_SAMPLES;
+    size_t chunk = 0;
+    for (; chunk < chunks; chunk++) {
+        int nowMs = chunk_ms(chunk, rec->rate);
+        VadEvent event = Vad_process(&vad, samples + chunk * CHUNK_SAMPLES, CHUNK_SAMPLES);
+        if (event == VAD_EVENT_SPEECH_START && result.startMs < 0) {
+            result.startMs = nowMs;
+        } else if (event == VAD_EVENT_SPEECH_END) {
+            result.reason = "end of speech";
+            break;
+        }
+        if (result.startMs < 0 && nowMs >= NO_SPEECH_TIMEOUT_MS) {
+            result.reason = "no speech";
+            break;
+        }
+        if (nowMs >= MAX_RECORDING_MS) {
+            result.reason = "maximum length";
+            break;
+        }
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+    result.stopMs = chunk_ms(chunk < chunks ? chunk : chunks - 1, rec->rate);
+    size_t frames = (chunk + 1) * CHUNK_SAMPLES / vad.frameSamples;
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    result.nsPerFrame = frames > 0 ? ns / frames : 0.0;
+    return result;
+}
+
+// The check record_audio() used before the VAD
+static struct result run_old(const struct recording *rec) {
+    struct result result = {.startMs = -1, .stopMs = -1, .reason = "end of file"};
+    size_t history = history_samples(rec);
+    const int16_t *samples = rec->samples + history;
+    size_t chunks = (rec->count - history) / CHUNK_SAMPLES;
+    int lastSoundMs = 0;
+    size_t chunk = 0;
+    for (; chunk < chunks; chunk++) {
+        int nowMs = chunk_ms(chunk, rec->rate);
+        long sum = 0;
+        for (int i = 0; i < CHUNK_SAMPLES; i++) {
+            sum += abs(samples[chunk * CHUNK_SAMPLES + i]);
+        }
+        if (sum / CHUNK_SAMPLES > MIN_LEVEL) {
+            lastSoundMs = nowMs;
+            if (result.startMs < 0) {
+                result.startMs = nowMs;
+            }
+        } else if (nowMs - lastSoundMs >= OLD_SILENCE_MS) {
+            result.reason = "silence";
+            break;
+        }
+        if (nowMs >= MAX_RECORDING_MS) {
+            result.reason = "maximum length";
+            break;
+        }
+    }
+    result.stopMs = chunk_ms(chunk < chunks ? chunk : chunks - 1, rec->rate);
+    return result;
+}
+
+// Returns false if a labelled recording misses its limits
+static bool report(const struct recording *rec) {
+    struct result vad = run_vad(rec);
+    struct result old = run_old(rec);
+    bool hasSpeech = rec->speechStartMs >= 0;
+    bool pass = true;
+    char check[64] = "";
+    if (rec->labelled && hasSpeech) {
+        int onset = vad.startMs - rec->speechStartMs;
+        int tail = vad.stopMs - rec->speechEndMs;
+        pass = vad.startMs >= rec->speechStartMs && onset <= ONSET_LIMIT_MS && tail <= STOP_LIMIT_MS &&
+               strcmp(vad.reason, "end of speech") == 0;
+        snprintf(check, sizeof(check), "onset %+d ms, stop %+d ms %s", onset, tail, pass ? "ok" : "FAIL");
+    } else if (rec->labelled) {
+        pass = vad.startMs < 0;
+        snprintf(check, sizeof(check), "%s", pass ? "no speech ok" : "FAIL: speech detected");
+    }
+    printf("%-24s %6d %6d  %-15s %7.0f   %6d  %-15s %s\n", rec->name, vad.startMs, vad.stopMs, vad.reason,
+           vad.nsPerFrame, old.stopMs, old.reason, check);
+    return pass;
+}
+
+int main(int argc, char *argv[]) {
+    bool raw = false;
+    BenchAudio_seed(NOISE_SEED);
+    int historyMs = 0;
+    int first = 1;
+    for (; first < argc; first++) {
+        if (strcmp(argv[first], "--raw") == 0) {
+            raw = true;
+        } else if (strcmp(argv[first], "--history") == 0 && first + 1 < argc) {
+            historyMs = atoi(argv[++first]);
+        } else {
+            break;
+        }
+    }
+    int count = argc > first ? argc - first : 5;
+    struct recording *recs = calloc((size_t)count, sizeof(struct recording));
+    if (argc > first) {
+        for (int i = 0; i < count; i++) {
+            char path[256];
+            snprintf(path, sizeof(path), "%s", argv[first + i]);
+            char *label = strchr(path, ':');
+            recs[i].speechStartMs = NO_LABEL;
+            recs[i].speechEndMs = NO_LABEL;
+            recs[i].historyMs = historyMs;
+            if (label) {
+                *label = '\0';
+                recs[i].labelled = sscanf(label + 1, "%d:%d", &recs[i].speechStartMs, &recs[i].speechEndMs) == 2;
+            }
+            const char *base = strrchr(path, '/');
+            snprintf(recs[i].name, sizeof(recs[i].name), "%s", base ? base + 1 : path);
+            if (!BenchAudio_loadWav(path, &recs[i].samples, &recs[i].count, &recs[i].rate)) {
+                return EXIT_FAILURE;
+            }
+        }
+    } else {
+        make_fixture(&recs[0], "quiet cabin", 20, true, 1500, 700, false);
+        make_fixture(&recs[1], "highway rumble", 800, true, 2500, 700, false);
+        make_fixture(&recs[2], "fan hiss", 150, false, 2000, 700, false);
+        make_fixture(&recs[3], "highway, no speech", 800, true, 0, 0, false);
+        make_fixture(&recs[4], "after wake word", 800, true, 2500, 0, true);
+    }
+
+    for (int i = 0; i < count && !raw; i++) {
+        if (!BenchAudio_frontEnd(recs[i].name, &recs[i].samples, &recs[i].count, &recs[i].rate)) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("%s\n", raw ? "Raw audio into the VAD" : "Audio through resampler, noise suppressor and AGC into the VAD");
+    printf("%-24s %6s %6s  %-15s %7s   %6s  %-15s %s\n", "", "VAD:", "", "", "", "old:", "", "");
+    printf("%-24s %6s %6s  %-15s %7s   %6s  %-15s %s\n", "recording", "start", "stop", "stopped by",
+           "ns/frm", "stop", "stopped by", "check");
+    int failures = 0;
+    for (int i = 0; i < count; i++) {
+        if (!report(&recs[i])) {
+            failures++;
+        }
+        free(recs[i].samples);
+    }
+    free(recs);
+    if (failures > 0) {
+        printf("FAIL: %d recordings outside the limits\n", failures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
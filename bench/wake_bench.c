@@ -0,0 +1,311 @@
+/**
+ * bench/wake_bench.c
+ *
+ * Cost and accuracy of the keyword spotter (hal/src/wake_word.c). The real detector thread
+ * runs unchanged; only the DSP ring it reads is replaced by a stub that serves a recording
+ * in the same 320-sample reads, and the bench waits until every MFCC frame is consumed.
+ *
+ * Recordings are WAV files (16-bit PCM, first channel used) labelled with how many times
+ * the keyword is spoken in them, as file.wav:N. Files at 16 kHz are taken to be DSP-stage
+ * output already; files at any other rate go through the same front end as on the device
+ * (resampling, noise suppression and AGC). Every detection above N is a false accept and
+ * every missing one a false reject.
+ *
+ * --model picks the network (otherwise WAKE_WORD_MODEL or wakeword.kws, as on the device).
+ * Without it and without a model file, a network of random weights with the same shape as
+ * the deployed one is generated, which is only good for timing: its detections mean
+ * nothing. Without recordings, a minute of synthetic cabin noise with voiced bursts is used.
+ *
+ * Reported per recording: the detector's own statistics (CPU per 10 ms frame, share of a
+ * core against WAKE_WORD_CPU_BUDGET_PERCENT) and, timed separately on the same audio, the
+ * MFCC front end alone, so the network's share is the difference.
+ *
+ * Run as: wake_bench [--model file.kws] [file.wav:N ...]
+ */
+
+#include "bench_audio.h"
+#include "hal/wake_word.h"
+#include "hal/audio_dsp.h"
+#include "hal/mfcc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RATE AUDIO_DSP_RATE
+#define SYNTHETIC_SECONDS 60
+#define MAX_MFCC_FRAMES 8
+
+// Shape of the generated timing model: 76 frames (760 ms) x 13 coefficients -> 128 -> 128 -> 2
+#define SYNTHETIC_CONTEXT 76
+#define SYNTHETIC_HIDDEN 128
+#define SYNTHETIC_LAYERS 3
+#define NOISE_SEED 4242
+
+struct recording {
+    char name[256];
+    int16_t *samples;
+    size_t count;
+    unsigned int rate;
+    int keywords;                       // Times the keyword is spoken; -1 when unlabelled
+};
+
+/******************************************************************************
+ * Stand-ins for the DSP stage, serving the current recording to the detector
+ ******************************************************************************/
+
+static struct AudioRing ring;
+static const int16_t *feedSamples = NULL;
+static size_t feedCount = 0;
+static int detections = 0;
+
+struct AudioRing* AudioDsp_getRing(void) {
+    return &ring;
+}
+
+unsigned int AudioDsp_getSampleRate(void) {
+    return RATE;
+}
+
+void AudioRing_openReader(struct AudioRing *r, struct AudioRingReader *reader) {
+    reader->ring = r;
+    reader->readPos = 0;
+    reader->droppedSamples = 0;
+}
+
+size_t AudioRing_readWait(struct AudioRingReader *reader, int16_t *out, size_t maxCount, int timeoutMs) {
+    (void)timeoutMs;
+    size_t left = feedCount - (size_t)reader->readPos;
+    if (left == 0) {
+        usleep(1000);
+        return 0;
+    }
+    size_t count = left < maxCount ? left : maxCount;
+    memcpy(out, feedSamples + reader->readPos, count * sizeof(int16_t));
+    reader->readPos += count;
+    return count;
+}
+
+static void on_wake(void) {
+    __atomic_add_fetch(&detections, 1, __ATOMIC_RELAXED);
+}
+
+/******************************************************************************
+ * Recordings
+ ******************************************************************************/
+
+// Cabin noise with voiced bursts (a harmonic series under a half-sine envelope) every 1.5 s
+static void make_synthetic(struct recording *rec) {
+    snprintf(rec->name, sizeof(rec->name), "synthetic cabin audio");
+    rec->rate = RATE;
+    rec->count = (size_t)SYNTHETIC_SECONDS * RATE;
+    rec->keywords = -1;
+    rec->samples = malloc(rec->count * sizeof(int16_t));
+    double phase = 0.0;
+    double lowPass = 0.0;
+    for (size_t i = 0; i < rec->count; i++) {
+        lowPass += 0.05 * (BenchAudio_uniform() - lowPass);
+        double value = 3000.0 * lowPass;
+        size_t inCycle = i % (RATE * 3 / 2);
+        if (inCycle < RATE / 2) {
+            double f0 = 120.0 + 20.0 * sin(i * 2.0 * M_PI / RATE);
+            phase += 2.0 * M_PI * f0 / RATE;
+            double voiced = 0.0;
+            for (int h = 1; h <= 12; h++) {
+                voiced += sin(h * phase) / h;
+            }
+            value += 2000.0 * sin(M_PI * inCycle / (RATE / 2.0)) * voiced;
+        }
+        rec->samples[i] = (int16_t)lrint(value > 32767.0 ? 32767.0 : value < -32768.0 ? -32768.0 : value);
+    }
+}
+
+/******************************************************************************
+ * Models
+ ******************************************************************************/
+
+static bool write_bytes(FILE *file, const void *data, size_t size) {
+    return fwrite(data, 1, size, file) == size;
+}
+
+// Writes a model in the KWS1 format of wake_word.h with random weights
+static bool write_synthetic_model(const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    uint16_t header[3] = {SYNTHETIC_CONTEXT, MFCC_NUM_COEFFS, SYNTHETIC_LAYERS};
+    float mean[MFCC_NUM_COEFFS] = {0};
+    float invStd[MFCC_NUM_COEFFS];
+    for (int c = 0; c < MFCC_NUM_COEFFS; c++) {
+        invStd[c] = 0.1f;
+    }
+    float inputScale = 0.05f;
+    bool ok = write_bytes(file, "KWS1", 4) && write_bytes(file, header, sizeof(header)) &&
+              write_bytes(file, mean, sizeof(mean)) && write_bytes(file, invStd, sizeof(invStd)) &&
+              write_bytes(file, &inputScale, sizeof(inputScale));
+    uint16_t inputs = SYNTHETIC_CONTEXT * MFCC_NUM_COEFFS;
+    for (int layer = 0; ok && layer < SYNTHETIC_LAYERS; layer++) {
+        bool last = layer == SYNTHETIC_LAYERS - 1;
+        uint16_t outputs = last ? 2 : SYNTHETIC_HIDDEN;
+        uint8_t relu = last ? 0 : 1;
+        float weightScale = 0.01f;
+        float outputScale = 0.1f;
+        ok = write_bytes(file, &inputs, 2) && write_bytes(file, &outputs, 2) && write_bytes(file, &relu, 1) &&
+             write_bytes(file, &weightScale, sizeof(float)) && write_bytes(file, &outputScale, sizeof(float));
+        for (int o = 0; ok && o < outputs; o++) {
+            int32_t bias = 0;
+            ok = write_bytes(file, &bias, sizeof(bias));
+        }
+        for (size_t w = 0; ok && w < (size_t)outputs * inputs; w++) {
+            int8_t weight = (int8_t)lrint(BenchAudio_uniform() * 127.0);
+            ok = write_bytes(file, &weight, 1);
+        }
+        inputs = outputs;
+    }
+    if (fclose(file) != 0 || !ok) {
+        fprintf(stderr, "%s: cannot write the synthetic model\n", path);
+        return false;
+    }
+    return true;
+}
+
+/******************************************************************************
+ * Runs
+ ******************************************************************************/
+
+static double thread_us(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+// Times the MFCC front end alone; returns the frames it produces
+static long time_mfcc(const struct recording *rec, double *usPerFrame) {
+    struct Mfcc mfcc;
+    if (Mfcc_init(&mfcc, RATE) != 0) {
+        perror("Mfcc_init");
+        exit(EXIT_FAILURE);
+    }
+    float coeffs[MAX_MFCC_FRAMES][MFCC_NUM_COEFFS];
+    long frames = 0;
+    double start = thread_us();
+    for (size_t pos = 0; pos < rec->count; pos += 320) {
+        size_t n = rec->count - pos < 320 ? rec->count - pos : 320;
+        frames += Mfcc_process(&mfcc, rec->samples + pos, n, coeffs, MAX_MFCC_FRAMES);
+    }
+    *usPerFrame = frames > 0 ? (thread_us() - start) / frames : 0.0;
+    Mfcc_destroy(&mfcc);
+    return frames;
+}
+
+// Runs the detector over the recording; returns false if the model could not be loaded
+static bool run_detector(const struct recording *rec, long expectedFrames, struct WakeWordStats *stats) {
+    feedSamples = rec->samples;
+    feedCount = rec->count;
+    detections = 0;
+    if (WakeWord_init(on_wake) != 0) {
+        return false;
+    }
+    do {
+        usleep(2000);
+        *stats = WakeWord_getStats();
+    } while (stats->frames < expectedFrames);
+    WakeWord_cleanup();
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    char modelPath[] = "/tmp/wake_bench_XXXXXX";
+    BenchAudio_seed(NOISE_SEED);
+    bool synthetic = false;
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "--model") == 0) {
+        setenv("WAKE_WORD_MODEL", argv[2], 1);
+        first = 3;
+    } else {
+        const char *path = getenv("WAKE_WORD_MODEL");
+        if (access(path && path[0] != '\0' ? path : "wakeword.kws", R_OK) != 0) {
+            int fd = mkstemp(modelPath);
+            if (fd < 0 || close(fd) != 0 || !write_synthetic_model(modelPath)) {
+                return EXIT_FAILURE;
+            }
+            setenv("WAKE_WORD_MODEL", modelPath, 1);
+            synthetic = true;
+            printf("No model given: timing a random %d x %d -> %d -> %d -> 2 network; detections mean nothing\n",
+                   SYNTHETIC_CONTEXT, MFCC_NUM_COEFFS, SYNTHETIC_HIDDEN, SYNTHETIC_HIDDEN);
+        }
+    }
+
+    int count = argc > first ? argc - first : 1;
+    struct recording *recs = calloc(count, sizeof(struct recording));
+    if (argc <= first) {
+        make_synthetic(&recs[0]);
+    }
+    for (int i = 0; i < argc - first; i++) {
+        struct recording *rec = &recs[i];
+        char *arg = argv[first + i];
+        char *label = strrchr(arg, ':');
+        rec->keywords = -1;
+        if (label) {
+            *label = '\0';
+            rec->keywords = atoi(label + 1);
+        }
+        snprintf(rec->name, sizeof(rec->name), "%s", arg);
+        if (!BenchAudio_loadWav(arg, &rec->samples, &rec->count, &rec->rate) ||
+            (rec->rate != RATE && !BenchAudio_frontEnd(rec->name, &rec->samples, &rec->count, &rec->rate))) {
+            return EXIT_FAILURE;
+        }
+    }
+
+    int falseAccepts = 0;
+    int falseRejects = 0;
+    int spoken = 0;
+    double audioSeconds = 0.0;
+    bool overBudget = false;
+    for (int i = 0; i < count; i++) {
+        struct recording *rec = &recs[i];
+        double mfccUs;
+        long frames = time_mfcc(rec, &mfccUs);
+        struct WakeWordStats stats;
+        if (!run_detector(rec, frames, &stats)) {
+            return EXIT_FAILURE;
+        }
+        printf("%s: %.1f s, %d detections", rec->name, (double)rec->count / RATE, detections);
+        if (rec->keywords >= 0 && !synthetic) {
+            int accepts = detections > rec->keywords ? detections - rec->keywords : 0;
+            int rejects = rec->keywords > detections ? rec->keywords - detections : 0;
+            printf(" of %d spoken (%d false accepts, %d false rejects)", rec->keywords, accepts, rejects);
+            falseAccepts += accepts;
+            falseRejects += rejects;
+            spoken += rec->keywords;
+            audioSeconds += (double)rec->count / RATE;
+        }
+        printf("\n  per 10 ms frame: %.1f us avg, %.1f us max, MFCC alone %.1f us, network share %.1f us\n",
+               stats.avgFrameUs, stats.maxFrameUs, mfccUs, stats.avgFrameUs - mfccUs);
+        printf("  %.2f%% of one core (budget %.1f%%), %ld network runs\n",
+               stats.cpuPercent, WAKE_WORD_CPU_BUDGET_PERCENT, stats.evaluations);
+        overBudget = overBudget || stats.cpuPercent > WAKE_WORD_CPU_BUDGET_PERCENT;
+        free(rec->samples);
+    }
+    if (spoken > 0 || audioSeconds > 0) {
+        printf("False rejects %d of %d keywords, false accepts %d in %.0f s (%.1f per hour)\n",
+               falseRejects, spoken, falseAccepts, audioSeconds,
+               audioSeconds > 0 ? falseAccepts * 3600.0 / audioSeconds : 0.0);
+    }
+    if (synthetic) {
+        unlink(modelPath);
+    }
+    free(recs);
+    if (overBudget) {
+        printf("FAIL: over the CPU budget\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -16,7 +16,7 @@ struct location {
 #define INVALID_LONGITUDE -1000
 #define INVALID_SPEED -1
 
-// Function to initialize/cleanup the GPS module.
+// Function to initialize/cleanup the GPS module. The UART is read on the reactor thread, so call Reactor_init first.
 void GPS_init();
 void GPS_cleanup();
 
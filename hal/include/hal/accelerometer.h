@@ -1,9 +1,11 @@
 /* accelerometer.h 
  * 
- * This file declares functions for initializing and cleaning up the I2C interface, 
- * opening an I2C bus, and performing 16-bit register read/write operations.
+ * This file declares the accelerometer interface. The sensor runs at ACCELEROMETER_ODR_HZ
+ * with its hardware FIFO in stream mode; a scheduler task drains the FIFO in I2C bursts and
+ * stores every sample, timestamped, in a ring buffer. Readers never touch the bus and never
+ * block: they take the newest sample, or every sample since their last read.
  * 
- * These methods are taken from class guide: I2C Guide
+ * Call Scheduler_init first.
  */
 
 #ifndef _ACCELEROMETER_H_
@@ -11,15 +13,39 @@
 
 #include <stdint.h>
 
+#define ACCELEROMETER_ODR_HZ 400
+#define ACCELEROMETER_RING_SAMPLES 256     // 640 ms of history
+
 typedef struct {
     double x;
     double y;
     double z;
 } AccelerometerData;
 
+typedef struct {
+    uint64_t timestampNs;   // CLOCK_MONOTONIC, estimated from the drain time and the ODR
+    AccelerometerData data; // In g
+} AccelerometerSample;
+
+typedef struct {
+    uint64_t samples;       // Read out of the FIFO
+    uint64_t drains;        // I2C bursts
+    int maxBurst;           // Most samples in one burst
+    uint64_t overruns;      // Drains that found the FIFO full and overwritten
+} AccelerometerStats;
+
 void Accelerometer_initialize(void);
 void Accelerometer_cleanUp(void);
+
+// Newest sample, in g
 AccelerometerData Accelerometer_getReading();
-uint8_t Accelerometer_readWhoAmI(void);
 
-#endif
\ No newline at end of file
+// Copies up to max samples newer than *cursor into samples, oldest first, and advances
+// *cursor past them. Start with *cursor = 0 to get whatever the ring still holds. Samples
+// overwritten before they were read are skipped; *cursor tells how many: it counts every
+// sample ever stored. Returns the number copied. Safe from any thread.
+int Accelerometer_readSamples(uint64_t *cursor, AccelerometerSample *samples, int max);
+
+AccelerometerStats Accelerometer_getStats(void);
+
+#endif
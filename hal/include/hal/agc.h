@@ -0,0 +1,29 @@
+/**
+ * hal/agc.h
+ *
+ * Automatic gain control. The level of each 10 ms block is measured and the gain moves
+ * toward the one that brings speech to the target level: quickly down when speech gets
+ * loud, slowly up when it gets quiet. Blocks near the noise floor do not raise the gain,
+ * so silence is not pumped up. The gain is ramped across each block to avoid clicks.
+ */
+
+#ifndef AGC_H
+#define AGC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct Agc {
+    size_t blockSamples;
+    float gain;
+    float noiseLevel;       // Running estimate of the background RMS
+    float smoothedLevel;    // Block RMS smoothed over a few blocks
+    int blocksSeen;         // Up to the number of blocks that seed noiseLevel
+};
+
+void Agc_init(struct Agc *agc, unsigned int sampleRate);
+
+// Applies the gain in place
+void Agc_process(struct Agc *agc, int16_t *samples, size_t count);
+
+#endif // AGC_H
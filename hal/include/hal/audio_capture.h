@@ -0,0 +1,28 @@
+/**
+ * hal/audio_capture.h
+ *
+ * In-process ALSA capture. A background thread reads the USB microphone continuously
+ * and publishes every period into an AudioRing that any number of consumers can read.
+ */
+
+#ifndef AUDIO_CAPTURE_H
+#define AUDIO_CAPTURE_H
+
+#include "hal/audio_ring.h"
+
+// Opens the capture device and starts the capture thread
+void AudioCapture_init(void);
+
+// Stops the capture thread and closes the device
+void AudioCapture_cleanup(void);
+
+// Ring that receives the raw captured samples (mono, S16)
+struct AudioRing* AudioCapture_getRing(void);
+
+// Sample rate of the samples in the ring
+unsigned int AudioCapture_getSampleRate(void);
+
+// Time from opening the device to the first captured period reaching the ring, in microseconds
+long AudioCapture_getFirstByteLatencyUs(void);
+
+#endif // AUDIO_CAPTURE_H
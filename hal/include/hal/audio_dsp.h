@@ -0,0 +1,29 @@
+/**
+ * hal/audio_dsp.h
+ *
+ * Front-end DSP stage between capture and the audio consumers. A thread reads the raw
+ * 44.1 kHz capture ring, resamples it to 16 kHz, removes steady background noise,
+ * levels it with an AGC and publishes the result in a second ring. Speech engines want
+ * 16 kHz, so recordings and uploads shrink to about a third.
+ */
+
+#ifndef AUDIO_DSP_H
+#define AUDIO_DSP_H
+
+#include "hal/audio_ring.h"
+
+#define AUDIO_DSP_RATE 16000
+
+// Starts the DSP thread. AudioCapture_init() must be called first.
+void AudioDsp_init(void);
+void AudioDsp_cleanup(void);
+
+// Ring of processed 16 kHz samples
+struct AudioRing* AudioDsp_getRing(void);
+
+unsigned int AudioDsp_getSampleRate(void);
+
+// Average processing time per 10 ms of audio, in microseconds
+double AudioDsp_getAvgBlockUs(void);
+
+#endif // AUDIO_DSP_H
@@ -0,0 +1,57 @@
+/**
+ * hal/audio_ring.h
+ *
+ * Lock-free single-producer / multi-consumer ring buffer for 16-bit audio samples.
+ * The producer never waits for readers: each reader keeps its own position and, if it
+ * falls too far behind, skips ahead and counts the lost samples. Readers stay maxWrite
+ * samples clear of a full lap, so the slots the producer may be filling at that moment are
+ * never handed out. The producer only takes waitMutex, briefly, when a reader is parked in
+ * AudioRing_readWait().
+ */
+
+#ifndef AUDIO_RING_H
+#define AUDIO_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+struct AudioRing {
+    int16_t *samples;
+    size_t capacity;                // Power of two
+    size_t maxWrite;                // Largest block published at once
+    _Atomic uint64_t writePos;      // Total samples ever written
+    atomic_int waiters;             // Readers parked on dataReady
+    pthread_mutex_t waitMutex;      // Only used to park and wake readers
+    pthread_cond_t dataReady;
+};
+
+struct AudioRingReader {
+    struct AudioRing *ring;
+    uint64_t readPos;
+    uint64_t droppedSamples;        // Samples overwritten before this reader got to them
+};
+
+// Capacity is rounded up to a power of two. Writes are published in blocks of at most
+// maxWrite samples; readers can hold up to capacity - maxWrite samples of history.
+void AudioRing_init(struct AudioRing *ring, size_t capacity, size_t maxWrite);
+void AudioRing_destroy(struct AudioRing *ring);
+
+// Producer side (one thread only)
+void AudioRing_write(struct AudioRing *ring, const int16_t *samples, size_t count);
+
+// Current write position, usable as a bookmark for AudioRing_openReaderAt()
+uint64_t AudioRing_getWritePos(struct AudioRing *ring);
+
+// Reader starting at the newest sample / at a given position
+void AudioRing_openReader(struct AudioRing *ring, struct AudioRingReader *reader);
+void AudioRing_openReaderAt(struct AudioRing *ring, struct AudioRingReader *reader, uint64_t position);
+
+// Copy up to maxCount samples without blocking. Returns the number of samples copied.
+size_t AudioRing_read(struct AudioRingReader *reader, int16_t *out, size_t maxCount);
+
+// Same as AudioRing_read() but waits up to timeoutMs for data when the ring is empty
+size_t AudioRing_readWait(struct AudioRingReader *reader, int16_t *out, size_t maxCount, int timeoutMs);
+
+#endif // AUDIO_RING_H
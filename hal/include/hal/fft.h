@@ -0,0 +1,31 @@
+/**
+ * hal/fft.h
+ *
+ * Radix-2 FFT with precomputed twiddle and bit-reversal tables, used by the audio
+ * feature front ends. Tables are built once in Fft_init(); transforms do not allocate.
+ */
+
+#ifndef FFT_H
+#define FFT_H
+
+#include <stddef.h>
+
+struct Fft {
+    size_t size;            // Power of two
+    float *cosTable;        // size / 2 twiddles
+    float *sinTable;
+    size_t *bitReverse;
+};
+
+// Returns 0 on success, -1 if size is not a power of two or allocation fails
+int Fft_init(struct Fft *fft, size_t size);
+void Fft_destroy(struct Fft *fft);
+
+// In-place forward transform of size complex values
+void Fft_transform(const struct Fft *fft, float *re, float *im);
+
+// Transforms size real samples (re is overwritten, im is scratch) and writes the
+// size / 2 + 1 bin power spectrum to power
+void Fft_powerSpectrum(const struct Fft *fft, float *re, float *im, float *power);
+
+#endif // FFT_H
@@ -0,0 +1,46 @@
+/**
+ * hal/flac_encoder.h
+ *
+ * Minimal in-memory FLAC encoder for 16-bit mono speech. Samples are fed as they are
+ * captured and every full block is encoded straight away (fixed predictors of order 0-4,
+ * partitioned Rice residuals), so when the utterance ends only the last partial block is
+ * left to encode and the upload payload is ready at once. Nothing touches the filesystem.
+ */
+
+#ifndef FLAC_ENCODER_H
+#define FLAC_ENCODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FLAC_ENCODER_BLOCK_SIZE 4096
+
+struct FlacEncoder {
+    unsigned int sampleRate;
+    int16_t block[FLAC_ENCODER_BLOCK_SIZE];     // Samples of the block being filled
+    size_t blockFill;
+    int32_t residual[FLAC_ENCODER_BLOCK_SIZE];  // Scratch for the predictor search
+    uint8_t *data;                              // Encoded stream: header then frames
+    size_t size;
+    size_t capacity;
+    uint64_t totalSamples;
+    uint32_t frameNumber;
+    uint32_t minFrameBytes;
+    uint32_t maxFrameBytes;
+};
+
+// Returns 0 on success, -1 on allocation failure
+int FlacEncoder_init(struct FlacEncoder *enc, size_t initialCapacity);
+void FlacEncoder_destroy(struct FlacEncoder *enc);
+
+// Start a new stream: drops previous data and writes the "fLaC" marker and STREAMINFO
+int FlacEncoder_begin(struct FlacEncoder *enc, unsigned int sampleRate);
+
+// Append samples, encoding each block as it fills. Returns -1 if the buffer cannot grow.
+int FlacEncoder_feed(struct FlacEncoder *enc, const int16_t *samples, size_t count);
+
+// Encode the last partial block and fill in the STREAMINFO totals. Returns the stream
+// (owned by the encoder, valid until the next begin) and its size in *size.
+const uint8_t *FlacEncoder_finish(struct FlacEncoder *enc, size_t *size);
+
+#endif // FLAC_ENCODER_H
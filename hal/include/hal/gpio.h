@@ -51,4 +51,10 @@ int Gpio_getLineValue(struct GpioLine* line);
 // Needed to work with sameer's rotary encoder code
 int Gpio_waitForLineChange(struct GpioLine* line, struct gpiod_line_bulk* bulkEvents);
 
+// Request both-edge events on a line. Returns an fd to watch for readability, or -1.
+int Gpio_requestEvents(struct GpioLine* line, const char* consumer);
+
+// Read one pending event; *isRising tells the edge. Returns 0 on success, -1 on failure.
+int Gpio_readEvent(struct GpioLine* line, bool* isRising);
+
 #endif
\ No newline at end of file
@@ -28,7 +28,7 @@ typedef enum {
     JOYSTICK_PRESSED
 } JoystickDirection;
 
-// Initializes the joystick and starts thread to sample xy position, and button press
+// Initializes the joystick; button presses are read by the reactor (call Reactor_init first)
 void Joystick_initialize(void);
 
 // Cleans up the joystick
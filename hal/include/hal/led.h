@@ -4,6 +4,11 @@
  * cleaning up, and controlling LED attributes like trigger, brightness, 
  * and delays using sysfs files. The `LED_FILE_NAME` macro defines the 
  * path to the sysfs LED directory.
+ *
+ * Each sysfs attribute is opened once and its file descriptor kept in the LED, together
+ * with the last value written. A setter whose value matches that cache makes no system
+ * call at all; otherwise it is a single pwrite(). Blinking is left to the kernel's timer
+ * and pattern triggers, so no thread has to wake up to toggle an LED.
  */
 
 #ifndef _LED_H_
@@ -12,20 +17,39 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifndef LED_FILE_NAME         // bench/led_bench.c points it at fake attribute files
 #define LED_FILE_NAME "/sys/class/leds"
+#endif
+#define LED_TRIGGER_LENGTH 32
 
 typedef struct {
     const char *name; //(e.g., "ACT", "PWR")
+
+    // Cached sysfs state, owned by the LED HAL
+    int triggerFd;
+    int brightnessFd;
+    int delayOnFd;          // Only exist while the trigger is "timer"
+    int delayOffFd;
+    char trigger[LED_TRIGGER_LENGTH];   // Last trigger written, "" if unknown
+    int brightness;         // Last value written, -1 if unknown
+    int delayOn;
+    int delayOff;
 } LED;
 
 extern LED leds[];
 
+typedef struct {
+    unsigned long writes;   // pwrite() calls made
+    unsigned long skipped;  // Setter calls that matched the cached value
+    unsigned long opens;    // Attribute files opened
+} LedStats;
+
 
 void Led_initialize(void);
 void Led_cleanUp(void);
 /*
 This function sets the trigger for the LED to the specified trigger value.
-    @Param trigger: type of trigger. E.g. timer, heartbeat, none.
+    @Param trigger: type of trigger. E.g. timer, heartbeat, pattern, none.
 */
 void Led_setTrigger(LED *led, const char *trigger);
 /*
@@ -35,13 +59,30 @@ This function sets the brightness of the LED to the specified value.
 void Led_setBrightness(LED *led, int brightness);
 /*
 This function sets the delay_on value for the LED to the specified value.
+Only valid while the trigger is "timer".
     @Param delay: delay in milliseconds to keep LED on.
 */
 void Led_setDelayOn(LED *led, int on);
 /*
 This function sets the delay_off value for the LED to the specified value.
+Only valid while the trigger is "timer".
     @Param delay: delay in milliseconds to keep LED off
 */
 void Led_setDelayOff(LED *led, int off);
+/*
+This function makes the kernel blink the LED (timer trigger).
+    @Param onMs, offMs: time on and off in milliseconds.
+*/
+void Led_blink(LED *led, int onMs, int offMs);
+/*
+This function makes the kernel play a brightness pattern on the LED (pattern trigger).
+    @Param pattern: "<brightness> <duration ms>" pairs, e.g. "1 100 0 100 1 100 0 700".
+    @Param repeat: number of repetitions, -1 for forever.
+*/
+void Led_setPattern(LED *led, const char *pattern, int repeat);
+/*
+This function returns how many sysfs writes were made and how many were avoided.
+*/
+LedStats Led_getStats(void);
 
-#endif
\ No newline at end of file
+#endif
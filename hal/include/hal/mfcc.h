@@ -0,0 +1,47 @@
+/**
+ * hal/mfcc.h
+ *
+ * Streaming MFCC front end: 25 ms Hamming windows every 10 ms, a 26-band mel filter bank
+ * up to 8 kHz, log energies and a DCT down to 13 cepstral coefficients. Samples can be
+ * fed in chunks of any size; all buffers are allocated once in Mfcc_init().
+ */
+
+#ifndef MFCC_H
+#define MFCC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hal/fft.h"
+
+#define MFCC_NUM_COEFFS 13
+#define MFCC_NUM_FILTERS 26
+
+struct Mfcc {
+    unsigned int sampleRate;
+    size_t frameLength;                 // Samples per analysis window
+    size_t hop;                         // Samples between windows
+    struct Fft fft;
+    float *window;                      // Hamming window, frameLength
+    float *re;                          // FFT buffers, fft.size
+    float *im;
+    float *power;                       // fft.size / 2 + 1
+    int filterStart[MFCC_NUM_FILTERS];  // First FFT bin of each triangle
+    int filterLength[MFCC_NUM_FILTERS];
+    float *filterWeights;               // Concatenated triangle weights
+    float dct[MFCC_NUM_COEFFS][MFCC_NUM_FILTERS];
+    int16_t *history;                   // Last frameLength samples
+    size_t filled;                      // Valid samples in history
+    size_t sinceLastFrame;              // Samples added since the last frame was emitted
+    float lastSample;                   // For pre-emphasis across chunks
+};
+
+// Returns 0 on success, -1 on allocation failure
+int Mfcc_init(struct Mfcc *mfcc, unsigned int sampleRate);
+void Mfcc_destroy(struct Mfcc *mfcc);
+
+// Feeds samples and writes one coefficient vector per completed frame into out.
+// Returns the number of frames written (at most maxFrames; later frames are dropped).
+int Mfcc_process(struct Mfcc *mfcc, const int16_t *samples, size_t count,
+                 float out[][MFCC_NUM_COEFFS], int maxFrames);
+
+#endif // MFCC_H
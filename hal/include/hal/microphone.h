@@ -36,12 +36,19 @@
  // Record for specified duration and return transcription
  char* Microphone_recordAndTranscribe(int durationMs);
  
- // Start the listener thread that monitors for rotary button presses
+ // Start recording on rotary button presses (handled on the reactor thread)
  int Microphone_startButtonListener(void);
  
- // Stop the listener thread
+ // Stop reacting to button presses
  void Microphone_stopButtonListener(void);
  
+ // Start the wake word detector; saying the keyword starts recording like a button press.
+ // Returns -1 when no wake word model is available.
+ int Microphone_startWakeWordListener(void);
+ 
+ // Stop the wake word detector
+ void Microphone_stopWakeWordListener(void);
+ 
  // Register transcription callback
  void Microphone_setTranscriptionCallback(void (*callback)(const char* transcription));
  
@@ -0,0 +1,42 @@
+/**
+ * hal/noise_suppressor.h
+ *
+ * Spectral subtraction for steady background noise (engine, road, fan). Audio is cut into
+ * 50% overlapping square-root-Hann frames; each bin is attenuated by how far it sits above
+ * a running noise estimate, and the frames are overlap-added back together. Output lags
+ * input by one hop.
+ */
+
+#ifndef NOISE_SUPPRESSOR_H
+#define NOISE_SUPPRESSOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "hal/fft.h"
+
+#define NOISE_SUPPRESSOR_FRAME 256
+#define NOISE_SUPPRESSOR_HOP (NOISE_SUPPRESSOR_FRAME / 2)
+
+struct NoiseSuppressor {
+    struct Fft fft;
+    float window[NOISE_SUPPRESSOR_FRAME];
+    float input[NOISE_SUPPRESSOR_FRAME];        // Last full frame of input
+    float overlap[NOISE_SUPPRESSOR_HOP];        // Second half of the previous output frame
+    float noise[NOISE_SUPPRESSOR_FRAME / 2 + 1];
+    float smoothed[NOISE_SUPPRESSOR_FRAME / 2 + 1];
+    float re[NOISE_SUPPRESSOR_FRAME];
+    float im[NOISE_SUPPRESSOR_FRAME];
+    float power[NOISE_SUPPRESSOR_FRAME / 2 + 1];
+    size_t pending;                             // New samples collected toward the next hop
+    int framesSeen;
+};
+
+// Returns 0 on success, -1 on allocation failure
+int NoiseSuppressor_init(struct NoiseSuppressor *ns);
+void NoiseSuppressor_destroy(struct NoiseSuppressor *ns);
+
+// Processes count samples. Output is produced a whole hop at a time, so out must have room
+// for count + NOISE_SUPPRESSOR_HOP samples. Returns the number of samples written.
+size_t NoiseSuppressor_process(struct NoiseSuppressor *ns, const int16_t *in, size_t count, int16_t *out);
+
+#endif // NOISE_SUPPRESSOR_H
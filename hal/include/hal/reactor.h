@@ -0,0 +1,49 @@
+/**
+ * hal/reactor.h
+ *
+ * Single-threaded I/O reactor. Device file descriptors (GPIO line events, the GPS UART)
+ * and periodic timers are registered with one epoll instance, and one thread runs the
+ * handler of whichever becomes ready, instead of every device having its own thread
+ * that blocks, or sleeps and polls. Each periodic timer is a timerfd armed on
+ * CLOCK_MONOTONIC, so its period does not drift with handler run time. An eventfd wakes
+ * the loop for shutdown.
+ *
+ * Handlers run on the reactor thread: they must read what is ready and return quickly,
+ * never block on other I/O.
+ */
+
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdint.h>
+#include <sys/epoll.h>
+
+// Called with the epoll events (EPOLLIN, EPOLLERR, ...) that fired on fd
+typedef void (*ReactorFdHandler)(int fd, uint32_t events, void *context);
+
+// Called once per timer wakeup; expirations > 1 means periods were missed
+typedef void (*ReactorTimerHandler)(uint64_t expirations, void *context);
+
+typedef struct {
+    uint64_t wakeups;           // epoll_wait returns
+    uint64_t dispatches;        // Handler calls
+    long voluntarySwitches;     // Reactor thread context switches (getrusage)
+    long involuntarySwitches;
+    double cpuMs;               // Reactor thread user + system time
+} ReactorStats;
+
+// Start/stop the reactor thread. Call cleanup before closing any registered fd.
+void Reactor_init(void);
+void Reactor_cleanup(void);
+
+// Watch fd for events (usually EPOLLIN) until Reactor_cleanup(). Returns 0 on success, -1 on failure.
+int Reactor_addFd(int fd, uint32_t events, ReactorFdHandler handler, void *context);
+
+// Run handler every periodMs. Returns a timer id (>= 0) or -1 on failure.
+int Reactor_addTimer(long periodMs, ReactorTimerHandler handler, void *context);
+void Reactor_removeTimer(int timerId);
+
+// Wakeup, dispatch and resource statistics for the reactor thread
+ReactorStats Reactor_getStats(void);
+
+#endif // REACTOR_H
@@ -0,0 +1,36 @@
+/**
+ * hal/resampler.h
+ *
+ * Polyphase rational resampler for 16-bit mono audio (e.g. 44.1 kHz -> 16 kHz is
+ * up by 160, down by 441). Only the filter phases that produce an output sample are
+ * evaluated, each as one contiguous dot product.
+ */
+
+#ifndef RESAMPLER_H
+#define RESAMPLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RESAMPLER_TAPS_PER_PHASE 192
+#define RESAMPLER_MAX_BLOCK 1024
+
+struct Resampler {
+    unsigned int up;                // L
+    unsigned int down;              // M
+    float *coeffs;                  // up x RESAMPLER_TAPS_PER_PHASE, each phase reversed
+    float *buffer;                  // TAPS - 1 samples of history + one input block
+    uint64_t position;              // Next output time, in 1/up input samples from the block start
+};
+
+// Returns 0 on success, -1 on allocation failure
+int Resampler_init(struct Resampler *r, unsigned int inRate, unsigned int outRate);
+void Resampler_destroy(struct Resampler *r);
+
+// Largest output count Resampler_process() can produce for count input samples
+size_t Resampler_maxOutput(const struct Resampler *r, size_t count);
+
+// Converts count input samples; returns the number of samples written to out
+size_t Resampler_process(struct Resampler *r, const int16_t *in, size_t count, int16_t *out);
+
+#endif // RESAMPLER_H
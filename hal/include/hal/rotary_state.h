@@ -4,6 +4,7 @@
  * 
  * Unified interface for rotary encoder with push button
  * Handles both rotation (A/B signals) and push button states
+ * Line events are read by the reactor, so no thread polls or blocks on the encoder
  */
 
  #ifndef ROTARY_STATE_H
@@ -13,9 +14,9 @@
  void RotaryState_init(void);
  void RotaryState_cleanup(void);
  
- // State machine processing 
- void RotaryState_doRotaryState(void);  // Process rotary encoder state
- void RotaryState_doPushState(void);    // Process push button state
+ // Edges are handled on the reactor thread (call Reactor_init first). The callback runs
+ // there after each button release, so it must return quickly.
+ void RotaryState_setPushCallback(void (*callback)(void));
  
  // Value getters
  int RotaryState_getRotaryValue(void);  // Get current rotation counter
@@ -0,0 +1,19 @@
+/* speaker.h
+*  This file is part of the audio output module. It keeps an ALSA playback handle open
+*  so that PCM already held in memory can start playing without spawning aplay.
+*/
+#ifndef _SPEAKER_H_
+#define _SPEAKER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Function to initialize/cleanup the speaker module (opens/closes the ALSA playback device).
+void Speaker_init(void);
+void Speaker_cleanup(void);
+
+// Play 16-bit signed mono PCM at the given sample rate. Blocks until playback is finished.
+// Returns 0 on success, -1 on failure.
+int Speaker_playPcm(const int16_t *samples, size_t numSamples, unsigned int sampleRate);
+
+#endif
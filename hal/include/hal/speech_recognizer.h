@@ -0,0 +1,44 @@
+/**
+ * hal/speech_recognizer.h
+ *
+ * Streaming speech recognition interface. Audio is fed in chunks while the user is
+ * still talking, so by the time the VAD reports end of speech the engine has already
+ * processed almost all of it and only the final result remains to be collected.
+ *
+ * Engines:
+ *  - "vosk":   offline, on-device recognizer (built when libvosk is available)
+ *  - "google": my_speech.py started at the beginning of the utterance and fed a FLAC
+ *              stream over stdin (--flac RATE -); used when no offline engine is available
+ */
+
+#ifndef SPEECH_RECOGNIZER_H
+#define SPEECH_RECOGNIZER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct SpeechRecognizer {
+    const char *name;
+
+    // Prepare a new utterance of 16-bit mono audio. Returns 0 on success.
+    int (*begin)(unsigned int sampleRate);
+
+    // Feed the next chunk of audio. Must not block for long; called from the capture consumer.
+    void (*feed)(const int16_t *samples, size_t count);
+
+    // No more audio: return the final transcript (caller frees), or NULL on failure
+    char *(*finish)(void);
+
+    // Drop the current utterance without producing a result
+    void (*abort)(void);
+};
+
+extern const struct SpeechRecognizer SpeechRecognizer_google;
+#ifdef HAVE_VOSK
+extern const struct SpeechRecognizer SpeechRecognizer_vosk;
+#endif
+
+// Picks the best available engine (offline first). Returns the same engine on every call.
+const struct SpeechRecognizer *SpeechRecognizer_getDefault(void);
+
+#endif // SPEECH_RECOGNIZER_H
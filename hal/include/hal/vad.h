@@ -0,0 +1,64 @@
+/**
+ * hal/vad.h
+ *
+ * Frame-based voice activity detector. Each 10 ms frame is classified from its pre-emphasized
+ * energy, averaged over the last few frames, relative to an adaptive noise floor, and from
+ * its zero-crossing rate, with an onset delay
+ * and a hangover so short pauses between words do not end the utterance.
+ */
+
+#ifndef VAD_H
+#define VAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define VAD_MAX_FRAME_SAMPLES 512
+#define VAD_SMOOTH_FRAMES 3
+
+typedef enum {
+    VAD_EVENT_NONE,
+    VAD_EVENT_SPEECH_START,
+    VAD_EVENT_SPEECH_END,
+} VadEvent;
+
+struct Vad {
+    size_t frameSamples;                 // Samples per 10 ms frame
+    int onsetFrames;                     // Consecutive speech frames needed to start
+    int hangoverFrames;                  // Consecutive non-speech frames needed to end
+    double minEnergy;                    // Absolute floor below which nothing is speech
+    double noiseFloor;                   // Adaptive estimate of background (emphasized) energy
+    double recent[VAD_SMOOTH_FRAMES];    // Emphasized energy of the last frames
+    int framesSeen;
+    int speechRun;
+    int silenceRun;
+    bool inSpeech;
+    int16_t pending[VAD_MAX_FRAME_SAMPLES];
+    size_t pendingCount;
+};
+
+// hangoverMs: how long speech must be absent before VAD_EVENT_SPEECH_END is reported
+void Vad_init(struct Vad *vad, unsigned int sampleRate, int hangoverMs);
+
+// Minimum level that can count as speech, as the RMS of the pre-emphasized signal (the old
+// SOUND_THRESHOLD, which was a mean absolute amplitude, keeps its default of 50)
+void Vad_setMinLevel(struct Vad *vad, int level);
+
+// Feed any number of samples. Returns the last event produced by the frames completed in this call.
+VadEvent Vad_process(struct Vad *vad, const int16_t *samples, size_t count);
+
+bool Vad_isSpeech(const struct Vad *vad);
+
+// Seeds the noise floor from audio heard just before the recording (for example what the
+// ring still holds before the start position), so speech in the first frames is not taken
+// for background. Returns false if count is too short, in which case the first frames of
+// the recording seed the floor as usual. Call right after Vad_init().
+bool Vad_seedNoiseFloor(struct Vad *vad, const int16_t *samples, size_t count);
+
+// Per-frame features, exposed so they can be reused by other audio stages: mean square,
+// mean square after pre-emphasis (x[n] - 0.95 x[n-1]) and zero-crossing rate
+void Vad_frameFeatures(const int16_t *frame, size_t count, double *energy, double *emphasizedEnergy,
+                       double *zeroCrossRate);
+
+#endif // VAD_H
@@ -0,0 +1,39 @@
+/**
+ * hal/wake_word.h
+ *
+ * Always-on keyword spotter for hands-free voice commands. A background thread reads the
+ * capture ring, turns it into MFCC frames and runs a small int8 network over the most
+ * recent frames every 30 ms. When the smoothed keyword score crosses the threshold the
+ * registered callback fires. It listens to the 16 kHz output of the DSP stage.
+ *
+ * The network is loaded from a file (WAKE_WORD_MODEL, default "wakeword.kws"), little endian:
+ *   "KWS1", uint16 contextFrames, uint16 numCoeffs, uint16 numLayers,
+ *   float mean[numCoeffs], float invStd[numCoeffs], float inputScale,
+ *   then per layer: uint16 inputs, uint16 outputs, uint8 relu, float weightScale,
+ *   float outputScale, int32 bias[outputs], int8 weights[outputs][inputs]
+ * The last layer has two outputs: background and keyword.
+ */
+
+#ifndef WAKE_WORD_H
+#define WAKE_WORD_H
+
+// Target share of one A53 core for the detector; exceeding it is reported
+#define WAKE_WORD_CPU_BUDGET_PERCENT 5.0
+
+struct WakeWordStats {
+    long frames;            // MFCC frames processed
+    long evaluations;       // Network runs
+    int detections;
+    double avgFrameUs;      // CPU time per 10 ms frame, including its share of inference
+    double maxFrameUs;
+    double cpuPercent;      // CPU time / audio time
+};
+
+// Loads the model and starts the detector thread. Returns 0 on success, or -1 when no
+// usable model is found, in which case the detector stays off.
+int WakeWord_init(void (*onWake)(void));
+void WakeWord_cleanup(void);
+
+struct WakeWordStats WakeWord_getStats(void);
+
+#endif // WAKE_WORD_H
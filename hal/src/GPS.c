@@ -15,52 +15,63 @@
 #include <assert.h>
 #include "hal/GPS.h"
 #include "stdbool.h"
+#include "hal/reactor.h"
 #include "sleep_and_timer.h"
+#include "eventBus.h"
 
 #define BUFFER_SIZE 255
 #define DEGREE_FACTOR 100
 #define MINUTES_IN_DEGREE 60.0
 #define KNOTS_TO_KMH 1.852
+#define DEMO_PERIOD_MS 500
 
 int serial_port;
-static pthread_t gps_thread;
 static pthread_mutex_t gps_mutex = PTHREAD_MUTEX_INITIALIZER;  // Mutex to protect current_location
 static struct location current_location = {INVALID_LATITUDE, INVALID_LONGITUDE, INVALID_SPEED};  // Default invalid location
-static bool isRunning = false;
 static bool signal = false;
 static bool isInitialized = false;
-static char* GPS_read();
 static struct location parse_GNRMC(char* gprmc_sentence);
 
-// Function that runs in the thread to continuously read GPS data
-static void* gps_thread_func(void* arg) {
-    (void)arg;
-    assert(isInitialized);
-    while (isRunning) {
-        // Get the latest GPS data
-        char* gps_data = GPS_read();
-        // Parse the data into the location structure
-        struct location new_location = parse_GNRMC(gps_data);
-
-        // Update the global location safely using mutex
-        pthread_mutex_lock(&gps_mutex);   // Lock the mutex before updating
-        current_location = new_location;
-        if (current_location.latitude == INVALID_LATITUDE) {
-            signal = false;
-            // printf("NO GPS Signal !\n");
-        } else {
-            // printf("Current_location: Latitude %.6f, Longitude: %.6f, Speed: %.6f \n", current_location.latitude, current_location.longitude, current_location.speed);
-            signal = true;
-        }
-        pthread_mutex_unlock(&gps_mutex); // Unlock the mutex after updating
-        
-        sleepForMs(100);  // Sleep for 100ms before reading again
+// Let the subscribers react to the new reading instead of polling GPS_getLocation()
+static void publish_fix(struct location location) {
+    struct Event event = {.topic = EVENT_FIX};
+    event.fix.location = location;
+    event.fix.valid = location.latitude != INVALID_LATITUDE;
+    EventBus_publish(&event);
+}
+
+// Called on the reactor thread when the UART has a line waiting (canonical mode: one sentence per read)
+static void on_serial_readable(int fd, uint32_t events, void *context) {
+    (void)events;
+    (void)context;
+    char read_buf[BUFFER_SIZE];
+    int n = read(fd, read_buf, sizeof(read_buf) - 1); // Leave space for null terminator
+    if (n <= 0) {
+        return;
+    }
+    read_buf[n] = '\0'; // Properly terminate the string
+    // Only $GNRMC messages include the location data and speed
+    if (strncmp(read_buf, "$GNRMC", 6) != 0) {
+        return;
+    }
+    // Parse the data into the location structure
+    struct location new_location = parse_GNRMC(read_buf);
+
+    // Update the global location safely using mutex
+    pthread_mutex_lock(&gps_mutex);   // Lock the mutex before updating
+    current_location = new_location;
+    if (current_location.latitude == INVALID_LATITUDE) {
+        signal = false;
+        // printf("NO GPS Signal !\n");
+    } else {
+        // printf("Current_location: Latitude %.6f, Longitude: %.6f, Speed: %.6f \n", current_location.latitude, current_location.longitude, current_location.speed);
+        signal = true;
     }
-    return NULL;
+    pthread_mutex_unlock(&gps_mutex); // Unlock the mutex after updating
+    publish_fix(new_location);
 }
 
 void GPS_init() {
-    isRunning = true;
     serial_port = open("/dev/ttyAMA0", O_RDWR);
     if (serial_port < 0) {
         printf("Error %i from open: %s\n", errno, strerror(errno));
@@ -97,38 +108,42 @@ void GPS_init() {
         return;
     }
     isInitialized = true;
-    // Create the GPS thread that will continuously read and update the location
-    pthread_create(&gps_thread, NULL, gps_thread_func, NULL);
+    // The reactor reads each sentence as it arrives (call Reactor_init first)
+    if (Reactor_addFd(serial_port, EPOLLIN, on_serial_readable, NULL) != 0) {
+        printf("Error: GPS serial port cannot be watched\n");
+    }
 }
 
-// Using for Demo purpose
-static void* gps_thread2_func(void* arg) {
-    (void)arg;
-    while (isRunning) {
-        pthread_mutex_lock(&gps_mutex);   // Lock the mutex before updating
-        FILE* file = fopen("demo_gps.txt", "r");
-        if (file == NULL) {
-            perror("Failed to open file");
-            return 0; // failure
-        }
-
-        if (fscanf(file, "%lf %lf %lf", &current_location.latitude, &current_location.longitude, &current_location.speed) != 3) {
-            fprintf(stderr, "Invalid file format. Expected 3 numbers.\n");
-            fclose(file);
-            return 0; // failure
-        }
-        // printf("Demo: Current lat=%.6f, lon=%.6ff, spd=%.6f\n", current_location.latitude, current_location.longitude, current_location.speed);
-        pthread_mutex_unlock(&gps_mutex); // Unlock the mutex after updating
-        sleepForMs(500);
+// Using for Demo purpose: called on the reactor thread every DEMO_PERIOD_MS
+static void on_demo_timer(uint64_t expirations, void *context) {
+    (void)expirations;
+    (void)context;
+    FILE* file = fopen("demo_gps.txt", "r");
+    if (file == NULL) {
+        perror("Failed to open file");
+        return;
     }
-    return NULL;
+
+    struct location demo_location;
+    if (fscanf(file, "%lf %lf %lf", &demo_location.latitude, &demo_location.longitude, &demo_location.speed) != 3) {
+        fprintf(stderr, "Invalid file format. Expected 3 numbers.\n");
+        fclose(file);
+        return;
+    }
+    fclose(file);
+    // printf("Demo: Current lat=%.6f, lon=%.6ff, spd=%.6f\n", demo_location.latitude, demo_location.longitude, demo_location.speed);
+    pthread_mutex_lock(&gps_mutex);   // Lock the mutex before updating
+    current_location = demo_location;
+    pthread_mutex_unlock(&gps_mutex); // Unlock the mutex after updating
+    publish_fix(demo_location);
 }
 
 // For demo using to read geolocation data from demo_gps.txt
 void GPS_demoInit() {
     signal = true;
-    isRunning = true;
-    pthread_create(&gps_thread, NULL, gps_thread2_func, NULL);
+    if (Reactor_addTimer(DEMO_PERIOD_MS, on_demo_timer, NULL) < 0) {
+        printf("Error: GPS demo timer unavailable\n");
+    }
 }
 
 
@@ -141,23 +156,6 @@ struct location GPS_getLocation() {
     return loc;  // Return the most recent GPS location
 }
 
-// Stati function to read GPS data from the serial port. This function only stop when finds a $GNRMC message (which include the location data and speed)
-static char* GPS_read() {
-    static char read_buf[BUFFER_SIZE];
-    while (isRunning) {  // Keep reading until we find a $GNGGA message
-        int n = read(serial_port, &read_buf, sizeof(read_buf)); // Leave space for null terminator
-        if (n > 0) {
-            read_buf[n] = '\0'; // Properly terminate the string
-            // Check if the received message starts with "$GNRMC"
-            if (strncmp(read_buf, "$GNRMC", 5) == 0) {
-                return read_buf;
-            }
-        }
-        sleepForMs(100);
-    }
-    return "";
-}
-
 // Function to parse the GNRMC sentence and extract latitude, longitude, and speed
 static struct location parse_GNRMC(char* gnrmc_sentence) {
     char *token;
@@ -217,10 +215,9 @@ static struct location parse_GNRMC(char* gnrmc_sentence) {
     return data;
 }
 
+// Call after Reactor_cleanup(), which stops the handlers
 void GPS_cleanup() {
-    isRunning = false;  
     isInitialized = false;  
-    pthread_cancel(gps_thread); 
     close(serial_port);
     printf("GPS cleanup\n");
 }
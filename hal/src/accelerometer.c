@@ -2,26 +2,33 @@
  * 
  * This file provides a HAL for interfacing with an
  * accelerometer over I2C using the existing I2C functions.
+ *
+ * The setup the board has always used (full scale in CTRL6, 14-bit left-justified output,
+ * 4096 counts per g) is the LIS2DW12 register map, so the FIFO is driven the LIS2DW12 way:
+ * FIFO_CTRL selects stream mode, FIFO_SAMPLES counts the unread samples, and a burst read
+ * from OUT_X_L returns one sample after another. The drain task runs on the scheduler
+ * thread, like the parking task that reads the joystick ADC on the same bus.
  */
 
 #include "hal/accelerometer.h"
 #include "hal/i2c.h"
-#include "sleep_and_timer.h"
+#include "scheduler.h"
 
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <inttypes.h> 
 #include <pthread.h>
+#include <stdatomic.h>
 #include <assert.h>
-#include <unistd.h>
-#include <math.h>
+#include <time.h>
 
 #define I2C_BUS "/dev/i2c-1"
 #define ACCEL_I2C_ADDRESS 0x19
 
-// Register addresses (example for an LIS3DH accelerometer)
+// Register addresses
 #define REG_WHO_AM_I 0x0F   // WHO_AM_I register address
 
 #define REG_CTRL1  0x20
@@ -31,6 +38,7 @@
 #define REG_CTRL5  0x24
 #define REG_CTRL6  0x25
 #define REG_FIFO_CTRL 0x2E
+#define REG_FIFO_SAMPLES 0x2F
 
 #define REG_OUT_X_L 0x28
 #define REG_OUT_X_H 0x29
@@ -39,47 +47,178 @@
 #define REG_OUT_Z_L 0x2C
 #define REG_OUT_Z_H 0x2D
 
+#define CTRL1_400HZ_HIGH_PERFORMANCE 0x77   // ODR 400 Hz, high-performance (14-bit)
+#define CTRL2_BDU_AUTO_INCREMENT 0x0C       // Block data update, register address auto increment
+#define CTRL6_2G 0x00
+#define FIFO_MODE_BYPASS 0x00
+#define FIFO_MODE_STREAM 0xC0               // Oldest samples are overwritten when full
+#define FIFO_SAMPLES_COUNT 0x3F
+#define FIFO_SAMPLES_OVERRUN 0x40
+#define FIFO_DEPTH 32
+#define FIFO_WATERMARK 16
+
+// Samples the ring can hand out; the slots of the oldest FIFO_DEPTH may be mid-rewrite
+#define SAFE_SAMPLES (ACCELEROMETER_RING_SAMPLES - FIFO_DEPTH)
+
+#define BYTES_PER_SAMPLE 6
 #define SENSITIVITY_2G 4096.0  // Sensitivity for ±2g range (14-bit resolution)
+#define SAMPLE_PERIOD_NS (1000000000LL / ACCELEROMETER_ODR_HZ)
+
+// The FIFO reaches the watermark in 40 ms and overflows in 80 ms; draining every 20 ms
+// keeps bursts short and leaves room for a late run
+#define DRAIN_PERIOD_MS 20
+#define DRAIN_SLACK_MS 5
+
+#define RING_MASK (ACCELEROMETER_RING_SAMPLES - 1)
 
 static int i2c_file_desc = -1;
 static bool isInitialized = false;
-static volatile bool keepReading = false;
-// static pthread_t accelerometer_thread;
+static int drainTask = -1;
+static pthread_mutex_t drainMutex = PTHREAD_MUTEX_INITIALIZER;
+
+// Single writer (the drain); readers copy and then check the head to see if the writer
+// lapped them meanwhile
+static AccelerometerSample ring[ACCELEROMETER_RING_SAMPLES];
+static atomic_uint_fast64_t head = 0;   // Samples ever stored
+static AccelerometerStats stats;
 
 //PROTOTYPES
-void Accelerometer_initialize(void);
-void Accelerometer_cleanUp(void);
-void *Accelerometer_thread_func(void *arg);
-AccelerometerData Accelerometer_getReading(void);
+static void drain_fifo(void *context);
+
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static double to_g(const uint8_t *raw) {
+    int16_t value = (int16_t)((raw[1] << 8) | raw[0]) >> 2;
+    return value / SENSITIVITY_2G;
+}
 
 void Accelerometer_initialize(void) {
+    assert(!isInitialized);
     i2c_file_desc = init_i2c_bus(I2C_BUS, ACCEL_I2C_ADDRESS);
+    memset(&stats, 0, sizeof(stats));
+    atomic_store(&head, 0);
+    write_i2c_reg8(i2c_file_desc, REG_CTRL1, CTRL1_400HZ_HIGH_PERFORMANCE);
+    write_i2c_reg8(i2c_file_desc, REG_CTRL2, CTRL2_BDU_AUTO_INCREMENT);
+    write_i2c_reg8(i2c_file_desc, REG_CTRL6, CTRL6_2G); //+2g
+    // Restart the FIFO from empty
+    write_i2c_reg8(i2c_file_desc, REG_FIFO_CTRL, FIFO_MODE_BYPASS);
+    write_i2c_reg8(i2c_file_desc, REG_FIFO_CTRL, FIFO_MODE_STREAM | FIFO_WATERMARK);
     isInitialized = true;
-    keepReading = true;
-    write_i2c_reg8(i2c_file_desc, REG_CTRL1, 0x97);  //100Hz, (High)14-bit resolution, (Low)14-bit resolution 
-    write_i2c_reg8(i2c_file_desc, REG_CTRL6, 0x00); //+2g
+
+    // Have a sample in the ring before anyone asks for one
+    struct timespec firstSample = {0, 2 * SAMPLE_PERIOD_NS};
+    nanosleep(&firstSample, NULL);
+    drain_fifo(NULL);
+    drainTask = Scheduler_addPeriodic("accelerometer", DRAIN_PERIOD_MS, DRAIN_SLACK_MS, drain_fifo, NULL);
 }
 
 void Accelerometer_cleanUp(void) {
-    keepReading = false;
+    assert(isInitialized);
+    Scheduler_remove(drainTask);
+    drainTask = -1;
+    write_i2c_reg8(i2c_file_desc, REG_FIFO_CTRL, FIFO_MODE_BYPASS);
+    AccelerometerStats s = Accelerometer_getStats();
+    printf("Accelerometer: %" PRIu64 " samples in %" PRIu64 " bursts (max %d), %" PRIu64 " FIFO overruns\n",
+           s.samples, s.drains, s.maxBurst, s.overruns);
     isInitialized = false;
 }
 
+// Scheduler task: moves everything in the FIFO into the ring with one status read and
+// one burst
+static void drain_fifo(void *context) {
+    (void)context;
+    pthread_mutex_lock(&drainMutex);
+    uint8_t status = read_i2c_reg8(i2c_file_desc, REG_FIFO_SAMPLES);
+    int count = status & FIFO_SAMPLES_COUNT;
+    if (count > FIFO_DEPTH) {
+        count = FIFO_DEPTH;
+    }
+    if (status & FIFO_SAMPLES_OVERRUN) {
+        stats.overruns++;
+    }
+    if (count == 0) {
+        pthread_mutex_unlock(&drainMutex);
+        return;
+    }
+
+    uint8_t raw[FIFO_DEPTH * BYTES_PER_SAMPLE];
+    read_i2c_burst(i2c_file_desc, REG_OUT_X_L, raw, count * BYTES_PER_SAMPLE);
+    // The last sample is the one the sensor took most recently
+    uint64_t newestNs = now_ns();
+    uint64_t first = atomic_load_explicit(&head, memory_order_relaxed);
+    for (int i = 0; i < count; i++) {
+        AccelerometerSample *sample = &ring[(first + i) & RING_MASK];
+        const uint8_t *bytes = &raw[i * BYTES_PER_SAMPLE];
+        sample->timestampNs = newestNs - (uint64_t)(count - 1 - i) * SAMPLE_PERIOD_NS;
+        sample->data.x = to_g(&bytes[0]);
+        sample->data.y = to_g(&bytes[2]);
+        sample->data.z = to_g(&bytes[4]);
+    }
+    atomic_store_explicit(&head, first + count, memory_order_release);
+
+    stats.samples += count;
+    stats.drains++;
+    if (count > stats.maxBurst) {
+        stats.maxBurst = count;
+    }
+    pthread_mutex_unlock(&drainMutex);
+}
+
+int Accelerometer_readSamples(uint64_t *cursor, AccelerometerSample *samples, int max) {
+    assert(isInitialized);
+    uint64_t end = atomic_load_explicit(&head, memory_order_acquire);
+    uint64_t start = *cursor;
+    if (start > end || end - start > SAFE_SAMPLES) {
+        start = end > SAFE_SAMPLES ? end - SAFE_SAMPLES : 0;
+    }
+    if (end - start > (uint64_t)max) {
+        end = start + max;
+    }
+    int count = (int)(end - start);
+    for (int i = 0; i < count; i++) {
+        samples[i] = ring[(start + i) & RING_MASK];
+    }
+
+    // Drop whatever the drain may have overwritten while we copied: the slot of sample n is
+    // reused by sample n + ACCELEROMETER_RING_SAMPLES, and a drain writes up to FIFO_DEPTH
+    // samples before it moves the head
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t written = atomic_load_explicit(&head, memory_order_relaxed);
+    int lost = 0;
+    if (written > start + SAFE_SAMPLES) {
+        uint64_t overwritten = written - SAFE_SAMPLES - start;
+        lost = overwritten < (uint64_t)count ? (int)overwritten : count;
+        memmove(samples, samples + lost, (count - lost) * sizeof(samples[0]));
+    }
+    *cursor = start + count;
+    return count - lost;
+}
 
 AccelerometerData Accelerometer_getReading(void) {
     if (!isInitialized) {
         fprintf(stderr, "Error: Accelerometer not initialized!\n");
         exit(EXIT_FAILURE);
     }
+    uint64_t newest = atomic_load_explicit(&head, memory_order_acquire);
+    if (newest == 0) {
+        AccelerometerData none = {0, 0, 0};
+        return none;
+    }
+    AccelerometerSample sample;
+    uint64_t cursor = newest - 1;
+    while (Accelerometer_readSamples(&cursor, &sample, 1) != 1) {
+        cursor = atomic_load_explicit(&head, memory_order_acquire) - 1;   // Lapped; take the new newest
+    }
+    return sample.data;
+}
 
-    uint8_t raw_data[6];
-    read_i2c_burst(i2c_file_desc, REG_OUT_X_L, raw_data, 6);
-
-    int16_t x = (int16_t)((raw_data[1] << 8) | raw_data[0]) >> 2;
-    int16_t y = (int16_t)((raw_data[3] << 8) | raw_data[2]) >> 2;
-    int16_t z = (int16_t)((raw_data[5] << 8) | raw_data[4]) >> 2;
-
-    sleepForMs(10);
-    AccelerometerData data = {x / SENSITIVITY_2G, y / SENSITIVITY_2G, z / SENSITIVITY_2G};
-    return data;
+AccelerometerStats Accelerometer_getStats(void) {
+    pthread_mutex_lock(&drainMutex);
+    AccelerometerStats s = stats;
+    pthread_mutex_unlock(&drainMutex);
+    return s;
 }
@@ -0,0 +1,114 @@
+/**
+ * hal/agc.c
+ *
+ * Implementation of the automatic gain control. Level measurement and gain application
+ * are the per-sample work and both have NEON paths.
+ */
+
+#include "hal/agc.h"
+
+#include <math.h>
+#include <stdbool.h>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define AGC_BLOCK_MS 10
+#define AGC_TARGET_RMS 3000.0f          // About -20 dBFS
+#define AGC_MAX_GAIN 16.0f              // +24 dB
+#define AGC_MIN_GAIN 0.25f
+#define AGC_ATTACK 0.5f                 // Share of the way to the wanted gain per block when lowering
+#define AGC_RELEASE 0.02f               // ... and when raising
+#define AGC_SPEECH_OVER_NOISE 3.0f      // The gain holds while the smoothed level is below this times the noise
+#define AGC_LEVEL_SMOOTHING 0.15f       // Weight of the new block in the smoothed level (~60 ms)
+#define AGC_SEED_BLOCKS 10              // Blocks averaged to seed the noise level
+#define AGC_NOISE_FALL 0.03f
+#define AGC_NOISE_RISE 0.003f
+
+void Agc_init(struct Agc *agc, unsigned int sampleRate) {
+    agc->blockSamples = sampleRate * AGC_BLOCK_MS / 1000;
+    agc->gain = 1.0f;
+    agc->noiseLevel = 0.0f;
+    agc->smoothedLevel = 0.0f;
+    agc->blocksSeen = 0;
+}
+
+static float block_rms(const int16_t *samples, size_t count) {
+    int64_t sum = 0;
+    size_t i = 0;
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    int64x2_t acc = vdupq_n_s64(0);
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t v = vld1q_s16(samples + i);
+        int32x4_t sq = vmull_s16(vget_low_s16(v), vget_low_s16(v));
+        sq = vmlal_high_s16(sq, v, v);
+        acc = vpadalq_s32(acc, sq);
+    }
+    sum = vaddvq_s64(acc);
+#endif
+    for (; i < count; i++) {
+        sum += (int32_t)samples[i] * samples[i];
+    }
+    return count > 0 ? sqrtf((float)sum / count) : 0.0f;
+}
+
+// Multiplies by a gain ramping linearly from start to end
+static void apply_gain(int16_t *samples, size_t count, float start, float end) {
+    float step = (end - start) / count;
+    size_t i = 0;
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    float32x4_t gain = {start, start + step, start + 2 * step, start + 3 * step};
+    float32x4_t gainStep = vdupq_n_f32(4 * step);
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t x = vcvtq_f32_s32(vmovl_s16(vld1_s16(samples + i)));
+        int32x4_t y = vcvtnq_s32_f32(vmulq_f32(x, gain));
+        vst1_s16(samples + i, vqmovn_s32(y));
+        gain = vaddq_f32(gain, gainStep);
+    }
+#endif
+    for (; i < count; i++) {
+        float y = samples[i] * (start + step * i);
+        samples[i] = y > 32767.0f ? 32767 : y < -32768.0f ? -32768 : (int16_t)lrintf(y);
+    }
+}
+
+void Agc_process(struct Agc *agc, int16_t *samples, size_t count) {
+    while (count > 0) {
+        size_t block = count < agc->blockSamples ? count : agc->blockSamples;
+        float rms = block_rms(samples, block);
+
+        // Track the noise on a smoothed level: single blocks of residual noise vary too much,
+        // and a floor set by the quietest one makes ordinary noise look like speech
+        if (agc->blocksSeen == 0) {
+            agc->smoothedLevel = rms;
+        } else {
+            agc->smoothedLevel += AGC_LEVEL_SMOOTHING * (rms - agc->smoothedLevel);
+        }
+        if (agc->blocksSeen < AGC_SEED_BLOCKS) {
+            agc->noiseLevel += agc->smoothedLevel / AGC_SEED_BLOCKS;
+            agc->blocksSeen++;
+        } else if (agc->smoothedLevel < agc->noiseLevel) {
+            agc->noiseLevel += AGC_NOISE_FALL * (agc->smoothedLevel - agc->noiseLevel);
+        } else {
+            agc->noiseLevel += AGC_NOISE_RISE * (agc->smoothedLevel - agc->noiseLevel);
+        }
+
+        float start = agc->gain;
+        bool seeded = agc->blocksSeen >= AGC_SEED_BLOCKS;
+        if (seeded && agc->smoothedLevel > AGC_SPEECH_OVER_NOISE * agc->noiseLevel && rms > 0) {
+            float wanted = AGC_TARGET_RMS / rms;
+            wanted = wanted > AGC_MAX_GAIN ? AGC_MAX_GAIN : wanted < AGC_MIN_GAIN ? AGC_MIN_GAIN : wanted;
+            float rate = wanted < agc->gain ? AGC_ATTACK : AGC_RELEASE;
+            agc->gain += rate * (wanted - agc->gain);
+        }
+        // Keep about 10 dB of headroom over the block level so a sudden loud block is cut at once
+        float peakSafe = rms > 0 ? 32767.0f / (rms * 3.0f) : AGC_MAX_GAIN;
+        if (agc->gain > peakSafe) {
+            agc->gain = peakSafe;
+        }
+        apply_gain(samples, block, start, agc->gain);
+        samples += block;
+        count -= block;
+    }
+}
@@ -0,0 +1,122 @@
+/**
+ * hal/audio_capture.c
+ *
+ * Implementation of the ALSA capture thread. Replaces the old
+ * `arecord | tee fifo > output.wav` pipeline: samples go straight from the
+ * driver into the ring buffer without touching a FIFO or the filesystem.
+ */
+
+#include "hal/audio_capture.h"
+#include "threadConfig.h"
+
+#include <alsa/asoundlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <assert.h>
+#include <time.h>
+
+#define CAPTURE_DEVICE "plughw:2,0"     // USB microphone (same card arecord used)
+#define CAPTURE_RATE 44100
+#define CAPTURE_PERIOD_FRAMES 441       // 10 ms per read
+#define CAPTURE_LATENCY_US 20000
+#define CAPTURE_RING_SAMPLES (CAPTURE_RATE * 4)  // ~4 seconds of history
+
+static snd_pcm_t *pcm_handle = NULL;
+static struct AudioRing capture_ring;
+static pthread_t capture_thread;
+static volatile bool isRunning = false;
+static bool isInitialized = false;
+static struct timespec open_time;
+static _Atomic long first_byte_latency_us = -1;
+
+static long elapsed_us(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1000000L + (end->tv_nsec - start->tv_nsec) / 1000L;
+}
+
+static void *capture_thread_func(void *arg) {
+    (void)arg;
+    int16_t period[CAPTURE_PERIOD_FRAMES];
+
+    while (isRunning) {
+        snd_pcm_sframes_t frames = snd_pcm_readi(pcm_handle, period, CAPTURE_PERIOD_FRAMES);
+        if (frames < 0) {
+            // Overrun (the thread was starved) or suspend: recover and keep capturing
+            if (snd_pcm_recover(pcm_handle, (int)frames, 1) < 0) {
+                fprintf(stderr, "AudioCapture: read failed: %s\n", snd_strerror((int)frames));
+                break;
+            }
+            continue;
+        }
+        if (frames == 0) {
+            continue;
+        }
+
+        if (first_byte_latency_us < 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            first_byte_latency_us = elapsed_us(&open_time, &now);
+            printf("AudioCapture: first samples after %ld us\n", (long)first_byte_latency_us);
+        }
+        AudioRing_write(&capture_ring, period, (size_t)frames);
+    }
+    return NULL;
+}
+
+void AudioCapture_init(void) {
+    assert(!isInitialized);
+    AudioRing_init(&capture_ring, CAPTURE_RING_SAMPLES, CAPTURE_PERIOD_FRAMES);
+
+    clock_gettime(CLOCK_MONOTONIC, &open_time);
+    int err = snd_pcm_open(&pcm_handle, CAPTURE_DEVICE, SND_PCM_STREAM_CAPTURE, 0);
+    if (err < 0) {
+        fprintf(stderr, "AudioCapture: unable to open %s: %s\n", CAPTURE_DEVICE, snd_strerror(err));
+        pcm_handle = NULL;
+        isInitialized = true;
+        return;
+    }
+    err = snd_pcm_set_params(pcm_handle, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED,
+                             1, CAPTURE_RATE, 1, CAPTURE_LATENCY_US);
+    if (err < 0) {
+        fprintf(stderr, "AudioCapture: unable to configure %s: %s\n", CAPTURE_DEVICE, snd_strerror(err));
+        snd_pcm_close(pcm_handle);
+        pcm_handle = NULL;
+        isInitialized = true;
+        return;
+    }
+
+    isRunning = true;
+    isInitialized = true;
+    if (ThreadConfig_create(&capture_thread, "audio-capture", capture_thread_func, NULL) != 0) {
+        perror("Failed to create capture thread");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void AudioCapture_cleanup(void) {
+    assert(isInitialized);
+    if (pcm_handle) {
+        isRunning = false;
+        // Abort a blocked snd_pcm_readi() so the thread can exit
+        snd_pcm_drop(pcm_handle);
+        pthread_join(capture_thread, NULL);
+        snd_pcm_close(pcm_handle);
+        pcm_handle = NULL;
+    }
+    AudioRing_destroy(&capture_ring);
+    isInitialized = false;
+}
+
+struct AudioRing* AudioCapture_getRing(void) {
+    assert(isInitialized);
+    return &capture_ring;
+}
+
+unsigned int AudioCapture_getSampleRate(void) {
+    return CAPTURE_RATE;
+}
+
+long AudioCapture_getFirstByteLatencyUs(void) {
+    return first_byte_latency_us;
+}
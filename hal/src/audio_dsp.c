@@ -0,0 +1,110 @@
+/**
+ * hal/audio_dsp.c
+ *
+ * Implementation of the front-end DSP stage: resampler -> noise suppressor -> AGC.
+ * Noise is removed before the AGC so the gain is never raised to lift the background.
+ */
+
+#include "hal/audio_dsp.h"
+#include "hal/audio_capture.h"
+#include "hal/resampler.h"
+#include "hal/noise_suppressor.h"
+#include "hal/agc.h"
+#include "threadConfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <assert.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#define DSP_READ_SAMPLES 441                    // 10 ms of capture per block
+#define DSP_RING_SAMPLES (AUDIO_DSP_RATE * 4)   // ~4 seconds of history
+#define DSP_STATS_BLOCKS 6000                   // Report once a minute
+
+static struct AudioRing dsp_ring;
+static struct Resampler resampler;
+static struct NoiseSuppressor suppressor;
+static struct Agc agc;
+static pthread_t dsp_thread;
+static volatile bool isRunning = false;
+static bool isInitialized = false;
+static _Atomic long total_block_ns = 0;
+static _Atomic long total_blocks = 0;
+
+static void *dsp_thread_func(void *arg) {
+    (void)arg;
+    struct AudioRingReader reader;
+    AudioRing_openReader(AudioCapture_getRing(), &reader);
+
+    int16_t raw[DSP_READ_SAMPLES];
+    int16_t resampled[DSP_READ_SAMPLES];
+    int16_t cleaned[DSP_READ_SAMPLES + NOISE_SUPPRESSOR_HOP];
+
+    while (isRunning) {
+        size_t count = AudioRing_readWait(&reader, raw, DSP_READ_SAMPLES, 100);
+        if (count == 0) {
+            continue;
+        }
+        struct timespec start, end;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &start);
+
+        size_t n = Resampler_process(&resampler, raw, count, resampled);
+        n = NoiseSuppressor_process(&suppressor, resampled, n, cleaned);
+        Agc_process(&agc, cleaned, n);
+        if (n > 0) {
+            AudioRing_write(&dsp_ring, cleaned, n);
+        }
+
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &end);
+        total_block_ns += (end.tv_sec - start.tv_sec) * 1000000000L + (end.tv_nsec - start.tv_nsec);
+        if (++total_blocks % DSP_STATS_BLOCKS == 0) {
+            printf("AudioDsp: %.1f us per 10 ms block\n", AudioDsp_getAvgBlockUs());
+        }
+    }
+    return NULL;
+}
+
+void AudioDsp_init(void) {
+    assert(!isInitialized);
+    AudioRing_init(&dsp_ring, DSP_RING_SAMPLES, DSP_READ_SAMPLES + NOISE_SUPPRESSOR_HOP);
+    if (Resampler_init(&resampler, AudioCapture_getSampleRate(), AUDIO_DSP_RATE) != 0 ||
+        NoiseSuppressor_init(&suppressor) != 0) {
+        perror("AudioDsp: init");
+        exit(EXIT_FAILURE);
+    }
+    Agc_init(&agc, AUDIO_DSP_RATE);
+    total_block_ns = 0;
+    total_blocks = 0;
+    isRunning = true;
+    isInitialized = true;
+    if (ThreadConfig_create(&dsp_thread, "audio-dsp", dsp_thread_func, NULL) != 0) {
+        perror("Failed to create audio DSP thread");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void AudioDsp_cleanup(void) {
+    assert(isInitialized);
+    isRunning = false;
+    pthread_join(dsp_thread, NULL);
+    Resampler_destroy(&resampler);
+    NoiseSuppressor_destroy(&suppressor);
+    AudioRing_destroy(&dsp_ring);
+    isInitialized = false;
+}
+
+struct AudioRing* AudioDsp_getRing(void) {
+    return &dsp_ring;
+}
+
+unsigned int AudioDsp_getSampleRate(void) {
+    return AUDIO_DSP_RATE;
+}
+
+double AudioDsp_getAvgBlockUs(void) {
+    long blocks = total_blocks;
+    return blocks > 0 ? total_block_ns / 1000.0 / blocks : 0.0;
+}
@@ -0,0 +1,155 @@
+/**
+ * hal/audio_ring.c
+ *
+ * Implementation of the lock-free audio ring buffer. Positions are 64-bit sample counts that
+ * never wrap, so "how far behind is this reader" is a plain subtraction.
+ */
+
+#include "hal/audio_ring.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void AudioRing_init(struct AudioRing *ring, size_t capacity, size_t maxWrite) {
+    size_t rounded = 1;
+    while (rounded < capacity || rounded < 2 * maxWrite) {
+        rounded <<= 1;
+    }
+    ring->samples = calloc(rounded, sizeof(int16_t));
+    if (!ring->samples) {
+        perror("AudioRing: calloc");
+        exit(EXIT_FAILURE);
+    }
+    ring->capacity = rounded;
+    ring->maxWrite = maxWrite > 0 ? maxWrite : 1;
+    atomic_init(&ring->writePos, 0);
+    atomic_init(&ring->waiters, 0);
+    pthread_mutex_init(&ring->waitMutex, NULL);
+    pthread_cond_init(&ring->dataReady, NULL);
+}
+
+void AudioRing_destroy(struct AudioRing *ring) {
+    free(ring->samples);
+    ring->samples = NULL;
+    pthread_mutex_destroy(&ring->waitMutex);
+    pthread_cond_destroy(&ring->dataReady);
+}
+
+// Copies one block of at most maxWrite samples and publishes it
+static void write_block(struct AudioRing *ring, const int16_t *samples, size_t count) {
+    uint64_t pos = atomic_load_explicit(&ring->writePos, memory_order_relaxed);
+    size_t mask = ring->capacity - 1;
+    size_t start = (size_t)(pos & mask);
+    size_t first = count < ring->capacity - start ? count : ring->capacity - start;
+    // Keep these stores after the previous block's position, so a reader that sees them
+    // also sees that position when it re-checks
+    atomic_thread_fence(memory_order_release);
+    memcpy(ring->samples + start, samples, first * sizeof(int16_t));
+    memcpy(ring->samples, samples + first, (count - first) * sizeof(int16_t));
+    // Publish the samples before the new position becomes visible to readers
+    atomic_store_explicit(&ring->writePos, pos + count, memory_order_release);
+}
+
+void AudioRing_write(struct AudioRing *ring, const int16_t *samples, size_t count) {
+    while (count > 0) {
+        size_t block = count < ring->maxWrite ? count : ring->maxWrite;
+        write_block(ring, samples, block);
+        samples += block;
+        count -= block;
+    }
+
+    // Pairs with the increment in AudioRing_readWait(): either the reader sees the new
+    // position before it sleeps, or the producer sees the reader and wakes it
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&ring->waiters) > 0) {
+        pthread_mutex_lock(&ring->waitMutex);
+        pthread_cond_broadcast(&ring->dataReady);
+        pthread_mutex_unlock(&ring->waitMutex);
+    }
+}
+
+uint64_t AudioRing_getWritePos(struct AudioRing *ring) {
+    return atomic_load_explicit(&ring->writePos, memory_order_acquire);
+}
+
+void AudioRing_openReader(struct AudioRing *ring, struct AudioRingReader *reader) {
+    AudioRing_openReaderAt(ring, reader, AudioRing_getWritePos(ring));
+}
+
+void AudioRing_openReaderAt(struct AudioRing *ring, struct AudioRingReader *reader, uint64_t position) {
+    reader->ring = ring;
+    reader->readPos = position;
+    reader->droppedSamples = 0;
+}
+
+size_t AudioRing_read(struct AudioRingReader *reader, int16_t *out, size_t maxCount) {
+    struct AudioRing *ring = reader->ring;
+    // The block being written next may already be overwriting the oldest maxWrite slots
+    uint64_t safe = ring->capacity - ring->maxWrite;
+    uint64_t writePos = atomic_load_explicit(&ring->writePos, memory_order_acquire);
+    if (writePos - reader->readPos > safe) {
+        // Reader was lapped: skip to the oldest sample that is certainly intact
+        reader->droppedSamples += writePos - reader->readPos - safe;
+        reader->readPos = writePos - safe;
+    }
+    size_t available = (size_t)(writePos - reader->readPos);
+    size_t count = available < maxCount ? available : maxCount;
+    if (count == 0) {
+        return 0;
+    }
+
+    size_t mask = ring->capacity - 1;
+    size_t start = (size_t)(reader->readPos & mask);
+    size_t first = count < ring->capacity - start ? count : ring->capacity - start;
+    memcpy(out, ring->samples + start, first * sizeof(int16_t));
+    memcpy(out + first, ring->samples, (count - first) * sizeof(int16_t));
+
+    // If the producer moved on far enough to overwrite part of what was just copied, drop
+    // the torn prefix. The fence keeps the copy above before the re-read of the position.
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t after = atomic_load_explicit(&ring->writePos, memory_order_relaxed);
+    if (after - reader->readPos > safe) {
+        uint64_t torn = after - reader->readPos - safe;
+        if (torn >= count) {
+            reader->droppedSamples += count;
+            reader->readPos += count;
+            return 0;
+        }
+        memmove(out, out + torn, (count - torn) * sizeof(int16_t));
+        reader->droppedSamples += torn;
+        reader->readPos += count;
+        return count - (size_t)torn;
+    }
+    reader->readPos += count;
+    return count;
+}
+
+size_t AudioRing_readWait(struct AudioRingReader *reader, int16_t *out, size_t maxCount, int timeoutMs) {
+    size_t count = AudioRing_read(reader, out, maxCount);
+    if (count > 0 || timeoutMs <= 0) {
+        return count;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (long)(timeoutMs % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    struct AudioRing *ring = reader->ring;
+    pthread_mutex_lock(&ring->waitMutex);
+    atomic_fetch_add(&ring->waiters, 1);
+    while (AudioRing_getWritePos(ring) == reader->readPos) {
+        if (pthread_cond_timedwait(&ring->dataReady, &ring->waitMutex, &deadline) != 0) {
+            break;
+        }
+    }
+    atomic_fetch_sub(&ring->waiters, 1);
+    pthread_mutex_unlock(&ring->waitMutex);
+    return AudioRing_read(reader, out, maxCount);
+}
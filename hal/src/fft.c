@@ -0,0 +1,103 @@
+/**
+ * hal/fft.c
+ *
+ * Iterative in-place radix-2 decimation-in-time FFT.
+ */
+
+#include "hal/fft.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+int Fft_init(struct Fft *fft, size_t size) {
+    memset(fft, 0, sizeof(*fft));
+    if (size < 2 || (size & (size - 1)) != 0) {
+        return -1;
+    }
+    fft->size = size;
+    fft->cosTable = malloc(size / 2 * sizeof(float));
+    fft->sinTable = malloc(size / 2 * sizeof(float));
+    fft->bitReverse = malloc(size * sizeof(size_t));
+    if (!fft->cosTable || !fft->sinTable || !fft->bitReverse) {
+        Fft_destroy(fft);
+        return -1;
+    }
+    for (size_t i = 0; i < size / 2; i++) {
+        fft->cosTable[i] = (float)cos(2.0 * M_PI * i / size);
+        fft->sinTable[i] = (float)-sin(2.0 * M_PI * i / size);
+    }
+    int bits = 0;
+    while (((size_t)1 << bits) < size) {
+        bits++;
+    }
+    for (size_t i = 0; i < size; i++) {
+        size_t reversed = 0;
+        for (int b = 0; b < bits; b++) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        fft->bitReverse[i] = reversed;
+    }
+    return 0;
+}
+
+void Fft_destroy(struct Fft *fft) {
+    free(fft->cosTable);
+    free(fft->sinTable);
+    free(fft->bitReverse);
+    memset(fft, 0, sizeof(*fft));
+}
+
+void Fft_transform(const struct Fft *fft, float *re, float *im) {
+    size_t n = fft->size;
+    for (size_t i = 0; i < n; i++) {
+        size_t j = fft->bitReverse[i];
+        if (j > i) {
+            float t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        size_t half = len / 2;
+        size_t step = n / len;
+        for (size_t start = 0; start < n; start += len) {
+            for (size_t k = 0; k < half; k++) {
+                float wr = fft->cosTable[k * step];
+                float wi = fft->sinTable[k * step];
+                size_t a = start + k;
+                size_t b = a + half;
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+void Fft_powerSpectrum(const struct Fft *fft, float *re, float *im, float *power) {
+    size_t bins = fft->size / 2 + 1;
+    memset(im, 0, fft->size * sizeof(float));
+    Fft_transform(fft, re, im);
+    size_t k = 0;
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    for (; k + 4 <= bins; k += 4) {
+        float32x4_t r = vld1q_f32(re + k);
+        float32x4_t i = vld1q_f32(im + k);
+        vst1q_f32(power + k, vmlaq_f32(vmulq_f32(r, r), i, i));
+    }
+#endif
+    for (; k < bins; k++) {
+        power[k] = re[k] * re[k] + im[k] * im[k];
+    }
+}
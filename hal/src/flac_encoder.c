@@ -0,0 +1,378 @@
+/**
+ * hal/flac_encoder.c
+ *
+ * Each block becomes one frame with a single subframe. The fixed predictor order with
+ * the smallest sum of absolute residuals is used, and the residual is split into the
+ * number of Rice partitions (up to 64) that codes it in the fewest bits. Silence is sent
+ * as a constant subframe and anything that would not shrink is sent verbatim. MD5 is
+ * left zero, which the format allows.
+ */
+
+#include "hal/flac_encoder.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#define FLAC_HEADER_BYTES 42            // "fLaC" + metadata block header + 34 byte STREAMINFO
+#define FLAC_MAX_FIXED_ORDER 4
+#define FLAC_MAX_PARTITION_ORDER 6
+#define FLAC_MAX_RICE_PARAM 14
+#define FLAC_FRAME_OVERHEAD 32          // Frame header, subframe header and footer, rounded up
+
+struct bit_writer {
+    uint8_t *out;
+    size_t pos;
+    uint64_t acc;
+    int bits;                           // Bits in acc not yet written to out (< 8 between calls)
+};
+
+static void put_bits(struct bit_writer *w, uint32_t value, int count) {
+    w->acc = (w->acc << count) | (value & ((1ULL << count) - 1));
+    w->bits += count;
+    while (w->bits >= 8) {
+        w->bits -= 8;
+        w->out[w->pos++] = (uint8_t)(w->acc >> w->bits);
+    }
+}
+
+static void put_unary(struct bit_writer *w, uint32_t zeros) {
+    while (zeros >= 32) {
+        put_bits(w, 0, 32);
+        zeros -= 32;
+    }
+    put_bits(w, 1, zeros + 1);
+}
+
+static void align_byte(struct bit_writer *w) {
+    if (w->bits > 0) {
+        put_bits(w, 0, 8 - w->bits);
+    }
+}
+
+static uint8_t crc8(const uint8_t *data, size_t length) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t *data, size_t length) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x8005) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static int ensure_capacity(struct FlacEncoder *enc, size_t extra) {
+    if (enc->size + extra <= enc->capacity) {
+        return 0;
+    }
+    size_t capacity = enc->capacity ? enc->capacity : 4096;
+    while (capacity < enc->size + extra) {
+        capacity *= 2;
+    }
+    uint8_t *grown = realloc(enc->data, capacity);
+    if (!grown) {
+        return -1;
+    }
+    enc->data = grown;
+    enc->capacity = capacity;
+    return 0;
+}
+
+// Frame header sample rate code, or 0 to take it from STREAMINFO
+static uint32_t sample_rate_code(unsigned int rate) {
+    switch (rate) {
+        case 8000:  return 4;
+        case 16000: return 5;
+        case 22050: return 6;
+        case 24000: return 7;
+        case 32000: return 8;
+        case 44100: return 9;
+        case 48000: return 10;
+        default:    return 0;
+    }
+}
+
+static void write_streaminfo(struct FlacEncoder *enc) {
+    struct bit_writer w = {.out = enc->data + 8};
+    put_bits(&w, FLAC_ENCODER_BLOCK_SIZE, 16);      // Minimum block size
+    put_bits(&w, FLAC_ENCODER_BLOCK_SIZE, 16);      // Maximum block size
+    put_bits(&w, enc->minFrameBytes, 24);
+    put_bits(&w, enc->maxFrameBytes, 24);
+    put_bits(&w, enc->sampleRate, 20);
+    put_bits(&w, 0, 3);                             // Channels - 1
+    put_bits(&w, 15, 5);                            // Bits per sample - 1
+    put_bits(&w, (uint32_t)(enc->totalSamples >> 32), 4);
+    put_bits(&w, (uint32_t)enc->totalSamples, 32);
+    memset(enc->data + 8 + 18, 0, 16);              // MD5 unknown
+}
+
+// Residual of the fixed polynomial predictor of the given order, for samples order..n-1
+static void fixed_residual(const int16_t *x, size_t n, int order, int32_t *res) {
+    for (size_t i = (size_t)order; i < n; i++) {
+        switch (order) {
+            case 0: res[i] = x[i]; break;
+            case 1: res[i] = x[i] - x[i - 1]; break;
+            case 2: res[i] = x[i] - 2 * x[i - 1] + x[i - 2]; break;
+            case 3: res[i] = x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3]; break;
+            default: res[i] = x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4]; break;
+        }
+    }
+}
+
+// Order whose residual has the smallest total magnitude (all orders scored from sample 4)
+static int best_fixed_order(const int16_t *x, size_t n) {
+    uint64_t total[FLAC_MAX_FIXED_ORDER + 1] = {0};
+    for (size_t i = FLAC_MAX_FIXED_ORDER; i < n; i++) {
+        int32_t e0 = x[i];
+        int32_t e1 = e0 - x[i - 1];
+        int32_t e2 = e1 - (x[i - 1] - x[i - 2]);
+        int32_t e3 = e2 - (x[i - 1] - 2 * x[i - 2] + x[i - 3]);
+        int32_t e4 = e3 - (x[i - 1] - 3 * x[i - 2] + 3 * x[i - 3] - x[i - 4]);
+        total[0] += (uint32_t)abs(e0);
+        total[1] += (uint32_t)abs(e1);
+        total[2] += (uint32_t)abs(e2);
+        total[3] += (uint32_t)abs(e3);
+        total[4] += (uint32_t)abs(e4);
+    }
+    int best = 0;
+    for (int order = 1; order <= FLAC_MAX_FIXED_ORDER && (size_t)order < n; order++) {
+        if (total[order] < total[best]) {
+            best = order;
+        }
+    }
+    return best;
+}
+
+static inline uint32_t zigzag(int32_t r) {
+    return ((uint32_t)r << 1) ^ (uint32_t)(r >> 31);
+}
+
+// Smallest Rice parameter whose expected quotient is about one; returns its cost in bits
+static uint64_t rice_cost(uint64_t sum, size_t count, int *param) {
+    int k = 0;
+    while (k < FLAC_MAX_RICE_PARAM && ((uint64_t)count << (k + 1)) < sum) {
+        k++;
+    }
+    *param = k;
+    // Upper bound: sum of floor(u / 2^k) never exceeds floor(sum / 2^k)
+    return 4 + (uint64_t)count * (k + 1) + (sum >> k);
+}
+
+// Picks the partition order and Rice parameters for res[order..n-1]; returns the bit cost
+static uint64_t plan_residual(const int32_t *res, size_t n, int order, int *partitionOrder,
+                              int params[1 << FLAC_MAX_PARTITION_ORDER]) {
+    uint64_t bestBits = UINT64_MAX;
+    for (int p = 0; p <= FLAC_MAX_PARTITION_ORDER; p++) {
+        size_t parts = (size_t)1 << p;
+        if (n % parts != 0 || n / parts <= (size_t)order) {
+            break;
+        }
+        size_t partLength = n / parts;
+        int trial[1 << FLAC_MAX_PARTITION_ORDER];
+        uint64_t bits = 6;                          // Coding method + partition order
+        size_t i = (size_t)order;
+        for (size_t part = 0; part < parts; part++) {
+            size_t end = (part + 1) * partLength;
+            size_t count = end - i;
+            uint64_t sum = 0;
+            for (; i < end; i++) {
+                sum += zigzag(res[i]);
+            }
+            bits += rice_cost(sum, count, &trial[part]);
+        }
+        if (bits < bestBits) {
+            bestBits = bits;
+            *partitionOrder = p;
+            memcpy(params, trial, parts * sizeof(int));
+        }
+    }
+    return bestBits;
+}
+
+static void write_utf8_number(struct bit_writer *w, uint32_t value) {
+    if (value < 0x80) {
+        put_bits(w, value, 8);
+        return;
+    }
+    int extra = value < 0x800 ? 1 : value < 0x10000 ? 2 : value < 0x200000 ? 3 : value < 0x4000000 ? 4 : 5;
+    uint32_t lead = (0xFF00u >> (extra + 1)) & 0xFF;
+    put_bits(w, lead | (value >> (6 * extra)), 8);
+    for (int i = extra - 1; i >= 0; i--) {
+        put_bits(w, 0x80 | ((value >> (6 * i)) & 0x3F), 8);
+    }
+}
+
+static int encode_block(struct FlacEncoder *enc) {
+    const int16_t *x = enc->block;
+    size_t n = enc->blockFill;
+    if (n == 0) {
+        return 0;
+    }
+    if (ensure_capacity(enc, n * sizeof(int16_t) + FLAC_FRAME_OVERHEAD) != 0) {
+        return -1;
+    }
+
+    struct bit_writer w = {.out = enc->data, .pos = enc->size};
+    size_t frameStart = w.pos;
+
+    // Frame header
+    bool fullBlock = n == FLAC_ENCODER_BLOCK_SIZE;
+    put_bits(&w, 0x3FFE, 14);                       // Sync code
+    put_bits(&w, 0, 1);
+    put_bits(&w, 0, 1);                             // Fixed block size stream
+    put_bits(&w, fullBlock ? 12 : 7, 4);            // 4096, or 16-bit size at the end
+    put_bits(&w, sample_rate_code(enc->sampleRate), 4);
+    put_bits(&w, 0, 4);                             // Mono
+    put_bits(&w, 4, 3);                             // 16 bits per sample
+    put_bits(&w, 0, 1);
+    write_utf8_number(&w, enc->frameNumber);
+    if (!fullBlock) {
+        put_bits(&w, (uint32_t)(n - 1), 16);
+    }
+    put_bits(&w, crc8(w.out + frameStart, w.pos - frameStart), 8);
+
+    // Subframe
+    bool constant = true;
+    for (size_t i = 1; i < n && constant; i++) {
+        constant = x[i] == x[0];
+    }
+    if (constant) {
+        put_bits(&w, 0, 8);                         // Constant, no wasted bits
+        put_bits(&w, (uint16_t)x[0], 16);
+    } else {
+        int order = best_fixed_order(x, n);
+        if ((size_t)order >= n) {
+            order = 0;
+        }
+        fixed_residual(x, n, order, enc->residual);
+        int partitionOrder = 0;
+        int params[1 << FLAC_MAX_PARTITION_ORDER];
+        uint64_t riceBits = plan_residual(enc->residual, n, order, &partitionOrder, params);
+        uint64_t fixedBits = (uint64_t)order * 16 + riceBits;
+
+        if (fixedBits >= (uint64_t)n * 16) {
+            put_bits(&w, 1 << 1, 8);                // Verbatim
+            for (size_t i = 0; i < n; i++) {
+                put_bits(&w, (uint16_t)x[i], 16);
+            }
+        } else {
+            put_bits(&w, (0x08 | order) << 1, 8);   // Fixed predictor of this order
+            for (int i = 0; i < order; i++) {
+                put_bits(&w, (uint16_t)x[i], 16);   // Warm-up samples
+            }
+            put_bits(&w, 0, 2);                     // Rice coding, 4-bit parameters
+            put_bits(&w, (uint32_t)partitionOrder, 4);
+            size_t parts = (size_t)1 << partitionOrder;
+            size_t partLength = n / parts;
+            size_t i = (size_t)order;
+            for (size_t part = 0; part < parts; part++) {
+                int k = params[part];
+                put_bits(&w, (uint32_t)k, 4);
+                for (size_t end = (part + 1) * partLength; i < end; i++) {
+                    uint32_t u = zigzag(enc->residual[i]);
+                    put_unary(&w, u >> k);
+                    if (k > 0) {
+                        put_bits(&w, u, k);
+                    }
+                }
+            }
+        }
+    }
+
+    // Footer
+    align_byte(&w);
+    uint16_t crc = crc16(w.out + frameStart, w.pos - frameStart);
+    put_bits(&w, crc, 16);
+
+    uint32_t frameBytes = (uint32_t)(w.pos - frameStart);
+    if (enc->frameNumber == 0 || frameBytes < enc->minFrameBytes) {
+        enc->minFrameBytes = frameBytes;
+    }
+    if (frameBytes > enc->maxFrameBytes) {
+        enc->maxFrameBytes = frameBytes;
+    }
+    enc->size = w.pos;
+    enc->totalSamples += n;
+    enc->frameNumber++;
+    enc->blockFill = 0;
+    return 0;
+}
+
+int FlacEncoder_init(struct FlacEncoder *enc, size_t initialCapacity) {
+    memset(enc, 0, sizeof(*enc));
+    if (initialCapacity < FLAC_HEADER_BYTES) {
+        initialCapacity = FLAC_HEADER_BYTES;
+    }
+    enc->data = malloc(initialCapacity);
+    if (!enc->data) {
+        return -1;
+    }
+    enc->capacity = initialCapacity;
+    return 0;
+}
+
+void FlacEncoder_destroy(struct FlacEncoder *enc) {
+    free(enc->data);
+    enc->data = NULL;
+    enc->capacity = 0;
+    enc->size = 0;
+}
+
+int FlacEncoder_begin(struct FlacEncoder *enc, unsigned int sampleRate) {
+    enc->sampleRate = sampleRate;
+    enc->blockFill = 0;
+    enc->size = 0;
+    enc->totalSamples = 0;
+    enc->frameNumber = 0;
+    enc->minFrameBytes = 0;
+    enc->maxFrameBytes = 0;
+    if (ensure_capacity(enc, FLAC_HEADER_BYTES) != 0) {
+        return -1;
+    }
+    memcpy(enc->data, "fLaC", 4);
+    enc->data[4] = 0x80;                            // Last metadata block, STREAMINFO
+    enc->data[5] = 0;
+    enc->data[6] = 0;
+    enc->data[7] = 34;
+    write_streaminfo(enc);                          // Totals stay "unknown" until finish
+    enc->size = FLAC_HEADER_BYTES;
+    return 0;
+}
+
+int FlacEncoder_feed(struct FlacEncoder *enc, const int16_t *samples, size_t count) {
+    while (count > 0) {
+        size_t take = FLAC_ENCODER_BLOCK_SIZE - enc->blockFill;
+        if (take > count) {
+            take = count;
+        }
+        memcpy(enc->block + enc->blockFill, samples, take * sizeof(int16_t));
+        enc->blockFill += take;
+        samples += take;
+        count -= take;
+        if (enc->blockFill == FLAC_ENCODER_BLOCK_SIZE && encode_block(enc) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+const uint8_t *FlacEncoder_finish(struct FlacEncoder *enc, size_t *size) {
+    if (encode_block(enc) != 0) {
+        *size = 0;
+        return NULL;
+    }
+    write_streaminfo(enc);
+    *size = enc->size;
+    return enc->data;
+}
@@ -173,4 +173,30 @@ int Gpio_getLineValue(struct GpioLine* line)
         exit(EXIT_FAILURE);
     }
     return value;
-}
\ No newline at end of file
+}
+
+// Request edge events on a line and return the fd that becomes readable when one arrives,
+// so the line can be watched by the reactor instead of a thread blocked in a wait call
+int Gpio_requestEvents(struct GpioLine* line, const char* consumer)
+{
+    assert(s_isInitialized);
+    struct gpiod_line* gpiodLine = (struct gpiod_line*) line;
+    if (gpiod_line_request_both_edges_events(gpiodLine, consumer) < 0) {
+        perror("Unable to request GPIO line events");
+        return -1;
+    }
+    return gpiod_line_event_get_fd(gpiodLine);
+}
+
+// Read one pending event from a line returned by Gpio_requestEvents (or a bulk request)
+int Gpio_readEvent(struct GpioLine* line, bool* isRising)
+{
+    assert(s_isInitialized);
+    struct gpiod_line_event event;
+    if (gpiod_line_event_read((struct gpiod_line*) line, &event) == -1) {
+        perror("Line Event");
+        return -1;
+    }
+    *isRising = event.event_type == GPIOD_LINE_EVENT_RISING_EDGE;
+    return 0;
+}
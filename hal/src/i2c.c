@@ -122,9 +122,6 @@ uint8_t read_i2c_reg8(int i2c_file_desc, uint8_t reg_addr) {
         exit(EXIT_FAILURE);
     }
 
-    struct timespec reqDelay = {0, 750000};
-    nanosleep(&reqDelay, (struct timespec *) NULL);
-
     return value;
 }
 
@@ -145,7 +142,4 @@ void read_i2c_burst(int i2c_file_desc, uint8_t reg_addr, uint8_t *buffer, int le
         perror("Unable to read i2c burst data.");
         exit(EXIT_FAILURE);
     }
-
-    struct timespec reqDelay = {0, 750000};
-    nanosleep(&reqDelay, (struct timespec *) NULL);
 }
@@ -8,7 +8,9 @@
 #include "hal/joystick.h"
 #include "hal/i2c.h"
 #include "hal/gpio.h"
+#include "hal/reactor.h"
 #include "sleep_and_timer.h"
+#include "eventBus.h"
 #include <stdbool.h>
 #include <assert.h>
 #include <pthread.h>
@@ -34,8 +36,6 @@ static bool isInitialized = false;
 static atomic_int page_number = 1;
 static atomic_int isButtonPressed = 0;
 
-static pthread_t button_thread;
-static volatile bool keepReading = false;
 
 static uint16_t x_min = 18, x_max = 1644;
 static uint16_t y_min = 8, y_max = 1635;
@@ -43,64 +43,56 @@ static uint16_t y_min = 8, y_max = 1635;
 //DEBOUNCE
 #define DEBOUNCE_TIME_MS 100
 static struct timespec last_btn_time;
-void *joystick_button_thread_func(void *arg);
+static void on_button_edge(int fd, uint32_t events, void *context);
 
 void Joystick_initialize(void) {
     s_line = Gpio_openForEvents(GPIO_CHIP, GPIO_LINE);
+#ifndef R5_SENSOR_OFFLOAD
+    // With the offload, the R5 owns the I2C bus and reads the joystick for parking itself
     i2c_file_desc = init_i2c_bus(I2CDRV_LINUX_BUS, I2C_DEVICE_ADDRESS);
-    keepReading = true;
+#endif
     isInitialized = true;
-    pthread_create(&button_thread, NULL, joystick_button_thread_func, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &last_btn_time);
+
+    // The reactor thread reads the button edges; no thread of our own waits on the line
+    int fd = Gpio_requestEvents(s_line, "joystick-button");
+    if (fd < 0 || Reactor_addFd(fd, EPOLLIN, on_button_edge, NULL) != 0) {
+        fprintf(stderr, "Joystick button events unavailable\n");
+    }
 }
 
+// Call after Reactor_cleanup(), which stops the handler
 void Joystick_cleanUp(void) {
-    keepReading = false;
-    pthread_join(button_thread, NULL);
     Gpio_close(s_line);
     isInitialized = false;
 }
 
-void *joystick_button_thread_func(void *arg) {
-    (void)arg;
-    assert(isInitialized);
-
-    clock_gettime(CLOCK_MONOTONIC, &last_btn_time);
-
-    while (keepReading) {
-        struct gpiod_line_bulk events;
-        bool buttonFlag = false;
-        
-        int eventCount = Gpio_waitFor1LineChange(s_line, &events);
-        if (eventCount > 0) {
-            struct gpiod_line_event event;
-            struct gpiod_line *line_handle = gpiod_line_bulk_get_line(&events, 0);
-            if (gpiod_line_event_read(line_handle, &event) == -1) {
-                perror("Line Event");
-                exit(EXIT_FAILURE);
-            }
-
-            if (event.event_type == GPIOD_LINE_EVENT_FALLING_EDGE) {
-                buttonFlag = true;
-            }
-        }
-
-        struct timespec now;
-        clock_gettime(CLOCK_MONOTONIC, &now);
-
-        if (buttonFlag && time_diff_ms(&last_btn_time, &now) > DEBOUNCE_TIME_MS) {
-            // int new_page = atomic_load(&page_number) % 2 + 1;
-            atomic_store(&isButtonPressed, 1);
-            // atomic_store(&page_number, new_page);
-            // printf("Button pressed");
-            last_btn_time = now;
-        } else {
-            atomic_store(&isButtonPressed, 0);
-            last_btn_time = now;
-        }
-
-        sleepForMs(10);
+// Called on the reactor thread when the button line has an edge waiting
+static void on_button_edge(int fd, uint32_t events, void *context) {
+    (void)fd;
+    (void)events;
+    (void)context;
+    bool isRising = false;
+    if (Gpio_readEvent(s_line, &isRising) != 0) {
+        return;
+    }
+    bool buttonFlag = !isRising;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (buttonFlag && time_diff_ms(&last_btn_time, &now) > DEBOUNCE_TIME_MS) {
+        // int new_page = atomic_load(&page_number) % 2 + 1;
+        atomic_store(&isButtonPressed, 1);
+        struct Event pressEvent = {.topic = EVENT_BUTTON, .button = JOYSTICK_PRESSED};
+        EventBus_publish(&pressEvent);
+        // atomic_store(&page_number, new_page);
+        // printf("Button pressed");
+        last_btn_time = now;
+    } else {
+        atomic_store(&isButtonPressed, 0);
+        last_btn_time = now;
     }
-    return NULL;
 }
 
 static double scale_value(double raw, double min, double max) {
@@ -121,6 +113,10 @@ struct JoystickData Joystick_getReading() {
         fprintf(stderr, "Error: Joystick not initialized!\n");
         exit(EXIT_FAILURE);
     }
+    if (i2c_file_desc < 0) {
+        struct JoystickData centered = {.x = 0, .y = 0, .isPressed = false};
+        return centered;
+    }
 
     write_i2c_reg16(i2c_file_desc, REG_CONFIGURATION, TLA2024_CHANNEL_CONF_0);
     uint16_t raw_y = read_i2c_reg16(i2c_file_desc, REG_DATA);
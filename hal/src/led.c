@@ -1,8 +1,13 @@
 /* led.c
- * 
- * This file provides functions to initialize and clean up LED control, 
- * set LED triggers, brightness, and delays by interacting with the 
+ *
+ * This file provides functions to initialize and clean up LED control,
+ * set LED triggers, brightness, and delays by interacting with the
  * sysfs files for the LEDs.
+ *
+ * trigger and brightness are opened at init; delay_on and delay_off only exist while the
+ * timer trigger is active, so they are opened when it is set and closed when it changes.
+ * Changing the trigger also lets the kernel change the brightness, so the cached
+ * brightness is forgotten then.
  */
 
 #include "hal/led.h"
@@ -11,122 +16,164 @@
 #include <string.h>
 #include <time.h>
 #include <stdbool.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 LED leds[] = {
-    {"ACT"}, // Green LED
-    {"PWR"}  // Red LED
+    {.name = "ACT"}, // Green LED
+    {.name = "PWR"}  // Red LED
 };
+#define LED_COUNT (int)(sizeof(leds) / sizeof(leds[0]))
 
 static bool isInitialized = false;
-
-void Led_initialize(void) {
-    isInitialized = true;
-}
-
-void Led_cleanUp(void) {
-    isInitialized = false;
-}
-
-
-void Led_setTrigger(LED *led, const char *trigger) {
-    if (!isInitialized) {
-        fprintf(stderr, "Error: Led not initialized!\n");
+static LedStats stats;
+
+static int open_attr(LED *led, const char *attr) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s/%s", LED_FILE_NAME, led->name, attr);
+    int fd = open(path, O_WRONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "Error opening LED %s file: ", attr);
+        perror(path);
         exit(EXIT_FAILURE);
     }
+    stats.opens++;
+    return fd;
+}
 
-    char trigger_file[256];
-    snprintf(trigger_file, sizeof(trigger_file), "%s/%s/trigger", LED_FILE_NAME, led->name);
-
-    FILE *pLedTriggerFile = fopen(trigger_file, "w");
-    if (pLedTriggerFile == NULL) {
-        perror("Error opening LED trigger file");
-        exit(EXIT_FAILURE);
+static void close_fd(int *fd) {
+    if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
     }
+}
 
-    int charWritten = fprintf(pLedTriggerFile, trigger);
-    if (charWritten <= 0) {
+static void write_attr(int fd, const char *value) {
+    size_t length = strlen(value);
+    if (pwrite(fd, value, length, 0) != (ssize_t)length) {
         perror("Error writing data to LED file");
-        fclose(pLedTriggerFile);
         exit(EXIT_FAILURE);
     }
+    stats.writes++;
+}
 
-    fclose(pLedTriggerFile);
+static void write_int_attr(int fd, int value) {
+    char buffer[16];
+    snprintf(buffer, sizeof(buffer), "%d", value);
+    write_attr(fd, buffer);
 }
 
-void Led_setBrightness(LED *led, int brightness) {
+static void check_initialized(void) {
     if (!isInitialized) {
         fprintf(stderr, "Error: Led not initialized!\n");
         exit(EXIT_FAILURE);
     }
+}
 
-    char brightness_file[256];
-    snprintf(brightness_file, sizeof(brightness_file), "%s/%s/brightness", LED_FILE_NAME, led->name);
-
-    FILE *pLedBrightnessFile = fopen(brightness_file, "w");
-    if (pLedBrightnessFile == NULL) {
-        perror("Error opening LED brightness file");
-        exit(EXIT_FAILURE);
-    }
-
-    int charWritten = fprintf(pLedBrightnessFile, "%d", brightness);
-    if (charWritten <= 0) {
-        perror("Error writing data to LED file");
-        fclose(pLedBrightnessFile);
-        exit(EXIT_FAILURE);
+void Led_initialize(void) {
+    memset(&stats, 0, sizeof(stats));
+    for (int i = 0; i < LED_COUNT; i++) {
+        LED *led = &leds[i];
+        led->triggerFd = open_attr(led, "trigger");
+        led->brightnessFd = open_attr(led, "brightness");
+        led->delayOnFd = -1;
+        led->delayOffFd = -1;
+        led->trigger[0] = '\0';
+        led->brightness = -1;
+        led->delayOn = -1;
+        led->delayOff = -1;
     }
-
-    fclose(pLedBrightnessFile);
-    // long seconds = 1;
-    // long nanoseconds = 500000000;
-    // struct timespec reqDelay = {seconds, nanoseconds};
-    // nanosleep(&reqDelay, (struct timespec *) NULL);
+    isInitialized = true;
 }
 
-void Led_setDelayOn(LED *led, int delay) {
-    if (!isInitialized) {
-        fprintf(stderr, "Error: Led not initialized!\n");
-        exit(EXIT_FAILURE);
+void Led_cleanUp(void) {
+    for (int i = 0; i < LED_COUNT; i++) {
+        close_fd(&leds[i].triggerFd);
+        close_fd(&leds[i].brightnessFd);
+        close_fd(&leds[i].delayOnFd);
+        close_fd(&leds[i].delayOffFd);
     }
+    printf("Led: %lu sysfs writes, %lu unchanged writes skipped, %lu files opened\n",
+           stats.writes, stats.skipped, stats.opens);
+    isInitialized = false;
+}
 
-    char delay_file[256];
-    snprintf(delay_file, sizeof(delay_file), "%s/%s/delay_on", LED_FILE_NAME, led->name);
 
-    FILE *pLedDelayFile = fopen(delay_file, "w");
-    if (pLedDelayFile == NULL) {
-        perror("Error opening LED delay_on file");
-        exit(EXIT_FAILURE);
+void Led_setTrigger(LED *led, const char *trigger) {
+    check_initialized();
+    if (strcmp(led->trigger, trigger) == 0) {
+        stats.skipped++;
+        return;
     }
+    write_attr(led->triggerFd, trigger);
+    snprintf(led->trigger, sizeof(led->trigger), "%s", trigger);
+    led->brightness = -1;
+
+    close_fd(&led->delayOnFd);
+    close_fd(&led->delayOffFd);
+    led->delayOn = -1;
+    led->delayOff = -1;
+    if (strcmp(trigger, "timer") == 0) {
+        led->delayOnFd = open_attr(led, "delay_on");
+        led->delayOffFd = open_attr(led, "delay_off");
+    }
+}
 
-    int charWritten = fprintf(pLedDelayFile, "%d", delay);
-    if (charWritten <= 0) {
-        perror("Error writing data to LED file");
-        fclose(pLedDelayFile);
-        exit(EXIT_FAILURE);
+void Led_setBrightness(LED *led, int brightness) {
+    check_initialized();
+    if (led->brightness == brightness) {
+        stats.skipped++;
+        return;
     }
+    write_int_attr(led->brightnessFd, brightness);
+    led->brightness = brightness;
+}
 
-    fclose(pLedDelayFile);
+void Led_setDelayOn(LED *led, int delay) {
+    check_initialized();
+    if (led->delayOnFd < 0) {
+        fprintf(stderr, "Error: LED %s delay_on needs the timer trigger\n", led->name);
+        return;
+    }
+    if (led->delayOn == delay) {
+        stats.skipped++;
+        return;
+    }
+    write_int_attr(led->delayOnFd, delay);
+    led->delayOn = delay;
 }
 
 void Led_setDelayOff(LED *led, int delay) {
-    if (!isInitialized) {
-        fprintf(stderr, "Error: Led not initialized!\n");
-        exit(EXIT_FAILURE);
+    check_initialized();
+    if (led->delayOffFd < 0) {
+        fprintf(stderr, "Error: LED %s delay_off needs the timer trigger\n", led->name);
+        return;
     }
-    
-    char delay_file[256];
-    snprintf(delay_file, sizeof(delay_file), "%s/%s/delay_off", LED_FILE_NAME, led->name);
-
-    FILE *pLedDelayFile = fopen(delay_file, "w");
-    if (pLedDelayFile == NULL) {
-        perror("Error opening LED delay_off file");
-        exit(EXIT_FAILURE);
+    if (led->delayOff == delay) {
+        stats.skipped++;
+        return;
     }
+    write_int_attr(led->delayOffFd, delay);
+    led->delayOff = delay;
+}
 
-    int charWritten = fprintf(pLedDelayFile, "%d", delay);
-    if (charWritten <= 0) {
-        perror("Error writing data to LED file");
-        exit(EXIT_FAILURE);
-    }
+void Led_blink(LED *led, int onMs, int offMs) {
+    Led_setTrigger(led, "timer");
+    Led_setDelayOn(led, onMs);
+    Led_setDelayOff(led, offMs);
+}
+
+void Led_setPattern(LED *led, const char *pattern, int repeat) {
+    Led_setTrigger(led, "pattern");
+    // Rarely changed, so these two are not kept open
+    int repeatFd = open_attr(led, "repeat");
+    write_int_attr(repeatFd, repeat);
+    close(repeatFd);
+    int patternFd = open_attr(led, "pattern");
+    write_attr(patternFd, pattern);
+    close(patternFd);
+}
 
-    fclose(pLedDelayFile);
+LedStats Led_getStats(void) {
+    return stats;
 }
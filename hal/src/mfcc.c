@@ -0,0 +1,189 @@
+/**
+ * hal/mfcc.c
+ *
+ * Implementation of the MFCC front end. Per frame the work is one FFT, the sparse mel
+ * filter bank and a 13x26 DCT; the window/convert step has a NEON path.
+ */
+
+#include "hal/mfcc.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define MFCC_FRAME_MS 25
+#define MFCC_HOP_MS 10
+#define MFCC_LOW_HZ 20.0
+#define MFCC_HIGH_HZ 8000.0
+#define MFCC_PREEMPHASIS 0.97f
+#define MFCC_LOG_FLOOR 1e-6f
+
+static double hz_to_mel(double hz) {
+    return 2595.0 * log10(1.0 + hz / 700.0);
+}
+
+static double mel_to_hz(double mel) {
+    return 700.0 * (pow(10.0, mel / 2595.0) - 1.0);
+}
+
+static void build_filters(struct Mfcc *mfcc) {
+    size_t bins = mfcc->fft.size / 2 + 1;
+    double high = MFCC_HIGH_HZ < mfcc->sampleRate / 2.0 ? MFCC_HIGH_HZ : mfcc->sampleRate / 2.0;
+    double lowMel = hz_to_mel(MFCC_LOW_HZ);
+    double highMel = hz_to_mel(high);
+    double edges[MFCC_NUM_FILTERS + 2];
+    for (int i = 0; i < MFCC_NUM_FILTERS + 2; i++) {
+        double hz = mel_to_hz(lowMel + (highMel - lowMel) * i / (MFCC_NUM_FILTERS + 1));
+        edges[i] = hz * mfcc->fft.size / mfcc->sampleRate;
+    }
+
+    size_t offset = 0;
+    for (int f = 0; f < MFCC_NUM_FILTERS; f++) {
+        int start = (int)ceil(edges[f]);
+        int end = (int)floor(edges[f + 2]);
+        if (end >= (int)bins) {
+            end = (int)bins - 1;
+        }
+        if (end < start) {
+            end = start;
+        }
+        mfcc->filterStart[f] = start;
+        mfcc->filterLength[f] = end - start + 1;
+        for (int k = start; k <= end; k++) {
+            double w;
+            if (k <= edges[f + 1]) {
+                w = (k - edges[f]) / (edges[f + 1] - edges[f]);
+            } else {
+                w = (edges[f + 2] - k) / (edges[f + 2] - edges[f + 1]);
+            }
+            mfcc->filterWeights[offset++] = w > 0 ? (float)w : 0.0f;
+        }
+    }
+}
+
+int Mfcc_init(struct Mfcc *mfcc, unsigned int sampleRate) {
+    memset(mfcc, 0, sizeof(*mfcc));
+    mfcc->sampleRate = sampleRate;
+    mfcc->frameLength = sampleRate * MFCC_FRAME_MS / 1000;
+    mfcc->hop = sampleRate * MFCC_HOP_MS / 1000;
+    size_t fftSize = 1;
+    while (fftSize < mfcc->frameLength) {
+        fftSize <<= 1;
+    }
+    if (Fft_init(&mfcc->fft, fftSize) != 0) {
+        return -1;
+    }
+    size_t bins = fftSize / 2 + 1;
+    mfcc->window = malloc(mfcc->frameLength * sizeof(float));
+    mfcc->re = malloc(fftSize * sizeof(float));
+    mfcc->im = malloc(fftSize * sizeof(float));
+    mfcc->power = malloc(bins * sizeof(float));
+    // Each bin belongs to at most two overlapping triangles
+    mfcc->filterWeights = malloc(2 * bins * sizeof(float));
+    mfcc->history = calloc(mfcc->frameLength, sizeof(int16_t));
+    if (!mfcc->window || !mfcc->re || !mfcc->im || !mfcc->power || !mfcc->filterWeights || !mfcc->history) {
+        Mfcc_destroy(mfcc);
+        return -1;
+    }
+    for (size_t i = 0; i < mfcc->frameLength; i++) {
+        mfcc->window[i] = (float)(0.54 - 0.46 * cos(2.0 * M_PI * i / (mfcc->frameLength - 1)));
+    }
+    build_filters(mfcc);
+    for (int c = 0; c < MFCC_NUM_COEFFS; c++) {
+        for (int f = 0; f < MFCC_NUM_FILTERS; f++) {
+            mfcc->dct[c][f] = (float)(cos(M_PI * c * (f + 0.5) / MFCC_NUM_FILTERS) * sqrt(2.0 / MFCC_NUM_FILTERS));
+        }
+    }
+    return 0;
+}
+
+void Mfcc_destroy(struct Mfcc *mfcc) {
+    Fft_destroy(&mfcc->fft);
+    free(mfcc->window);
+    free(mfcc->re);
+    free(mfcc->im);
+    free(mfcc->power);
+    free(mfcc->filterWeights);
+    free(mfcc->history);
+    memset(mfcc, 0, sizeof(*mfcc));
+}
+
+// Pre-emphasis, window and zero padding of the frame in history into re
+static void prepare_frame(struct Mfcc *mfcc) {
+    const int16_t *x = mfcc->history;
+    size_t n = mfcc->frameLength;
+    float *re = mfcc->re;
+    re[0] = ((float)x[0] - MFCC_PREEMPHASIS * mfcc->lastSample) * mfcc->window[0];
+    size_t i = 1;
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    float32x4_t coeff = vdupq_n_f32(MFCC_PREEMPHASIS);
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t cur = vcvtq_f32_s32(vmovl_s16(vld1_s16(x + i)));
+        float32x4_t prev = vcvtq_f32_s32(vmovl_s16(vld1_s16(x + i - 1)));
+        float32x4_t emphasized = vmlsq_f32(cur, prev, coeff);
+        vst1q_f32(re + i, vmulq_f32(emphasized, vld1q_f32(mfcc->window + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        re[i] = ((float)x[i] - MFCC_PREEMPHASIS * (float)x[i - 1]) * mfcc->window[i];
+    }
+    memset(re + n, 0, (mfcc->fft.size - n) * sizeof(float));
+}
+
+static void compute_coeffs(struct Mfcc *mfcc, float out[MFCC_NUM_COEFFS]) {
+    prepare_frame(mfcc);
+    Fft_powerSpectrum(&mfcc->fft, mfcc->re, mfcc->im, mfcc->power);
+
+    float logEnergy[MFCC_NUM_FILTERS];
+    const float *w = mfcc->filterWeights;
+    for (int f = 0; f < MFCC_NUM_FILTERS; f++) {
+        const float *p = mfcc->power + mfcc->filterStart[f];
+        float sum = 0;
+        for (int k = 0; k < mfcc->filterLength[f]; k++) {
+            sum += p[k] * w[k];
+        }
+        w += mfcc->filterLength[f];
+        logEnergy[f] = logf(sum > MFCC_LOG_FLOOR ? sum : MFCC_LOG_FLOOR);
+    }
+    for (int c = 0; c < MFCC_NUM_COEFFS; c++) {
+        float sum = 0;
+        for (int f = 0; f < MFCC_NUM_FILTERS; f++) {
+            sum += mfcc->dct[c][f] * logEnergy[f];
+        }
+        out[c] = sum;
+    }
+}
+
+int Mfcc_process(struct Mfcc *mfcc, const int16_t *samples, size_t count,
+                 float out[][MFCC_NUM_COEFFS], int maxFrames) {
+    int frames = 0;
+    size_t n = mfcc->frameLength;
+    while (count > 0) {
+        // Slide the window: keep the newest samples, append as many new ones as the next frame needs
+        size_t need = mfcc->filled < n ? n - mfcc->filled : mfcc->hop - mfcc->sinceLastFrame;
+        size_t take = count < need ? count : need;
+        if (mfcc->filled + take > n) {
+            size_t drop = mfcc->filled + take - n;
+            mfcc->lastSample = mfcc->history[drop - 1];
+            memmove(mfcc->history, mfcc->history + drop, (mfcc->filled - drop) * sizeof(int16_t));
+            mfcc->filled -= drop;
+        }
+        memcpy(mfcc->history + mfcc->filled, samples, take * sizeof(int16_t));
+        mfcc->filled += take;
+        mfcc->sinceLastFrame += take;
+        samples += take;
+        count -= take;
+
+        if (mfcc->filled == n && mfcc->sinceLastFrame >= mfcc->hop) {
+            if (frames < maxFrames) {
+                compute_coeffs(mfcc, out[frames++]);
+            }
+            mfcc->sinceLastFrame = 0;
+        }
+    }
+    return frames;
+}
@@ -7,8 +7,13 @@
  #include "hal/microphone.h"
  #include "hal/rotary_state.h"
  #include "hal/gpio.h"
- #include "ai_api.h"
- #include "roadTracker.h"
+ #include "hal/audio_capture.h"
+ #include "hal/audio_dsp.h"
+ #include "hal/vad.h"
+ #include "hal/speech_recognizer.h"
+ #include "hal/wake_word.h"
+ #include "sleep_and_timer.h"
+ #include "voiceCommand.h"
 
  #include <stdio.h>
  #include <stdlib.h>
@@ -21,200 +26,217 @@
  #include <fcntl.h>
  #include <errno.h>
  #include <sys/types.h>
- #include <sys/stat.h>
- #include <ctype.h>
+ #include <stdint.h>
+ #include <stdatomic.h>
 
- static void runCommand(const char* command) {
-    if (system(command) == -1) {
-        // printf("%s\n", command);
-        printf("error: system() command failed\n");
-    } else {
-        // printf("%s\n", command);
-    }
-}
- 
  // Global variables
  static pthread_t record_thread;
- static pthread_t button_listener_thread;
+ static bool record_thread_valid = false;  // record_thread still has to be joined
+ // Set from Microphone_startRecording() until the utterance has been fully handled, so a
+ // button press or wake word can never start a second recording over the first one
  static int recording_active = 0;
+ static atomic_int stop_requested = 0;      // Microphone_stopRecording() wants the thread out
  static int listener_active = 0;
- static time_t last_sound_time = 0;
- static int consecutive_silent_frames = 0;  // Count of consecutive silent frames
+ static int wake_word_active = 0;
  static int auto_transcribe_on_stop = 1;
  static char transcription_result[1024] = {0}; // To store transcription result
- static char output_folder[256] = "app_output"; // Folder to save output files
- static char output_filename[256] = "output.wav"; // Audio output filename
- static char transcription_filename[256] = "transcribed_output.txt"; // Transcription output filename
  static void (*transcription_callback)(const char* transcription) = NULL;
  
  static const int MAX_RECORDING_DURATION = 15;  // 15 seconds, maybe we should change this, shouldn't have to
 
- // Silence timeout in seconds (how long mic picks up silence before it stops recording)
- static const int SILENCE_TIMEOUT = 2;
+ // How long the VAD must hear no speech after an utterance before recording stops
+ #define END_OF_SPEECH_MS 300
+ 
+ // Stop early if no speech starts at all within this time
+ #define NO_SPEECH_TIMEOUT_MS 2000
  
- // Sound detection threshold lower value = more sensitive
- static const int SOUND_THRESHOLD = 50;
+ // Audio from just before the recording that seeds the VAD's noise floor
+ #define NOISE_HISTORY_MS 1500
  
- // Recording is done in frames, how many frames of silence are required before we stop recording
- static const int SILENT_FRAMES_REQUIRED = 100;  // 1 frame per 10 ms
+ // Minimum sound level that can count as speech, lower value = more sensitive
+ static int sound_threshold = 50;
  
  // Mutex for thread synchronization
  static pthread_mutex_t mic_mutex = PTHREAD_MUTEX_INITIALIZER;
+ 
+ // Samples handed to each consumer per read (10 ms at 16 kHz)
+ #define CHUNK_SAMPLES 160
 
- // Case-insensitive character comparison
-static int char_icmp(char a, char b) {
-    return tolower((unsigned char)a) - tolower((unsigned char)b);
+ // In-memory copy of the current recording, filled by the WAV writer consumer
+ static int16_t *recording_samples = NULL;
+ static size_t recording_capacity = 0;
+ static size_t recording_length = 0;
+ static unsigned int recording_rate = 0;
+ 
+ // A capture consumer: a thread that forwards samples from its own ring reader to a sink
+ struct consumer {
+     const char *name;
+     void (*sink)(const int16_t *samples, size_t count);
+     pthread_t thread;
+     struct AudioRingReader reader;
+     _Atomic uint64_t stopPos;
+     int active;
+ };
+ 
+ static void wav_sink(const int16_t *samples, size_t count);
+ static void stream_sink(const int16_t *samples, size_t count);
+ 
+ static struct consumer wav_consumer = {.name = "WAV writer", .sink = wav_sink};
+ static struct consumer stream_consumer = {.name = "Transcription streamer", .sink = stream_sink};
+ static const struct SpeechRecognizer *recognizer = NULL;
+
+// Copies the capture stream into recording_samples
+static void wav_sink(const int16_t *samples, size_t count) {
+    if (count > recording_capacity - recording_length) {
+        count = recording_capacity - recording_length;
+    }
+    memcpy(recording_samples + recording_length, samples, count * sizeof(int16_t));
+    recording_length += count;
 }
 
-// Case-insensitive string search
-static const char* my_strcasestr(const char* haystack, const char* needle) {
-    if (!haystack || !needle) return NULL;
-    
-    size_t needle_len = strlen(needle);
-    if (needle_len == 0) return haystack;
-    
-    for (; *haystack; haystack++) {
-        if (char_icmp(*haystack, *needle) == 0) {
-            const char* h = haystack;
-            const char* n = needle;
-            size_t i = 0;
-            
-            while (i < needle_len && *h && char_icmp(*h, *n) == 0) {
-                h++;
-                n++;
-                i++;
-            }
-            
-            if (i == needle_len) {
-                return haystack;
-            }
+// Hands the capture stream to the recognizer while the user is still speaking
+static void stream_sink(const int16_t *samples, size_t count) {
+    recognizer->feed(samples, count);
+}
+
+// Forward samples to the sink until stopPos is reached
+static void *consumer_thread(void *arg) {
+    struct consumer *c = arg;
+    int16_t chunk[CHUNK_SAMPLES];
+
+    while (c->reader.readPos < atomic_load(&c->stopPos)) {
+        size_t want = CHUNK_SAMPLES;
+        uint64_t stop = atomic_load(&c->stopPos);
+        if (stop != UINT64_MAX && stop - c->reader.readPos < want) {
+            want = (size_t)(stop - c->reader.readPos);
+        }
+        size_t count = AudioRing_readWait(&c->reader, chunk, want, 20);
+        if (count > 0) {
+            c->sink(chunk, count);
         }
     }
-    
+    if (c->reader.droppedSamples > 0) {
+        printf("Warning: %s dropped %llu samples\n", c->name, (unsigned long long)c->reader.droppedSamples);
+    }
     return NULL;
 }
 
-// Function to parse location from transcription
-static char* parse_location(const char* transcription) {
-    // Check if transcription contains the trigger phrase
-    const char* trigger = "set target";
-    const char* pos = my_strcasestr(transcription, trigger);
+static int start_consumer(struct consumer *c, struct AudioRing *ring, uint64_t startPos) {
+    AudioRing_openReaderAt(ring, &c->reader, startPos);
+    atomic_store(&c->stopPos, UINT64_MAX);
+    if (pthread_create(&c->thread, NULL, consumer_thread, c) != 0) {
+        perror("pthread_create");
+        return -1;
+    }
+    c->active = 1;
+    return 0;
+}
+
+// Stop the consumer once it has forwarded everything up to stopPos
+static void stop_consumer(struct consumer *c, uint64_t stopPos) {
+    if (!c->active) {
+        return;
+    }
+    atomic_store(&c->stopPos, stopPos);
+    pthread_join(c->thread, NULL);
+    c->active = 0;
+}
+
+// Keep the recognizer output as the transcription result (takes ownership of output)
+static char* store_transcription(char *output) {
+    memset(transcription_result, 0, sizeof(transcription_result));
+    if (!output || strlen(output) == 0) {
+        free(output);
+        return NULL;
+    }
     
-    if (pos) {
-        // Move past the trigger phrase to get the target location
-        pos += strlen(trigger);
-        
-        // Skip any leading whitespace
-        while (*pos == ' ' || *pos == '\t') {
-            pos++;
-        }
-        
-        // If there's location text after the trigger
-        if (*pos) {
-            return strdup(pos);
-        }
+    // Strip newlines and limit length
+    char *newline = strchr(output, '\n');
+    if (newline) *newline = '\0';
+    if (strlen(output) >= sizeof(transcription_result) - 1) {
+        free(output);
+        return NULL;
     }
+    strcpy(transcription_result, output);
+    free(output);
     
-    return NULL; // No location found
+    // Call the callback if registered
+    if (transcription_callback) {
+        transcription_callback(transcription_result);
+    }
+    return transcription_result;
 }
  
-
-static int check_clear_target(const char* transcription) {
-    const char* trigger = "clear target";
-    const char* pos = my_strcasestr(transcription, trigger);
-    if (pos) {
-        return 1;
+// Seeds the VAD from what the ring still holds before start_pos. After the wake word the
+// user often talks straight on, so the first frames of the recording are no measure of
+// the background.
+static void seed_vad(struct Vad *vad, struct AudioRing *ring, uint64_t start_pos) {
+    size_t want = (size_t)recording_rate * NOISE_HISTORY_MS / 1000;
+    if (start_pos < want) {
+        want = (size_t)start_pos;
     }
-    return 0;
+    int16_t *history = want > 0 ? malloc(want * sizeof(int16_t)) : NULL;
+    if (!history) {
+        return;
+    }
+    struct AudioRingReader reader;
+    AudioRing_openReaderAt(ring, &reader, start_pos - want);
+    size_t got = 0;
+    while (reader.readPos < start_pos) {
+        size_t count = AudioRing_read(&reader, history + got, (size_t)(start_pos - reader.readPos));
+        if (count == 0) {
+            break;
+        }
+        got += count;
+    }
+    Vad_seedNoiseFloor(vad, history, got);
+    free(history);
 }
  
- // Function to read command output
- static char* read_command_output(const char *cmd) {
-     FILE *fp;
-     char *output = NULL;
-     size_t output_size = 0;
-     char buffer[1024];
-     
-     fp = popen(cmd, "r");
-     if (fp == NULL) {
-         perror("Failed to run command");
-         return NULL;
-     }
-     
-     while (fgets(buffer, sizeof(buffer), fp) != NULL) {
-         size_t buffer_len = strlen(buffer);
-         char *new_output = realloc(output, output_size + buffer_len + 1);
-         if (new_output == NULL) {
-             free(output);
-             pclose(fp);
-             return NULL;
-         }
-         output = new_output;
-         strcpy(output + output_size, buffer);
-         output_size += buffer_len;
-     }
-     
-     pclose(fp);
-     return output;
- }
- 
+// Last thing the recording thread does: the next recording may start from here on
+static void finish_recording(void) {
+    pthread_mutex_lock(&mic_mutex);
+    recording_active = 0;
+    atomic_store(&stop_requested, 0);
+    pthread_mutex_unlock(&mic_mutex);
+}
+
 // Function to handle recording audio and monitoring sound levels
 static void *record_audio(void *arg) {
     int duration_ms = *((int*)arg);
     free(arg);
     
+    // Consumers read the resampled, denoised 16 kHz output of the DSP stage
+    struct AudioRing *ring = AudioDsp_getRing();
+    recording_rate = AudioDsp_getSampleRate();
+    recording_length = 0;
     
-    // Ensure output directory exists
-    char mkdir_cmd[512];
-    snprintf(mkdir_cmd, sizeof(mkdir_cmd), "mkdir -p %s", output_folder);
-    system(mkdir_cmd);
-    
-    // Prepare full output path
-    char output_path[512];
-    snprintf(output_path, sizeof(output_path), "%s/%s", output_folder, output_filename);
-    
-    // Set up the arecord command with the output path
-    // Using a named pipe to split the audio stream
-    char path[512];
-    snprintf(path, sizeof(path), "%s/audio_fifo", output_folder);
-    
-    // Create a named pipe (FIFO)
-    unlink(path); // Remove any existing pipe
-    if (mkfifo(path, 0666) == -1) {
-        perror("mkfifo");
-        return NULL;
-    }
-    
-    // Command to record audio and write to both the WAV file and the path
-    char cmd[2048];
-    snprintf(cmd, sizeof(cmd), 
-            "arecord --device=hw:2,0 --format=S16_LE --rate=44100 -c1 -d 7 | tee %s > %s",
-            path, output_path);
-    
-    // Start the recording process
-    FILE *fp = popen(cmd, "r");
-    if (fp == NULL) {
-        perror("Failed to run arecord");
-        unlink(path);
+    // All consumers start at the same sample so the WAV, the recognizer and the VAD line up
+    uint64_t start_pos = AudioRing_getWritePos(ring);
+    struct AudioRingReader vad_reader;
+    AudioRing_openReaderAt(ring, &vad_reader, start_pos);
+    if (start_consumer(&wav_consumer, ring, start_pos) != 0) {
+        finish_recording();
         return NULL;
     }
-    
-    // Open the FIFO for reading audio data for sound detection
-    int fifo_fd = open(path, O_RDONLY | O_NONBLOCK);
-    if (fifo_fd == -1) {
-        perror("open fifo");
-        pclose(fp);
-        unlink(path);
-        return NULL;
+    bool streaming = recognizer->begin(recording_rate) == 0;
+    if (streaming && start_consumer(&stream_consumer, ring, start_pos) != 0) {
+        // Nothing will feed the recognizer; end it before the fallback begins another
+        recognizer->abort();
+        streaming = false;
     }
     
-    // Initialize time of last sound and silence counter
-    last_sound_time = time(NULL);
-    consecutive_silent_frames = 0;
+    // Fresh detector per recording, its noise floor taken from the cabin just before it
+    struct Vad vad;
+    Vad_init(&vad, recording_rate, END_OF_SPEECH_MS);
+    Vad_setMinLevel(&vad, sound_threshold);
+    seed_vad(&vad, ring, start_pos);
+    bool speech_detected = false;
     
     // Buffer to read audio samples
-    short buffer[1024];
-    ssize_t read_size;
+    short buffer[CHUNK_SAMPLES];
+    size_t read_size;
+    bool first_chunk = true;
     
     // If duration is specified, set end time
     struct timespec end_time;
@@ -233,7 +255,7 @@ static void *record_audio(void *arg) {
     clock_gettime(CLOCK_MONOTONIC, &start_time);
     
     // Process audio data until told to stop
-    while (recording_active) {
+    while (!atomic_load(&stop_requested)) {
         // Check if any duration is met
         if (duration_ms > 0) {
             struct timespec current_time;
@@ -241,9 +263,6 @@ static void *record_audio(void *arg) {
             if (current_time.tv_sec > end_time.tv_sec || 
                 (current_time.tv_sec == end_time.tv_sec && current_time.tv_nsec >= end_time.tv_nsec)) {
                 printf("Specified duration reached, stopping recording...\n");
-                pthread_mutex_lock(&mic_mutex);
-                recording_active = 0;
-                pthread_mutex_unlock(&mic_mutex);
                 break;
             }
         }
@@ -255,244 +274,219 @@ static void *record_audio(void *arg) {
         
         if (elapsed_seconds >= MAX_RECORDING_DURATION) {
             printf("Maximum recording duration (%d seconds) reached, stopping...\n", MAX_RECORDING_DURATION);
-            pthread_mutex_lock(&mic_mutex);
-            recording_active = 0;
-            pthread_mutex_unlock(&mic_mutex);
             break;
         }
         
-        // Read from FIFO
-        read_size = read(fifo_fd, buffer, sizeof(buffer));
+        // Block until the capture thread publishes the next period
+        read_size = AudioRing_readWait(&vad_reader, buffer, CHUNK_SAMPLES, 50);
         
         if (read_size > 0) {
-            // Calculate energy level (simple sum of absolute values)
-            long energy = 0;
-            size_t sample_count = read_size / sizeof(short);
-            for (size_t i = 0; i < sample_count; i++) {
-                energy += abs(buffer[i]);
-            }
-            
-            if (sample_count > 0) {
-                energy /= sample_count;  // Average energy
+            if (first_chunk) {
+                clock_gettime(CLOCK_MONOTONIC, &current_time);
+                printf("Capture-to-first-byte: %ld us\n",
+                       (current_time.tv_sec - start_time.tv_sec) * 1000000L +
+                       (current_time.tv_nsec - start_time.tv_nsec) / 1000L);
+                first_chunk = false;
             }
             
-            // If energy reading is above threshold, it counts as proper sound
-            if (energy > SOUND_THRESHOLD) {
-                last_sound_time = time(NULL);
-                consecutive_silent_frames = 0;  // Reset silent frame counter
-                
-                // Only print for loud sounds to reduce console spam
-                if (energy > SOUND_THRESHOLD * 2) {
-                    // printf("Sound detected! Level: %ld\n", energy);
-                }
-            } else {
-                // Count consecutive silent frames
-                consecutive_silent_frames++;
-                
-                // Only check for timeout if we have enough consecutive silent frames
-                if (consecutive_silent_frames >= SILENT_FRAMES_REQUIRED) {
-                    time_t current_time = time(NULL);
-                    double silent_time = difftime(current_time, last_sound_time);
-                    
-                    if (silent_time >= SILENCE_TIMEOUT) {
-                        printf("Silence detected for %.1f seconds (%d frames), stopping recording...\n", 
-                               silent_time, consecutive_silent_frames);
-                        pthread_mutex_lock(&mic_mutex);
-                        recording_active = 0;
-                        pthread_mutex_unlock(&mic_mutex);
-                        break;
-                    }
-                }
+            VadEvent event = Vad_process(&vad, buffer, read_size);
+            if (event == VAD_EVENT_SPEECH_START) {
+                speech_detected = true;
+            } else if (event == VAD_EVENT_SPEECH_END) {
+                printf("End of speech detected, stopping recording...\n");
+                break;
             }
-        } else if (read_size == -1 && errno != EAGAIN) {
-            // Error reading from FIFO
-            perror("read fifo");
-            break;
         }
         
-        // Short sleep to avoid high CPU usage
-        usleep(10000);  // 10ms sleep
+        // Give up if nothing that sounds like speech shows up at all
+        if (!speech_detected) {
+            clock_gettime(CLOCK_MONOTONIC, &current_time);
+            if (time_diff_ms(&start_time, &current_time) >= NO_SPEECH_TIMEOUT_MS) {
+                printf("No speech detected for %d ms, stopping recording...\n", NO_SPEECH_TIMEOUT_MS);
+                break;
+            }
+        }
     }
     
-    // Clean up
-    close(fifo_fd);
-    pclose(fp);
-    unlink(path);
+    // Let the consumers catch up to exactly where the VAD stopped
+    stop_consumer(&wav_consumer, vad_reader.readPos);
+    stop_consumer(&stream_consumer, vad_reader.readPos);
     
-    // Transcribe once recording is done
-    printf("Recording stopped, starting transcription...\n");
+    // Stopped from outside, or nobody spoke: keep the audio for Microphone_transcribe() but
+    // handle nothing, so noise is never transcribed into a command
+    if (atomic_load(&stop_requested) || !speech_detected) {
+        if (streaming) {
+            recognizer->abort();
+        }
+        finish_recording();
+        return NULL;
+    }
     
-    // Small delay to ensure file is properly closed
-    usleep(500000);  // 0.5 seconds
+    // Most of the audio has already been recognized; only the final result is left
+    struct timespec end_of_speech;
+    clock_gettime(CLOCK_MONOTONIC, &end_of_speech);
+    char* result = NULL;
+    if (streaming) {
+        result = store_transcription(recognizer->finish());
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        printf("Final transcript %ld ms after end of speech\n", time_diff_ms(&end_of_speech, &now));
+    }
     
-    // Call transcribe function directly
-    char* result = Microphone_transcribe();
+    // Fall back to recognizing the whole recording at once
+    if (!result) {
+        result = Microphone_transcribe();
+    }
     if (result) {
         printf("Auto-transcription result: %s\n", result);
-        
-        // Check if this is a location setting request
-        int reset = check_clear_target(result);
-        char* location = parse_location(result);
-        if (location) {
-            printf("Location detected: %s\n", location);
-            
-            // Create a formatted query for the AI to get address details
-            char location_query[1024];
-            snprintf(location_query, sizeof(location_query), 
-                    "Provide only the full address in standard format for: %s. Format should be like: 8888 University Dr W, Burnaby, BC V5A 1S6. Do not include any other text in your response.", location);
-                    
-            // Process with AI API for location formattingx
-            printf("Getting formatted address for location...\n");
-            char* ai_response = AI_processText(location_query);
-            if (ai_response) {
-                printf("Location Formatted: %s\n", ai_response);
-                RoadTracker_setTarget(ai_response);
-            } else {
-                printf("Failed to get formatted address\n");
-            }
-            
-            free(location);
-        } else if (reset) {
-            RoadTracker_resetTarget();
-        } else {
-            // Normal AI processing for non-location queries
-            printf("Getting AI response...\n");
-            char* ai_response = AI_processTranscription();
-            char responseAudio[1024]; // Adjust size if needed
-            snprintf(responseAudio, sizeof(responseAudio),"espeak -v mb-en1 -s 120 '%s' -w aiResponse.wav", ai_response);
-            // snprintf(responseAudio, sizeof(responseAudio), "espeak -ven-us+f3 '%s' -a 300 -s 130 -w aiResponse.wav", ai_response);
-            runCommand(responseAudio);
-            runCommand("aplay -q aiResponse.wav");
-            if (ai_response) {
-                printf("Fun Fact: %s\n", ai_response);
-            } else {
-                printf("Failed to get AI response\n");
-            }
-        }
+        VoiceCommand_handle(result);
     } else {
         printf("Auto-transcription failed\n");
     }
     
+    finish_recording();
     return NULL;
 }
 
 
-// Function to handle rotary button press detection
-static void *button_listener(void *arg) {
-    (void)arg; 
-    
-    int prevPushValue = RotaryState_getPushValue();
-    
-    while (listener_active) {
-        RotaryState_doPushState();
-        int currentPushValue = RotaryState_getPushValue();
-        
-        // Button state changed
-        if (currentPushValue != prevPushValue) {
-            // Button was pressed
-            if (currentPushValue > prevPushValue) {
-                // Only start recording if not already recording
-                if (!Microphone_isRecording()) {
-                    printf("Button pressed! Starting voice recording...\n");
-                    // Start recording
-                    Microphone_startRecording();
-                } else {
-                    printf("Already recording - button press ignored\n");
-                }
-            }
-            
-            prevPushValue = currentPushValue;
-        }
-        
-        usleep(10000); // 10ms sleep to reduce CPU usage
+// Called on the reactor thread after each rotary button press
+static void on_rotary_push(void) {
+    if (!listener_active) {
+        return;
+    }
+    // Only start recording if not already recording
+    if (!Microphone_isRecording()) {
+        printf("Button pressed! Starting voice recording...\n");
+        Microphone_startRecording();
+    } else {
+        printf("Already recording - button press ignored\n");
+    }
+}
+ 
+// Called from the wake word detector thread
+static void on_wake_word(void) {
+    if (!Microphone_isRecording()) {
+        printf("Wake word detected! Starting voice recording...\n");
+        Microphone_startRecording();
     }
-    
-    return NULL;
 }
  
  // Initialize the microphone
  void Microphone_init(void) {
+     // A crashed speech script must not kill us with SIGPIPE while we stream audio to it
+     signal(SIGPIPE, SIG_IGN);
+     
+     // Room for the longest allowed recording, so the WAV writer never reallocates
+     recording_capacity = (size_t)MAX_RECORDING_DURATION * AudioDsp_getSampleRate() + CHUNK_SAMPLES;
+     recording_samples = malloc(recording_capacity * sizeof(int16_t));
+     if (!recording_samples) {
+         perror("malloc");
+         exit(EXIT_FAILURE);
+     }
+     recording_length = 0;
+     
      pthread_mutex_lock(&mic_mutex);
      recording_active = 0;
      listener_active = 0;
-     consecutive_silent_frames = 0;
      pthread_mutex_unlock(&mic_mutex);
      
      // Ensure rotary encoder is initialized
      RotaryState_init();
+     
+     // Start the always-on capture thread and the DSP stage that feeds every audio consumer
+     AudioCapture_init();
+     AudioDsp_init();
+     recognizer = SpeechRecognizer_getDefault();
  }
  
  // Cleanup and free resources
  void Microphone_cleanup(void) {
-     // Stop recording if active
-     if (recording_active) {
-         Microphone_stopRecording();
-     }
+     // Stop recording if active, and join a recording thread that already finished
+     Microphone_stopRecording();
      
      // Stop listener if active
      if (listener_active) {
          Microphone_stopButtonListener();
      }
+     if (wake_word_active) {
+         Microphone_stopWakeWordListener();
+     }
      // Clean up rotary state
      RotaryState_cleanup();
+     
+     AudioDsp_cleanup();
+     AudioCapture_cleanup();
+     free(recording_samples);
+     recording_samples = NULL;
+     recording_capacity = 0;
+     recording_length = 0;
  }
  
- // Start recording audio
- int Microphone_startRecording(void) {
+ // Starts the recording thread unless one is still busy; duration_ms 0 means until the VAD
+ // or Microphone_stopRecording() ends it
+ static int start_record_thread(int duration_ms) {
      pthread_mutex_lock(&mic_mutex);
      if (recording_active) {
          printf("Recording already in progress\n");
          pthread_mutex_unlock(&mic_mutex);
          return -1;
      }
+     // The previous thread has cleared recording_active, so it is about to return
+     if (record_thread_valid) {
+         pthread_join(record_thread, NULL);
+         record_thread_valid = false;
+     }
      
-     recording_active = 1;
-     consecutive_silent_frames = 0;
-     pthread_mutex_unlock(&mic_mutex);
-     
-     // Allocate memory for the duration argument (0 = manual stop)
      int *duration_arg = malloc(sizeof(int));
      if (!duration_arg) {
          perror("malloc");
-         pthread_mutex_lock(&mic_mutex);
-         recording_active = 0;
          pthread_mutex_unlock(&mic_mutex);
          return -1;
      }
+     *duration_arg = duration_ms;
      
-     *duration_arg = 0; // 0 means manual stop
-     
-     // Create thread to handle recording
+     atomic_store(&stop_requested, 0);
+     recording_active = 1;
      if (pthread_create(&record_thread, NULL, record_audio, duration_arg) != 0) {
          perror("pthread_create");
          free(duration_arg);
-         pthread_mutex_lock(&mic_mutex);
          recording_active = 0;
          pthread_mutex_unlock(&mic_mutex);
          return -1;
      }
-     
+     record_thread_valid = true;
+     pthread_mutex_unlock(&mic_mutex);
      return 0;
  }
  
- // Stop recording audio
- int Microphone_stopRecording(void) {
-    //  pthread_mutex_lock(&mic_mutex);
-    //  if (!recording_active) {
-    //      pthread_mutex_unlock(&mic_mutex);
-    //      return -1;
-    //  }
-     
-    //  recording_active = 0;
-    //  pthread_mutex_unlock(&mic_mutex);
-     
-    //  // Wait for recording thread to finish
-    //  pthread_join(record_thread, NULL);
-    pthread_cancel(record_thread);
-     
+ // Takes the recording thread over from the module and waits for it to return
+ static int join_record_thread(bool stop) {
+     pthread_mutex_lock(&mic_mutex);
+     if (!record_thread_valid) {
+         pthread_mutex_unlock(&mic_mutex);
+         return -1;
+     }
+     pthread_t thread = record_thread;
+     record_thread_valid = false;
+     if (stop && recording_active) {
+         atomic_store(&stop_requested, 1);
+     }
+     pthread_mutex_unlock(&mic_mutex);
+     pthread_join(thread, NULL);
      return 0;
  }
  
+ // Start recording audio
+ int Microphone_startRecording(void) {
+     return start_record_thread(0);
+ }
+ 
+ // Stop recording audio. The thread sees the flag within one VAD read; if it is already
+ // handling the utterance, this waits for that to finish.
+ int Microphone_stopRecording(void) {
+     return join_record_thread(true);
+ }
+ 
  // Check if currently recording
  bool Microphone_isRecording(void) {
      pthread_mutex_lock(&mic_mutex);
@@ -508,74 +502,24 @@ static void *button_listener(void *arg) {
  
  // Transcribe the last recording and return the result
  char* Microphone_transcribe(void) {
-     // Clear previous result
      memset(transcription_result, 0, sizeof(transcription_result));
      
-     // Prepare full audio file path
-     char audio_path[512];
-     snprintf(audio_path, sizeof(audio_path), "%s/%s", output_folder, output_filename);
-     
-     // Check if audio file exists
-     if (access(audio_path, F_OK) == -1) {
-         printf("Error: No audio file found at %s. Recording may have failed.\n", audio_path);
-         return NULL;
-     }
-     
-    //  printf("Transcribing audio from %s...\n", audio_path);
-     
-     // Check if the Python script exists in the current directory
-     if (access("my_speech.py", F_OK) == -1) {
-         printf("Error: my_speech.py not found in the current directory.\n");
+     if (recording_length == 0) {
+         printf("Error: No audio captured. Recording may have failed.\n");
          return NULL;
      }
      
-     // Run the Python script with the audio file path - with more space for command
-     char cmd[2048];  // Larger buffer to avoid truncation warnings
-     snprintf(cmd, sizeof(cmd), "python3 ./my_speech.py %s", audio_path);
-     
-     char *output = read_command_output(cmd);
-     if (!output) {
-         printf("Error: Failed to run speech recognition.\n");
+     // Run the whole recording through the recognizer in one go
+     if (recognizer->begin(recording_rate) != 0) {
+         printf("Error: Failed to start speech recognition.\n");
          return NULL;
      }
-     
-     // Prepare full transcription output path
-     char transcription_path[512];
-     snprintf(transcription_path, sizeof(transcription_path), "%s/%s", output_folder, transcription_filename);
-     
-     // Store the raw output as the transcription result
-     if (output && strlen(output) > 0) {
-         // Strip newlines and limit length
-         char *newline = strchr(output, '\n');
-         if (newline) *newline = '\0';
-         
-         if (strlen(output) < sizeof(transcription_result) - 1) {
-             strcpy(transcription_result, output);
-             
-             // Save transcription to file
-             FILE *transcription_file = fopen(transcription_path, "w");
-             if (transcription_file) {
-                 fprintf(transcription_file, "%s", transcription_result);
-                 fclose(transcription_file);
-                //  printf("Transcription saved to %s\n", transcription_path);
-             } else {
-                 perror("Failed to save transcription to file");
-             }
-             
-             free(output);
-             
-             // Call the callback if registered
-             if (transcription_callback) {
-                 transcription_callback(transcription_result);
-             }
-             
-             return transcription_result;
-         }
+     recognizer->feed(recording_samples, recording_length);
+     char *result = store_transcription(recognizer->finish());
+     if (!result) {
+         printf("Error: Failed to parse transcription result.\n");
      }
-     
-     free(output);
-     printf("Error: Failed to parse transcription result.\n");
-     return NULL;
+     return result;
  }
  
  // Convenience function: record for specified duration and return transcription
@@ -584,30 +528,12 @@ static void *button_listener(void *arg) {
      
      if (durationMs > 0) {
          // For timed recording
-         int *duration_arg = malloc(sizeof(int));
-         if (!duration_arg) {
-             perror("malloc");
-             return NULL;
-         }
-         
-         *duration_arg = durationMs;
-         
-         pthread_mutex_lock(&mic_mutex);
-         recording_active = 1;
-         consecutive_silent_frames = 0;
-         pthread_mutex_unlock(&mic_mutex);
-         
-         if (pthread_create(&record_thread, NULL, record_audio, duration_arg) != 0) {
-             perror("pthread_create");
-             free(duration_arg);
-             pthread_mutex_lock(&mic_mutex);
-             recording_active = 0;
-             pthread_mutex_unlock(&mic_mutex);
+         if (start_record_thread(durationMs) != 0) {
              return NULL;
          }
          
          // Wait for recording to complete
-         pthread_join(record_thread, NULL);
+         join_record_thread(false);
      } else {
          // For manual stop recording
          if (Microphone_startRecording() != 0) {
@@ -624,7 +550,7 @@ static void *button_listener(void *arg) {
      return Microphone_transcribe();
  }
  
- // Start the listener thread that monitors for rotary button presses
+ // Start reacting to rotary button presses
  int Microphone_startButtonListener(void) {
      pthread_mutex_lock(&mic_mutex);
      if (listener_active) {
@@ -636,21 +562,33 @@ static void *button_listener(void *arg) {
      listener_active = 1;
      pthread_mutex_unlock(&mic_mutex);
      
-     // Create thread to handle button monitoring
-     if (pthread_create(&button_listener_thread, NULL, button_listener, NULL) != 0) {
-         perror("pthread_create");
-         pthread_mutex_lock(&mic_mutex);
-         listener_active = 0;
-         pthread_mutex_unlock(&mic_mutex);
+     RotaryState_setPushCallback(on_rotary_push);
+     return 0;
+ }
+ 
+ // Stop reacting to button presses
+ void Microphone_stopButtonListener(void) {
+     RotaryState_setPushCallback(NULL);
+     listener_active = 0;
+ }
+ 
+ // Start hands-free activation: the wake word triggers the same recording as the button
+ int Microphone_startWakeWordListener(void) {
+     if (wake_word_active) {
+         return 0;
+     }
+     if (WakeWord_init(on_wake_word) != 0) {
          return -1;
      }
-     
+     wake_word_active = 1;
      return 0;
  }
  
- // Stop the listener thread
- void Microphone_stopButtonListener(void) {
-     pthread_cancel(button_listener_thread);
+ void Microphone_stopWakeWordListener(void) {
+     if (wake_word_active) {
+         WakeWord_cleanup();
+         wake_word_active = 0;
+     }
  }
  
  // Register a callback function to be called when speech recognition completes
@@ -661,6 +599,6 @@ static void *button_listener(void *arg) {
  // Update the sound threshold for detection
  void Microphone_setSoundThreshold(int threshold) {
      if (threshold > 0) {
-         *((int*)&SOUND_THRESHOLD) = threshold;
+         sound_threshold = threshold;
      }
  }
\ No newline at end of file
@@ -0,0 +1,128 @@
+/**
+ * hal/noise_suppressor.c
+ *
+ * Implementation of the spectral subtraction stage. The noise estimate falls quickly
+ * to quieter bins and rises slowly, so it follows the background between words without
+ * learning speech. The gain is floored so residual noise stays smooth instead of
+ * turning into "musical" tones.
+ */
+
+#include "hal/noise_suppressor.h"
+
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define NS_BINS (NOISE_SUPPRESSOR_FRAME / 2 + 1)
+#define NS_SEED_FRAMES 8                // Frames averaged to seed the noise estimate
+#define NS_OVERSUBTRACT 2.0f
+#define NS_GAIN_FLOOR 0.1f
+#define NS_SMOOTHING 0.7f               // Per-bin power is smoothed over frames before tracking
+#define NS_NOISE_FALL 0.10f
+#define NS_NOISE_RISE 0.01f
+#define NS_NOISE_BIAS 1.5f              // Tracking leans toward the minimum; scale back up to the mean
+
+int NoiseSuppressor_init(struct NoiseSuppressor *ns) {
+    memset(ns, 0, sizeof(*ns));
+    if (Fft_init(&ns->fft, NOISE_SUPPRESSOR_FRAME) != 0) {
+        return -1;
+    }
+    // Periodic sqrt-Hann on analysis and synthesis sums to one at 50% overlap
+    for (int i = 0; i < NOISE_SUPPRESSOR_FRAME; i++) {
+        ns->window[i] = (float)sqrt(0.5 - 0.5 * cos(2 * M_PI * i / NOISE_SUPPRESSOR_FRAME));
+    }
+    return 0;
+}
+
+void NoiseSuppressor_destroy(struct NoiseSuppressor *ns) {
+    Fft_destroy(&ns->fft);
+}
+
+static void update_noise(struct NoiseSuppressor *ns) {
+    if (ns->framesSeen < NS_SEED_FRAMES) {
+        for (int k = 0; k < NS_BINS; k++) {
+            ns->noise[k] += ns->power[k] / NS_SEED_FRAMES;
+            ns->smoothed[k] = ns->noise[k] * NS_SEED_FRAMES / (ns->framesSeen + 1);
+        }
+        ns->framesSeen++;
+        return;
+    }
+    for (int k = 0; k < NS_BINS; k++) {
+        ns->smoothed[k] = NS_SMOOTHING * ns->smoothed[k] + (1.0f - NS_SMOOTHING) * ns->power[k];
+        float rate = ns->smoothed[k] < ns->noise[k] ? NS_NOISE_FALL : NS_NOISE_RISE;
+        ns->noise[k] += rate * (ns->smoothed[k] - ns->noise[k]);
+    }
+}
+
+// Analyses ns->input, applies the gains and overlap-adds one hop of output into out
+static void process_frame(struct NoiseSuppressor *ns, float *out) {
+    const int n = NOISE_SUPPRESSOR_FRAME;
+    int i = 0;
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(ns->re + i, vmulq_f32(vld1q_f32(ns->input + i), vld1q_f32(ns->window + i)));
+    }
+#endif
+    for (; i < n; i++) {
+        ns->re[i] = ns->input[i] * ns->window[i];
+    }
+    Fft_powerSpectrum(&ns->fft, ns->re, ns->im, ns->power);
+    update_noise(ns);
+
+    for (int k = 0; k < NS_BINS; k++) {
+        float gain = 1.0f;
+        if (ns->framesSeen >= NS_SEED_FRAMES) {
+            float snr = ns->power[k] > 0 ? 1.0f - NS_OVERSUBTRACT * NS_NOISE_BIAS * ns->noise[k] / ns->power[k] : 0.0f;
+            gain = snr > NS_GAIN_FLOOR * NS_GAIN_FLOOR ? sqrtf(snr) : NS_GAIN_FLOOR;
+        }
+        ns->re[k] *= gain;
+        ns->im[k] *= gain;
+        if (k > 0 && k < n / 2) {
+            ns->re[n - k] *= gain;
+            ns->im[n - k] *= gain;
+        }
+    }
+
+    // Inverse FFT as the conjugate of the forward transform of the conjugate
+    for (i = 0; i < n; i++) {
+        ns->im[i] = -ns->im[i];
+    }
+    Fft_transform(&ns->fft, ns->re, ns->im);
+    float scale = 1.0f / n;
+    for (i = 0; i < NOISE_SUPPRESSOR_HOP; i++) {
+        out[i] = ns->overlap[i] + ns->re[i] * scale * ns->window[i];
+        ns->overlap[i] = ns->re[i + NOISE_SUPPRESSOR_HOP] * scale * ns->window[i + NOISE_SUPPRESSOR_HOP];
+    }
+}
+
+size_t NoiseSuppressor_process(struct NoiseSuppressor *ns, const int16_t *in, size_t count, int16_t *out) {
+    const size_t hop = NOISE_SUPPRESSOR_HOP;
+    float block[NOISE_SUPPRESSOR_HOP];
+    size_t produced = 0;
+    while (count > 0) {
+        size_t take = hop - ns->pending;
+        if (take > count) {
+            take = count;
+        }
+        for (size_t i = 0; i < take; i++) {
+            ns->input[hop + ns->pending + i] = in[i];
+        }
+        ns->pending += take;
+        in += take;
+        count -= take;
+        if (ns->pending < hop) {
+            break;
+        }
+        process_frame(ns, block);
+        for (size_t i = 0; i < hop; i++) {
+            float v = block[i];
+            out[produced++] = v > 32767.0f ? 32767 : v < -32768.0f ? -32768 : (int16_t)lrintf(v);
+        }
+        memmove(ns->input, ns->input + hop, hop * sizeof(float));
+        ns->pending = 0;
+    }
+    return produced;
+}
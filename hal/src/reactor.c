@@ -0,0 +1,283 @@
+/**
+ * hal/reactor.c
+ *
+ * Sources live in a small fixed table; the epoll data of each registration carries the
+ * table index and a generation count, so an event that was already returned by
+ * epoll_wait for a source removed in the meantime is dropped instead of reaching the
+ * wrong handler. Once a minute the loop logs its own context switches and CPU time next
+ * to the whole process's, which shows what the remaining threads still cost.
+ */
+
+#define _GNU_SOURCE             // RUSAGE_THREAD
+
+#include "hal/reactor.h"
+#include "threadConfig.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/resource.h>
+
+#define REACTOR_MAX_SOURCES 16
+#define REACTOR_MAX_EVENTS 16
+#define REACTOR_STATS_PERIOD_MS 60000
+
+struct source {
+    bool active;
+    bool isTimer;
+    uint32_t generation;
+    int fd;
+    ReactorFdHandler fdHandler;
+    ReactorTimerHandler timerHandler;
+    void *context;
+};
+
+static struct source sources[REACTOR_MAX_SOURCES];
+static pthread_mutex_t sourcesMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int epollFd = -1;
+static int wakeFd = -1;
+static pthread_t reactorThread;
+static volatile bool isRunning = false;
+static bool isInitialized = false;
+
+static ReactorStats stats;
+static pthread_mutex_t statsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static double timeval_ms(struct timeval tv) {
+    return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// Must run on the reactor thread: RUSAGE_THREAD describes the caller
+static void refresh_usage(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_THREAD, &usage) != 0) {
+        return;
+    }
+    pthread_mutex_lock(&statsMutex);
+    stats.voluntarySwitches = usage.ru_nvcsw;
+    stats.involuntarySwitches = usage.ru_nivcsw;
+    stats.cpuMs = timeval_ms(usage.ru_utime) + timeval_ms(usage.ru_stime);
+    pthread_mutex_unlock(&statsMutex);
+}
+
+static void log_usage(uint64_t expirations, void *context) {
+    (void)expirations;
+    (void)context;
+    refresh_usage();
+    ReactorStats s = Reactor_getStats();
+    struct rusage process;
+    getrusage(RUSAGE_SELF, &process);
+    printf("Reactor: %llu wakeups, %llu dispatches, %ld/%ld ctx switches, %.1f ms CPU | "
+           "process: %ld/%ld ctx switches, %.1f ms CPU\n",
+           (unsigned long long)s.wakeups, (unsigned long long)s.dispatches,
+           s.voluntarySwitches, s.involuntarySwitches, s.cpuMs,
+           process.ru_nvcsw, process.ru_nivcsw,
+           timeval_ms(process.ru_utime) + timeval_ms(process.ru_stime));
+}
+
+static void dispatch(uint64_t data, uint32_t events) {
+    uint32_t index = (uint32_t)data;
+    uint32_t generation = (uint32_t)(data >> 32);
+
+    pthread_mutex_lock(&sourcesMutex);
+    struct source source = sources[index];
+    pthread_mutex_unlock(&sourcesMutex);
+    if (!source.active || source.generation != generation) {
+        return;
+    }
+
+    if (source.isTimer) {
+        uint64_t expirations = 0;
+        if (read(source.fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+            return;
+        }
+        source.timerHandler(expirations, source.context);
+    } else {
+        source.fdHandler(source.fd, events, source.context);
+    }
+    pthread_mutex_lock(&statsMutex);
+    stats.dispatches++;
+    pthread_mutex_unlock(&statsMutex);
+}
+
+static void *reactor_loop(void *arg) {
+    (void)arg;
+    struct epoll_event events[REACTOR_MAX_EVENTS];
+    while (isRunning) {
+        int count = epoll_wait(epollFd, events, REACTOR_MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("epoll_wait");
+            break;
+        }
+        pthread_mutex_lock(&statsMutex);
+        stats.wakeups++;
+        pthread_mutex_unlock(&statsMutex);
+
+        for (int i = 0; i < count && isRunning; i++) {
+            if (events[i].data.u64 == UINT64_MAX) {
+                continue;           // Shutdown wakeup
+            }
+            dispatch(events[i].data.u64, events[i].events);
+        }
+    }
+    refresh_usage();
+    return NULL;
+}
+
+// Claims a table slot and registers fd with epoll. Returns the index or -1.
+static int add_source(int fd, uint32_t events, bool isTimer, ReactorFdHandler fdHandler,
+                      ReactorTimerHandler timerHandler, void *context) {
+    pthread_mutex_lock(&sourcesMutex);
+    int index = -1;
+    for (int i = 0; i < REACTOR_MAX_SOURCES; i++) {
+        if (!sources[i].active) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        pthread_mutex_unlock(&sourcesMutex);
+        fprintf(stderr, "Reactor: no free source slot for fd %d\n", fd);
+        return -1;
+    }
+    struct source *source = &sources[index];
+    source->generation++;
+    source->fd = fd;
+    source->isTimer = isTimer;
+    source->fdHandler = fdHandler;
+    source->timerHandler = timerHandler;
+    source->context = context;
+    source->active = true;
+
+    struct epoll_event event = {
+        .events = events,
+        .data.u64 = ((uint64_t)source->generation << 32) | (uint32_t)index,
+    };
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        perror("epoll_ctl");
+        source->active = false;
+        index = -1;
+    }
+    pthread_mutex_unlock(&sourcesMutex);
+    return index;
+}
+
+// Unregisters slot index; returns its fd
+static int remove_source(int index) {
+    pthread_mutex_lock(&sourcesMutex);
+    int fd = sources[index].fd;
+    if (sources[index].active) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+        sources[index].active = false;
+    }
+    pthread_mutex_unlock(&sourcesMutex);
+    return fd;
+}
+
+void Reactor_init(void) {
+    assert(!isInitialized);
+    memset(sources, 0, sizeof(sources));
+    memset(&stats, 0, sizeof(stats));
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epollFd < 0 || wakeFd < 0) {
+        perror("Reactor init");
+        exit(EXIT_FAILURE);
+    }
+    struct epoll_event wake = {.events = EPOLLIN, .data.u64 = UINT64_MAX};
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &wake);
+
+    isRunning = true;
+    isInitialized = true;
+    Reactor_addTimer(REACTOR_STATS_PERIOD_MS, log_usage, NULL);
+    if (ThreadConfig_create(&reactorThread, "reactor", reactor_loop, NULL) != 0) {
+        perror("pthread_create");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void Reactor_cleanup(void) {
+    assert(isInitialized);
+    isRunning = false;
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) != sizeof(one)) {
+        perror("Reactor wakeup");
+    }
+    pthread_join(reactorThread, NULL);
+
+    ReactorStats s = Reactor_getStats();
+    printf("Reactor: %llu wakeups, %llu dispatches, %ld/%ld ctx switches, %.1f ms CPU\n",
+           (unsigned long long)s.wakeups, (unsigned long long)s.dispatches,
+           s.voluntarySwitches, s.involuntarySwitches, s.cpuMs);
+
+    // Timers belong to the reactor; device fds belong to their modules
+    for (int i = 0; i < REACTOR_MAX_SOURCES; i++) {
+        if (sources[i].active && sources[i].isTimer) {
+            close(sources[i].fd);
+        }
+        sources[i].active = false;
+    }
+    close(wakeFd);
+    close(epollFd);
+    wakeFd = -1;
+    epollFd = -1;
+    isInitialized = false;
+}
+
+int Reactor_addFd(int fd, uint32_t events, ReactorFdHandler handler, void *context) {
+    assert(isInitialized);
+    return add_source(fd, events, false, handler, NULL, context) < 0 ? -1 : 0;
+}
+
+int Reactor_addTimer(long periodMs, ReactorTimerHandler handler, void *context) {
+    assert(isInitialized);
+    int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (fd < 0) {
+        perror("timerfd_create");
+        return -1;
+    }
+    struct timespec period = {periodMs / 1000, (periodMs % 1000) * 1000000L};
+    struct itimerspec spec = {.it_interval = period, .it_value = period};
+    if (timerfd_settime(fd, 0, &spec, NULL) != 0) {
+        perror("timerfd_settime");
+        close(fd);
+        return -1;
+    }
+    int index = add_source(fd, EPOLLIN, true, NULL, handler, context);
+    if (index < 0) {
+        close(fd);
+    }
+    return index;
+}
+
+void Reactor_removeTimer(int timerId) {
+    assert(isInitialized);
+    if (timerId < 0 || timerId >= REACTOR_MAX_SOURCES || !sources[timerId].isTimer) {
+        return;
+    }
+    pthread_mutex_lock(&sourcesMutex);
+    bool active = sources[timerId].active;
+    pthread_mutex_unlock(&sourcesMutex);
+    if (active) {
+        close(remove_source(timerId));
+    }
+}
+
+ReactorStats Reactor_getStats(void) {
+    pthread_mutex_lock(&statsMutex);
+    ReactorStats s = stats;
+    pthread_mutex_unlock(&statsMutex);
+    return s;
+}
@@ -0,0 +1,129 @@
+/**
+ * hal/resampler.c
+ *
+ * The prototype low-pass is a Blackman-windowed sinc at the up-sampled rate with its
+ * cutoff just under the lower of the two Nyquist frequencies. Output sample n lies at
+ * up-sampled time n * down; its phase picks one row of taps and its integer part picks
+ * the newest input sample of the dot product.
+ */
+
+#include "hal/resampler.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define RESAMPLER_CUTOFF_RATIO 0.92     // Cutoff as a fraction of the lower Nyquist frequency
+
+static unsigned int gcd(unsigned int a, unsigned int b) {
+    while (b != 0) {
+        unsigned int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static void design_filter(struct Resampler *r, unsigned int inRate, unsigned int outRate) {
+    size_t taps = RESAMPLER_TAPS_PER_PHASE;
+    size_t length = (size_t)r->up * taps;
+    double nyquist = (inRate < outRate ? inRate : outRate) / 2.0;
+    // Cutoff normalized to the up-sampled rate, in cycles per sample
+    double fc = RESAMPLER_CUTOFF_RATIO * nyquist / ((double)inRate * r->up);
+    double center = (length - 1) / 2.0;
+
+    for (size_t i = 0; i < length; i++) {
+        double x = i - center;
+        double sinc = x == 0 ? 2 * fc : sin(2 * M_PI * fc * x) / (M_PI * x);
+        double w = 0.42 - 0.5 * cos(2 * M_PI * i / (length - 1)) + 0.08 * cos(4 * M_PI * i / (length - 1));
+        // Tap i belongs to phase i % up, position i / up; store each phase reversed so the
+        // dot product runs forward over the input history
+        size_t phase = i % r->up;
+        size_t k = i / r->up;
+        r->coeffs[phase * taps + (taps - 1 - k)] = (float)(sinc * w * r->up);
+    }
+}
+
+int Resampler_init(struct Resampler *r, unsigned int inRate, unsigned int outRate) {
+    memset(r, 0, sizeof(*r));
+    unsigned int g = gcd(inRate, outRate);
+    r->up = outRate / g;
+    r->down = inRate / g;
+    r->coeffs = malloc((size_t)r->up * RESAMPLER_TAPS_PER_PHASE * sizeof(float));
+    r->buffer = calloc(RESAMPLER_TAPS_PER_PHASE - 1 + RESAMPLER_MAX_BLOCK, sizeof(float));
+    if (!r->coeffs || !r->buffer) {
+        Resampler_destroy(r);
+        return -1;
+    }
+    design_filter(r, inRate, outRate);
+    return 0;
+}
+
+void Resampler_destroy(struct Resampler *r) {
+    free(r->coeffs);
+    free(r->buffer);
+    memset(r, 0, sizeof(*r));
+}
+
+size_t Resampler_maxOutput(const struct Resampler *r, size_t count) {
+    return (size_t)(((uint64_t)count * r->up) / r->down) + 1;
+}
+
+static float dot_f32(const float *a, const float *b, size_t n) {
+    size_t i = 0;
+    float sum = 0;
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    float32x4_t acc0 = vdupq_n_f32(0);
+    float32x4_t acc1 = vdupq_n_f32(0);
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#endif
+    for (; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+static int16_t saturate(float value) {
+    if (value > 32767.0f) {
+        return 32767;
+    }
+    if (value < -32768.0f) {
+        return -32768;
+    }
+    return (int16_t)lrintf(value);
+}
+
+size_t Resampler_process(struct Resampler *r, const int16_t *in, size_t count, int16_t *out) {
+    const size_t history = RESAMPLER_TAPS_PER_PHASE - 1;
+    size_t produced = 0;
+    while (count > 0) {
+        size_t block = count < RESAMPLER_MAX_BLOCK ? count : RESAMPLER_MAX_BLOCK;
+        float *fresh = r->buffer + history;
+        for (size_t i = 0; i < block; i++) {
+            fresh[i] = in[i];
+        }
+
+        // Output whose newest input sample is fresh[j] uses buffer[j .. j + history]
+        uint64_t limit = (uint64_t)block * r->up;
+        while (r->position < limit) {
+            size_t j = (size_t)(r->position / r->up);
+            size_t phase = (size_t)(r->position % r->up);
+            out[produced++] = saturate(dot_f32(r->buffer + j, r->coeffs + phase * RESAMPLER_TAPS_PER_PHASE,
+                                               RESAMPLER_TAPS_PER_PHASE));
+            r->position += r->down;
+        }
+        r->position -= limit;
+        memmove(r->buffer, r->buffer + block, history * sizeof(float));
+        in += block;
+        count -= block;
+    }
+    return produced;
+}
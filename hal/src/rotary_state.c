@@ -7,6 +7,7 @@
 
  #include "hal/rotary_state.h"
  #include "hal/gpio.h"
+ #include "hal/reactor.h"
  
  #include <gpiod.h>
  #include <assert.h>
@@ -58,6 +59,12 @@
  static struct gpiod_line_bulk s_bulkLines;
  static bool bulkInitialized = false;
  
+ // Called on the reactor thread after each button release
+ static void (*pushCallback)(void) = NULL;
+ 
+ static void on_rotary_edge(int fd, uint32_t events, void *context);
+ static void on_push_edge(int fd, uint32_t events, void *context);
+ 
 
  struct stateEvent {
      struct state* pNextState;
@@ -73,6 +80,9 @@
  static void on_push_release(void)
  {
      pushCounter++;
+     if (pushCallback != NULL) {
+         pushCallback();
+     }
  }
  
  // Push button states
@@ -180,6 +190,14 @@
          // Read initial state
          lastRotaryState = readRotaryState();
          rotaryInitialized = true;
+         
+         // Both lines are watched by the reactor instead of being polled
+         int fdA = gpiod_line_event_get_fd((struct gpiod_line*)s_lineA);
+         int fdB = gpiod_line_event_get_fd((struct gpiod_line*)s_lineB);
+         if (fdA < 0 || Reactor_addFd(fdA, EPOLLIN, on_rotary_edge, s_lineA) != 0 ||
+             fdB < 0 || Reactor_addFd(fdB, EPOLLIN, on_rotary_edge, s_lineB) != 0) {
+             fprintf(stderr, "Rotary encoder events unavailable\n");
+         }
      }
      
      // Initialize push button
@@ -191,13 +209,17 @@
          s_lineBtn = Gpio_openForEvents(PUSH_GPIO_CHIP, PUSH_GPIO_LINE);
          if (s_lineBtn) {
              pushInitialized = true;
+             int fd = Gpio_requestEvents(s_lineBtn, "rotary-push");
+             if (fd < 0 || Reactor_addFd(fd, EPOLLIN, on_push_edge, NULL) != 0) {
+                 fprintf(stderr, "Push button events unavailable\n");
+             }
          } else {
              fprintf(stderr, "Failed to open GPIO pin %d for push button\n", PUSH_GPIO_LINE);
          }
      }
  }
  
- // Clean up all resources
+ // Clean up all resources; call after Reactor_cleanup(), which stops the handlers
  void RotaryState_cleanup(void) {
      // Clean up rotary encoder
      if (rotaryInitialized) {
@@ -229,29 +251,16 @@
      }
  }
  
- void RotaryState_doRotaryState(void) {
-     if (!rotaryInitialized) {
-         return;
-     }
-     
+ // Called on the reactor thread when an A or B edge is waiting (context is the line)
+ static void on_rotary_edge(int fd, uint32_t events, void *context) {
+     (void)fd;
+     (void)events;
      static struct timespec lastEventTime = {0, 0};
      static int lastDir = 0; 
      static int sameDirectionCount = 0;  
      
-     // Wait for events on either line
-     struct gpiod_line_bulk eventBulk;
-     gpiod_line_bulk_init(&eventBulk);
-     
-     // Set up a zero timeout for non-blocking operation
-     struct timespec timeout = {0, 0};
-     
-     int ret = gpiod_line_event_wait_bulk(&s_bulkLines, &timeout, &eventBulk);
-     
-     if (ret <= 0) {
-         // No events or error
-         if (ret < 0 && ret != -ETIMEDOUT) {
-             perror("Error waiting for events");
-         }
+     bool isRising = false;
+     if (Gpio_readEvent(context, &isRising) != 0) {
          return;
      }
      
@@ -259,98 +268,78 @@
      struct timespec now;
      clock_gettime(CLOCK_MONOTONIC, &now);
      
-     // Check all events
-     for (unsigned int i = 0; i < gpiod_line_bulk_num_lines(&eventBulk); i++) {
-         struct gpiod_line* changedLine = gpiod_line_bulk_get_line(&eventBulk, i);
-         struct gpiod_line_event ev;
-         
-         if (gpiod_line_event_read(changedLine, &ev) < 0) {
-             continue;
-         }
-         
-         // Debounce: skip if event is too close to the previous one
-         long diffNs = (now.tv_sec - lastEventTime.tv_sec) * 1000000000L + 
-                      (now.tv_nsec - lastEventTime.tv_nsec);
-         
-         if (diffNs < DEBOUNCE_NS) {
-             continue;
-         }
-         
-         lastEventTime = now;
-         
-         // Read the current state
-         int currentState = readRotaryState();
-         
-         // Skip if no actual change in state
-         if (currentState == lastRotaryState || lastRotaryState == -1) {
-             lastRotaryState = currentState;
-             continue;
-         }
-         
-         // Detect direction using helper function
-         int direction = detectDirection(lastRotaryState, currentState);
-         
+     // Debounce: skip if event is too close to the previous one
+     long diffNs = (now.tv_sec - lastEventTime.tv_sec) * 1000000000L + 
+                  (now.tv_nsec - lastEventTime.tv_nsec);
+     
+     if (diffNs < DEBOUNCE_NS) {
+         return;
+     }
+     
+     lastEventTime = now;
+     
+     // Read the current state
+     int currentState = readRotaryState();
+     
+     // Skip if no actual change in state
+     if (currentState == lastRotaryState || lastRotaryState == -1) {
          lastRotaryState = currentState;
+         return;
+     }
+     
+     // Detect direction using helper function
+     int direction = detectDirection(lastRotaryState, currentState);
+     
+     lastRotaryState = currentState;
+     
+     // If the direction matches the previous direction, increase confidence
+     if (direction != 0) {
+         if (direction == lastDir) {
+             sameDirectionCount++;
+         } else {
+             // Direction changed - reset counter and set new direction
+             lastDir = direction;
+             sameDirectionCount = 1;
+         }
          
-         // If the direction matches the previous direction, increase confidence
-         if (direction != 0) {
-             if (direction == lastDir) {
-                 sameDirectionCount++;
-             } else {
-                 // Direction changed - reset counter and set new direction
-                 lastDir = direction;
-                 sameDirectionCount = 1;
-             }
-             
-             // Only trigger when we have enough confidence that we are turning
-             if (sameDirectionCount >= 1) {
-                 if (direction == 1) {
-                     on_clockwise();
-                 } else if (direction == -1) {
-                     on_counterclockwise();
-                 }
+         // Only trigger when we have enough confidence that we are turning
+         if (sameDirectionCount >= 1) {
+             if (direction == 1) {
+                 on_clockwise();
+             } else if (direction == -1) {
+                 on_counterclockwise();
              }
          }
      }
  }
  
- // Process push button state
- void RotaryState_doPushState(void) {
-     if (!pushInitialized) {
+ // Called on the reactor thread when the push button line has an edge waiting
+ static void on_push_edge(int fd, uint32_t events, void *context) {
+     (void)fd;
+     (void)events;
+     (void)context;
+     bool isRising = false;
+     if (Gpio_readEvent(s_lineBtn, &isRising) != 0) {
          return;
      }
      
-     struct gpiod_line_bulk bulkEvents;
-     int numEvents = Gpio_waitForLineChange(s_lineBtn, &bulkEvents);
+     // Run the state machine
+     struct stateEvent* pStateEvent = NULL;
+     if (isRising) {
+         pStateEvent = &pCurrentPushState->rising;
+     } else {
+         pStateEvent = &pCurrentPushState->falling;
+     } 
      
-     // Iterate over the events
-     for (int i = 0; i < numEvents; i++) {
-         // Get the line handle for this event
-         struct gpiod_line* line_handle = gpiod_line_bulk_get_line(&bulkEvents, i);
-         
-         // Get the line event
-         struct gpiod_line_event event;
-         if (gpiod_line_event_read(line_handle, &event) == -1) {
-             perror("Line Event");
-             continue;
-         }
-         
-         // Run the state machine
-         bool isRising = event.event_type == GPIOD_LINE_EVENT_RISING_EDGE;
-         
-         struct stateEvent* pStateEvent = NULL;
-         if (isRising) {
-             pStateEvent = &pCurrentPushState->rising;
-         } else {
-             pStateEvent = &pCurrentPushState->falling;
-         } 
-         
-         // Do the action
-         if (pStateEvent->action != NULL) {
-             pStateEvent->action();
-         }
-         pCurrentPushState = pStateEvent->pNextState;
+     // Do the action
+     if (pStateEvent->action != NULL) {
+         pStateEvent->action();
      }
+     pCurrentPushState = pStateEvent->pNextState;
+ }
+ 
+ void RotaryState_setPushCallback(void (*callback)(void)) {
+     pushCallback = callback;
  }
  
  // Get the current rotation counter value
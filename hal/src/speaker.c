@@ -0,0 +1,92 @@
+/* speaker.c
+*  This file implements the speaker module. The ALSA playback device is opened once in
+*  Speaker_init() and reused for every call, so playing a cached prompt only costs the
+*  time to hand the samples to the driver.
+**/
+
+#include "hal/speaker.h"
+
+#include <alsa/asoundlib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <assert.h>
+
+#define SPEAKER_DEVICE "default"
+#define SPEAKER_LATENCY_US 50000 // Requested ALSA buffer latency
+
+static snd_pcm_t *pcm_handle = NULL;
+static unsigned int current_rate = 0;
+static bool isInitialized = false;
+static pthread_mutex_t speaker_mutex = PTHREAD_MUTEX_INITIALIZER; // Only one clip plays at a time
+
+void Speaker_init(void) {
+    assert(!isInitialized);
+    int err = snd_pcm_open(&pcm_handle, SPEAKER_DEVICE, SND_PCM_STREAM_PLAYBACK, 0);
+    if (err < 0) {
+        fprintf(stderr, "Speaker: unable to open playback device: %s\n", snd_strerror(err));
+        pcm_handle = NULL;
+    }
+    current_rate = 0;
+    isInitialized = true;
+}
+
+void Speaker_cleanup(void) {
+    assert(isInitialized);
+    pthread_mutex_lock(&speaker_mutex);
+    if (pcm_handle) {
+        snd_pcm_close(pcm_handle);
+        pcm_handle = NULL;
+    }
+    pthread_mutex_unlock(&speaker_mutex);
+    isInitialized = false;
+}
+
+// Reconfigure the device only when the sample rate of the clip changes
+static int configure_rate(unsigned int sampleRate) {
+    if (sampleRate == current_rate) {
+        return snd_pcm_prepare(pcm_handle);
+    }
+    int err = snd_pcm_set_params(pcm_handle, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED,
+                                 1, sampleRate, 1, SPEAKER_LATENCY_US);
+    if (err < 0) {
+        fprintf(stderr, "Speaker: unable to set %u Hz: %s\n", sampleRate, snd_strerror(err));
+        current_rate = 0;
+        return err;
+    }
+    current_rate = sampleRate;
+    return 0;
+}
+
+int Speaker_playPcm(const int16_t *samples, size_t numSamples, unsigned int sampleRate) {
+    assert(isInitialized);
+    if (!samples || numSamples == 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&speaker_mutex);
+    if (!pcm_handle || configure_rate(sampleRate) < 0) {
+        pthread_mutex_unlock(&speaker_mutex);
+        return -1;
+    }
+
+    size_t written = 0;
+    while (written < numSamples) {
+        snd_pcm_sframes_t frames = snd_pcm_writei(pcm_handle, samples + written, numSamples - written);
+        if (frames < 0) {
+            // Underrun or suspend: try to recover and keep going
+            frames = snd_pcm_recover(pcm_handle, (int)frames, 1);
+            if (frames < 0) {
+                fprintf(stderr, "Speaker: write failed: %s\n", snd_strerror((int)frames));
+                pthread_mutex_unlock(&speaker_mutex);
+                return -1;
+            }
+            continue;
+        }
+        written += (size_t)frames;
+    }
+    snd_pcm_drain(pcm_handle);
+    pthread_mutex_unlock(&speaker_mutex);
+    return 0;
+}
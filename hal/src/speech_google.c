@@ -0,0 +1,188 @@
+/**
+ * hal/speech_google.c
+ *
+ * Google Speech Recognition backend. my_speech.py is launched when the utterance begins,
+ * so the interpreter and the speech_recognition import overlap with the user talking.
+ * Audio is FLAC-encoded in memory as it arrives and each finished frame is pushed to the
+ * script, which uploads the bytes as they are instead of converting a WAV itself. Anything
+ * the pipe cannot take yet stays in the encoder's buffer and is flushed later, so the
+ * capture consumer never blocks on a slow script.
+ */
+
+#define _GNU_SOURCE             // pipe2
+
+#include "hal/speech_recognizer.h"
+#include "hal/flac_encoder.h"
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+// About 10 s of 16 kHz speech at a typical 2:1 ratio; the encoder grows it if needed
+#define FLAC_INITIAL_BYTES (160 * 1024)
+
+static pid_t script_pid = -1;
+static int to_script = -1;
+static int from_script = -1;
+static struct FlacEncoder encoder;
+static bool encoder_ready = false;
+static size_t sent_bytes = 0;           // Encoded bytes already accepted by the pipe
+
+// Write as much of the encoded stream as the pipe accepts right now
+static void flush_pending(void) {
+    while (sent_bytes < encoder.size) {
+        ssize_t n = write(to_script, encoder.data + sent_bytes, encoder.size - sent_bytes);
+        if (n <= 0) {
+            break;
+        }
+        sent_bytes += (size_t)n;
+    }
+}
+
+static int google_begin(unsigned int sampleRate) {
+    if (access("my_speech.py", F_OK) == -1) {
+        printf("Error: my_speech.py not found in the current directory.\n");
+        return -1;
+    }
+    if (!encoder_ready) {
+        if (FlacEncoder_init(&encoder, FLAC_INITIAL_BYTES) != 0) {
+            perror("malloc");
+            return -1;
+        }
+        encoder_ready = true;
+    }
+    if (FlacEncoder_begin(&encoder, sampleRate) != 0) {
+        perror("realloc");
+        return -1;
+    }
+    sent_bytes = 0;
+    int inPipe[2];
+    int outPipe[2];
+    // Close-on-exec, so other children (the AI worker, espeak) never hold the script's stdin
+    // open; dup2() clears the flag on the script's own copies
+    if (pipe2(inPipe, O_CLOEXEC) < 0) {
+        perror("pipe");
+        return -1;
+    }
+    if (pipe2(outPipe, O_CLOEXEC) < 0) {
+        perror("pipe");
+        close(inPipe[0]);
+        close(inPipe[1]);
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        close(inPipe[0]);
+        close(inPipe[1]);
+        close(outPipe[0]);
+        close(outPipe[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        dup2(inPipe[0], STDIN_FILENO);
+        dup2(outPipe[1], STDOUT_FILENO);
+        close(inPipe[0]);
+        close(inPipe[1]);
+        close(outPipe[0]);
+        close(outPipe[1]);
+        char rate[16];
+        snprintf(rate, sizeof(rate), "%u", sampleRate);
+        execlp("python3", "python3", "./my_speech.py", "--flac", rate, "-", (char*)NULL);
+        perror("execlp failed");
+        exit(1);
+    }
+    close(inPipe[0]);
+    close(outPipe[1]);
+    to_script = inPipe[1];
+    from_script = outPipe[0];
+    script_pid = pid;
+
+    int flags = fcntl(to_script, F_GETFL, 0);
+    fcntl(to_script, F_SETFL, flags | O_NONBLOCK);
+    flush_pending();
+    return 0;
+}
+
+static void google_feed(const int16_t *samples, size_t count) {
+    if (to_script < 0) {
+        return;
+    }
+    if (FlacEncoder_feed(&encoder, samples, count) != 0) {
+        return;
+    }
+    flush_pending();
+}
+
+static void close_script(void) {
+    if (to_script >= 0) {
+        close(to_script);
+        to_script = -1;
+    }
+    if (from_script >= 0) {
+        close(from_script);
+        from_script = -1;
+    }
+    if (script_pid > 0) {
+        waitpid(script_pid, NULL, 0);
+        script_pid = -1;
+    }
+}
+
+static char *google_finish(void) {
+    if (to_script < 0) {
+        return NULL;
+    }
+    // Encode the last partial frame and send what is left with a blocking write,
+    // then EOF tells the script to upload
+    size_t total_bytes = 0;
+    FlacEncoder_finish(&encoder, &total_bytes);
+    int flags = fcntl(to_script, F_GETFL, 0);
+    fcntl(to_script, F_SETFL, flags & ~O_NONBLOCK);
+    flush_pending();
+    printf("Uploading %zu bytes of FLAC for %.1f s of audio\n", total_bytes,
+           (double)encoder.totalSamples / encoder.sampleRate);
+    close(to_script);
+    to_script = -1;
+
+    char *output = NULL;
+    size_t output_size = 0;
+    char buffer[1024];
+    ssize_t count;
+    while ((count = read(from_script, buffer, sizeof(buffer))) > 0) {
+        char *new_output = realloc(output, output_size + count + 1);
+        if (new_output == NULL) {
+            free(output);
+            output = NULL;
+            break;
+        }
+        output = new_output;
+        memcpy(output + output_size, buffer, count);
+        output_size += count;
+        output[output_size] = '\0';
+    }
+    close_script();
+    return output;
+}
+
+static void google_abort(void) {
+    if (script_pid > 0) {
+        kill(script_pid, SIGKILL);
+    }
+    close_script();
+    sent_bytes = 0;
+}
+
+const struct SpeechRecognizer SpeechRecognizer_google = {
+    .name = "google",
+    .begin = google_begin,
+    .feed = google_feed,
+    .finish = google_finish,
+    .abort = google_abort,
+};
@@ -0,0 +1,118 @@
+/**
+ * hal/speech_vosk.c
+ *
+ * Offline speech recognition with Vosk (Kaldi). The model is loaded once and every chunk
+ * is decoded as it arrives, so finishing an utterance only flushes the last few frames.
+ * Also picks the default engine for SpeechRecognizer_getDefault().
+ */
+
+#include "hal/speech_recognizer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#ifdef HAVE_VOSK
+#include <vosk_api.h>
+
+#define VOSK_DEFAULT_MODEL_PATH "vosk-model"
+
+static VoskModel *model = NULL;
+static VoskRecognizer *recognizer = NULL;
+
+static bool vosk_load_model(void) {
+    const char *path = getenv("VOSK_MODEL_PATH");
+    if (!path || path[0] == '\0') {
+        path = VOSK_DEFAULT_MODEL_PATH;
+    }
+    model = vosk_model_new(path);
+    if (!model) {
+        printf("Vosk model not found at %s, falling back to online recognition\n", path);
+        return false;
+    }
+    return true;
+}
+
+static int vosk_begin(unsigned int sampleRate) {
+    if (!model) {
+        return -1;
+    }
+    if (recognizer) {
+        vosk_recognizer_free(recognizer);
+    }
+    recognizer = vosk_recognizer_new(model, (float)sampleRate);
+    return recognizer ? 0 : -1;
+}
+
+static void vosk_feed(const int16_t *samples, size_t count) {
+    if (recognizer) {
+        vosk_recognizer_accept_waveform_s(recognizer, (const short *)samples, (int)count);
+    }
+}
+
+// Vosk returns {"text" : "..."}; pull out the string without a JSON library
+static char *extract_text(const char *json) {
+    const char *key = strstr(json, "\"text\"");
+    if (!key) {
+        return NULL;
+    }
+    const char *start = strchr(key + strlen("\"text\""), '"');
+    if (!start) {
+        return NULL;
+    }
+    start++;
+    const char *end = strchr(start, '"');
+    if (!end) {
+        return NULL;
+    }
+    return strndup(start, (size_t)(end - start));
+}
+
+static char *vosk_finish(void) {
+    if (!recognizer) {
+        return NULL;
+    }
+    char *text = extract_text(vosk_recognizer_final_result(recognizer));
+    vosk_recognizer_free(recognizer);
+    recognizer = NULL;
+    if (text && text[0] == '\0') {
+        free(text);
+        return strdup("Could not understand audio");
+    }
+    return text;
+}
+
+static void vosk_abort(void) {
+    if (recognizer) {
+        vosk_recognizer_free(recognizer);
+        recognizer = NULL;
+    }
+}
+
+const struct SpeechRecognizer SpeechRecognizer_vosk = {
+    .name = "vosk",
+    .begin = vosk_begin,
+    .feed = vosk_feed,
+    .finish = vosk_finish,
+    .abort = vosk_abort,
+};
+#endif // HAVE_VOSK
+
+static pthread_once_t select_once = PTHREAD_ONCE_INIT;
+static const struct SpeechRecognizer *default_engine = &SpeechRecognizer_google;
+
+static void select_engine(void) {
+#ifdef HAVE_VOSK
+    if (vosk_load_model()) {
+        default_engine = &SpeechRecognizer_vosk;
+    }
+#endif
+    printf("Speech recognition engine: %s\n", default_engine->name);
+}
+
+const struct SpeechRecognizer *SpeechRecognizer_getDefault(void) {
+    pthread_once(&select_once, select_engine);
+    return default_engine;
+}
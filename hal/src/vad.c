@@ -0,0 +1,231 @@
+/**
+ * hal/vad.c
+ *
+ * Implementation of the voice activity detector. The feature loop (sums of squares and
+ * zero crossings) is the only per-sample work, so it has a NEON path for the A53.
+ *
+ * The speech test uses pre-emphasized energy (x[n] - 0.95 x[n-1]), which is 20 dB down
+ * at 100 Hz but not at speech formants, so road rumble barely moves it. It is averaged
+ * over VAD_SMOOTH_FRAMES frames, because single 10 ms frames of rumble, or of what the
+ * noise suppressor leaves of it, jump well above their average.
+ */
+
+#include "hal/vad.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define VAD_FRAME_MS 10
+#define VAD_ONSET_MS 50
+#define VAD_SEED_FRAMES 10              // Frames averaged to seed the noise floor
+#define VAD_HISTORY_FRAMES 200          // At most this much earlier audio seeds the floor (2 s)
+#define VAD_HISTORY_QUANTILE 0.25       // Share of the earlier frames quieter than the seeded floor
+#define VAD_EMPHASIS_NUM 19             // Pre-emphasis coefficient 0.95, as 19/20 in integers
+#define VAD_EMPHASIS_DEN 20
+
+// A frame is speech when its energy is this many times the noise floor...
+#define VAD_SPEECH_RATIO 3.0
+// ...and its zero-crossing rate is below this (broadband hiss and wind cross very often)
+#define VAD_MAX_ZCR 0.45
+// Frames this far above the floor count as speech regardless of ZCR (loud fricatives)
+#define VAD_STRONG_RATIO 12.0
+
+// Noise floor smoothing: fall faster than rise, and barely move during speech. Close enough
+// to symmetric that the floor sits near the mean noise energy, not its quietest frames.
+#define VAD_FLOOR_FALL 0.03
+#define VAD_FLOOR_RISE 0.01
+#define VAD_FLOOR_RISE_SPEECH 0.0005
+
+#define VAD_DEFAULT_MIN_LEVEL 50
+
+void Vad_init(struct Vad *vad, unsigned int sampleRate, int hangoverMs) {
+    memset(vad, 0, sizeof(*vad));
+    vad->frameSamples = sampleRate * VAD_FRAME_MS / 1000;
+    if (vad->frameSamples > VAD_MAX_FRAME_SAMPLES) {
+        vad->frameSamples = VAD_MAX_FRAME_SAMPLES;
+    }
+    vad->onsetFrames = VAD_ONSET_MS / VAD_FRAME_MS;
+    vad->hangoverFrames = hangoverMs / VAD_FRAME_MS;
+    Vad_setMinLevel(vad, VAD_DEFAULT_MIN_LEVEL);
+}
+
+void Vad_setMinLevel(struct Vad *vad, int level) {
+    vad->minEnergy = (double)level * level;
+}
+
+void Vad_frameFeatures(const int16_t *frame, size_t count, double *energy, double *emphasizedEnergy,
+                       double *zeroCrossRate) {
+    int64_t sumSquares = 0;
+    int64_t sumEmphasized = 0;          // Scaled by VAD_EMPHASIS_DEN squared
+    uint32_t crossings = 0;
+    size_t i = 0;
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    int64x2_t acc = vdupq_n_s64(0);
+    int64x2_t accEmphasized = vdupq_n_s64(0);
+    uint16x8_t cross = vdupq_n_u16(0);
+    // Compare each sample with its neighbour, so one extra sample must be readable
+    for (; i + 9 <= count; i += 8) {
+        int16x8_t a = vld1q_s16(frame + i);
+        int16x8_t b = vld1q_s16(frame + i + 1);
+        acc = vpadalq_s32(acc, vmull_s16(vget_low_s16(a), vget_low_s16(a)));
+        acc = vpadalq_s32(acc, vmull_s16(vget_high_s16(a), vget_high_s16(a)));
+        int32x4_t lo = vmlsl_n_s16(vmull_n_s16(vget_low_s16(b), VAD_EMPHASIS_DEN), vget_low_s16(a), VAD_EMPHASIS_NUM);
+        int32x4_t hi = vmlsl_n_s16(vmull_n_s16(vget_high_s16(b), VAD_EMPHASIS_DEN), vget_high_s16(a), VAD_EMPHASIS_NUM);
+        accEmphasized = vaddq_s64(accEmphasized, vmull_s32(vget_low_s32(lo), vget_low_s32(lo)));
+        accEmphasized = vaddq_s64(accEmphasized, vmull_s32(vget_high_s32(lo), vget_high_s32(lo)));
+        accEmphasized = vaddq_s64(accEmphasized, vmull_s32(vget_low_s32(hi), vget_low_s32(hi)));
+        accEmphasized = vaddq_s64(accEmphasized, vmull_s32(vget_high_s32(hi), vget_high_s32(hi)));
+        // Sign bit of a^b is set exactly when the pair crosses zero
+        cross = vaddq_u16(cross, vshrq_n_u16(vreinterpretq_u16_s16(veorq_s16(a, b)), 15));
+    }
+    sumSquares = vaddvq_s64(acc);
+    sumEmphasized = vaddvq_s64(accEmphasized);
+    crossings = vaddlvq_u16(cross);
+#endif
+
+    for (; i < count; i++) {
+        sumSquares += (int32_t)frame[i] * frame[i];
+        if (i + 1 < count) {
+            int64_t d = (int32_t)frame[i + 1] * VAD_EMPHASIS_DEN - (int32_t)frame[i] * VAD_EMPHASIS_NUM;
+            sumEmphasized += d * d;
+            if ((frame[i] ^ frame[i + 1]) < 0) {
+                crossings++;
+            }
+        }
+    }
+
+    *energy = count > 0 ? (double)sumSquares / count : 0.0;
+    *emphasizedEnergy = count > 1 ?
+        (double)sumEmphasized / (VAD_EMPHASIS_DEN * VAD_EMPHASIS_DEN) / (count - 1) : 0.0;
+    *zeroCrossRate = count > 1 ? (double)crossings / (count - 1) : 0.0;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+bool Vad_seedNoiseFloor(struct Vad *vad, const int16_t *samples, size_t count) {
+    size_t frames = count / vad->frameSamples;
+    if (frames > VAD_HISTORY_FRAMES) {
+        frames = VAD_HISTORY_FRAMES;
+    }
+    if (frames < VAD_SEED_FRAMES + VAD_SMOOTH_FRAMES) {
+        return false;
+    }
+    // Use the frames just before the recording
+    samples += count - frames * vad->frameSamples;
+
+    double energies[VAD_HISTORY_FRAMES];
+    double smoothed[VAD_HISTORY_FRAMES];
+    for (size_t f = 0; f < frames; f++) {
+        double level;
+        double zcr;
+        Vad_frameFeatures(samples + f * vad->frameSamples, vad->frameSamples, &level, &energies[f], &zcr);
+    }
+    // Same averaging as process_frame(), then a low quantile: the earlier audio may end in
+    // speech (the wake word), but the pauses around it still show the background
+    size_t smoothedCount = frames - VAD_SMOOTH_FRAMES + 1;
+    for (size_t f = 0; f < smoothedCount; f++) {
+        smoothed[f] = 0.0;
+        for (int i = 0; i < VAD_SMOOTH_FRAMES; i++) {
+            smoothed[f] += energies[f + i] / VAD_SMOOTH_FRAMES;
+        }
+    }
+    qsort(smoothed, smoothedCount, sizeof(double), compare_doubles);
+    vad->noiseFloor = smoothed[(size_t)(smoothedCount * VAD_HISTORY_QUANTILE)];
+    for (int i = 0; i < VAD_SMOOTH_FRAMES; i++) {
+        vad->recent[i] = vad->noiseFloor;
+    }
+    vad->framesSeen = VAD_SEED_FRAMES;
+    return true;
+}
+
+// Classify one full frame and update the state machine
+static VadEvent process_frame(struct Vad *vad, const int16_t *frame) {
+    double plainEnergy;
+    double frameEnergy;
+    double zcr;
+    Vad_frameFeatures(frame, vad->frameSamples, &plainEnergy, &frameEnergy, &zcr);
+
+    // Average the emphasized energy over the last VAD_SMOOTH_FRAMES frames
+    vad->recent[vad->framesSeen % VAD_SMOOTH_FRAMES] = frameEnergy;
+    vad->framesSeen++;
+    int frames = vad->framesSeen < VAD_SMOOTH_FRAMES ? vad->framesSeen : VAD_SMOOTH_FRAMES;
+    double energy = 0.0;
+    for (int i = 0; i < frames; i++) {
+        energy += vad->recent[i];
+    }
+    energy /= frames;
+
+    // Without earlier audio, seed the floor with the average of the first frames
+    if (vad->framesSeen <= VAD_SEED_FRAMES) {
+        vad->noiseFloor += energy / VAD_SEED_FRAMES;
+        return VAD_EVENT_NONE;
+    }
+
+    // The absolute gate is on the emphasized energy too: what the noise suppressor lets
+    // through of heavy rumble comes in bursts several times its average, but stays far below
+    // speech once the low end is taken out
+    double floor = vad->noiseFloor > 1.0 ? vad->noiseFloor : 1.0;
+    double ratio = energy / floor;
+    bool isSpeech = energy > vad->minEnergy &&
+                    ((ratio > VAD_SPEECH_RATIO && zcr < VAD_MAX_ZCR) || ratio > VAD_STRONG_RATIO);
+
+    if (energy < vad->noiseFloor) {
+        vad->noiseFloor += VAD_FLOOR_FALL * (energy - vad->noiseFloor);
+    } else {
+        double rise = isSpeech ? VAD_FLOOR_RISE_SPEECH : VAD_FLOOR_RISE;
+        vad->noiseFloor += rise * (energy - vad->noiseFloor);
+    }
+
+    if (isSpeech) {
+        vad->speechRun++;
+        vad->silenceRun = 0;
+        if (!vad->inSpeech && vad->speechRun >= vad->onsetFrames) {
+            vad->inSpeech = true;
+            return VAD_EVENT_SPEECH_START;
+        }
+    } else {
+        vad->speechRun = 0;
+        vad->silenceRun++;
+        if (vad->inSpeech && vad->silenceRun >= vad->hangoverFrames) {
+            vad->inSpeech = false;
+            return VAD_EVENT_SPEECH_END;
+        }
+    }
+    return VAD_EVENT_NONE;
+}
+
+VadEvent Vad_process(struct Vad *vad, const int16_t *samples, size_t count) {
+    VadEvent lastEvent = VAD_EVENT_NONE;
+    while (count > 0) {
+        size_t take = vad->frameSamples - vad->pendingCount;
+        if (take > count) {
+            take = count;
+        }
+        memcpy(vad->pending + vad->pendingCount, samples, take * sizeof(int16_t));
+        vad->pendingCount += take;
+        samples += take;
+        count -= take;
+
+        if (vad->pendingCount == vad->frameSamples) {
+            VadEvent event = process_frame(vad, vad->pending);
+            if (event != VAD_EVENT_NONE) {
+                lastEvent = event;
+            }
+            vad->pendingCount = 0;
+        }
+    }
+    return lastEvent;
+}
+
+bool Vad_isSpeech(const struct Vad *vad) {
+    return vad->inSpeech;
+}
@@ -0,0 +1,353 @@
+/**
+ * hal/wake_word.c
+ *
+ * Implementation of the keyword spotter. MFCC frames are normalized and quantized to int8
+ * as they arrive and kept in a circular window, so each evaluation is just the int8
+ * matrix-vector products of the network (NEON multiply-accumulate on the A53).
+ */
+
+#include "hal/wake_word.h"
+#include "hal/audio_dsp.h"
+#include "hal/mfcc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include <assert.h>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#define WAKE_WORD_DEFAULT_MODEL "wakeword.kws"
+#define WAKE_WORD_MAGIC "KWS1"
+#define MAX_LAYERS 4
+#define MAX_LAYER_WIDTH 1024
+#define EVAL_EVERY_FRAMES 3             // Run the network every 30 ms
+#define SMOOTHING_EVALS 4               // Average the score over the last 4 runs
+#define DETECT_THRESHOLD 0.85f
+#define REFRACTORY_FRAMES 200           // 2 s before the keyword can fire again
+#define READ_CHUNK_SAMPLES 320
+#define MAX_FRAMES_PER_READ 8
+#define STATS_REPORT_FRAMES 6000        // Report CPU use once a minute
+
+struct layer {
+    uint16_t inputs;
+    uint16_t outputs;
+    bool relu;
+    float weightScale;
+    float outputScale;
+    int32_t *bias;
+    int8_t *weights;
+};
+
+struct model {
+    int contextFrames;
+    int numLayers;
+    float mean[MFCC_NUM_COEFFS];
+    float invStd[MFCC_NUM_COEFFS];
+    float inputScale;
+    struct layer layers[MAX_LAYERS];
+};
+
+static struct model model;
+static struct Mfcc mfcc;
+static int8_t *window = NULL;           // contextFrames x MFCC_NUM_COEFFS, circular by frame
+static int windowHead = 0;              // Next frame slot to write
+static int framesInWindow = 0;
+
+static void (*wakeCallback)(void) = NULL;
+static pthread_t detectorThread;
+static volatile bool isRunning = false;
+static bool isInitialized = false;
+
+static pthread_mutex_t statsMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct WakeWordStats stats;
+static double totalCpuUs = 0;
+static double totalAudioUs = 0;
+
+static bool read_bytes(FILE *file, void *out, size_t size) {
+    return fread(out, 1, size, file) == size;
+}
+
+static void free_model(void) {
+    for (int i = 0; i < MAX_LAYERS; i++) {
+        free(model.layers[i].bias);
+        free(model.layers[i].weights);
+    }
+    memset(&model, 0, sizeof(model));
+}
+
+static bool load_model(const char *path) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        printf("Wake word model not found at %s, hands-free activation disabled\n", path);
+        return false;
+    }
+    memset(&model, 0, sizeof(model));
+    char magic[4];
+    uint16_t contextFrames, numCoeffs, numLayers;
+    bool ok = read_bytes(file, magic, sizeof(magic)) && memcmp(magic, WAKE_WORD_MAGIC, 4) == 0 &&
+              read_bytes(file, &contextFrames, 2) && read_bytes(file, &numCoeffs, 2) &&
+              read_bytes(file, &numLayers, 2) &&
+              contextFrames > 0 && numCoeffs == MFCC_NUM_COEFFS && numLayers > 0 && numLayers <= MAX_LAYERS &&
+              read_bytes(file, model.mean, sizeof(model.mean)) &&
+              read_bytes(file, model.invStd, sizeof(model.invStd)) &&
+              read_bytes(file, &model.inputScale, sizeof(float));
+    model.contextFrames = contextFrames;
+    model.numLayers = numLayers;
+
+    int expectedInputs = contextFrames * MFCC_NUM_COEFFS;
+    for (int i = 0; ok && i < numLayers; i++) {
+        struct layer *l = &model.layers[i];
+        uint8_t relu;
+        ok = read_bytes(file, &l->inputs, 2) && read_bytes(file, &l->outputs, 2) &&
+             read_bytes(file, &relu, 1) && read_bytes(file, &l->weightScale, sizeof(float)) &&
+             read_bytes(file, &l->outputScale, sizeof(float)) &&
+             l->inputs == expectedInputs && l->inputs <= MAX_LAYER_WIDTH &&
+             l->outputs > 0 && l->outputs <= MAX_LAYER_WIDTH;
+        if (!ok) {
+            break;
+        }
+        l->relu = relu != 0;
+        l->bias = malloc(l->outputs * sizeof(int32_t));
+        l->weights = malloc((size_t)l->outputs * l->inputs);
+        ok = l->bias && l->weights &&
+             read_bytes(file, l->bias, l->outputs * sizeof(int32_t)) &&
+             read_bytes(file, l->weights, (size_t)l->outputs * l->inputs);
+        expectedInputs = l->outputs;
+    }
+    ok = ok && model.layers[numLayers - 1].outputs == 2;
+    fclose(file);
+    if (!ok) {
+        printf("Wake word model %s is invalid, hands-free activation disabled\n", path);
+        free_model();
+    }
+    return ok;
+}
+
+static int8_t quantize(float value, float scale) {
+    float q = roundf(value / scale);
+    if (q > 127) {
+        return 127;
+    }
+    if (q < -128) {
+        return -128;
+    }
+    return (int8_t)q;
+}
+
+static int32_t dot_s8(const int8_t *a, const int8_t *b, size_t n) {
+    int32_t sum = 0;
+    size_t i = 0;
+#if defined(__ARM_NEON) && defined(__aarch64__)
+    int32x4_t acc = vdupq_n_s32(0);
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t va = vld1q_s8(a + i);
+        int8x16_t vb = vld1q_s8(b + i);
+        acc = vpadalq_s16(acc, vmull_s8(vget_low_s8(va), vget_low_s8(vb)));
+        acc = vpadalq_s16(acc, vmull_high_s8(va, vb));
+    }
+    sum = vaddvq_s32(acc);
+#endif
+    for (; i < n; i++) {
+        sum += (int32_t)a[i] * b[i];
+    }
+    return sum;
+}
+
+// Appends one MFCC frame to the window, normalized and quantized to the model's input scale
+static void push_frame(const float coeffs[MFCC_NUM_COEFFS]) {
+    int8_t *slot = window + (size_t)windowHead * MFCC_NUM_COEFFS;
+    for (int c = 0; c < MFCC_NUM_COEFFS; c++) {
+        slot[c] = quantize((coeffs[c] - model.mean[c]) * model.invStd[c], model.inputScale);
+    }
+    windowHead = (windowHead + 1) % model.contextFrames;
+    if (framesInWindow < model.contextFrames) {
+        framesInWindow++;
+    }
+}
+
+// Runs the network over the window and returns the keyword probability
+static float evaluate(void) {
+    static int8_t bufferA[MAX_LAYER_WIDTH];
+    static int8_t bufferB[MAX_LAYER_WIDTH];
+    size_t frameBytes = MFCC_NUM_COEFFS;
+
+    // Unroll the circular window oldest frame first
+    size_t tail = (size_t)(model.contextFrames - windowHead) * frameBytes;
+    memcpy(bufferA, window + (size_t)windowHead * frameBytes, tail);
+    memcpy(bufferA + tail, window, (size_t)windowHead * frameBytes);
+
+    int8_t *in = bufferA;
+    int8_t *out = bufferB;
+    float inScale = model.inputScale;
+    float logits[2] = {0, 0};
+    for (int i = 0; i < model.numLayers; i++) {
+        const struct layer *l = &model.layers[i];
+        bool last = i == model.numLayers - 1;
+        float scale = inScale * l->weightScale;
+        for (int o = 0; o < l->outputs; o++) {
+            int32_t acc = l->bias[o] + dot_s8(l->weights + (size_t)o * l->inputs, in, l->inputs);
+            float value = acc * scale;
+            if (l->relu && value < 0) {
+                value = 0;
+            }
+            if (last) {
+                logits[o] = value;
+            } else {
+                out[o] = quantize(value, l->outputScale);
+            }
+        }
+        inScale = l->outputScale;
+        int8_t *swap = in;
+        in = out;
+        out = swap;
+    }
+    return 1.0f / (1.0f + expf(logits[0] - logits[1]));
+}
+
+static double elapsed_us(const struct timespec *start, const struct timespec *end) {
+    return (end->tv_sec - start->tv_sec) * 1e6 + (end->tv_nsec - start->tv_nsec) / 1e3;
+}
+
+static void* detectorThreadFunc(void* arg) {
+    (void)arg;
+    struct AudioRingReader reader;
+    AudioRing_openReader(AudioDsp_getRing(), &reader);
+    double usPerSample = 1e6 / AudioDsp_getSampleRate();
+
+    int16_t buffer[READ_CHUNK_SAMPLES];
+    float coeffs[MAX_FRAMES_PER_READ][MFCC_NUM_COEFFS];
+    float scores[SMOOTHING_EVALS] = {0};
+    int scoreIndex = 0;
+    int framesSinceEval = 0;
+    int refractory = 0;
+    long nextReport = STATS_REPORT_FRAMES;
+
+    while (isRunning) {
+        size_t count = AudioRing_readWait(&reader, buffer, READ_CHUNK_SAMPLES, 100);
+        if (count == 0) {
+            continue;
+        }
+        struct timespec cpuStart, cpuEnd;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuStart);
+
+        bool detected = false;
+        int evaluations = 0;
+        int frames = Mfcc_process(&mfcc, buffer, count, coeffs, MAX_FRAMES_PER_READ);
+        for (int f = 0; f < frames; f++) {
+            push_frame(coeffs[f]);
+            if (refractory > 0) {
+                refractory--;
+            }
+            if (framesInWindow < model.contextFrames || ++framesSinceEval < EVAL_EVERY_FRAMES) {
+                continue;
+            }
+            framesSinceEval = 0;
+            evaluations++;
+            scores[scoreIndex] = evaluate();
+            scoreIndex = (scoreIndex + 1) % SMOOTHING_EVALS;
+            float smoothed = 0;
+            for (int i = 0; i < SMOOTHING_EVALS; i++) {
+                smoothed += scores[i];
+            }
+            smoothed /= SMOOTHING_EVALS;
+            if (smoothed >= DETECT_THRESHOLD && refractory == 0) {
+                detected = true;
+                refractory = REFRACTORY_FRAMES;
+                memset(scores, 0, sizeof(scores));
+            }
+        }
+
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuEnd);
+        double cpuUs = elapsed_us(&cpuStart, &cpuEnd);
+        pthread_mutex_lock(&statsMutex);
+        totalCpuUs += cpuUs;
+        totalAudioUs += count * usPerSample;
+        stats.frames += frames;
+        stats.evaluations += evaluations;
+        if (frames > 0) {
+            stats.avgFrameUs = totalCpuUs / stats.frames;
+            if (cpuUs / frames > stats.maxFrameUs) {
+                stats.maxFrameUs = cpuUs / frames;
+            }
+        }
+        stats.cpuPercent = 100.0 * totalCpuUs / totalAudioUs;
+        if (detected) {
+            stats.detections++;
+        }
+        struct WakeWordStats snapshot = stats;
+        pthread_mutex_unlock(&statsMutex);
+
+        if (snapshot.frames >= nextReport) {
+            nextReport += STATS_REPORT_FRAMES;
+            printf("Wake word: %.2f%% CPU (budget %.1f%%), %.1f us/frame avg, %.1f us max%s\n",
+                   snapshot.cpuPercent, WAKE_WORD_CPU_BUDGET_PERCENT, snapshot.avgFrameUs, snapshot.maxFrameUs,
+                   snapshot.cpuPercent > WAKE_WORD_CPU_BUDGET_PERCENT ? " - OVER BUDGET" : "");
+        }
+        if (detected && wakeCallback) {
+            wakeCallback();
+        }
+    }
+    return NULL;
+}
+
+int WakeWord_init(void (*onWake)(void)) {
+    assert(!isInitialized);
+    const char *path = getenv("WAKE_WORD_MODEL");
+    if (!path || path[0] == '\0') {
+        path = WAKE_WORD_DEFAULT_MODEL;
+    }
+    if (!load_model(path)) {
+        return -1;
+    }
+    window = calloc((size_t)model.contextFrames * MFCC_NUM_COEFFS, sizeof(int8_t));
+    if (!window || Mfcc_init(&mfcc, AudioDsp_getSampleRate()) != 0) {
+        perror("Wake word init");
+        free(window);
+        window = NULL;
+        free_model();
+        return -1;
+    }
+    windowHead = 0;
+    framesInWindow = 0;
+    memset(&stats, 0, sizeof(stats));
+    totalCpuUs = 0;
+    totalAudioUs = 0;
+    wakeCallback = onWake;
+    isRunning = true;
+    isInitialized = true;
+    if (pthread_create(&detectorThread, NULL, detectorThreadFunc, NULL) != 0) {
+        perror("Failed to create wake word thread");
+        exit(EXIT_FAILURE);
+    }
+    printf("Wake word detector running (%d frame context, %d layers)\n", model.contextFrames, model.numLayers);
+    return 0;
+}
+
+void WakeWord_cleanup(void) {
+    if (!isInitialized) {
+        return;
+    }
+    isRunning = false;
+    pthread_join(detectorThread, NULL);
+    Mfcc_destroy(&mfcc);
+    free(window);
+    window = NULL;
+    free_model();
+    wakeCallback = NULL;
+    isInitialized = false;
+}
+
+struct WakeWordStats WakeWord_getStats(void) {
+    pthread_mutex_lock(&statsMutex);
+    struct WakeWordStats result = stats;
+    pthread_mutex_unlock(&statsMutex);
+    return result;
+}